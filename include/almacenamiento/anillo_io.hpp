@@ -0,0 +1,61 @@
+#include <cstddef>
+#pragma once
+
+// Una lectura o escritura de un lote. exito lo llena quien ejecuta el lote.
+struct PeticionIO {
+    size_t offset;
+    char* buffer;
+    size_t bytes;
+    bool escritura;
+    bool exito;
+};
+
+// Envoltura minima de io_uring (Linux 5.1+) usando las llamadas al sistema directamente,
+// sin liburing. Permite mandar un lote de lecturas/escrituras de paginas de una sola vez y
+// tener muchas en vuelo en lugar de esperar una por una.
+//
+// Si el kernel no tiene io_uring (o esta bloqueado, por ejemplo por seccomp en contenedores)
+// abrir() devuelve false y quien lo usa debe seguir con pread/pwrite. En Windows siempre es asi.
+class AnilloIO {
+
+    private:
+
+        int anillo_fd;
+        unsigned entradas;
+
+        // Regiones mapeadas del anillo (cola de envio, cola de completados y arreglo de SQEs)
+        void* sq_mapa;
+        size_t sq_mapa_size;
+        void* cq_mapa;
+        size_t cq_mapa_size;
+        void* sqes;
+        size_t sqes_size;
+
+        // Punteros dentro de los mapas; los comparte el kernel
+        unsigned* sq_cabeza;
+        unsigned* sq_cola;
+        unsigned* sq_mascara;
+        unsigned* sq_arreglo;
+        unsigned* cq_cabeza;
+        unsigned* cq_cola;
+        unsigned* cq_mascara;
+        void* cqes;
+
+    public:
+
+        AnilloIO();
+        ~AnilloIO();
+
+        AnilloIO(const AnilloIO&) = delete;
+        AnilloIO& operator=(const AnilloIO&) = delete;
+
+        // profundidad: maximo de peticiones en vuelo a la vez
+        bool abrir(unsigned profundidad);
+        void cerrar();
+        bool activo() const;
+
+        // Ejecuta todas las peticiones sobre fd y espera a que terminen. Las lecturas o
+        // escrituras cortas se completan con pread/pwrite. Devuelve true si todas tuvieron exito.
+        bool ejecutar(int fd, PeticionIO* peticiones, size_t cantidad);
+
+};
@@ -0,0 +1,61 @@
+#include "almacenamiento/anillo_io.hpp"
+#include <string>
+#include <cstddef>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#pragma once
+
+// Acceso al archivo con lecturas y escrituras explicitas (pread/pwrite) en lugar de mmap.
+// Lo usa el buffer pool: asi somos nosotros, y no la cache del sistema operativo, quienes
+// deciden que paginas estan en memoria y cuando se escriben.
+class ArchivoDirecto {
+
+    private:
+
+        #ifdef _WIN32
+            HANDLE archivo_handle;
+        #else
+            int archivo_fd;
+        #endif
+
+        size_t size;
+        bool directo; // true si el archivo se abrio saltando la cache del SO (O_DIRECT / FILE_FLAG_NO_BUFFERING)
+        AnilloIO anillo; // Solo se usa para los lotes si activar_io_uring tuvo exito
+        AnilloIO anillo_segundo_plano; // El de los lotes de otro hilo: un anillo no se comparte entre hilos
+
+    public:
+
+        ArchivoDirecto();
+        ~ArchivoDirecto();
+
+        // Con io_directa intentamos abrir con O_DIRECT; si el sistema de archivos no lo soporta
+        // (tmpfs por ejemplo) se abre normal y esta_en_modo_directo() lo indica.
+        // En modo directo los buffers, offsets y tamaños deben estar alineados a PAGINA_SIZE.
+        bool abrir (const std::string& ruta, size_t initial_size, bool io_directa);
+        bool cerrar ();
+
+        bool leer (size_t offset, char* buffer, size_t bytes);
+        bool escribir (size_t offset, const char* buffer, size_t bytes);
+
+        // Intenta crear un anillo io_uring con esa profundidad para ejecutar_lote. Si el kernel
+        // no lo soporta devuelve false y los lotes se hacen con pread/pwrite uno por uno.
+        bool activar_io_uring (unsigned profundidad);
+
+        // Ejecuta un lote de lecturas/escrituras (con io_uring si esta activo) y espera a que
+        // terminen todas. Llena peticion.exito de cada una; devuelve true si todas tuvieron exito.
+        // Con segundo_plano usa otro anillo, para que un hilo aparte (el checkpoint) pueda mandar
+        // lotes mientras el buffer pool manda los suyos; cada anillo lo usa un hilo a la vez.
+        bool ejecutar_lote (PeticionIO* peticiones, size_t cantidad, bool segundo_plano = false);
+
+        bool redimensionar (size_t nuevo_size);
+
+        // Libera los bloques de disco del rango sin cambiar el tamaño (ver MapeoMemoria::perforar)
+        bool perforar (size_t offset, size_t longitud);
+        bool sincronizar ();
+
+        size_t get_size () const;
+        bool esta_en_modo_directo () const;
+        bool usa_io_uring () const;
+
+};
@@ -1,8 +1,45 @@
+#include <atomic>
 #include <string>
 #include <cstddef>
+#include <memory>
+#include <vector>
+#ifdef _WIN32
 #include <windows.h>
+#endif
 #pragma once
 
+// Pista que le damos al kernel sobre como vamos a recorrer el mapeo.
+// En Linux se traduce a madvise; en Windows se ignora.
+enum class PatronAcceso {
+    NORMAL,      // Readahead por defecto del kernel
+    ALEATORIO,   // MADV_RANDOM: busquedas puntuales en el B+ Tree, sin readahead
+    SECUENCIAL,  // MADV_SEQUENTIAL: recorridos completos (readahead agresivo)
+    PRECARGAR    // MADV_WILLNEED: calentar el rango antes de usarlo
+};
+
+struct OpcionesMapeo {
+    PatronAcceso patron = PatronAcceso::NORMAL;
+    bool pre_poblar = false; // MAP_POPULATE: cargar todas las paginas al mapear
+
+    // MAP_PRIVATE / FILE_MAP_COPY: lo que se escribe en el mapeo no llega al archivo hasta
+    // llamar a escribir(). Asi el sistema no baja al disco paginas a medio modificar (ver WAL).
+    bool copia_privada = false;
+
+    // Rango de direcciones virtuales que se reserva al abrir (solo POSIX). Los segmentos que
+    // caben en la reserva quedan contiguos; los que no, se mapean donde el sistema quiera.
+    // Reservar no consume RAM; 0 desactiva la reserva.
+    size_t reserva_bytes = sizeof(void*) >= 8 ? (size_t(1) << 40) : 0; // 1 TB en 64 bits
+
+    // Tamaño de cada segmento del mapeo. Se redondea a potencia de 2 y debe ser multiplo
+    // de la granularidad de mapeo del sistema (4KB en Linux, 64KB en Windows).
+    size_t size_segmento = size_t(64) << 20; // 64 MB
+};
+
+// Mapea el archivo por segmentos de tamaño fijo. Crecer solo agrega segmentos al final de
+// la tabla y nunca mueve los que ya existen, asi que un puntero obtenido con obtener_puntero
+// sigue siendo valido aunque el archivo crezca (hasta cerrar o achicar el archivo).
+// obtener_puntero se puede llamar desde otro hilo mientras el archivo crece, para offsets
+// que ya existian antes de crecer.
 class MapeoMemoria {
 
     private:
@@ -12,28 +49,85 @@ class MapeoMemoria {
         // Windows los maneja con HANDLES que es un puntero void* para rastrear a los archivos abiertos y en memoria
         #ifdef _WIN32
             HANDLE archivo_handle;
-            HANDLE mapeo_handle;
+            HANDLE mapeo_handle; // Cubre el archivo completo; al crecer se crea otro y las vistas viejas siguen validas
 
         // Linux lo maneja con un entero llamado file descriptor. Es el estandar "POSIX"
         #else
             int archivo_fd;
+            char* reserva;       // Inicio del rango virtual reservado (nullptr si no hay reserva)
+            size_t reserva_size;
         #endif
 
-        char* datos;
+        // segmentos[i] apunta al byte i * size_segmento del archivo
+        std::vector<char*> segmentos;
+
+        // Copia de segmentos que lee obtener_puntero. Cuando se llena se pasa a una del doble
+        // de tamaño y la anterior se libera recien al cerrar: otro hilo puede seguir leyendola.
+        std::atomic<char**> tabla;
+        size_t capacidad_tabla;
+        std::vector<std::unique_ptr<char*[]>> tablas;
+        size_t size_segmento;
+        unsigned bits_segmento; // log2(size_segmento), para dividir con un shift
+
         size_t size;
+        OpcionesMapeo opciones;
+
+        bool mapear_segmento(size_t indice);
+        void agregar_segmento(char* segmento);
+        void desmapear_segmento(size_t indice);
 
     public:
 
         MapeoMemoria();
         ~MapeoMemoria();
 
-        bool abrir (const std::string& ruta, size_t initial_size);
+        bool abrir (const std::string& ruta, size_t initial_size, const OpcionesMapeo& opciones = {});
 
         bool cerrar ();
 
+        // Cambia el tamaño del archivo. Crecer no invalida punteros; achicar invalida los
+        // punteros a la parte que se corta.
         bool redimensionar (size_t nuevo_size);
-        char* obtener_datos();
+
+        // Puntero al byte `offset` del archivo (offset < get_size()). Una pagina nunca cruza
+        // un limite de segmento porque size_segmento es multiplo de PAGINA_SIZE.
+        char* obtener_puntero (size_t offset) const {
+            return tabla.load(std::memory_order_acquire)[offset >> bits_segmento] + (offset & (size_segmento - 1));
+        }
 
         size_t get_size () const;
+        size_t get_size_reservado () const;
+        size_t get_num_segmentos () const;
+
+        // Aplica un patron de acceso a [offset, offset + longitud). Con longitud 0 se aplica a todo el mapeo.
+        bool aconsejar (PatronAcceso patron, size_t offset = 0, size_t longitud = 0);
+
+        // Copia [offset, offset + longitud) del mapeo al archivo. Con copia_privada es la unica
+        // manera de que los cambios lleguen al archivo; despues suelta las copias privadas del
+        // rango (en Linux), que se vuelven a leer del archivo la proxima vez que se toquen.
+        bool escribir (size_t offset, size_t longitud);
+
+        // Escribe buffer en [offset, offset + longitud) del archivo, sin pasar por el mapeo.
+        // Junto con sincronizar_archivo solo usa el descriptor, asi que se puede llamar desde
+        // otro hilo aunque el mapeo este creciendo (el rango debe existir en el archivo).
+        bool escribir_desde (size_t offset, const char* buffer, size_t longitud);
+        bool sincronizar_archivo ();
+
+        // Con copia_privada, suelta las copias privadas de [offset, offset + longitud) (solo
+        // Linux): el rango se vuelve a leer del archivo, que ya debe tener el mismo contenido
+        void soltar_copias (size_t offset, size_t longitud);
+
+        // Escribe al disco las paginas modificadas del mapeo (msync / FlushViewOfFile) y espera.
+        // Con copia_privada solo baja al disco lo que ya se paso al archivo con escribir().
+        bool sincronizar ();
+
+        // Como sincronizar() pero solo para [offset, offset + longitud), sin copia_privada.
+        // Con esperar en false solo se pide que empiece la escritura (sync_file_range en Linux,
+        // MS_ASYNC en otros POSIX) y no hay garantia de que el rango este en el disco al volver.
+        bool sincronizar_rango (size_t offset, size_t longitud, bool esperar = true);
+
+        // Libera los bloques de disco de [offset, offset + longitud) sin cambiar el tamaño del
+        // archivo (FALLOC_FL_PUNCH_HOLE / FSCTL_SET_ZERO_DATA). El rango se lee como ceros despues.
+        bool perforar (size_t offset, size_t longitud);
 
-};
\ No newline at end of file
+};
@@ -0,0 +1,132 @@
+#include "almacenamiento/archivo_directo.hpp"
+#include "almacenamiento/pagina.hpp"
+#include "almacenamiento/tabla_paginas.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#pragma once
+
+constexpr size_t INVALID_FRAME = SIZE_MAX;
+
+// Maximo de paginas sucias que se escriben juntas al desalojar
+constexpr size_t LOTE_ESCRITURA = 32;
+
+// Cuantas vueltas del reloj sobrevive una pagina sin volver a usarse
+constexpr uint8_t USO_MAXIMO = 3;
+
+struct EstadisticasBufferPool {
+    size_t num_frames;
+    size_t frames_fijados;
+    size_t frames_sucios;
+    size_t aciertos;       // fijar encontro la pagina en el pool
+    size_t fallos;         // fijar tuvo que leerla del disco
+    size_t lecturas;       // Paginas leidas del disco (fallos + precargadas)
+    size_t escrituras;     // Paginas escritas al disco (desalojos y vaciados)
+    size_t desalojos;
+    size_t lotes_io;       // Lotes enviados juntos al disco (ver ArchivoDirecto::ejecutar_lote)
+};
+
+// Pool de frames de tamaño fijo con paginas leidas via pread y escritas via pwrite.
+//
+// Reemplazo CLOCK con contador de uso (GCLOCK): cada acierto sube el contador del frame
+// (hasta USO_MAXIMO) y la manecilla, al buscar victima, baja el contador de los frames que
+// recorre y se queda con el primero que encuentra en 0. Una pagina que entra al pool empieza
+// en 0, asi un recorrido que toca cada pagina una sola vez no saca del pool a la raiz ni a
+// los nodos internos del arbol, que se usan en cada operacion.
+//
+// Toda la memoria (frames, tabla de paginas, lotes) se reserva al abrir: fijar y desfijar no
+// reservan nada.
+//
+// Las escrituras se agrupan: al desalojar una pagina sucia se escriben en el mismo lote las
+// otras paginas sucias que la manecilla va a visitar pronto, y vaciar() manda todas juntas.
+// Con io_uring el lote queda en vuelo a la vez en lugar de una escritura sincrona por pagina.
+class BufferPool {
+
+    private:
+
+        struct Frame {
+            PaginaID pagina_id;  // INVALID_PAGE_ID si el frame esta libre
+            uint32_t pines;      // Cuantas PaginaFijada apuntan a este frame; con pines > 0 no se desaloja
+            uint8_t uso;         // Contador del reloj
+            bool sucio;          // Modificado desde que se leyo del disco
+            bool precargado;     // Leido por precargar y todavia sin pedir: el primer fijar no cuenta como reuso
+            bool retenido;       // Su contenido todavia no llego al archivo aunque no este sucio (ver retener)
+        };
+
+        ArchivoDirecto* archivo;
+        char* memoria;                     // num_frames * size_pagina bytes alineados a PAGINA_SIZE
+        size_t size_pagina;                // Bytes por frame (ver OpcionesPaginador::size_pagina)
+        std::vector<Frame> frames;
+        TablaPaginas tabla_paginas;        // PaginaID -> frame
+        std::vector<size_t> libres;        // Frames que nunca se usaron o se liberaron
+        size_t manecilla;
+        size_t num_sucios;
+        bool desalojar_sucios;             // false: una pagina sucia no sale del pool hasta vaciar()
+
+        size_t aciertos;
+        size_t fallos;
+        size_t lecturas;
+        size_t escrituras;
+        size_t desalojos;
+        size_t lotes_io;
+
+        // Vectores reutilizados entre lotes para no reservar memoria cada vez
+        std::vector<size_t> lote_lectura;    // Frames a leer en precargar
+        std::vector<size_t> lote_escritura;  // Frames sucios a escribir
+        std::vector<PeticionIO> peticiones;  // peticiones[i] corresponde al frame lote[i] tras ejecutar_lote
+
+        size_t elegir_victima();
+        bool desalojar(size_t frame);
+        bool escribir_lote_sucios(size_t victima);
+        bool ejecutar_lote(std::vector<size_t>& lote, bool escritura);
+        void liberar_frame(size_t frame);
+
+    public:
+
+        BufferPool();
+        ~BufferPool();
+
+        // size_pagina: multiplo de PAGINA_SIZE
+        bool abrir(ArchivoDirecto& archivo, size_t num_frames, size_t size_pagina = PAGINA_SIZE);
+        bool cerrar();
+
+        // Avisar cuando el archivo crece (la tabla de paginas puede necesitar mas lugar)
+        void ajustar_paginas_archivo(size_t paginas_archivo);
+
+        // Fija la pagina en un frame (leyendola si no estaba) y devuelve su direccion.
+        // Devuelve nullptr si todos los frames estan fijados o si fallo la lectura.
+        char* fijar(PaginaID page_id, size_t& frame_out);
+        void desfijar(size_t frame);
+        void marcar_sucio(size_t frame);
+
+        // Lee en un solo lote las paginas que no esten en el pool, sin fijarlas (quedan con el
+        // contador de uso en 0). Pensado para recorridos que ya saben que hojas van a visitar.
+        // Se detiene si no quedan frames sin fijar; devuelve cuantas paginas leyo.
+        size_t precargar(const PaginaID* paginas, size_t cantidad);
+
+        // Saca paginas del pool sin escribirlas (paginas perforadas o cortadas del archivo).
+        // Las paginas fijadas se dejan como estan.
+        void descartar(PaginaID page_id);
+        void descartar_desde(PaginaID primera);
+
+        // Escribe todas las paginas sucias (no sincroniza el archivo)
+        bool vaciar();
+
+        // Con false las paginas sucias solo llegan al archivo con vaciar(), nunca al desalojar
+        // (politica "no-steal" que necesita el WAL). Quien lo apaga debe vaciar antes de que
+        // todos los frames queden sucios: fijar devuelve nullptr si no hay frame limpio.
+        void set_desalojar_sucios(bool permitir);
+
+        // La pagina deja de contar como sucia (los cambios siguientes la vuelven a ensuciar),
+        // pero no sale del pool hasta soltar_retenida: quien la retiene se encarga de llevar al
+        // archivo una copia de como estaba. Si la pagina no esta en el pool no hace nada.
+        void retener(PaginaID page_id);
+        // Con escrita en false (la copia no llego al archivo) la pagina vuelve a quedar sucia
+        void soltar_retenida(PaginaID page_id, bool escrita);
+        size_t get_num_sucios() const;
+        std::vector<PaginaID> get_paginas_sucias() const;
+
+        EstadisticasBufferPool get_estadisticas() const;
+
+};
@@ -0,0 +1,7 @@
+#include <cstddef>
+#include <cstdint>
+#pragma once
+
+// CRC-32C (Castagnoli), el mismo que usan ext4, iSCSI y la instruccion crc32 de SSE 4.2.
+// Para seguir un calculo en varios pedazos se pasa el resultado anterior como crc.
+uint32_t crc32c(const void* datos, size_t longitud, uint32_t crc = 0);
@@ -0,0 +1,77 @@
+#include "core/types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#pragma once
+
+enum class CriterioOrden {
+    // Registros serializados (ver serializar en core/ciudadano.hpp), que empiezan con el DNI
+    DNI,
+    // Los bytes del registro, como memcmp (si uno es prefijo del otro, va primero el corto)
+    BYTES,
+};
+
+// Ordena registros por DNI (o por sus bytes, ver CriterioOrden) aunque no entren en memoria.
+// Los registros se juntan en un tramo de hasta memoria_tramo bytes; cada tramo lleno se
+// ordena y se escribe seguido en un archivo temporal ("<prefijo>.<n>"). Al leer se mezclan
+// todos los tramos con un heap, leyendo cada archivo de forma secuencial. Si todo entra en
+// un tramo no se escribe ningun archivo.
+//
+// Los registros con el mismo DNI (o iguales) salen en el orden en que se agregaron.
+// Los errores de E/S lanzan std::runtime_error. El destructor borra los temporales.
+class OrdenExterno {
+
+    private:
+
+        struct Tramo {
+            std::string ruta;
+            std::ifstream archivo;
+            std::vector<char> registro;  // Registro actual (el menor de este tramo que no salio)
+            DNI_t dni;
+        };
+
+        std::string prefijo;
+        size_t memoria_tramo;
+        CriterioOrden criterio;
+
+        // Tramo en memoria: registros como [uint16_t size][bytes], y donde empieza cada uno
+        std::vector<char> datos;
+        std::vector<size_t> posiciones;
+
+        std::vector<std::unique_ptr<Tramo>> tramos;
+        std::vector<size_t> heap;   // Indices de tramos, el de menor (dni, indice) arriba
+        std::vector<char> actual;   // Lo que devolvio el ultimo siguiente()
+        size_t leidos_memoria;      // Sin archivos: cuantos registros del tramo en memoria salieron
+        bool terminado;
+        size_t total;
+
+        void ordenar_tramo();
+        void volcar_tramo();
+        bool leer_registro(Tramo& tramo);
+        bool menor(size_t a, size_t b) const;
+        bool registro_menor(const char* a, size_t size_a, const char* b, size_t size_b) const;
+
+    public:
+
+        OrdenExterno(const std::string& prefijo_temporales, size_t memoria_tramo, CriterioOrden criterio = CriterioOrden::DNI);
+        ~OrdenExterno();
+
+        OrdenExterno(const OrdenExterno&) = delete;
+        OrdenExterno& operator=(const OrdenExterno&) = delete;
+
+        void agregar(const char* serializado, size_t size);
+
+        // Despues de terminar no se puede agregar; los registros se leen con siguiente
+        void terminar();
+
+        // El puntero vale hasta la proxima llamada. Devuelve false cuando no quedan registros.
+        bool siguiente(const char*& serializado, size_t& size);
+
+        size_t get_num_tramos() const;
+        size_t get_total() const;
+
+};
@@ -41,6 +41,9 @@ public:
     bool insertar_registro_en_slot(SlotID slot_id, const char* registro, size_t size);
     bool leer_registro(SlotID slot_id, char* buffer, size_t& size);
     bool borrar_registro(SlotID slot_id);
+    // Deshace el ultimo insertar_registro devolviendo su slot y su espacio (borrar_registro
+    // no los recupera). Devuelve false si slot_id no es el ultimo registro insertado.
+    bool descartar_ultimo(SlotID slot_id);
 
     bool tiene_espacio(size_t size) const;
     uint16_t get_num_registros() const;
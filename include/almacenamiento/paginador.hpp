@@ -1,90 +1,359 @@
 #include "almacenamiento/archivo_mapeado_memoria.hpp"
+#include "almacenamiento/archivo_directo.hpp"
+#include "almacenamiento/buffer_pool.hpp"
 #include "almacenamiento/pagina.hpp"
-#include <set>
+#include "core/latch_optimista.hpp"
+#include <atomic>
+#include <memory>
+#include <vector>
 #include <cstddef>
-#include <unordered_map>
-#include <list>
+#include <cstdint>
 
 #pragma once
 
-// Caché LRU simple para páginas frecuentemente accedidas
-class CacheLRU {
-private:
-    struct NodoCache {
-        PaginaID pagina_id;
-        char* datos;
-    };
+// MAPEO: el archivo se mapea completo y el sistema operativo decide que paginas estan en RAM.
+// BUFFER_POOL: pool de frames propio de tamaño fijo, con lecturas y escrituras explicitas.
+// Sirve cuando el archivo es mucho mas grande que la RAM y queremos controlar el uso de memoria.
+enum class ModoAlmacenamiento {
+    MAPEO,
+    BUFFER_POOL
+};
+
+struct OpcionesPaginador {
+    ModoAlmacenamiento modo = ModoAlmacenamiento::MAPEO;
+
+    // Bytes por pagina: potencia de 2, PAGINA_SIZE o mas. La Database usa siempre PAGINA_SIZE
+    // (el formato del archivo y el WAL dependen de eso); paginas mas grandes sirven para
+    // indices sueltos con nodos mas anchos (ver BPlusTreeGenerico). Las cantidades de abajo
+    // ("64 MB con paginas de 4KB") estan en paginas, asi que crecen con el tamaño.
+    size_t size_pagina = PAGINA_SIZE;
+    OpcionesMapeo mapeo; // Solo en modo MAPEO
+
+    // Solo en modo BUFFER_POOL
+    size_t frames_buffer_pool = 16384; // 64 MB con paginas de 4KB
+    bool io_directa = false;           // Abrir con O_DIRECT para no duplicar las paginas en la cache del SO
+    bool io_uring = true;              // Lotes de lectura/escritura con io_uring si el kernel lo soporta
+    unsigned profundidad_io = 64;      // Maximo de peticiones io_uring en vuelo
+
+    // "No-steal": una pagina modificada solo llega al archivo con sincronizar(). En modo MAPEO
+    // el mapeo es privado (copia en escritura) y en BUFFER_POOL no se desalojan paginas sucias.
+    // Lo necesita el WAL: entre checkpoints el archivo queda exactamente como en el ultimo.
+    bool escribir_solo_al_sincronizar = false;
+
+    // Crecimiento del archivo por extensiones: cada vez que se acaba la capacidad crecemos
+    // factor_crecimiento * capacidad actual, acotado a [extension_minima, extension_maxima] paginas
+    size_t extension_minima = 256;    // 1 MB con paginas de 4KB
+    size_t extension_maxima = 16384;  // 64 MB con paginas de 4KB
+    double factor_crecimiento = 0.25;
+};
+
+struct EstadisticasPaginador {
+    size_t num_paginas;        // Paginas entregadas por alloc_pagina (incluye las libres)
+    size_t capacidad_paginas;  // Paginas que caben en el archivo ya extendido
+    size_t bytes_reservados;   // Rango virtual reservado para el mapeo
+    size_t num_segmentos;      // Segmentos mapeados (ver MapeoMemoria)
+    size_t num_crecimientos;   // Veces que se extendio el archivo
+    size_t num_paginas_libres; // Paginas en la lista de libres (troncos incluidos)
+    size_t num_paginas_sucias; // Modificadas desde el ultimo sincronizar()
+    size_t rangos_escritos;    // Tramos de paginas sucias consecutivas bajados por sincronizar() (solo MAPEO)
+    EstadisticasBufferPool buffer_pool; // Todo en 0 en modo MAPEO
+    bool io_uring_activo;      // Los lotes del pool van por io_uring (si no, pread/pwrite)
+};
+
+// Lista de paginas libres guardada en el mismo archivo: una cadena de paginas "tronco", cada
+// una con los IDs de hasta MAX_HOJAS paginas libres (en sus primeros PAGINA_SIZE bytes, con
+// cualquier tamaño de pagina). Los troncos tambien son paginas libres:
+// cuando un tronco se queda sin hojas se entrega el propio tronco. Quien guarda los metadatos
+// (el Superblock) persiste el primer tronco y la cantidad de libres.
+struct TroncoLibres {
+    static constexpr size_t MAX_HOJAS = (PAGINA_SIZE - 2 * sizeof(uint32_t)) / sizeof(PaginaID); // 1022
+
+    PaginaID siguiente;   // Proximo tronco o INVALID_PAGE_ID
+    uint32_t num_hojas;
+    PaginaID hojas[MAX_HOJAS];
+};
+static_assert(sizeof(TroncoLibres) <= PAGINA_SIZE, "El tronco de libres debe caber en una pagina");
+
+// Paginas consecutivas [primera, primera + cantidad)
+struct RangoPaginas {
+    PaginaID primera;
+    size_t cantidad;
+};
+
+// Un bit por pagina del archivo: que paginas se modificaron desde el ultimo sincronizar() en
+// modo MAPEO. En modo BUFFER_POOL cada frame sabe si esta sucio.
+// Varios hilos pueden marcar a la vez (escritores del arbol en hojas distintas) mientras otro
+// hace crecer el mapa: las palabras son atomicas y estan en bloques que no se mueven al crecer.
+class MapaSucias {
+
+    private:
 
-    size_t capacidad;
-    std::list<NodoCache> lista_lru;
-    std::unordered_map<PaginaID, typename std::list<NodoCache>::iterator> mapa;
+        static constexpr unsigned BITS_BLOQUE = 12; // 4096 palabras (262144 paginas) por bloque
+        static constexpr size_t PALABRAS_POR_BLOQUE = size_t(1) << BITS_BLOQUE;
+        static constexpr size_t MAX_BLOQUES = (size_t(1) << 32) / 64 / PALABRAS_POR_BLOQUE;
 
-public:
-    CacheLRU(size_t capacidad) : capacidad(capacidad) {}
+        std::vector<std::unique_ptr<std::atomic<uint64_t>[]>> bloques; // Reservado a MAX_BLOQUES
+        size_t num_palabras;
+        std::atomic<size_t> cantidad;
 
-    char* get(PaginaID page_id) {
-        auto it = mapa.find(page_id);
-        if (it == mapa.end()) {
-            return nullptr; // No está en caché
+        std::atomic<uint64_t>& palabra(size_t i) {
+            return bloques[i >> BITS_BLOQUE][i & (PALABRAS_POR_BLOQUE - 1)];
+        }
+        uint64_t leer_palabra(size_t i) const {
+            return bloques[i >> BITS_BLOQUE][i & (PALABRAS_POR_BLOQUE - 1)].load(std::memory_order_relaxed);
         }
 
-        // Mover al frente (más recientemente usado)
-        lista_lru.splice(lista_lru.begin(), lista_lru, it->second);
-        return it->second->datos;
-    }
+    public:
+
+        MapaSucias() : num_palabras(0), cantidad(0) { bloques.reserve(MAX_BLOQUES); }
+
+        // Solo crece: los bits de paginas que ya no existen se borran con desmarcar_desde
+        void redimensionar(size_t paginas);
+
+        void marcar(PaginaID id) {
+            std::atomic<uint64_t>& p = palabra(id >> 6);
+            uint64_t bit = uint64_t(1) << (id & 63);
+            // Casi siempre ya esta marcada: solo se escribe la primera vez
+            if ((p.load(std::memory_order_relaxed) & bit) == 0 && (p.fetch_or(bit, std::memory_order_relaxed) & bit) == 0) {
+                cantidad.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        void desmarcar(PaginaID id) {
+            std::atomic<uint64_t>& p = palabra(id >> 6);
+            uint64_t bit = uint64_t(1) << (id & 63);
+            if ((p.load(std::memory_order_relaxed) & bit) != 0 && (p.fetch_and(~bit, std::memory_order_relaxed) & bit) != 0) {
+                cantidad.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        bool esta_marcada(PaginaID id) const {
+            return ((leer_palabra(id >> 6) >> (id & 63)) & 1) != 0;
+        }
+
+        void desmarcar_desde(size_t primera);
+        void limpiar();
+        std::vector<PaginaID> listar() const;
+
+        // Las paginas marcadas juntando las consecutivas: un rango por cada tramo sin huecos.
+        // Recorre el mapa de a 64 paginas, asi que saltar las zonas limpias es barato.
+        std::vector<RangoPaginas> listar_rangos() const;
+
+        size_t get_cantidad() const { return cantidad.load(std::memory_order_relaxed); }
+
+};
+
+// Pagina fijada en memoria mientras el objeto exista (RAII). En modo BUFFER_POOL el frame no
+// se puede desalojar hasta que se destruya o se llame a soltar(); en modo MAPEO no hace nada
+// porque el puntero al mapeo siempre es valido.
+// Quien modifique la pagina debe llamar a marcar_sucia() para que se escriba al desalojarla
+// (o, en modo MAPEO, para que sincronizar() sepa que cambio).
+class PaginaFijada {
 
-    void put(PaginaID page_id, char* datos) {
-        auto it = mapa.find(page_id);
+    private:
+
+        BufferPool* pool;     // nullptr en modo MAPEO
+        MapaSucias* sucias;   // Solo en modo MAPEO
+        size_t frame;
+        PaginaID pagina_id;
+        char* ptr;
+
+    public:
 
-        if (it != mapa.end()) {
-            // Ya existe, actualizar y mover al frente
-            it->second->datos = datos;
-            lista_lru.splice(lista_lru.begin(), lista_lru, it->second);
-            return;
+        PaginaFijada() : pool(nullptr), sucias(nullptr), frame(INVALID_FRAME), pagina_id(INVALID_PAGE_ID), ptr(nullptr) {}
+        PaginaFijada(BufferPool* pool, size_t frame, PaginaID pagina_id, char* ptr)
+            : pool(pool), sucias(nullptr), frame(frame), pagina_id(pagina_id), ptr(ptr) {}
+        PaginaFijada(MapaSucias* sucias, PaginaID pagina_id, char* ptr)
+            : pool(nullptr), sucias(sucias), frame(INVALID_FRAME), pagina_id(pagina_id), ptr(ptr) {}
+
+        ~PaginaFijada() { soltar(); }
+
+        PaginaFijada(const PaginaFijada&) = delete;
+        PaginaFijada& operator=(const PaginaFijada&) = delete;
+
+        PaginaFijada(PaginaFijada&& otra) noexcept
+            : pool(otra.pool), sucias(otra.sucias), frame(otra.frame), pagina_id(otra.pagina_id), ptr(otra.ptr) {
+            otra.pool = nullptr;
+            otra.sucias = nullptr;
+            otra.ptr = nullptr;
         }
 
-        // Verificar capacidad
-        if (lista_lru.size() >= capacidad) {
-            // Eliminar el menos recientemente usado
-            auto ultimo = lista_lru.back();
-            mapa.erase(ultimo.pagina_id);
-            lista_lru.pop_back();
+        PaginaFijada& operator=(PaginaFijada&& otra) noexcept {
+            if (this != &otra) {
+                soltar();
+                pool = otra.pool;
+                sucias = otra.sucias;
+                frame = otra.frame;
+                pagina_id = otra.pagina_id;
+                ptr = otra.ptr;
+                otra.pool = nullptr;
+                otra.sucias = nullptr;
+                otra.ptr = nullptr;
+            }
+            return *this;
         }
 
-        // Agregar nuevo al frente
-        lista_lru.push_front({page_id, datos});
-        mapa[page_id] = lista_lru.begin();
-    }
+        char* datos() const { return ptr; }
+        PaginaID id() const { return pagina_id; }
+        explicit operator bool() const { return ptr != nullptr; }
+
+        void marcar_sucia() {
+            if (pool != nullptr) {
+                pool->marcar_sucio(frame);
+            } else if (sucias != nullptr) {
+                sucias->marcar(pagina_id);
+            }
+        }
+
+        void soltar() {
+            if (pool != nullptr) {
+                pool->desfijar(frame);
+                pool = nullptr;
+            }
+            sucias = nullptr;
+            ptr = nullptr;
+        }
 
-    void clear() {
-        lista_lru.clear();
-        mapa.clear();
-    }
 };
 
 class Paginador {
 
     private:
 
-    MapeoMemoria archivo;
-    size_t num_paginas; // size_t es uint64_t (mayor rango que PageID que es uint32_t)
-    std::set<PaginaID> paginas_libres; //IDs de paginas liberadas para reusarlas
+    MapeoMemoria archivo;          // Modo MAPEO
+    ArchivoDirecto archivo_directo; // Modo BUFFER_POOL
+    BufferPool pool;
+    MapaSucias sucias;             // Modo MAPEO
+    TablaLatches latches;
+    size_t size_pagina; // OpcionesPaginador::size_pagina
+
+    // size_t es uint64_t (mayor rango que PageID que es uint32_t). Atomico porque fijar_pagina
+    // lo lee sin lock mientras otro hilo pide paginas.
+    std::atomic<size_t> num_paginas;
+    size_t capacidad_paginas; // Paginas que caben en el archivo; num_paginas <= capacidad_paginas
+    size_t num_crecimientos;
+    size_t rangos_escritos;
+    std::atomic<size_t> lotes_copias; // Lotes de escribir_copias (en BUFFER_POOL), desde el hilo del checkpoint
+    OpcionesPaginador opciones;
 
-    // Caché LRU con capacidad para 1024 páginas (4MB de caché con páginas de 4KB)
-    CacheLRU cache;
+    // Lista de libres persistente. Solo se lee el tronco de la cabeza, y recien cuando hace
+    // falta (la primera vez que se pide o se libera una pagina)
+    PaginaID tronco_libres;
+    size_t num_paginas_libres;
 
     public:
 
     Paginador();
     ~Paginador();
 
-    bool abrir(const std::string& ruta, size_t paginas_iniciales);
+    bool abrir(const std::string& ruta, size_t paginas_iniciales, const OpcionesPaginador& opciones = {});
     void cerrar();
 
-    PaginaID alloc_pagina();
+    // El archivo puede tener mas paginas de las usadas (capacidad preasignada). Quien guarda
+    // los metadatos (el Superblock) nos dice al abrir cuantas estaban realmente en uso.
+    bool fijar_num_paginas(size_t paginas_usadas);
+
+    // Extiende el archivo si hace falta para que existan las paginas [0, paginas). Lo usa la
+    // recuperacion del WAL: la extension del archivo puede no haber llegado al disco.
+    bool asegurar_paginas(size_t paginas);
+
+    // Cambia la pista de acceso del archivo (por ejemplo SECUENCIAL antes de un recorrido completo)
+    bool aconsejar(PatronAcceso patron);
+
+    // Restaura la lista de libres guardada en el archivo. Devuelve false si el tronco no es valido.
+    bool fijar_lista_libres(PaginaID primer_tronco, size_t cantidad);
+    PaginaID get_primer_tronco_libres() const;
+    size_t get_num_paginas_libres() const;
+
+    // Toma una pagina de la lista de libres en O(1) o extiende el archivo. Con cerca_de, entre
+    // las libres del tronco de la cabeza elige la mas cercana a esa pagina (por ejemplo el
+    // nodo que se esta dividiendo), asi los nodos vecinos del arbol quedan cerca en el disco.
+    PaginaID alloc_pagina(PaginaID cerca_de = INVALID_PAGE_ID);
+    // Siempre extiende el archivo, sin tocar la lista de libres: la carga masiva escribe sus
+    // paginas seguidas y sin pisar ninguna que el archivo ya usara (ni los troncos de libres)
+    PaginaID alloc_pagina_nueva();
+    // Como alloc_pagina_nueva, pero cantidad paginas seguidas (devuelve la primera). Si no
+    // entran, el archivo crece solo lo que falta y no una extension: es para rangos de tamaño
+    // conocido que no van a seguir creciendo, como las paginas del filtro de la base.
+    PaginaID alloc_paginas_nuevas(size_t cantidad);
     void liberar_pagina(PaginaID page_id);
 
-    char* get_pagina(PaginaID page_id);
+    // === Compactacion (ver Database::vacuum) ===
+
+    // Todas las paginas de la lista de libres, troncos incluidos
+    std::vector<PaginaID> listar_paginas_libres();
+
+    // Rehace la lista de libres con exactamente estas paginas. Con perforar, las que no quedan
+    // como tronco se perforan en el archivo (no ocupan disco hasta que se vuelvan a usar).
+    // Devuelve cuantas paginas se perforaron.
+    size_t reconstruir_lista_libres(const std::vector<PaginaID>& libres, bool perforar);
+
+    // Corta el archivo a `paginas` paginas (y descarta la capacidad preasignada). Ninguna
+    // pagina >= paginas puede seguir en uso ni en la lista de libres.
+    bool truncar(size_t paginas);
+
+    // Fija la pagina y devuelve el guard. Si el id no es valido, o en modo BUFFER_POOL todos
+    // los frames estan fijados o fallo la lectura, el guard queda vacio (datos() == nullptr).
+    // En modo MAPEO se puede llamar desde varios hilos a la vez, y mientras otro hilo pide
+    // paginas; en BUFFER_POOL el pool no es seguro entre hilos. Lo demas (alloc_pagina,
+    // liberar_pagina, sincronizar...) lo llama un solo hilo a la vez.
+    PaginaFijada fijar_pagina(PaginaID page_id);
+
+    // Latch de version de la pagina (ver LatchOptimista), para el arbol y las paginas de
+    // datos. Existe para toda pagina < capacidad del archivo.
+    LatchOptimista& latch(PaginaID page_id) { return latches[page_id]; }
+
+    // Avisa que se van a leer estas paginas (por ejemplo las hojas de un recorrido). En modo
+    // BUFFER_POOL se leen en un solo lote; en modo MAPEO se pide readahead con MADV_WILLNEED.
+    void precargar(const std::vector<PaginaID>& paginas);
+
+    // Escribe al disco las paginas modificadas desde el ultimo sincronizar() y espera. En modo
+    // MAPEO solo se tocan los tramos del mapa de sucias, juntando paginas consecutivas en una
+    // sola llamada (msync del tramo, o pwrite + fdatasync con escribir_solo_al_sincronizar):
+    // el costo depende de lo que cambio y no del tamaño del archivo. En BUFFER_POOL se vacia el pool.
+    bool sincronizar();
+
+    // Como sincronizar(), pero solo pide al sistema que empiece a escribir y vuelve sin
+    // esperar. Las paginas siguen contando como sucias hasta el proximo sincronizar(), que
+    // despues tiene poco que esperar. Con escribir_solo_al_sincronizar no hace nada: ahi las
+    // paginas no pueden llegar al archivo fuera de sincronizar().
+    bool sincronizar_async();
+
+    // Paginas modificadas desde el ultimo sincronizar(): las que bajaria el proximo
+    size_t get_num_paginas_sucias() const;
+    std::vector<PaginaID> get_paginas_sucias() const;
+
+    // === Checkpoint en segundo plano (ver Database) ===
+    // Con escribir_solo_al_sincronizar, en lugar de sincronizar() todo con el lock tomado: se
+    // copian las paginas sucias, se retienen, se escriben las copias sin lock y se sueltan.
+
+    // Las paginas dejan de contar como sucias (lo que se modifique despues las vuelve a marcar),
+    // pero en BUFFER_POOL no se desalojan hasta soltar_paginas_retenidas: el archivo todavia
+    // tiene la version anterior. Quien las retiene ya copio su contenido.
+    void retener_paginas(const std::vector<PaginaID>& ids);
+
+    // Escribe las copias en su lugar y espera a que esten en el disco. Con ids ordenados, la
+    // copia de ids[i] esta en copias + i * get_size_pagina() (alineado a PAGINA_SIZE por O_DIRECT);
+    // las paginas consecutivas salen en una sola escritura y en BUFFER_POOL todas van en un
+    // lote (ArchivoDirecto::ejecutar_lote, con io_uring si esta activo). Solo usa el archivo,
+    // asi que otro hilo puede seguir fijando paginas o haciendo crecer el archivo mientras
+    // tanto; no se puede truncar ni cerrar.
+    bool escribir_copias(const std::vector<PaginaID>& ids, const char* copias);
+
+    // Con escritas en false (fallo escribir_copias) las paginas vuelven a quedar sucias
+    void soltar_paginas_retenidas(const std::vector<PaginaID>& ids, bool escritas);
+
+    size_t get_size_pagina() const;
     size_t get_num_paginas() const;
+    ModoAlmacenamiento get_modo() const;
+    EstadisticasPaginador get_estadisticas() const;
+
+    private:
+
+    bool crecer();
+    // Lleva la capacidad a nueva_capacidad paginas (no mas que INVALID_PAGE_ID)
+    bool crecer_hasta(size_t nueva_capacidad);
+    bool redimensionar_archivo(size_t paginas);
+    size_t get_size_archivo() const;
 
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "almacenamiento/pagina.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#pragma once
+
+// Hasta este tamaño de archivo (en paginas) la tabla es un arreglo indexado por PaginaID:
+// 4 bytes por pagina del archivo, 4 MB de tabla para un archivo de 4 GB
+constexpr size_t PAGINAS_MAX_INDICE_DIRECTO = size_t(1) << 20;
+
+// Tabla PaginaID -> frame del buffer pool, con toda la memoria reservada al abrir.
+// Buscar, insertar y eliminar nunca reservan memoria.
+//
+// Mientras el archivo es chico la tabla es un arreglo indexado directamente por PaginaID.
+// Pasado PAGINAS_MAX_INDICE_DIRECTO se cambia a una tabla hash de direccionamiento abierto
+// (sondeo lineal) con el doble de ranuras que frames, asi nunca pasa del 50% de ocupacion.
+class TablaPaginas {
+
+    public:
+
+        static constexpr uint32_t VACIO = UINT32_MAX;
+
+    private:
+
+        struct Ranura {
+            PaginaID pagina_id; // INVALID_PAGE_ID si esta libre
+            uint32_t frame;
+        };
+
+        bool modo_directo;
+        std::vector<uint32_t> directo; // directo[pagina_id] = frame (o VACIO)
+        std::vector<Ranura> ranuras;
+        size_t mascara;
+        unsigned desplazamiento;       // 64 - log2(ranuras.size()), para el hash multiplicativo
+        size_t max_entradas;
+
+        size_t posicion_inicial(PaginaID pagina_id) const {
+            // Hash de Fibonacci: multiplica por 2^64 / phi y se queda con los bits altos
+            return static_cast<size_t>((static_cast<uint64_t>(pagina_id) * 0x9E3779B97F4A7C15ULL) >> desplazamiento);
+        }
+
+        void insertar_en_hash(PaginaID pagina_id, uint32_t frame);
+        void pasar_a_hash();
+
+    public:
+
+        TablaPaginas();
+
+        // max_entradas: cuantas paginas puede haber a la vez (los frames del pool)
+        // paginas_archivo: tamaño actual del archivo, decide si arrancamos en modo directo
+        void abrir(size_t max_entradas, size_t paginas_archivo);
+        void cerrar();
+
+        // Avisar cuando el archivo crece. Es el unico metodo que puede reservar memoria.
+        void ajustar_paginas_archivo(size_t paginas_archivo);
+
+        uint32_t buscar(PaginaID pagina_id) const {
+            if (modo_directo) {
+                return pagina_id < directo.size() ? directo[pagina_id] : VACIO;
+            }
+            for (size_t i = posicion_inicial(pagina_id); ; i = (i + 1) & mascara) {
+                const Ranura& r = ranuras[i];
+                if (r.pagina_id == pagina_id) return r.frame;
+                if (r.pagina_id == INVALID_PAGE_ID) return VACIO;
+            }
+        }
+
+        // La pagina no debe estar en la tabla
+        void insertar(PaginaID pagina_id, uint32_t frame);
+        void eliminar(PaginaID pagina_id);
+
+        bool es_directa() const { return modo_directo; }
+
+};
@@ -0,0 +1,138 @@
+#include "almacenamiento/archivo_directo.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#pragma once
+
+enum class TipoRegistroWAL : uint8_t {
+    // Operaciones logicas: se vuelven a aplicar al recuperar
+    INSERTAR = 1,       // Ciudadano serializado
+    MODIFICAR = 2,      // Ciudadano serializado
+    ELIMINAR = 3,       // DNI
+    // Checkpoint: imagenes de las paginas que se van a escribir en su lugar, y al final el
+    // registro CHECKPOINT. Solo si el CHECKPOINT llego al log se usan las imagenes. Las
+    // imagenes pueden quedar mezcladas con operaciones de otros hilos (checkpoint en segundo
+    // plano), por eso cada una dice de que checkpoint es.
+    IMAGEN_PAGINA = 4,  // LSN del checkpoint (8 bytes) + PaginaID + PAGINA_SIZE bytes
+    CHECKPOINT = 5,     // LSN hasta el que el checkpoint refleja las operaciones
+};
+
+struct OpcionesWAL {
+    bool activo = true;
+
+    // true: cada operacion vuelve recien cuando su registro esta en el disco. Las que llegan a
+    // la vez comparten el mismo fdatasync (group commit).
+    // false: vuelve enseguida y el registro baja con el proximo commit o checkpoint. Un corte
+    // puede perder las ultimas operaciones, pero nunca deja la base a medias.
+    bool commit_sincrono = true;
+};
+
+// Registro leido del log al abrir. datos apunta a memoria del WAL hasta liberar_recuperados().
+struct RegistroWAL {
+    TipoRegistroWAL tipo;
+    uint64_t lsn;
+    const char* datos;
+    uint32_t longitud;
+};
+
+struct EstadisticasWAL {
+    uint64_t lsn_siguiente;
+    size_t bytes_log;          // Tamaño del log, incluido lo que todavia no se escribio
+    size_t registros;
+    size_t escrituras;         // Veces que se escribio al archivo (cada una lleva uno o mas registros)
+    size_t sincronizaciones;   // fdatasync del log
+};
+
+// Write-ahead log. Cada registro lleva su LSN (la posicion del registro en el log desde que
+// se creo, en bytes) y un CRC-32C; al abrir se lee hasta el primer registro roto o fuera de
+// orden, que es donde se corto la ultima escritura.
+//
+// El log usa dos archivos, "<ruta>" y "<ruta>.1". Los registros nuevos van siempre al activo;
+// rotar() cambia de archivo sin frenar a nadie y descartar_anterior() vacia el otro cuando
+// sus registros ya no hacen falta. Asi un checkpoint que corre en paralelo con las
+// operaciones puede recortar el log sin perder lo que se agrego mientras tanto.
+//
+// Group commit: agregar() solo copia el registro a un buffer. El primer hilo que llama a
+// esperar_durable() escribe todo lo acumulado y hace un fdatasync; los que llegan mientras
+// tanto esperan, y el siguiente en despertar escribe de una vez todo lo que se junto.
+//
+// Los metodos se pueden llamar desde varios hilos, excepto abrir, cerrar y reiniciar.
+class WAL {
+
+    private:
+
+        ArchivoDirecto archivos[2];
+        size_t activo;                   // Archivo que recibe los registros nuevos
+
+        std::mutex mutex;
+        std::condition_variable escritura_terminada;
+
+        std::vector<char> pendiente;     // Registros [lsn_escrito, lsn_siguiente) sin escribir
+        std::vector<char> en_escritura;  // Lo que se esta escribiendo sin el mutex tomado
+        bool escribiendo;
+        bool fallo;                      // Fallo una escritura: ya no se garantiza nada
+
+        uint64_t lsn_inicial;            // LSN del primer registro del archivo activo
+        bool hay_anterior;               // El otro archivo todavia tiene [lsn_inicial_anterior, lsn_inicial)
+        uint64_t lsn_inicial_anterior;
+        uint64_t lsn_siguiente;
+        uint64_t lsn_escrito;
+        uint64_t lsn_durable;
+
+        size_t registros;
+        size_t escrituras;
+        size_t sincronizaciones;
+
+        std::vector<char> contenido_recuperado[2];
+        std::vector<RegistroWAL> recuperados;
+
+        bool escribir_pendiente(std::unique_lock<std::mutex>& lock, bool sincronizar);
+        bool escribir_cabecera(ArchivoDirecto& archivo, uint64_t lsn);
+        size_t bytes_log() const;
+        bool leer_registros(size_t indice, uint64_t& lsn_inicio, std::vector<RegistroWAL>& registros);
+
+    public:
+
+        WAL();
+        ~WAL();
+
+        WAL(const WAL&) = delete;
+        WAL& operator=(const WAL&) = delete;
+
+        // Con crear_nuevo se descarta lo que hubiera en los archivos. Si no, los registros validos
+        // de los dos quedan en get_recuperados(), ordenados por LSN, y lo que sigue despues del
+        // ultimo (una escritura cortada) se borra.
+        bool abrir(const std::string& ruta, bool crear_nuevo);
+        void cerrar();
+
+        // Agrega el registro al buffer y devuelve el LSN siguiente: el que hay que pasar a
+        // esperar_durable() para saber que este registro ya esta en el disco.
+        uint64_t agregar(TipoRegistroWAL tipo, const void* datos, size_t longitud);
+
+        // Espera a que todo hasta `lsn` este en el disco, escribiendolo si nadie lo esta haciendo
+        bool esperar_durable(uint64_t lsn);
+
+        // Vacia el log (los dos archivos) despues de un checkpoint. El proximo registro tendra un
+        // LSN >= lsn_minimo (y nunca menor que los ya entregados).
+        bool reiniciar(uint64_t lsn_minimo);
+
+        // Los registros siguientes van al otro archivo, que se vacia. Falla si todavia no se
+        // descarto el anterior. No espera ninguna escritura: se puede llamar con cualquier
+        // otro lock tomado.
+        bool rotar();
+
+        // Vacia el archivo anterior a la ultima rotacion. Todo lo que tenia debe estar reflejado
+        // en la base (un checkpoint con LSN >= el de la rotacion ya termino) y ya en el disco.
+        bool descartar_anterior();
+
+        const std::vector<RegistroWAL>& get_recuperados() const;
+        void liberar_recuperados();
+
+        uint64_t get_lsn_siguiente();
+        size_t get_bytes_log();
+        EstadisticasWAL get_estadisticas();
+
+};
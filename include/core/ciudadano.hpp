@@ -81,3 +81,121 @@ inline Ciudadano deserializar(const char* buffer, size_t size) {
     deserializar(buffer, size, c); // Llama a la otra versión para hacer el trabajo
     return c;
 }
+
+// === Claves del indice de apellidos y nombres (ver Database::buscar_por_nombre) ===
+
+// Bytes de apellidos o de nombres que entran en la clave: lo que sigue no distingue
+constexpr size_t MAX_NOMBRE_CLAVE = 255;
+// Van despues de los apellidos y de los nombres. Son menores que cualquier letra, asi que
+// "PEREZ" va antes que "PEREZ GOMEZ", y normalizar_nombre los saca del texto.
+constexpr char SEPARADOR_NOMBRES = '\x01';
+constexpr char FIN_NOMBRES = '\x00';
+
+// Forma de apellidos y nombres en el indice, para que la busqueda no dependa de como se
+// cargaron: mayusculas, sin acentos ni dieresis (la Ñ se conserva), sin caracteres de control
+// y con los espacios de mas quitados. Solo entiende ASCII y las letras latinas de UTF-8 que
+// empiezan con 0xC3 (Latin-1); lo demas queda como esta.
+inline std::string normalizar_nombre(const std::string& texto) {
+    std::string normalizado;
+    normalizado.reserve(texto.size());
+    bool espacio_pendiente = false;
+
+    auto agregar = [&](char c) {
+        if (espacio_pendiente && !normalizado.empty()) {
+            normalizado += ' ';
+        }
+        espacio_pendiente = false;
+        normalizado += c;
+    };
+
+    for (size_t i = 0; i < texto.size(); i++) {
+        unsigned char c = static_cast<unsigned char>(texto[i]);
+        if (c == ' ' || c == '\t') {
+            espacio_pendiente = true;
+        } else if (c < 0x20 || c == 0x7F) {
+            continue;
+        } else if (c >= 'a' && c <= 'z') {
+            agregar(static_cast<char>(c - 'a' + 'A'));
+        } else if (c == 0xC3 && i + 1 < texto.size() && (static_cast<unsigned char>(texto[i + 1]) & 0xC0) == 0x80) {
+            unsigned char letra = static_cast<unsigned char>(texto[++i]);
+            // Las minusculas estan 0x20 despues de sus mayusculas, salvo ÷ y ÿ
+            if (letra >= 0xA0 && letra != 0xB7 && letra != 0xBF) {
+                letra -= 0x20;
+            }
+            if (letra >= 0x80 && letra <= 0x85) agregar('A');
+            else if (letra == 0x87) agregar('C');
+            else if (letra >= 0x88 && letra <= 0x8B) agregar('E');
+            else if (letra >= 0x8C && letra <= 0x8F) agregar('I');
+            else if (letra >= 0x92 && letra <= 0x96) agregar('O');
+            else if (letra >= 0x99 && letra <= 0x9C) agregar('U');
+            else {
+                agregar(static_cast<char>(c));
+                normalizado += static_cast<char>(letra);
+            }
+        } else {
+            agregar(static_cast<char>(c));
+        }
+    }
+
+    // Sin cortar una letra de UTF-8 por la mitad
+    if (normalizado.size() > MAX_NOMBRE_CLAVE) {
+        size_t corte = MAX_NOMBRE_CLAVE;
+        while (corte > 0 && (static_cast<unsigned char>(normalizado[corte]) & 0xC0) == 0x80) {
+            corte--;
+        }
+        normalizado.resize(corte);
+        while (!normalizado.empty() && normalizado.back() == ' ') {
+            normalizado.pop_back();
+        }
+    }
+    return normalizado;
+}
+
+// El DNI en big-endian: comparadas con memcmp, las claves quedan en el orden de los DNIs.
+// Es la clave de la tabla agrupada (ver ModoTabla::AGRUPADA).
+inline std::string clave_dni(DNI_t dni) {
+    std::string clave(sizeof(DNI_t), '\0');
+    for (size_t i = 0; i < sizeof(DNI_t); i++) {
+        clave[i] = static_cast<char>((dni >> (8 * (sizeof(DNI_t) - 1 - i))) & 0xFF);
+    }
+    return clave;
+}
+
+// El DNI de los ultimos bytes de una clave de clave_dni o de clave_nombre
+inline DNI_t dni_de_clave(const std::string& clave) {
+    DNI_t dni = 0;
+    for (size_t i = clave.size() - sizeof(DNI_t); i < clave.size(); i++) {
+        dni = (dni << 8) | static_cast<unsigned char>(clave[i]);
+    }
+    return dni;
+}
+
+// Clave del ciudadano en el indice: apellidos y nombres normalizados y el DNI en big-endian,
+// que la hace unica y ordena por DNI a los que se llaman igual
+inline std::string clave_nombre(DNI_t dni, const std::string& apellidos, const std::string& nombres) {
+    std::string clave = normalizar_nombre(apellidos);
+    clave += SEPARADOR_NOMBRES;
+    clave += normalizar_nombre(nombres);
+    clave += FIN_NOMBRES;
+    clave += clave_dni(dni);
+    return clave;
+}
+
+inline std::string clave_nombre(const Ciudadano& c) {
+    return clave_nombre(c.dni, c.apellidos, c.nombres);
+}
+
+// Desde el registro serializado, sin deserializar la direccion
+inline std::string clave_nombre(const char* buffer) {
+    DNI_t dni;
+    uint16_t len_nombres;
+    uint16_t len_apellidos;
+    memcpy(&dni, buffer, sizeof(DNI_t));
+    const char* ptr = buffer + sizeof(DNI_t);
+    memcpy(&len_nombres, ptr, sizeof(uint16_t));
+    const char* nombres = ptr + sizeof(uint16_t);
+    ptr = nombres + len_nombres;
+    memcpy(&len_apellidos, ptr, sizeof(uint16_t));
+    const char* apellidos = ptr + sizeof(uint16_t);
+    return clave_nombre(dni, std::string(apellidos, len_apellidos), std::string(nombres, len_nombres));
+}
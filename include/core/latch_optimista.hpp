@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#pragma once
+
+// Latch de version para lecturas optimistas (optimistic lock coupling). Quien escribe lo
+// bloquea y al soltarlo la version cambia; quien lee no escribe nada: anota la version, lee
+// y despues valida que no cambio. Si cambio, lo leido puede estar a medio escribir y hay que
+// volver a empezar. Por eso quien lee de forma optimista no puede confiar en nada de lo leido
+// (por ejemplo un num_claves fuera de rango) hasta validar.
+//
+// La version es impar mientras esta bloqueado.
+class LatchOptimista {
+
+    private:
+
+        std::atomic<uint64_t> version;
+
+        static void esperar(unsigned& vueltas) {
+            // Con pocos nucleos quien tiene el latch puede no estar corriendo: despues de unas
+            // vueltas le cedemos el procesador
+            if (++vueltas > 64) {
+                std::this_thread::yield();
+            }
+        }
+
+    public:
+
+        LatchOptimista() : version(0) {}
+
+        // Espera a que nadie lo tenga bloqueado y devuelve la version para validar despues
+        uint64_t leer_version() const {
+            unsigned vueltas = 0;
+            uint64_t v = version.load(std::memory_order_acquire);
+            while ((v & 1) != 0) {
+                esperar(vueltas);
+                v = version.load(std::memory_order_acquire);
+            }
+            return v;
+        }
+
+        // true si nadie lo bloqueo desde leer_version: todo lo leido en el medio es consistente
+        bool validar(uint64_t v) const {
+            // Las lecturas de la pagina no pueden pasar a despues de esta
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return version.load(std::memory_order_relaxed) == v;
+        }
+
+        // Bloquea solo si sigue en la version v (nadie escribio desde que se leyo)
+        bool subir(uint64_t v) {
+            if (!version.compare_exchange_strong(v, v + 1, std::memory_order_acquire)) {
+                return false;
+            }
+            // Las escrituras de la pagina no pueden pasar a antes del bloqueo
+            std::atomic_thread_fence(std::memory_order_release);
+            return true;
+        }
+
+        void bloquear() {
+            while (!subir(leer_version())) {
+            }
+        }
+
+        void desbloquear() {
+            version.fetch_add(1, std::memory_order_release);
+        }
+
+};
+
+// Bloquea el latch mientras el objeto exista
+class BloqueoLatch {
+
+    private:
+
+        LatchOptimista& latch;
+
+    public:
+
+        explicit BloqueoLatch(LatchOptimista& latch) : latch(latch) { latch.bloquear(); }
+        ~BloqueoLatch() { latch.desbloquear(); }
+
+        BloqueoLatch(const BloqueoLatch&) = delete;
+        BloqueoLatch& operator=(const BloqueoLatch&) = delete;
+
+};
+
+// Un latch por pagina. Se guardan en bloques que no se mueven al crecer: otro hilo puede
+// estar usando un latch mientras se agregan paginas.
+class TablaLatches {
+
+    private:
+
+        static constexpr unsigned BITS_BLOQUE = 12; // 4096 latches (32 KB) por bloque
+        static constexpr size_t LATCHES_POR_BLOQUE = size_t(1) << BITS_BLOQUE;
+        // Alcanza para todos los PaginaID. Se reserva al construir, asi agregar un bloque
+        // nunca mueve la tabla (la reserva es solo memoria virtual hasta usarse).
+        static constexpr size_t MAX_BLOQUES = (size_t(1) << 32) / LATCHES_POR_BLOQUE;
+
+        std::vector<std::unique_ptr<LatchOptimista[]>> bloques;
+
+    public:
+
+        TablaLatches() { bloques.reserve(MAX_BLOQUES); }
+
+        // Solo crece
+        void redimensionar(size_t paginas) {
+            size_t necesarios = std::min((paginas + LATCHES_POR_BLOQUE - 1) / LATCHES_POR_BLOQUE, MAX_BLOQUES);
+            while (bloques.size() < necesarios) {
+                bloques.emplace_back(new LatchOptimista[LATCHES_POR_BLOQUE]);
+            }
+        }
+
+        LatchOptimista& operator[](size_t pagina) {
+            return bloques[pagina >> BITS_BLOQUE][pagina & (LATCHES_POR_BLOQUE - 1)];
+        }
+
+};
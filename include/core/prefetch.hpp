@@ -0,0 +1,11 @@
+#pragma once
+
+// Pide a la cache la linea que contiene p sin esperarla. No lee la memoria: p puede apuntar
+// a cualquier lado (si la pagina no esta mapeada el pedido se descarta).
+inline void prefetch_linea(const void* p) {
+#if defined(__GNUC__)
+    __builtin_prefetch(p);
+#else
+    (void)p;
+#endif
+}
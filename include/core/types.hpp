@@ -1,6 +1,7 @@
 #include "almacenamiento/pagina.hpp"
 #include "almacenamiento/pagina_ranurada.hpp"
 #include <cstdint>
+#include <cstring>
 
 #pragma once
 
@@ -14,3 +15,24 @@ struct RegistroID {
         return pagina_id == other.pagina_id && slot_id == other.slot_id;
     }
 };
+
+// RegistroID tal como se guarda en las hojas del indice: 6 bytes, sin los 2 de relleno que
+// el compilador agrega al final de RegistroID
+struct RegistroIDEmpaquetado {
+    uint8_t bytes[sizeof(PaginaID) + sizeof(SlotID)];
+
+    static RegistroIDEmpaquetado de(RegistroID rid) {
+        RegistroIDEmpaquetado empaquetado;
+        std::memcpy(empaquetado.bytes, &rid.pagina_id, sizeof(PaginaID));
+        std::memcpy(empaquetado.bytes + sizeof(PaginaID), &rid.slot_id, sizeof(SlotID));
+        return empaquetado;
+    }
+
+    RegistroID desempaquetar() const {
+        RegistroID rid;
+        std::memcpy(&rid.pagina_id, bytes, sizeof(PaginaID));
+        std::memcpy(&rid.slot_id, bytes + sizeof(PaginaID), sizeof(SlotID));
+        return rid;
+    }
+};
+static_assert(sizeof(RegistroIDEmpaquetado) == 6, "RegistroIDEmpaquetado no debe tener relleno");
@@ -1,40 +1,308 @@
 #pragma once
 
 #include "almacenamiento/paginador.hpp"
+#include "almacenamiento/wal.hpp"
 #include "index/bplustree.hpp"
+#include "index/bplustree_cadenas.hpp"
+#include "index/filtro_bloom.hpp"
 #include "core/ciudadano.hpp"
 #include <string>
 #include <stdexcept>
 #include <optional>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+// Donde se guardan los registros de los ciudadanos. Se elige al crear la base (ver
+// OpcionesDB::modo_tabla) y queda en el superblock.
+enum class ModoTabla : uint32_t {
+    // En paginas de datos ranuradas aparte: el indice de DNIs lleva al RegistroID de cada uno
+    HEAP = 0,
+    // En las hojas de un BPlusTreeCadenas por DNI (ver clave_dni): una busqueda por DNI lee una
+    // pagina menos, y un recorrido por rango lee los registros seguidos. Los registros se
+    // mueven cuando las hojas se dividen, asi que el indice de nombres no guarda RegistroIDs:
+    // encuentra a cada ciudadano por el DNI que tiene al final de su clave.
+    AGRUPADA = 1,
+};
 
 struct Superblock {
+    // En ModoTabla::AGRUPADA, la raiz de la tabla
     PaginaID raiz_indice_dni;
     PaginaID ultima_pagina_datos;
+    // Paginas en uso. El archivo crece por extensiones, asi que su tamaño ya no dice cuantas
+    // paginas hay. 0 en archivos viejos: en ese caso se usa el tamaño del archivo.
+    uint64_t num_paginas;
+    // Lista de paginas libres (ver TroncoLibres). 0 en archivos viejos: sin lista.
+    PaginaID primer_tronco_libres;
+    uint32_t reservado;
+    uint64_t num_paginas_libres;
+    // Las operaciones del WAL con LSN menor ya estan reflejadas en el archivo
+    uint64_t lsn_checkpoint;
+    // MAGIA_SUPERBLOCK y VERSION_FORMATO del archivo. Los archivos anteriores a la version 2
+    // tienen 0 en los dos: son de la version 1.
+    uint32_t magia;
+    uint32_t version_formato;
+    // Mientras se migra una version anterior: la proxima hoja a convertir (0: la primera)
+    PaginaID hoja_migracion;
+    // Desde la version 3 (ver Database::buscar_por_nombre)
+    PaginaID raiz_indice_nombres;
+    // ModoTabla, desde la version 4
+    uint32_t modo_tabla;
+    // Desde la version 5: el filtro de DNIs (ver OpcionesDB::filtro_dni) guardado en
+    // paginas_filtro paginas seguidas desde primera_pagina_filtro (INVALID_PAGE_ID: sin
+    // paginas). Solo vale con filtro_al_dia en 1, que se escribe al cerrar (ver Database::cerrar).
+    PaginaID primera_pagina_filtro;
+    uint32_t paginas_filtro;
+    uint64_t claves_filtro;
+    uint32_t filtro_al_dia;
 };
 
 constexpr PaginaID SUPERBLOCK_PAGE_ID = 0;
 
+constexpr uint32_t MAGIA_SUPERBLOCK = 0x42445550; // "PUDB"
+// 1: hojas del indice con entradas {clave, RegistroID} de 12 bytes
+// 2: hojas con las claves y los RegistroID (empaquetados en 6 bytes) en arreglos separados
+// 3: con el indice de apellidos y nombres
+// 4: con el modo de la tabla (las anteriores son ModoTabla::HEAP)
+// 5: con las paginas del filtro de DNIs
+constexpr uint32_t VERSION_FORMATO = 5;
+
+struct OpcionesDB {
+    OpcionesPaginador paginador = opciones_por_defecto();
+
+    // Solo cuenta al crear la base: una existente se abre con el modo de su superblock
+    ModoTabla modo_tabla = ModoTabla::HEAP;
+
+    // Filtro de Bloom de los DNIs en memoria (ver FiltroBloom): las busquedas, modificaciones
+    // y eliminaciones de un DNI que no esta, y la comprobacion de repetidos de insertar_lote,
+    // vuelven sin bajar por el indice. Se guarda en el archivo al cerrar y se lee al abrir; si
+    // no se cerro bien, o el filtro paso de su capacidad, se arma recorriendo las hojas. Las
+    // inserciones que lo pasan de su capacidad lo vuelven a armar del doble de los DNIs.
+    bool filtro_dni = true;
+
+    // Log en "<ruta>.wal". Sin WAL los cambios llegan al archivo cuando el sistema los baja
+    // (MAPEO) o al desalojar (BUFFER_POOL), y un corte puede dejar el arbol a medias.
+    OpcionesWAL wal;
+
+    // Con WAL, las paginas modificadas solo se escriben en un checkpoint. Se pide uno cuando el
+    // log o las paginas sucias pasan de estos limites, o cuando paso el intervalo y hubo cambios.
+    // El tamaño del log acota lo que hay que rehacer al abrir despues de una caida.
+    size_t checkpoint_bytes_log = size_t(64) << 20;  // 64 MB
+    size_t checkpoint_paginas_sucias = 32768;        // 128 MB con paginas de 4KB
+    unsigned intervalo_checkpoint_ms = 30000;        // 0: solo por los limites
+
+    // Los checkpoints los hace un hilo propio: las operaciones solo lo despiertan, y esperan
+    // unicamente si el hilo no da abasto (el doble de los limites, o el pool sin frames
+    // limpios). Con false se hacen en la operacion que pasa el limite.
+    bool checkpoint_en_segundo_plano = true;
+
+    // El acceso tipico es una busqueda puntual por DNI: sin readahead el kernel no trae
+    // paginas vecinas que el B+ Tree no va a tocar
+    static OpcionesPaginador opciones_por_defecto() {
+        OpcionesPaginador opciones;
+        opciones.mapeo.patron = PatronAcceso::ALEATORIO;
+        return opciones;
+    }
+};
+
+struct OpcionesCargaMasiva {
+    // Fraccion de cada hoja y nodo interno que se llena (entre 0.5 y 1). Con 1 el arbol queda
+    // lo mas compacto posible, pero la primera insercion en cada hoja la divide.
+    double factor_llenado = 0.9;
+    // La entrada se ordena en tramos de este tamaño, que se escriben a archivos temporales
+    // ("<ruta>.carga.N") y despues se mezclan. Las claves del indice de nombres se ordenan
+    // aparte ("<ruta>.carga_nombres.N") mientras se leen los datos: puede usar el doble.
+    size_t memoria_orden = size_t(256) << 20;  // 256 MB
+};
+
+enum class ModoVacuum {
+    // Mueve las paginas vivas del final a los huecos del principio y corta el archivo
+    COMPACTAR,
+    // No mueve nada: corta solo las paginas libres del final y perfora las demas
+    SOLO_PERFORAR,
+};
+
+struct ResultadoVacuum {
+    size_t paginas_movidas;
+    size_t paginas_truncadas;    // Paginas que dejaron de existir al cortar el archivo
+    size_t paginas_perforadas;   // Paginas libres que quedaron en el archivo sin ocupar disco
+    size_t bytes_recuperados;    // Lo que se achico el archivo mas lo perforado
+};
+
+// Los metodos publicos se pueden llamar desde varios hilos: un mutex serializa las escrituras,
+// pero la espera del commit (el fdatasync del WAL) se hace fuera del mutex, asi que los
+// commits de operaciones concurrentes se juntan en un mismo fdatasync.
+// El hilo de checkpoints tambien toma el mutex solo para copiar las paginas sucias; las
+// escrituras y los fdatasync del checkpoint corren en paralelo con las operaciones.
+// En modo MAPEO buscar_ciudadano no toma el mutex: lee el indice y la pagina de datos de
+// forma optimista (ver BPlusTree y LatchOptimista), en paralelo con otras busquedas y con
+// las escrituras. En BUFFER_POOL (el pool no es seguro entre hilos), en ModoTabla::AGRUPADA
+// (la tabla no tiene latches), y siempre en buscar_lote y buscar_rango, las busquedas toman
+// el mutex.
 class Database {
 public:
     Database();
     ~Database();
 
-    bool abrir(const std::string& ruta);
+    bool abrir(const std::string& ruta, const OpcionesDB& opciones = {});
 
     bool insertar_ciudadano(const Ciudadano& ciudadano);
+
+    // Inserta varios ciudadanos a la vez: los ordena por DNI y los pasa al indice por tandas
+    // con BPlusTree::insertar_lote, que baja una vez por hoja. Los DNIs que ya estan, o
+    // repetidos en el lote (queda el primero), no se insertan. Devuelve cuantos se insertaron.
+    // Cada ciudadano va al WAL como un insert individual.
+    size_t insertar_lote(const std::vector<Ciudadano>& ciudadanos);
     std::optional<Ciudadano> buscar_ciudadano(DNI_t dni);
+
+    // Busca varios DNIs a la vez (ver BPlusTree::buscar_lote) y devuelve un resultado por DNI,
+    // en el mismo orden. Las paginas de datos tambien se leen de a tandas y en orden de
+    // pagina, cada una una sola vez aunque tenga varios de los ciudadanos buscados.
+    std::vector<std::optional<Ciudadano>> buscar_lote(const std::vector<DNI_t>& dnis);
+
+    // Llama a visitar con cada ciudadano de DNI entre dni_desde y dni_hasta (inclusive), en
+    // orden de DNI, recorriendo la cadena de hojas del indice sin juntar los resultados.
+    // Si visitar devuelve false el recorrido se corta. Devuelve cuantos ciudadanos visito.
+    // El mutex queda tomado durante todo el recorrido: visitar no puede usar esta Database.
+    size_t buscar_rango(DNI_t dni_desde, DNI_t dni_hasta, const std::function<bool(const Ciudadano&)>& visitar);
+
+    // Como buscar_rango, pero por el indice de apellidos y nombres, en orden de apellidos,
+    // nombres y DNI. Con nombres vacio visita a los ciudadanos cuyos apellidos empiezan con
+    // apellidos; si no, a los que tienen exactamente esos apellidos y nombres que empiezan con
+    // nombres. Los dos se comparan normalizados (ver normalizar_nombre): "perez" encuentra a
+    // "Pérez". Con los dos vacios visita a todos.
+    size_t buscar_por_nombre(const std::string& apellidos, const std::string& nombres, const std::function<bool(const Ciudadano&)>& visitar);
     bool modificar_ciudadano(const Ciudadano& ciudadano);
+
+    // Carga en una base vacia los ciudadanos que devuelve siguiente (llena el ciudadano y
+    // devuelve false cuando no hay mas). Los ordena por DNI fuera de memoria, escribe las
+    // paginas de datos una tras otra y arma el indice de abajo hacia arriba, sin pasar por el
+    // WAL: un corte a mitad de la carga deja la base vacia. Con DNIs repetidos queda el
+    // primero. Devuelve cuantos se cargaron; lanza si la base ya tiene ciudadanos.
+    // El mutex queda tomado durante toda la carga: siguiente no puede usar esta Database.
+    size_t carga_masiva(const std::function<bool(Ciudadano&)>& siguiente, const OpcionesCargaMasiva& opciones_carga = {});
     bool eliminar_ciudadano(DNI_t dni);
 
+    EstadisticasPaginador get_estadisticas_paginador() const;
+    EstadisticasWAL get_estadisticas_wal();
+
+    // Devuelve al sistema el espacio de las paginas libres. Con WAL avanza por checkpoints y un
+    // corte a mitad de camino deja una base valida; sin WAL no es seguro ante una caida.
+    // Las paginas del filtro de DNIs quedan reservadas del largo que van a tener al cerrar, asi
+    // que cerrar no vuelve a hacer crecer el archivo y lo que dice ResultadoVacuum se mantiene.
+    ResultadoVacuum vacuum(ModoVacuum modo = ModoVacuum::COMPACTAR);
+
 private:
+    mutable std::mutex mutex;
+    // Las busquedas sin mutex lo toman compartido. Lo que cambia todo el archivo o libera
+    // el indice (abrir, cerrar, carga_masiva, vacuum) lo toma exclusivo, antes que el mutex.
+    std::shared_mutex estructura;
     Paginador paginador;
-    std::unique_ptr<BPlusTree> indice_dni;
+    ModoTabla modo_tabla = ModoTabla::HEAP;
+    std::unique_ptr<BPlusTree> indice_dni;     // ModoTabla::HEAP
+    std::unique_ptr<BPlusTreeCadenas> tabla;   // ModoTabla::AGRUPADA: DNI -> registro serializado
+    // Claves de clave_nombre (ver core/ciudadano.hpp). Se mantiene en las mismas operaciones
+    // que indice_dni y solo se lee con el mutex.
+    std::unique_ptr<BPlusTreeCadenas> indice_nombres;
+    // Con OpcionesDB::filtro_dni. Se reemplaza solo con estructura exclusivo.
+    std::unique_ptr<FiltroBloom> filtro;
+    // Paginas del archivo reservadas para guardarlo, y si tienen lo mismo que el de memoria
+    // (solo entre guardar_filtro y la proxima operacion, o al abrir)
+    PaginaID primera_pagina_filtro = INVALID_PAGE_ID;
+    size_t paginas_filtro = 0;
+    bool filtro_al_dia = false;
     bool inicializado = false;
     std::string ruta_db;
     PaginaID ultima_pagina_datos_id;
+    uint32_t version_formato = VERSION_FORMATO;
+    PaginaID hoja_migracion = SUPERBLOCK_PAGE_ID;
+
+    OpcionesDB opciones;
+    WAL wal;
+    bool usar_wal = false;
+    uint64_t lsn_checkpoint = 0;
+
+    // Hilo de checkpoints. Todo lo que sigue se protege con el mutex.
+    std::thread checkpointer;
+    std::condition_variable aviso_checkpointer;   // Despierta al hilo
+    std::condition_variable checkpoint_terminado; // Despierta a quien espera que termine uno
+    bool detener_checkpointer = false;
+    bool checkpoint_pedido = false;
+    bool checkpoint_en_curso = false;             // Paginas retenidas, todavia sin escribir
+    size_t paginas_en_checkpoint = 0;
+    std::string error_checkpoint;                 // Si fallo uno en segundo plano
+    std::chrono::steady_clock::time_point ultimo_checkpoint;
+    std::vector<char> copias_checkpoint;          // Reutilizado entre checkpoints
 
     void crear_db(const std::string& ruta);
     void cargar_db();
     void cerrar();
+    bool escribir_superblock();
+
+    // Lleva un archivo de una version anterior a VERSION_FORMATO al abrirlo, de a una version.
+    // De la 1 a la 2 convierte las hojas por tandas que se hacen durables (con un checkpoint,
+    // o sincronizando sin WAL) junto con el superblock, que guarda por cual hoja va: un corte
+    // a mitad de la migracion la retoma desde ahi al abrir de nuevo. De la 2 a la 3 arma el
+    // indice de nombres, que recien cuenta cuando el superblock lo apunta: un corte en el
+    // medio lo vuelve a armar desde el principio. Sin WAL no es seguro ante una caida.
+    void migrar_formato();
+    // Arma indice_nombres con construir_desde_ordenados desde los registros de indice_dni
+    void construir_indice_nombres();
+
+    // === Filtro de DNIs ===
+    // Al abrir: lee el filtro guardado si esta al dia, o lo arma. Sin WAL deja escrito que
+    // ya no esta al dia antes de que cambie nada (el archivo se escribe en cualquier orden).
+    void abrir_filtro(size_t claves_guardadas);
+    // Lo arma con los DNIs de la cadena de hojas
+    void armar_filtro();
+    // Con mas claves que su capacidad da "puede estar" para casi todo: las inserciones lo
+    // miran con el mutex y, ya sin el, llaman a agrandar_filtro, que lo vuelve a armar
+    bool filtro_lleno() const { return filtro && filtro->get_num_claves() > filtro->get_capacidad(); }
+    void agrandar_filtro();
+    // Libera las paginas del filtro y reserva las que necesita el de memoria
+    void reservar_paginas_filtro();
+    // Escribe las paginas que cambiaron, sincroniza y lo da por al dia. false si no hay filtro.
+    bool guardar_filtro();
+    // false si el DNI seguro no esta
+    bool puede_estar(DNI_t dni) const { return !filtro || filtro->puede_estar(dni); }
+
+    // Las operaciones sin WAL ni mutex: las usan los metodos publicos y la recuperacion
+    bool aplicar_insertar(DNI_t dni, const char* serializado, size_t size);
+    bool aplicar_modificar(DNI_t dni, const char* serializado, size_t size);
+    bool aplicar_eliminar(DNI_t dni);
+    // Agrega el registro a la ultima pagina de datos (o a una nueva) sin tocar el indice
+    std::optional<RegistroID> escribir_registro(const char* serializado, size_t size);
+    // Las aplicar_* de ModoTabla::AGRUPADA, a las que derivan las de arriba
+    bool aplicar_insertar_agrupada(DNI_t dni, const char* serializado, size_t size);
+    bool aplicar_modificar_agrupada(DNI_t dni, const char* serializado, size_t size);
+    bool aplicar_eliminar_agrupada(DNI_t dni);
+    bool agrupada() const { return modo_tabla == ModoTabla::AGRUPADA; }
+
+    // === WAL ===
+    uint64_t registrar(TipoRegistroWAL tipo, const void* datos, size_t longitud);
+    bool esperar_commit(uint64_t lsn);
+    void recuperar();
+    void checkpoint(uint64_t lsn_aplicado, bool reiniciar_log);
+    void checkpoint_si_hace_falta(uint64_t lsn_aplicado, bool reiniciar_log);
+    size_t limite_paginas_sucias() const;
+    char* copiar_paginas_sucias(std::vector<PaginaID>& ids);
+    uint64_t registrar_imagenes(uint64_t lsn_aplicado, const std::vector<PaginaID>& ids, const char* copias);
+
+    // === Checkpoint en segundo plano ===
+    void iniciar_checkpointer();
+    void detener_checkpointer_hilo(std::unique_lock<std::mutex>& lock);
+    void bucle_checkpointer();
+    void checkpoint_en_segundo_plano(std::unique_lock<std::mutex>& lock);
+    void antes_de_operar(std::unique_lock<std::mutex>& lock);
+    void despues_de_operar();
+    void esperar_checkpoint_en_curso(std::unique_lock<std::mutex>& lock);
+
+    size_t compactar();
+    size_t perforar_libres();
+    void cortar_archivo(size_t paginas);
 };
@@ -1,6 +1,14 @@
 #include "almacenamiento/paginador.hpp"
 #include "core/ciudadano.hpp"
 #include "core/types.hpp"
+#include "index/busqueda_nodo.hpp"
+#include "index/cache_internos.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <type_traits>
 #include <vector>
 #include <optional>
 
@@ -11,65 +19,333 @@ enum class TipoNodo : uint8_t {
     Hoja = 1,
 };
 
+// Hojas que un iterador pide juntas al pool (en BUFFER_POOL) mientras recorre la cadena:
+// pocas la primera vez, para que un recorrido corto no traiga de mas, y el doble cada vez
+// hasta el maximo
+constexpr size_t HOJAS_PRECARGA_INICIAL = 4;
+constexpr size_t HOJAS_PRECARGA_MAX = 32;
+
 struct BPlusTreeHeader {
     TipoNodo tipo;
     uint16_t num_claves;
 };
 
-namespace Hoja {
-    struct Entrada {
-        DNI_t clave;
-        RegistroID valor;
+// Como se guarda un valor en las hojas: por defecto tal cual, y RegistroID empaquetado en 6
+// bytes (sin el relleno de la struct)
+template <typename Valor>
+struct ValorHoja {
+    using Guardado = Valor;
+    static Guardado guardar(const Valor& valor) { return valor; }
+    static Valor leer(const Guardado& guardado) { return guardado; }
+};
+
+template <>
+struct ValorHoja<RegistroID> {
+    using Guardado = RegistroIDEmpaquetado;
+    static Guardado guardar(const RegistroID& valor) { return RegistroIDEmpaquetado::de(valor); }
+    static RegistroID leer(const Guardado& guardado) { return guardado.desempaquetar(); }
+};
+
+// Formato de los nodos con claves Clave, valores Valor y paginas de TAM_PAGINA bytes. Todo
+// se calcula al compilar. Cada arreglo empieza alineado a su tipo; con DNI_t, RegistroID y
+// paginas de 4KB las alineaciones no agregan relleno y el formato es el de siempre.
+template <typename Clave, typename Valor, size_t TAM_PAGINA>
+struct FormatoNodo {
+    using Guardado = typename ValorHoja<Valor>::Guardado;
+
+    static constexpr size_t alinear(size_t offset, size_t alineacion) {
+        return (offset + alineacion - 1) / alineacion * alineacion;
+    }
+
+    struct Hoja {
+        // Despues del header y del puntero a la siguiente hoja van todas las claves seguidas y
+        // despues todos los valores (structure of arrays): la busqueda solo lee el arreglo de
+        // claves, que ocupa 4 bytes por entrada en lugar de los 12 de un par clave/RegistroID.
+        static constexpr size_t OFFSET_CLAVES = alinear(sizeof(BPlusTreeHeader) + sizeof(PaginaID), alignof(Clave));
+        static constexpr int MAX_CLAVES = (TAM_PAGINA - OFFSET_CLAVES - (alignof(Guardado) - 1)) / (sizeof(Clave) + sizeof(Guardado));
+        // Con 4KB páginas: (4096 - 4 - 4) / (4 + 6) = 408 entradas por hoja
+        static constexpr size_t OFFSET_VALORES = alinear(OFFSET_CLAVES + MAX_CLAVES * sizeof(Clave), alignof(Guardado));
+
+        static Clave* claves(char* pagina) { return reinterpret_cast<Clave*>(pagina + OFFSET_CLAVES); }
+        static const Clave* claves(const char* pagina) { return reinterpret_cast<const Clave*>(pagina + OFFSET_CLAVES); }
+        static Guardado* valores(char* pagina) { return reinterpret_cast<Guardado*>(pagina + OFFSET_VALORES); }
+        static const Guardado* valores(const char* pagina) { return reinterpret_cast<const Guardado*>(pagina + OFFSET_VALORES); }
+    };
+
+    struct Interno {
+        // Orden optimizado para 30M registros
+        // Fórmula: (TAM_PAGINA - Header) / (sizeof(PaginaID) + sizeof(Clave))
+        static constexpr int ORDEN = (TAM_PAGINA - sizeof(BPlusTreeHeader) - (alignof(Clave) - 1)) / (sizeof(PaginaID) + sizeof(Clave));
+        static constexpr int MAX_CLAVES = ORDEN - 1;
+        // Con 4KB: (4096 - 4) / (4 + 4) = 511 orden, 510 claves por nodo interno
+        // Altura del árbol con 30M registros: 30M/408 ≈ 73.500 hojas y log_511(73.500) ≈ 1,8,
+        // o sea 2 niveles internos sobre las hojas: 3 niveles
+        static constexpr size_t OFFSET_CLAVES = alinear(sizeof(BPlusTreeHeader) + ORDEN * sizeof(PaginaID), alignof(Clave));
     };
-    // Cálculo correcto: Página - Header - PunteroSiguiente / TamañoEntrada
-    constexpr int MAX_CLAVES = (PAGINA_SIZE - sizeof(BPlusTreeHeader) - sizeof(PaginaID)) / sizeof(Entrada);
-    // Con 4KB páginas: (4096 - 3 - 4) / (4 + 8) = 340 entradas por hoja
-}
-
-namespace Interno {
-    // Orden optimizado para 30M registros
-    // Fórmula: (PAGINA_SIZE - Header) / (sizeof(PaginaID) + sizeof(DNI_t))
-    constexpr int ORDEN = (PAGINA_SIZE - sizeof(BPlusTreeHeader)) / (sizeof(PaginaID) + sizeof(DNI_t));
-    constexpr int MAX_CLAVES = ORDEN - 1;
-    // Con 4KB: (4096 - 3) / (4 + 4) = 511 orden, 510 claves por nodo interno
-    // Altura del árbol con 30M registros: log_511(30M/340) ≈ 3 niveles
-}
-
-class BPlusTree {
+
+    static_assert(std::is_trivially_copyable<Clave>::value && std::is_trivially_copyable<Guardado>::value,
+                  "Las claves y los valores se copian tal cual a las paginas");
+    static_assert(Hoja::OFFSET_VALORES + Hoja::MAX_CLAVES * sizeof(Guardado) <= TAM_PAGINA, "Las hojas no entran en una pagina");
+    static_assert(Interno::OFFSET_CLAVES + Interno::MAX_CLAVES * sizeof(Clave) <= TAM_PAGINA, "Los nodos internos no entran en una pagina");
+    static_assert(Hoja::MAX_CLAVES >= 4 && Interno::ORDEN >= 4, "La pagina es muy chica para estas claves");
+    static_assert(Hoja::MAX_CLAVES <= UINT16_MAX && Interno::ORDEN <= UINT16_MAX, "num_claves es de 16 bits");
+};
+
+// Concurrencia (en modo MAPEO; el buffer pool no es seguro entre hilos): buscar, insertar,
+// insertar_si_no_existe, upsert, eliminar, eliminar_y_devolver e insertar_lote se pueden
+// llamar desde varios hilos a la vez. Cada pagina tiene un latch de version (ver
+// LatchOptimista):
+//  - buscar baja sin bloquear nada: lee la version de cada nodo, lo lee y valida que no
+//    cambio antes de pasar al hijo. Si algo cambio vuelve a empezar desde la raiz.
+//  - Las escrituras bajan igual y bloquean solo la hoja. Si hay que dividirla (o fusionarla
+//    con una hermana) sueltan todo y repiten la operacion con mutex_estructura, que serializa
+//    los cambios de estructura: ahi se bloquea cada nodo que se modifica y se sueltan todos
+//    al final. Los internos solo cambian con ese mutex tomado.
+// Lo demas (iteradores, buscar_lote, carga masiva, compactacion, migracion) necesita que
+// nadie mas use el arbol mientras tanto.
+//
+// Plantilla sobre la clave, el valor, el tamaño de pagina (el del Paginador, ver
+// OpcionesPaginador::size_pagina) y el orden de las claves. El formato de los nodos sale de
+// FormatoNodo al compilar y las comparaciones quedan en linea; con std::less sobre enteros
+// de 4 u 8 bytes la busqueda dentro del nodo usa los kernels SIMD de busqueda_nodo. La
+// implementacion esta en bplustree.cpp, que instancia al final las variantes disponibles.
+// BPlusTree es el indice de DNIs de la Database.
+template <typename Clave, typename Valor, size_t TAM_PAGINA = PAGINA_SIZE, typename Comparar = std::less<Clave>>
+class BPlusTreeGenerico {
 public:
-    BPlusTree(Paginador& paginador);
+    using Formato = FormatoNodo<Clave, Valor, TAM_PAGINA>;
+    using Hoja = typename Formato::Hoja;
+    using Interno = typename Formato::Interno;
+    using Guardado = typename Formato::Guardado;
+
+    // Recorre las entradas de las hojas en orden de clave siguiendo la cadena de hojas. Tiene
+    // fijada la hoja actual (en BUFFER_POOL ocupa un frame): el arbol no se puede modificar
+    // mientras haya un iterador vivo.
+    class Iterador {
+    public:
+        Iterador() : arbol(nullptr), posicion(0), siguiente_proxima(0), ventana(0) {}
+
+        bool valido() const { return static_cast<bool>(hoja); }
+        Clave clave() const { return Hoja::claves(hoja.datos())[posicion]; }
+        Valor valor() const { return ValorHoja<Valor>::leer(Hoja::valores(hoja.datos())[posicion]); }
+
+        // Pasar del principio o del final deja el iterador invalido
+        void siguiente();
+        void anterior();
+
+    private:
+        friend class BPlusTreeGenerico;
+
+        BPlusTreeGenerico* arbol;
+        PaginaFijada hoja;
+        int posicion;
+        // Hojas que siguen a la actual en la cadena, ya pedidas al pool (ver precargar_hojas)
+        std::vector<PaginaID> proximas;
+        size_t siguiente_proxima;
+        size_t ventana;
+
+        Iterador(BPlusTreeGenerico* arbol, PaginaFijada hoja, int posicion);
+        int num_claves() const;
+        // Si la posicion quedo al final de la hoja, avanza hasta la proxima hoja con entradas
+        void saltar_hojas_agotadas();
+        // Recien fijada la hoja id_hoja: si ya no quedan pedidas por delante, pide las siguientes
+        void precargar_hojas(PaginaID id_hoja);
+    };
+
+    // Lanza std::runtime_error si las paginas del paginador no son de TAM_PAGINA bytes
+    BPlusTreeGenerico(Paginador& paginador);
 
     PaginaID inicializar(PaginaID id_raiz);
 
-    std::optional<RegistroID> buscar(DNI_t clave);
+    std::optional<Valor> buscar(Clave clave);
+
+    // Busca varias claves a la vez y devuelve un resultado por clave, en el mismo orden. Las
+    // claves se ordenan y bajan juntas nivel por nivel: cada nodo se visita una sola vez por
+    // lote aunque lo necesiten muchas claves. Los nodos de un nivel se procesan de a tandas:
+    // se piden todos (a la cache con prefetch, y en BUFFER_POOL al disco en un solo lote)
+    // antes de buscar en el primero, asi sus fallos de cache y de TLB se solapan.
+    std::vector<std::optional<Valor>> buscar_lote(const std::vector<Clave>& claves);
+
+    // Primera entrada con clave >= clave, y ultima con clave <= clave (invalidos si no hay)
+    Iterador buscar_desde(Clave clave);
+    Iterador buscar_hasta(Clave clave);
     
-    bool insertar(DNI_t clave, RegistroID valor);
+    // Devuelve false (y no inserta) si la clave ya estaba
+    bool insertar(Clave clave, Valor valor);
+
+    // Operaciones de una sola bajada que devuelven el valor que tenia la clave, o nullopt si
+    // no estaba. insertar_si_no_existe no cambia nada si la clave esta; upsert le pone el
+    // valor nuevo.
+    std::optional<Valor> insertar_si_no_existe(Clave clave, Valor valor);
+    std::optional<Valor> upsert(Clave clave, Valor valor);
+    std::optional<Valor> eliminar_y_devolver(Clave clave);
 
-    bool eliminar(DNI_t clave);
+    // Inserta de una vez entradas ordenadas por clave (si no lo estan, lanza). Baja una sola
+    // vez por cada hoja que recibe entradas y las mezcla con las de la hoja en una pasada; si
+    // no entran, la hoja se divide en tantas como haga falta, y lo mismo los internos con las
+    // divisiones de sus hijos. Las claves que ya estan en el arbol, o repetidas en el lote,
+    // no se insertan. Devuelve cuantas se insertaron.
+    size_t insertar_lote(const std::vector<std::pair<Clave, Valor>>& entradas);
+
+    // Devuelve false si la clave no estaba
+    bool eliminar(Clave clave);
 
     PaginaID get_id_raiz() const;
+    // Nodos internos fijados en la cache (ver CacheInternos)
+    size_t get_num_nodos_fijados();
+
+    // === Carga masiva (ver Database::carga_masiva) ===
+
+    // Arma un arbol nuevo de abajo hacia arriba con las entradas que devuelve siguiente, que
+    // deben venir en orden estrictamente creciente de clave (si no, lanza). Cada nodo se llena
+    // hasta factor_llenado de su capacidad, sin bajar de la mitad: al final de cada nivel lo
+    // que sobra se reparte entre los dos ultimos nodos. Las paginas se piden al final del
+    // archivo (alloc_pagina_nueva) y el arbol anterior no se toca: devuelve su raiz para que
+    // quien llama la libere.
+    PaginaID construir_desde_ordenados(const std::function<bool(Clave&, Valor&)>& siguiente, double factor_llenado);
+
+    // === Compactacion (ver Database::vacuum) ===
+
+    // Marca en vivas[] cada nodo del arbol y cada pagina de datos a la que apunta algun RID
+    // (si los valores son Valor). vivas debe tener una entrada por pagina del archivo.
+    void marcar_paginas_vivas(std::vector<bool>& vivas);
+
+    // Despues de copiar cada pagina p a nuevo_id[p], reescribe los punteros del arbol (hijos,
+    // siguiente hoja y RIDs) para que apunten a las copias. Se hace por partes: reubicar_raiz
+    // mueve la raiz y devuelve los nodos a recorrer, y cada llamada a reubicar_nodos traduce
+    // hasta max_nodos de ellos. Entre llamadas el arbol es valido, porque las paginas
+    // originales siguen en su lugar con el mismo contenido que las copias.
+    std::vector<PaginaID> reubicar_raiz(const std::vector<PaginaID>& nuevo_id);
+    void reubicar_nodos(const std::vector<PaginaID>& nuevo_id, std::vector<PaginaID>& pendientes, size_t max_nodos);
+
+    // === Migracion de formato (ver Database::migrar_formato) ===
+
+    // Convierte al formato actual hasta max_hojas hojas del formato 1 (entradas {clave,
+    // Valor} de 12 bytes), siguiendo la cadena de hojas desde desde (INVALID_PAGE_ID: la
+    // primera). Devuelve la proxima hoja a convertir, o INVALID_PAGE_ID si no quedan. Solo
+    // existe para el indice de DNIs (BPlusTree); en las otras variantes lanza.
+    PaginaID migrar_hojas_v1(PaginaID desde, size_t max_hojas);
 
 private:
     Paginador& paginador;
-    PaginaID id_raiz;
+    Comparar comparar;
+    // Una raiz nueva se publica antes de soltar el latch de la anterior
+    std::atomic<PaginaID> id_raiz;
+
+    // Hoja de mas a la derecha, para agregar al final sin bajar desde la raiz (ver
+    // insertar_o_reemplazar). INVALID_PAGE_ID si hay que volver a encontrarla: la proxima
+    // insercion que baje por el borde derecho la anota. Dividirla o liberarla la invalida
+    // (con el latch de la hoja tomado), y tambien reubicar y reconstruir el arbol.
+    std::atomic<PaginaID> hoja_derecha;
 
-    std::optional<RegistroID> buscar_en_nodo(PaginaID id_pagina, DNI_t clave);
+    // Los niveles internos fijados en memoria, para que buscar y las escrituras (en su bajada
+    // optimista) y los iteradores lleguen a la hoja sin pasar por el paginador (ver
+    // CacheInternos). Los nodos que se liberan se olvidan, y la vacian inicializar,
+    // construir_desde_ordenados y reubicar_raiz. Tiene paginas fijadas: el arbol se destruye
+    // antes de cerrar el paginador.
+    CacheInternos cache;
+
+    // Serializa los cambios de estructura (ver arriba). bloqueadas son los latches que tiene
+    // el cambio en curso; CambioEstructura toma el mutex y los suelta al terminar.
+    std::mutex mutex_estructura;
+    std::vector<PaginaID> bloqueadas;
+    class CambioEstructura;
+    // Bloquea el latch de la pagina hasta el final del cambio de estructura en curso
+    void bloquear(PaginaID id_pagina);
+
+    // Hoja a la que llega una bajada optimista y su version
+    struct Bajada {
+        PaginaID id_hoja;
+        uint64_t version;
+        bool es_raiz;
+        bool borde_derecho;
+    };
+    // Baja sin bloquear nada. Devuelve false si algo cambio en el camino y hay que repetir.
+    bool bajar_optimista(Clave clave, Bajada& bajada);
+
+    // Estado de construir_desde_ordenados (definido en bplustree.cpp)
+    struct CargaAscendente;
+
+    // Fija la pagina o lanza std::runtime_error si el paginador no puede dar un frame
+    PaginaFijada fijar(PaginaID id_pagina);
+
+    // Busqueda dentro de un nodo (ver busqueda_nodo.hpp): primera posicion con clave >= clave
+    // y primera con clave > clave
+    static constexpr bool BUSQUEDA_SIMD = std::is_same<Comparar, std::less<Clave>>::value &&
+        (std::is_same<Clave, uint32_t>::value || std::is_same<Clave, uint64_t>::value);
+    size_t posicion_inferior(const Clave* claves, size_t n, const Clave& clave) const {
+        if constexpr (BUSQUEDA_SIMD) {
+            return ::posicion_inferior(claves, n, clave);
+        } else {
+            return ::posicion_inferior(claves, n, clave, comparar);
+        }
+    }
+    size_t posicion_superior(const Clave* claves, size_t n, const Clave& clave) const {
+        if constexpr (BUSQUEDA_SIMD) {
+            return ::posicion_superior(claves, n, clave);
+        } else {
+            return ::posicion_superior(claves, n, clave, comparar);
+        }
+    }
+    bool iguales(const Clave& a, const Clave& b) const { return !comparar(a, b) && !comparar(b, a); }
+
+    // Mueve n entradas (clave y valor) de la posicion desde de la hoja origen a la posicion
+    // hasta de la hoja destino. Pueden ser la misma hoja y los rangos pueden solaparse.
+    static void mover_entradas(const char* origen, size_t desde, char* destino, size_t hasta, size_t n);
+
+    // Pide las lineas de un nodo que la busqueda va a leer primero (ver buscar_lote)
+    static void prefetch_nodo(const char* pagina_ptr);
 
     struct ResultadoDivision {
-        DNI_t clave_promocionada;
+        Clave clave_promocionada;
         PaginaID id_nueva_pagina;
     };
 
-    std::optional<ResultadoDivision> insertar_en_nodo(PaginaID id_pagina, DNI_t clave, RegistroID valor);
+    // Que hace insertar_en_nodo si la clave ya esta en la hoja
+    enum class SiExiste {
+        DEJAR,
+        REEMPLAZAR,
+    };
+
+    // upsert e insertar_si_no_existe. En insertar_en_nodo, anterior queda con el valor que
+    // tenia la clave.
+    std::optional<Valor> insertar_o_reemplazar(Clave clave, Valor valor, SiExiste si_existe);
+    // borde_derecho: el nodo es el ultimo de su nivel. Ahi las claves suelen llegar en orden
+    // creciente, asi que si la nueva va al final la division deja la izquierda casi llena.
+    std::optional<ResultadoDivision> insertar_en_nodo(PaginaID id_pagina, Clave clave, Valor valor, SiExiste si_existe, std::optional<Valor>& anterior, bool borde_derecho);
+    // Agrega al final de hoja_derecha si la clave es mayor que todas y entra
+    bool agregar_al_final(Clave clave, Valor valor);
+    // Caminos rapidos con solo la hoja bloqueada. Devuelven false, sin cambiar nada, si hace
+    // falta un cambio de estructura (la hoja esta llena, o quedaria por debajo del minimo).
+    bool insertar_sin_dividir(Clave clave, Valor valor, SiExiste si_existe, std::optional<Valor>& anterior);
+    bool eliminar_sin_fusionar(Clave clave, std::optional<Valor>& eliminado);
     
-    void insertar_en_hoja(char* pagina_ptr, DNI_t clave, RegistroID valor);
+    void insertar_en_hoja(char* pagina_ptr, Clave clave, Valor valor);
     
-    void insertar_en_interno(char* pagina_ptr, DNI_t clave, PaginaID id_hijo_derecho);
+    void insertar_en_interno(char* pagina_ptr, Clave clave, PaginaID id_hijo_derecho);
+
+    // === Insercion por lotes (ver insertar_lote) ===
+    // Devuelven las divisiones para el padre, en orden de clave
+    std::vector<ResultadoDivision> insertar_lote_en_nodo(PaginaID id_pagina, const std::pair<Clave, Valor>* entradas, size_t n, size_t& insertadas);
+    // Mezcla en el interno las divisiones de sus hijos
+    std::vector<ResultadoDivision> agregar_divisiones(PaginaFijada& pagina, const std::vector<ResultadoDivision>& divisiones);
+    // Escriben el contenido en la pagina y, si no entra, en las paginas nuevas que hagan
+    // falta, repartido en partes iguales
+    std::vector<ResultadoDivision> repartir_hoja(PaginaFijada& pagina, const std::vector<Clave>& claves, const std::vector<Guardado>& valores);
+    std::vector<ResultadoDivision> repartir_interno(PaginaFijada& pagina, const std::vector<Clave>& claves, const std::vector<PaginaID>& hijos);
     
-    PaginaID buscar_hoja(DNI_t clave);
+    PaginaID buscar_hoja(Clave clave);
+
+    // Las hojas solo apuntan a la siguiente: la anterior a la que contiene `clave` es la ultima
+    // del subarbol izquierdo mas profundo del camino desde la raiz. INVALID_PAGE_ID si es la primera.
+    PaginaID buscar_hoja_anterior(Clave clave);
+
+    // Hasta maximo hojas que siguen en la cadena a la que contiene `clave` y cuelgan del mismo
+    // padre, en orden (ninguna si es la ultima hijo de su padre o la raiz es una hoja)
+    void hojas_siguientes(Clave clave, size_t maximo, std::vector<PaginaID>& ids);
 
     // === Helpers para Eliminación ===
-    void eliminar_interno(PaginaID id_pagina, DNI_t clave, PaginaID id_padre, int indice_en_padre);
+    void eliminar_interno(PaginaID id_pagina, Clave clave, PaginaID id_padre, int indice_en_padre, std::optional<Valor>& eliminado);
 
     // Estructura para encontrar hermanos
     enum class DireccionHermano { Izquierdo, Derecho };
@@ -88,3 +364,5 @@ private:
     void redistribuir_internos(char* pagina_hermano_ptr, char* pagina_actual_ptr, DireccionHermano direccion, char* pagina_padre_ptr, int indice_padre);
     void fusionar_internos(char* pagina_hermano_ptr, char* pagina_actual_ptr, DireccionHermano direccion, char* pagina_padre_ptr, int indice_padre);
 };
+
+using BPlusTree = BPlusTreeGenerico<DNI_t, RegistroID>;
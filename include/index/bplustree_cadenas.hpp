@@ -0,0 +1,183 @@
+#include "almacenamiento/paginador.hpp"
+#include "core/types.hpp"
+#include "index/bplustree.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#pragma once
+
+// Formato de los nodos de BPlusTreeCadenas (paginas ranuradas, como las de datos):
+//
+//   [NodoCadenasHeader][prefijo][slots ->]    libre    [<- entradas]
+//
+// Cada nodo guarda una sola vez el prefijo comun a todas sus claves, y de cada clave solo lo
+// que sigue (el sufijo). Los slots estan ordenados por clave y apuntan a su entrada, que es
+// el sufijo seguido del valor: en las hojas el de ValorCadenas, y en los internos el hijo a
+// la derecha de la clave (el de la izquierda de la primera es enlace).
+struct NodoCadenasHeader {
+    TipoNodo tipo;
+    uint8_t reservado;
+    uint16_t num_claves;
+    uint16_t size_prefijo;
+    uint16_t inicio_entradas;  // Las entradas crecen desde el final de la pagina hacia atras
+    uint16_t bytes_huecos;     // Entradas borradas entre las vivas: se recuperan compactando
+    uint16_t reservado2;
+    PaginaID enlace;           // Hoja: la siguiente hoja. Interno: el primer hijo.
+};
+
+struct SlotCadena {
+    uint16_t offset;
+    uint16_t size;             // Del sufijo
+    // Los primeros 4 bytes del sufijo (completados con ceros) como entero big-endian: el
+    // orden de las cabezas es el de los sufijos, y la mayoria de las comparaciones de la
+    // busqueda se resuelven con ellas sin ir a la entrada
+    uint32_t cabeza;
+};
+
+// Lo que guardan las hojas de un BPlusTreeCadenas junto a cada clave
+enum class ValorCadenas {
+    // Indice: el RegistroID empaquetado (6 bytes)
+    REGISTRO_ID,
+    // Tabla: bytes de largo variable, precedidos por su largo como uint16_t
+    BYTES,
+};
+
+// B+ Tree de claves de largo variable (cadenas de bytes, en el orden de memcmp) a RegistroID,
+// para los indices secundarios de la Database (ver Database::buscar_por_nombre), o a valores
+// de largo variable, para la tabla agrupada (ver ModoTabla::AGRUPADA):
+//  - Prefijos comprimidos: cada nodo guarda una vez el prefijo comun de sus claves. Cuando
+//    llega una clave que no lo comparte, el nodo se reescribe con el prefijo mas corto.
+//  - Separadores truncados: al dividir una hoja sube el prefijo mas corto de la primera clave
+//    de la derecha que todavia es mayor que la ultima de la izquierda, y el punto de division
+//    se elige cerca de la mitad donde ese separador sea mas corto.
+//  - Los nodos no se fusionan, como en muchos indices secundarios: una hoja vacia sigue en la
+//    cadena y vuelve a llenarse con las claves de su rango.
+//
+// No es seguro entre hilos: la Database lo usa siempre con su mutex tomado. Las paginas que
+// toma del paginador se inicializan con su latch bloqueado, porque pudieron ser nodos del
+// indice de DNIs que una busqueda optimista todavia esta leyendo.
+class BPlusTreeCadenas {
+public:
+    // Maximo de una clave mas su valor: asi cualquier division deja dos mitades que entran
+    static constexpr size_t MAX_ENTRADA = 1024;
+
+    // Recorre las entradas en orden de clave siguiendo la cadena de hojas. Tiene fijada la
+    // hoja actual: el arbol no se puede modificar mientras haya un iterador vivo.
+    class Iterador {
+    public:
+        Iterador() : arbol(nullptr), posicion(0), siguiente_proxima(0), ventana(0) {}
+
+        bool valido() const { return static_cast<bool>(hoja); }
+        std::string clave() const;
+        // Con ValorCadenas::REGISTRO_ID
+        RegistroID valor() const;
+        // Con ValorCadenas::BYTES: el puntero vale mientras el iterador no avance
+        const char* valor_bytes(size_t& size) const;
+        // Sin armar la clave completa
+        bool clave_empieza_con(const std::string& prefijo) const;
+
+        // Pasar del final deja el iterador invalido
+        void siguiente();
+
+    private:
+        friend class BPlusTreeCadenas;
+
+        BPlusTreeCadenas* arbol;
+        PaginaFijada hoja;
+        int posicion;
+        // Como en BPlusTree::Iterador: hojas siguientes ya pedidas al pool
+        std::vector<PaginaID> proximas;
+        size_t siguiente_proxima;
+        size_t ventana;
+
+        Iterador(BPlusTreeCadenas* arbol, PaginaFijada hoja, int posicion);
+        // Si la posicion quedo al final de la hoja, avanza hasta la proxima hoja con entradas
+        void saltar_hojas_agotadas();
+        void precargar_hojas(PaginaID id_hoja);
+    };
+
+    // Lanza std::runtime_error si las paginas del paginador no son de PAGINA_SIZE bytes
+    BPlusTreeCadenas(Paginador& paginador, ValorCadenas tipo_valor = ValorCadenas::REGISTRO_ID);
+
+    PaginaID inicializar(PaginaID id_raiz);
+    PaginaID get_id_raiz() const;
+
+    std::optional<RegistroID> buscar(const std::string& clave);
+    std::optional<std::string> buscar_bytes(const std::string& clave);
+
+    // Primera entrada con clave >= clave (invalido si no hay)
+    Iterador buscar_desde(const std::string& clave);
+
+    // Devuelven false (y no insertan) si la clave ya estaba. Lanzan si la entrada pasa de
+    // MAX_ENTRADA.
+    bool insertar(const std::string& clave, RegistroID valor);
+    bool insertar(const std::string& clave, const char* valor, size_t size);
+
+    // Cambia el valor de una clave que ya esta y devuelve el que tenia (nullopt si no esta),
+    // en la misma bajada. Con valores de otro largo la entrada se saca de la hoja y se vuelve
+    // a insertar. Lanza, sin tocar nada, si la entrada nueva pasa de MAX_ENTRADA.
+    std::optional<std::string> reemplazar(const std::string& clave, const char* valor, size_t size);
+
+    // Devuelve el valor que tenia la clave (nullopt si no estaba)
+    std::optional<std::string> eliminar(const std::string& clave);
+
+    // === Carga masiva (ver BPlusTree::construir_desde_ordenados) ===
+
+    // Arma un arbol nuevo de abajo hacia arriba con las entradas de siguiente, en orden
+    // estrictamente creciente de clave (si no, lanza). Cada nodo se llena hasta factor_llenado
+    // de la pagina contando los prefijos comprimidos; el ultimo de cada nivel queda con lo que
+    // sobra. Las paginas se piden al final del archivo y el arbol anterior no se toca: devuelve
+    // su raiz para que quien llama la libere.
+    PaginaID construir_desde_ordenados(const std::function<bool(std::string&, RegistroID&)>& siguiente, double factor_llenado);
+    PaginaID construir_desde_ordenados(const std::function<bool(std::string&, std::string&)>& siguiente, double factor_llenado);
+
+    // === Compactacion (ver BPlusTree y Database::vacuum) ===
+    // Los RegistroID con INVALID_PAGE_ID no apuntan a ninguna pagina y no se traducen
+
+    void marcar_paginas_vivas(std::vector<bool>& vivas);
+    std::vector<PaginaID> reubicar_raiz(const std::vector<PaginaID>& nuevo_id);
+    void reubicar_nodos(const std::vector<PaginaID>& nuevo_id, std::vector<PaginaID>& pendientes, size_t max_nodos);
+
+private:
+    Paginador& paginador;
+    PaginaID id_raiz;
+    ValorCadenas tipo_valor;
+
+    // Una entrada de un nodo con la clave completa, para reescribirlo o dividirlo
+    struct Entrada {
+        std::string clave;
+        std::string valor; // Hojas: los bytes del valor (con REGISTRO_ID, el empaquetado)
+        PaginaID hijo;     // Internos
+    };
+
+    struct ResultadoDivision {
+        std::string separador;
+        PaginaID id_nueva_pagina;
+    };
+
+    struct CargaAscendente;
+
+    // Fija la pagina o lanza std::runtime_error si el paginador no puede dar un frame
+    PaginaFijada fijar(PaginaID id_pagina);
+    // Pagina para un nodo nuevo, inicializada con su latch bloqueado
+    PaginaFijada nueva_pagina(TipoNodo tipo, PaginaID& id);
+
+    // Hoja donde estaria la clave
+    PaginaFijada bajar(const std::string& clave);
+    // Hasta maximo hojas que siguen a la de la clave y cuelgan del mismo padre (ver BPlusTree)
+    void hojas_siguientes(const std::string& clave, size_t maximo, std::vector<PaginaID>& ids);
+
+    bool insertar_valor(const std::string& clave, std::string valor);
+    // Los bytes del valor de la entrada pos de una hoja
+    std::string valor_en_hoja(const char* pagina_ptr, size_t pos) const;
+    // Saca la entrada pos de la hoja, que quien llama tiene fijada y marca sucia
+    void sacar_de_hoja(char* pagina_ptr, size_t pos);
+    std::optional<ResultadoDivision> insertar_en_nodo(PaginaID id_pagina, const std::string& clave, std::string& valor, bool& insertada);
+    // Agrega la entrada en la posicion pos; si no entra divide el nodo
+    std::optional<ResultadoDivision> insertar_entrada(PaginaFijada& pagina, size_t pos, Entrada entrada);
+    ResultadoDivision dividir(PaginaFijada& pagina, std::vector<Entrada>& entradas);
+};
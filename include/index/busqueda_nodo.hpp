@@ -0,0 +1,83 @@
+#include "core/prefetch.hpp"
+#include "core/types.hpp"
+#include <cstddef>
+#include <cstdint>
+
+#pragma once
+
+// Busqueda de una clave dentro de un nodo del B+ Tree (hasta 510 claves en un interno, 408
+// en una hoja; en los dos las claves estan seguidas). En lugar de la busqueda binaria de std::lower_bound, cuyos saltos dependen de
+// cada comparacion y el procesador no puede predecir, se hace:
+//  1. Busqueda binaria sin saltos (el lado elegido se resuelve con un cmov) hasta que queda
+//     una ventana de a lo sumo VENTANA_BUSQUEDA claves. En cada paso se piden a la cache
+//     las dos posiciones que puede mirar el siguiente.
+//  2. Se cuentan con SIMD las claves de la ventana menores que la buscada: como estan
+//     ordenadas, esa cuenta es la posicion.
+//
+// El kernel del paso 2 se elige al arrancar segun el procesador: AVX2 (8 claves por
+// comparacion), SSE2 (4; siempre disponible en x86-64) o escalar en otras arquitecturas.
+// Hay versiones para claves de 4 y de 8 bytes (con 8 bytes, AVX2 compara 4 y SSE2 cuenta
+// con el escalar), y una generica para cualquier clave y comparacion.
+
+constexpr size_t VENTANA_BUSQUEDA = 32;
+
+enum class KernelBusqueda {
+    ESCALAR,
+    SSE2,
+    AVX2,
+};
+
+// Primera posicion con clave >= clave (como std::lower_bound)
+size_t posicion_inferior(const DNI_t* claves, size_t n, DNI_t clave);
+
+// Primera posicion con clave > clave (como std::upper_bound)
+size_t posicion_superior(const DNI_t* claves, size_t n, DNI_t clave);
+
+size_t posicion_inferior(const uint64_t* claves, size_t n, uint64_t clave);
+size_t posicion_superior(const uint64_t* claves, size_t n, uint64_t clave);
+
+// Con cualquier orden estricto comparar(a, b) ("a va antes que b"): la misma busqueda
+// binaria sin saltos, terminando la ventana con una cuenta escalar. Queda en el header para
+// que la comparacion se compile en linea.
+template <typename Clave, typename Comparar>
+size_t posicion_inferior(const Clave* claves, size_t n, const Clave& clave, Comparar comparar) {
+    const Clave* base = claves;
+    size_t len = n;
+    while (len > VENTANA_BUSQUEDA) {
+        size_t mitad = len / 2;
+        prefetch_linea(base + mitad / 2);
+        prefetch_linea(base + mitad + mitad / 2);
+        base = comparar(base[mitad], clave) ? base + mitad : base;
+        len -= mitad;
+    }
+    size_t cuenta = 0;
+    for (size_t i = 0; i < len; i++) {
+        cuenta += comparar(base[i], clave);
+    }
+    return static_cast<size_t>(base - claves) + cuenta;
+}
+
+template <typename Clave, typename Comparar>
+size_t posicion_superior(const Clave* claves, size_t n, const Clave& clave, Comparar comparar) {
+    // Invariante: la respuesta esta en [base, base + len]; base[mitad] <= clave la deja despues
+    const Clave* base = claves;
+    size_t len = n;
+    while (len > VENTANA_BUSQUEDA) {
+        size_t mitad = len / 2;
+        prefetch_linea(base + mitad / 2);
+        prefetch_linea(base + mitad + mitad / 2);
+        base = !comparar(clave, base[mitad]) ? base + mitad : base;
+        len -= mitad;
+    }
+    size_t cuenta = 0;
+    for (size_t i = 0; i < len; i++) {
+        cuenta += !comparar(clave, base[i]);
+    }
+    return static_cast<size_t>(base - claves) + cuenta;
+}
+
+// Para benchmarks: cambia el kernel en uso. Devuelve false (y no cambia nada) si el
+// procesador no lo soporta.
+bool usar_kernel_busqueda(KernelBusqueda kernel);
+KernelBusqueda get_kernel_busqueda();
+const char* nombre_kernel_busqueda(KernelBusqueda kernel);
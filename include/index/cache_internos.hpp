@@ -0,0 +1,100 @@
+#include "almacenamiento/paginador.hpp"
+#include "core/latch_optimista.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#pragma once
+
+// Un nodo interno que CacheInternos mantiene fijado
+struct NodoFijado {
+    // INVALID_PAGE_ID desde que el arbol libero la pagina (ver CacheInternos::olvidar)
+    std::atomic<PaginaID> id;
+    // Distancia a las hojas: los hijos de un nodo de nivel 1 son hojas. No cambia mientras
+    // el nodo exista, porque el arbol solo crece o se achica por la raiz.
+    uint32_t nivel;
+    char* datos;               // El frame (BUFFER_POOL) o el mapeo: la pagina misma, no una copia
+    LatchOptimista* latch;
+    // El hijo de cada posicion la ultima vez que se bajo por ahi (nullptr: todavia no).
+    // Antes de seguirlo se compara su id con el que el nodo tiene en esa posicion: si una
+    // division o una fusion corrio los hijos, o el hijo se libero, no coincide y se vuelve
+    // a resolver.
+    std::unique_ptr<std::atomic<NodoFijado*>[]> hijos;
+    PaginaFijada pagina;
+};
+
+// Los niveles internos de un B+ Tree fijados en memoria, con los punteros a los hijos ya
+// resueltos (pointer swizzling): una bajada que los encuentra no pasa por el paginador (ni
+// por la tabla de paginas del pool, ni por el pin de cada frame) hasta la hoja. Las paginas
+// siguen siendo las del paginador y el arbol las modifica por ahi como siempre.
+//
+// Solo se usa en BUFFER_POOL: en MAPEO fijar una pagina no cuesta mas que seguir el puntero.
+// La raiz se anota despues de una bajada validada que midio la altura, y los demas nodos al
+// bajar por ellos. Cada nodo ocupa un frame: se fijan como mucho 1/32 de los frames, y los
+// que no entran se leen del paginador. Los nodos solo se sueltan con vaciar()
+// o, uno por uno, cuando el arbol libera su pagina.
+//
+// Las busquedas optimistas del arbol la usan desde varios hilos: los punteros resueltos se
+// leen sin lock, y lo que la cambia toma su mutex. Un NodoFijado que se olvida no se borra
+// hasta vaciar(), porque alguna bajada puede estar leyendolo todavia.
+class CacheInternos {
+public:
+    // max_hijos: el orden de los nodos internos
+    CacheInternos(Paginador& paginador, size_t max_hijos);
+
+    // El nodo de la raiz si esta anotada con ese id
+    NodoFijado* raiz(PaginaID id_raiz) {
+        NodoFijado* nodo = raiz_actual.load(std::memory_order_acquire);
+        if (nodo != nullptr && nodo->id.load(std::memory_order_acquire) == id_raiz) {
+            return nodo;
+        }
+        return nullptr;
+    }
+
+    // Despues de bajar desde id_raiz hasta una hoja a esa altura (1: sus hijos son hojas).
+    // version es la de la raiz al empezar la bajada: si cambio, la altura puede no ser esa y
+    // no se anota. Se valida con el mutex tomado, asi que una raiz que se libera despues
+    // (el arbol bloquea su latch antes de olvidarla) no queda anotada.
+    void anotar_raiz(PaginaID id_raiz, uint32_t altura, uint64_t version);
+
+    // El hijo interno de la posicion pos del padre, que en la pagina es id_hijo. nullptr si
+    // los hijos son hojas o si no hay lugar para fijarlo.
+    NodoFijado* hijo(NodoFijado* padre, size_t pos, PaginaID id_hijo) {
+        NodoFijado* nodo = padre->hijos[pos].load(std::memory_order_acquire);
+        if (nodo != nullptr && nodo->id.load(std::memory_order_acquire) == id_hijo) {
+            return nodo;
+        }
+        return resolver(padre, pos, id_hijo);
+    }
+
+    // El arbol va a liberar la pagina: si era un nodo fijado se suelta
+    void olvidar(PaginaID id);
+
+    // Suelta todos los nodos. Nadie puede estar usando el arbol (ver BPlusTreeGenerico):
+    // lo llama cuando se rearma o se reubica, y antes de cerrar el paginador.
+    void vaciar();
+
+    size_t get_num_nodos();
+
+private:
+    Paginador& paginador;
+    size_t max_hijos;
+    size_t max_nodos; // Se calcula al fijar el primero, con el paginador ya abierto
+
+    // Sin lugar para mas nodos: las bajadas que no los encuentran no toman el mutex
+    std::atomic<bool> llena;
+
+    std::mutex mutex;
+    std::atomic<NodoFijado*> raiz_actual;
+    std::unordered_map<PaginaID, std::unique_ptr<NodoFijado>> nodos;
+    std::vector<std::unique_ptr<NodoFijado>> olvidados;
+
+    NodoFijado* resolver(NodoFijado* padre, size_t pos, PaginaID id_hijo);
+    // Con el mutex tomado. nullptr si no hay lugar o no se pudo fijar la pagina.
+    NodoFijado* fijar_nodo(PaginaID id, uint32_t nivel);
+    void olvidar_nodo(std::unordered_map<PaginaID, std::unique_ptr<NodoFijado>>::iterator it);
+};
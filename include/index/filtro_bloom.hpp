@@ -0,0 +1,61 @@
+#include "almacenamiento/pagina.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#pragma once
+
+// Filtro de Bloom de las claves de un indice, en memoria: dice si una clave puede estar, sin
+// falsos negativos, asi una busqueda de una clave que no esta vuelve sin bajar por el arbol.
+// Con BITS_POR_CLAVE bits por clave se equivoca (dice que puede estar) en ~1% de las ausentes.
+//
+// Es un filtro por bloques (split block): cada clave cae en un bloque de 32 bytes y marca un
+// bit en cada una de sus 8 palabras, asi que agregar o consultar toca una sola linea de cache.
+// Los bloques se agrupan en paginas de PAGINA_SIZE para guardarlo tal cual en el archivo
+// (ver Database::guardar_filtro), y recuerda que paginas cambiaron desde que se guardo.
+//
+// No se pueden sacar claves: las que se eliminan siguen dando "puede estar" hasta que se
+// vuelva a armar. Las consultas se pueden hacer desde varios hilos mientras otro agrega.
+class FiltroBloom {
+public:
+    static constexpr size_t BITS_POR_CLAVE = 10;
+    static constexpr size_t BYTES_BLOQUE = 32;
+    static constexpr size_t BLOQUES_POR_PAGINA = PAGINA_SIZE / BYTES_BLOQUE;
+    // Capacidad minima al armarlo, para que una base chica no lo vuelva a armar enseguida
+    static constexpr size_t MIN_CLAVES = 65536;
+
+    // Paginas para capacidad claves, y claves que entran en num_paginas sin pasar del ~1% de errores
+    static size_t paginas_para(size_t capacidad);
+    static size_t capacidad_de(size_t num_paginas) { return num_paginas * BLOQUES_POR_PAGINA * BYTES_BLOQUE * 8 / BITS_POR_CLAVE; }
+
+    // Vacio y con todas las paginas sin guardar
+    explicit FiltroBloom(size_t num_paginas);
+
+    void agregar(uint64_t clave);
+    bool puede_estar(uint64_t clave) const;
+
+    // Claves agregadas (las repetidas y las que despues se eliminaron tambien cuentan)
+    size_t get_num_claves() const { return num_claves; }
+    size_t get_capacidad() const { return capacidad_de(num_paginas); }
+    size_t get_num_paginas() const { return num_paginas; }
+
+    // === Persistencia ===
+    void copiar_pagina(size_t pagina, char* destino) const;
+    // Al abrir, desde lo guardado. num_claves es el que se guardo con las paginas.
+    void cargar_pagina(size_t pagina, const char* origen);
+    void fijar_num_claves(size_t claves) { num_claves = claves; }
+
+    bool pagina_cambiada(size_t pagina) const { return cambiadas[pagina]; }
+    void marcar_guardado();
+    // Todas las paginas, por ejemplo para guardarlo en otro lugar
+    void marcar_sin_guardar();
+
+private:
+    size_t num_paginas;
+    size_t num_bloques;
+    size_t num_claves;
+    std::unique_ptr<std::atomic<uint32_t>[]> palabras; // 8 por bloque
+    std::vector<bool> cambiadas;                         // Una por pagina
+};
@@ -0,0 +1,261 @@
+#include "almacenamiento/anillo_io.hpp"
+#include <algorithm>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sched.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+
+AnilloIO::AnilloIO() {
+    anillo_fd = -1;
+    entradas = 0;
+    sq_mapa = nullptr;
+    sq_mapa_size = 0;
+    cq_mapa = nullptr;
+    cq_mapa_size = 0;
+    sqes = nullptr;
+    sqes_size = 0;
+    sq_cabeza = sq_cola = sq_mascara = sq_arreglo = nullptr;
+    cq_cabeza = cq_cola = cq_mascara = nullptr;
+    cqes = nullptr;
+}
+
+AnilloIO::~AnilloIO() {
+    cerrar();
+}
+
+bool AnilloIO::activo() const {
+    return anillo_fd >= 0;
+}
+
+#ifdef __linux__
+
+// glibc no trae envolturas para io_uring, las llamamos por numero
+static int io_uring_setup(unsigned entradas, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entradas, params));
+}
+
+static int io_uring_enter(int anillo_fd, unsigned a_enviar, unsigned min_completados, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, anillo_fd, a_enviar, min_completados, flags, nullptr, 0));
+}
+
+// Termina con pread/pwrite lo que quedo pendiente a partir del byte `hecho`
+static bool completar_sincrono(int fd, const PeticionIO& peticion, size_t hecho) {
+    while (hecho < peticion.bytes) {
+        ssize_t n = peticion.escritura
+            ? pwrite(fd, peticion.buffer + hecho, peticion.bytes - hecho, static_cast<off_t>(peticion.offset + hecho))
+            : pread(fd, peticion.buffer + hecho, peticion.bytes - hecho, static_cast<off_t>(peticion.offset + hecho));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        hecho += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool AnilloIO::abrir(unsigned profundidad) {
+    cerrar();
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    int fd = io_uring_setup(profundidad, &params);
+    if (fd < 0) {
+        return false; // ENOSYS (kernel viejo) o EPERM (bloqueado): se usara pread/pwrite
+    }
+    anillo_fd = fd;
+    entradas = params.sq_entries; // El kernel lo redondea a potencia de 2
+
+    sq_mapa_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_mapa_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    // Desde 5.4 las dos colas comparten un solo mapeo
+    bool mapa_unico = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (mapa_unico) {
+        sq_mapa_size = cq_mapa_size = std::max(sq_mapa_size, cq_mapa_size);
+    }
+
+    void* mapa = mmap(nullptr, sq_mapa_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (mapa == MAP_FAILED) {
+        cerrar();
+        return false;
+    }
+    sq_mapa = mapa;
+
+    if (mapa_unico) {
+        cq_mapa = sq_mapa;
+    } else {
+        mapa = mmap(nullptr, cq_mapa_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (mapa == MAP_FAILED) {
+            cerrar();
+            return false;
+        }
+        cq_mapa = mapa;
+    }
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    mapa = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (mapa == MAP_FAILED) {
+        cerrar();
+        return false;
+    }
+    sqes = mapa;
+
+    char* sq = static_cast<char*>(sq_mapa);
+    sq_cabeza = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_cola = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mascara = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_arreglo = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char* cq = static_cast<char*>(cq_mapa);
+    cq_cabeza = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_cola = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mascara = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+
+    return true;
+}
+
+void AnilloIO::cerrar() {
+    if (sqes != nullptr) {
+        munmap(sqes, sqes_size);
+    }
+    if (cq_mapa != nullptr && cq_mapa != sq_mapa) {
+        munmap(cq_mapa, cq_mapa_size);
+    }
+    if (sq_mapa != nullptr) {
+        munmap(sq_mapa, sq_mapa_size);
+    }
+    if (anillo_fd >= 0) {
+        ::close(anillo_fd);
+    }
+
+    anillo_fd = -1;
+    entradas = 0;
+    sq_mapa = cq_mapa = sqes = nullptr;
+    sq_cabeza = sq_cola = sq_mascara = sq_arreglo = nullptr;
+    cq_cabeza = cq_cola = cq_mascara = nullptr;
+    cqes = nullptr;
+}
+
+bool AnilloIO::ejecutar(int fd, PeticionIO* peticiones, size_t cantidad) {
+    if (!activo()) {
+        return false;
+    }
+
+    // READV/WRITEV (5.1+) en lugar de READ/WRITE (5.6+); el iovec debe vivir hasta que se complete
+    std::vector<iovec> iov(cantidad);
+    auto* arreglo_sqes = static_cast<io_uring_sqe*>(sqes);
+    auto* arreglo_cqes = static_cast<io_uring_cqe*>(cqes);
+
+    size_t siguiente = 0;     // Proxima peticion a encolar
+    size_t completadas = 0;
+    unsigned en_vuelo = 0;    // Encoladas y todavia sin completar (incluye las no enviadas)
+    unsigned sin_enviar = 0;  // Encoladas que el kernel aun no tomo
+    bool fallo_anillo = false;
+    bool exito = true;
+
+    while (completadas < siguiente || (!fallo_anillo && siguiente < cantidad)) {
+
+        if (!fallo_anillo) {
+            // Limitamos las peticiones en vuelo al tamaño de la cola de envio; la de completados
+            // es el doble, asi nunca se desborda
+            unsigned cola = *sq_cola;
+            while (siguiente < cantidad && en_vuelo < entradas) {
+                PeticionIO& peticion = peticiones[siguiente];
+                iov[siguiente].iov_base = peticion.buffer;
+                iov[siguiente].iov_len = peticion.bytes;
+
+                unsigned indice = cola & *sq_mascara;
+                io_uring_sqe* sqe = &arreglo_sqes[indice];
+                std::memset(sqe, 0, sizeof(*sqe));
+                sqe->opcode = peticion.escritura ? IORING_OP_WRITEV : IORING_OP_READV;
+                sqe->fd = fd;
+                sqe->off = peticion.offset;
+                sqe->addr = reinterpret_cast<unsigned long long>(&iov[siguiente]);
+                sqe->len = 1;
+                sqe->user_data = siguiente;
+                sq_arreglo[indice] = indice;
+
+                cola++;
+                siguiente++;
+                en_vuelo++;
+                sin_enviar++;
+            }
+            // El kernel debe ver las SQEs escritas antes que la nueva cola
+            __atomic_store_n(sq_cola, cola, __ATOMIC_RELEASE);
+
+            int enviadas = io_uring_enter(anillo_fd, sin_enviar, 1, IORING_ENTER_GETEVENTS);
+            if (enviadas >= 0) {
+                sin_enviar -= static_cast<unsigned>(enviadas);
+            } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                // Error del anillo (no deberia pasar). Las que no llegaron al kernel se retiran y se
+                // hacen con pread/pwrite; las que ya estan en vuelo se esperan igual.
+                __atomic_store_n(sq_cola, cola - sin_enviar, __ATOMIC_RELEASE);
+                siguiente -= sin_enviar;
+                en_vuelo -= sin_enviar;
+                sin_enviar = 0;
+                fallo_anillo = true;
+            }
+        }
+
+        unsigned cabeza = *cq_cabeza;
+        unsigned cola_cq = __atomic_load_n(cq_cola, __ATOMIC_ACQUIRE);
+
+        if (fallo_anillo && cabeza == cola_cq && completadas < siguiente) {
+            sched_yield(); // Sin io_uring_enter solo nos queda esperar a que aparezcan los completados
+            continue;
+        }
+
+        while (cabeza != cola_cq) {
+            io_uring_cqe* cqe = &arreglo_cqes[cabeza & *cq_mascara];
+            PeticionIO& peticion = peticiones[cqe->user_data];
+
+            // Un error o una transferencia corta se reintenta de forma sincrona desde donde quedo
+            size_t hecho = cqe->res < 0 ? 0 : static_cast<size_t>(cqe->res);
+            peticion.exito = completar_sincrono(fd, peticion, hecho);
+            exito = exito && peticion.exito;
+
+            cabeza++;
+            completadas++;
+            en_vuelo--;
+        }
+        __atomic_store_n(cq_cabeza, cabeza, __ATOMIC_RELEASE);
+    }
+
+    if (fallo_anillo) {
+        for (size_t i = siguiente; i < cantidad; i++) {
+            peticiones[i].exito = completar_sincrono(fd, peticiones[i], 0);
+            exito = exito && peticiones[i].exito;
+        }
+        cerrar(); // Las siguientes llamadas van directo a pread/pwrite
+    }
+
+    return exito;
+}
+
+#else
+
+bool AnilloIO::abrir(unsigned /*profundidad*/) {
+    return false;
+}
+
+void AnilloIO::cerrar() {
+}
+
+bool AnilloIO::ejecutar(int /*fd*/, PeticionIO* /*peticiones*/, size_t /*cantidad*/) {
+    return false;
+}
+
+#endif
@@ -0,0 +1,333 @@
+#include "almacenamiento/archivo_directo.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <fileapi.h>
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+
+ArchivoDirecto::ArchivoDirecto() {
+
+    #ifdef _WIN32
+        archivo_handle = INVALID_HANDLE_VALUE;
+    #else
+        archivo_fd = -1;
+    #endif
+    size = 0;
+    directo = false;
+
+}
+
+ArchivoDirecto::~ArchivoDirecto() {
+    cerrar();
+}
+
+#ifdef _WIN32
+
+bool ArchivoDirecto::abrir (const std::string& ruta, size_t initial_size, bool io_directa) {
+
+    // FILE_FLAG_NO_BUFFERING es el equivalente de O_DIRECT: las lecturas no pasan por la cache del sistema
+    DWORD flags = FILE_ATTRIBUTE_NORMAL;
+    if (io_directa) {
+        flags |= FILE_FLAG_NO_BUFFERING | FILE_FLAG_WRITE_THROUGH;
+    }
+
+    archivo_handle = CreateFileA(ruta.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, flags, NULL);
+    directo = io_directa;
+
+    if (archivo_handle == INVALID_HANDLE_VALUE && io_directa) {
+        archivo_handle = CreateFileA(ruta.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        directo = false;
+    }
+
+    if (archivo_handle == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(archivo_handle, &file_size)) {
+        cerrar();
+        return false;
+    }
+    size = static_cast<size_t>(file_size.QuadPart);
+
+    size_t tamano = initial_size != 0 ? initial_size : size;
+    if (tamano == 0) {
+        cerrar();
+        return false;
+    }
+
+    if (size < tamano && !redimensionar(tamano)) {
+        cerrar();
+        return false;
+    }
+
+    return true;
+}
+
+bool ArchivoDirecto::cerrar () {
+
+    if (archivo_handle == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    CloseHandle(archivo_handle);
+    archivo_handle = INVALID_HANDLE_VALUE;
+    size = 0;
+    directo = false;
+
+    return true;
+}
+
+bool ArchivoDirecto::leer (size_t offset, char* buffer, size_t bytes) {
+
+    // Con un OVERLAPPED indicamos el offset sin mover el puntero del archivo (como pread)
+    OVERLAPPED posicion = {};
+    posicion.Offset = (DWORD)(offset & 0xFFFFFFFF);
+    posicion.OffsetHigh = (DWORD)(offset >> 32);
+
+    DWORD leidos = 0;
+    if (!ReadFile(archivo_handle, buffer, (DWORD)bytes, &leidos, &posicion)) {
+        return false;
+    }
+    return leidos == bytes;
+}
+
+bool ArchivoDirecto::escribir (size_t offset, const char* buffer, size_t bytes) {
+
+    OVERLAPPED posicion = {};
+    posicion.Offset = (DWORD)(offset & 0xFFFFFFFF);
+    posicion.OffsetHigh = (DWORD)(offset >> 32);
+
+    DWORD escritos = 0;
+    if (!WriteFile(archivo_handle, buffer, (DWORD)bytes, &escritos, &posicion)) {
+        return false;
+    }
+    return escritos == bytes;
+}
+
+bool ArchivoDirecto::redimensionar (size_t nuevo_size) {
+
+    LARGE_INTEGER nuevo_fin;
+    nuevo_fin.QuadPart = static_cast<LONGLONG>(nuevo_size);
+
+    if (!SetFilePointerEx(archivo_handle, nuevo_fin, NULL, FILE_BEGIN) || !SetEndOfFile(archivo_handle)) {
+        return false;
+    }
+
+    size = nuevo_size;
+    return true;
+}
+
+bool ArchivoDirecto::perforar (size_t offset, size_t longitud) {
+
+    // El archivo tiene que ser disperso para que Windows suelte los bloques en cero
+    DWORD bytes = 0;
+    if (!DeviceIoControl(archivo_handle, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &bytes, NULL)) {
+        return false;
+    }
+
+    FILE_ZERO_DATA_INFORMATION rango;
+    rango.FileOffset.QuadPart = static_cast<LONGLONG>(offset);
+    rango.BeyondFinalZero.QuadPart = static_cast<LONGLONG>(offset + longitud);
+    return DeviceIoControl(archivo_handle, FSCTL_SET_ZERO_DATA, &rango, sizeof(rango), NULL, 0, &bytes, NULL) != 0;
+}
+
+// En Windows no hay io_uring; los lotes se hacen de a una peticion
+bool ArchivoDirecto::activar_io_uring (unsigned /*profundidad*/) {
+    return false;
+}
+
+bool ArchivoDirecto::ejecutar_lote (PeticionIO* peticiones, size_t cantidad, bool /*segundo_plano*/) {
+    bool exito = true;
+    for (size_t i = 0; i < cantidad; i++) {
+        PeticionIO& peticion = peticiones[i];
+        peticion.exito = peticion.escritura
+            ? escribir(peticion.offset, peticion.buffer, peticion.bytes)
+            : leer(peticion.offset, peticion.buffer, peticion.bytes);
+        exito = exito && peticion.exito;
+    }
+    return exito;
+}
+
+bool ArchivoDirecto::sincronizar () {
+    return FlushFileBuffers(archivo_handle) != 0;
+}
+
+#else
+
+bool ArchivoDirecto::abrir (const std::string& ruta, size_t initial_size, bool io_directa) {
+
+    directo = false;
+    archivo_fd = -1;
+
+    #ifdef O_DIRECT
+        if (io_directa) {
+            archivo_fd = ::open(ruta.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+            directo = archivo_fd >= 0;
+        }
+    #else
+        (void)io_directa;
+    #endif
+
+    // Sin O_DIRECT (o si el sistema de archivos lo rechaza con EINVAL) abrimos normal
+    if (archivo_fd < 0) {
+        archivo_fd = ::open(ruta.c_str(), O_RDWR | O_CREAT, 0644);
+    }
+
+    if (archivo_fd < 0) { return false; }
+
+    struct stat info;
+    if (fstat(archivo_fd, &info) != 0) {
+        cerrar();
+        return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+
+    // Si initial_size es 0, usar el tamaño del archivo existente
+    size_t tamano = initial_size != 0 ? initial_size : size;
+    if (tamano == 0) {
+        cerrar();
+        return false;
+    }
+
+    if (size < tamano && !redimensionar(tamano)) {
+        cerrar();
+        return false;
+    }
+
+    return true;
+}
+
+bool ArchivoDirecto::cerrar () {
+
+    if (archivo_fd < 0) {
+        return false;
+    }
+
+    anillo.cerrar();
+    anillo_segundo_plano.cerrar();
+    ::close(archivo_fd);
+    archivo_fd = -1;
+    size = 0;
+    directo = false;
+
+    return true;
+}
+
+bool ArchivoDirecto::leer (size_t offset, char* buffer, size_t bytes) {
+
+    // pread puede devolver menos bytes de los pedidos (por ejemplo si llega una señal), repetimos hasta completar
+    size_t total = 0;
+    while (total < bytes) {
+        ssize_t leidos = pread(archivo_fd, buffer + total, bytes - total, static_cast<off_t>(offset + total));
+        if (leidos < 0 && errno == EINTR) {
+            continue;
+        }
+        if (leidos <= 0) {
+            return false;
+        }
+        total += static_cast<size_t>(leidos);
+    }
+    return true;
+}
+
+bool ArchivoDirecto::escribir (size_t offset, const char* buffer, size_t bytes) {
+
+    size_t total = 0;
+    while (total < bytes) {
+        ssize_t escritos = pwrite(archivo_fd, buffer + total, bytes - total, static_cast<off_t>(offset + total));
+        if (escritos < 0 && errno == EINTR) {
+            continue;
+        }
+        if (escritos <= 0) {
+            return false;
+        }
+        total += static_cast<size_t>(escritos);
+    }
+    return true;
+}
+
+bool ArchivoDirecto::redimensionar (size_t nuevo_size) {
+
+    // Al crecer preasignamos los bloques con fallocate, igual que MapeoMemoria
+    #ifdef __linux__
+        if (nuevo_size > size && fallocate(archivo_fd, 0, static_cast<off_t>(size), static_cast<off_t>(nuevo_size - size)) == 0) {
+            size = nuevo_size;
+            return true;
+        }
+    #endif
+
+    if (ftruncate(archivo_fd, static_cast<off_t>(nuevo_size)) != 0) {
+        return false;
+    }
+
+    size = nuevo_size;
+    return true;
+}
+
+bool ArchivoDirecto::perforar (size_t offset, size_t longitud) {
+
+    #if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+        return fallocate(archivo_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset), static_cast<off_t>(longitud)) == 0;
+    #else
+        (void)offset;
+        (void)longitud;
+        return false;
+    #endif
+}
+
+bool ArchivoDirecto::activar_io_uring (unsigned profundidad) {
+    if (archivo_fd < 0) {
+        return false;
+    }
+    if (!anillo.abrir(profundidad)) {
+        return false;
+    }
+    // Si este no se puede crear, los lotes del otro hilo van con pwrite
+    anillo_segundo_plano.abrir(profundidad);
+    return true;
+}
+
+bool ArchivoDirecto::ejecutar_lote (PeticionIO* peticiones, size_t cantidad, bool segundo_plano) {
+    AnilloIO& anillo_lote = segundo_plano ? anillo_segundo_plano : anillo;
+    if (anillo_lote.activo()) {
+        return anillo_lote.ejecutar(archivo_fd, peticiones, cantidad);
+    }
+
+    bool exito = true;
+    for (size_t i = 0; i < cantidad; i++) {
+        PeticionIO& peticion = peticiones[i];
+        peticion.exito = peticion.escritura
+            ? escribir(peticion.offset, peticion.buffer, peticion.bytes)
+            : leer(peticion.offset, peticion.buffer, peticion.bytes);
+        exito = exito && peticion.exito;
+    }
+    return exito;
+}
+
+bool ArchivoDirecto::sincronizar () {
+    #ifdef __linux__
+        return fdatasync(archivo_fd) == 0;
+    #else
+        return fsync(archivo_fd) == 0;
+    #endif
+}
+
+#endif
+
+size_t ArchivoDirecto::get_size () const {
+    return size;
+}
+
+bool ArchivoDirecto::esta_en_modo_directo () const {
+    return directo;
+}
+
+bool ArchivoDirecto::usa_io_uring () const {
+    return anillo.activo();
+}
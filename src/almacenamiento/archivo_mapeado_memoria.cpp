@@ -1,14 +1,34 @@
 #include "almacenamiento/archivo_mapeado_memoria.hpp"
+#include <algorithm>
+
+#ifdef _WIN32
 #include <windows.h>
 #include <fileapi.h>
+#include <winioctl.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 
 MapeoMemoria::MapeoMemoria() {
 
-    archivo_handle = INVALID_HANDLE_VALUE;
-    mapeo_handle = NULL;
-    datos = nullptr;
+    #ifdef _WIN32
+        archivo_handle = INVALID_HANDLE_VALUE;
+        mapeo_handle = NULL;
+    #else
+        archivo_fd = -1;
+        reserva = nullptr;
+        reserva_size = 0;
+    #endif
+    size_segmento = 0;
+    bits_segmento = 0;
     size = 0;
+    tabla = nullptr;
+    capacidad_tabla = 0;
 
 }
 
@@ -16,7 +36,126 @@ MapeoMemoria::~MapeoMemoria() {
     cerrar();
 }
 
-bool MapeoMemoria::abrir (const std::string& ruta, size_t initial_size) {
+static size_t redondear_arriba(size_t valor, size_t multiplo) {
+    return ((valor + multiplo - 1) / multiplo) * multiplo;
+}
+
+// Menor potencia de 2 >= valor
+static size_t potencia_de_dos_arriba(size_t valor) {
+    size_t potencia = 1;
+    while (potencia < valor) {
+        potencia <<= 1;
+    }
+    return potencia;
+}
+
+static unsigned log2_exacto(size_t potencia) {
+    unsigned bits = 0;
+    while ((size_t(1) << bits) < potencia) {
+        bits++;
+    }
+    return bits;
+}
+
+// Numero de segmentos necesarios para cubrir `bytes` del archivo
+static size_t segmentos_para(size_t bytes, size_t size_segmento) {
+    return (bytes + size_segmento - 1) / size_segmento;
+}
+
+// Al achicar, los segmentos se sacan solo del vector: las entradas que sobran en la tabla no
+// se leen (estan fuera del archivo) y los segmentos que se agreguen despues las pisan
+void MapeoMemoria::agregar_segmento(char* segmento) {
+    segmentos.push_back(segmento);
+    size_t indice = segmentos.size() - 1;
+    if (indice < capacidad_tabla) {
+        tabla.load(std::memory_order_relaxed)[indice] = segmento;
+        return;
+    }
+
+    size_t capacidad = std::max<size_t>(64, capacidad_tabla * 2);
+    std::unique_ptr<char*[]> nueva(new char*[capacidad]);
+    std::copy(segmentos.begin(), segmentos.end(), nueva.get());
+    tabla.store(nueva.get(), std::memory_order_release);
+    tablas.push_back(std::move(nueva));
+    capacidad_tabla = capacidad;
+}
+
+#ifdef _WIN32
+
+// Windows exige que el offset de MapViewOfFile sea multiplo de esta granularidad (normalmente 64KB)
+static size_t granularidad_mapeo() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+}
+
+// Crea un objeto de mapeo para los primeros `bytes` del archivo. Si el archivo es mas chico,
+// CreateFileMappingA lo hace crecer hasta ese tamaño.
+static HANDLE crear_mapeo(HANDLE archivo_handle, size_t bytes) {
+    /*
+    Sacado de la documentacion de microsoft
+
+    HANDLE CreateFileMappingA(
+        [in]           HANDLE                hFile,
+        [in, optional] LPSECURITY_ATTRIBUTES lpFileMappingAttributes,
+        [in]           DWORD                 flProtect,
+        [in]           DWORD                 dwMaximumSizeHigh,
+        [in]           DWORD                 dwMaximumSizeLow,
+        [in, optional] LPCSTR                lpName
+    );
+    */
+
+    // DWORD es un tipo de dato definido por Windows en la API de Win32.
+    // WORD = 16 bits, DWORD = 32bits
+    // DWORD = unsigned long con un rango de (0......4,294,967,295)
+    return CreateFileMappingA(
+        archivo_handle,                    // Handle que creamos antes
+        NULL,                              // Sin atributos de seguridad
+        PAGE_READWRITE,                    // Poder leer y escribir
+        // Algunas funciones de windows solo aceptan 64bits dividido en dos valores de 32 bits. High-order DWORD & Low-order DWORD
+        (DWORD)(bytes >> 32),              // Tamaño alto (64-bit)
+        (DWORD)(bytes & 0xFFFFFFFF),       // Tamaño bajo (32-bit)
+        NULL
+        );
+}
+
+bool MapeoMemoria::mapear_segmento(size_t indice) {
+    /*
+    LPVOID MapViewOfFile(
+        [in] HANDLE hFileMappingObject,
+        [in] DWORD  dwDesiredAccess,
+        [in] DWORD  dwFileOffsetHigh,
+        [in] DWORD  dwFileOffsetLow,
+        [in] SIZE_T dwNumberOfBytesToMap
+    );
+    */
+
+    size_t offset = indice * size_segmento;
+
+    // FILE_MAP_COPY: copia en escritura, las vistas no modifican el archivo
+    char* vista = (char*)MapViewOfFile(
+        mapeo_handle,
+        opciones.copia_privada ? FILE_MAP_COPY : FILE_MAP_ALL_ACCESS,
+        (DWORD)(offset >> 32),
+        (DWORD)(offset & 0xFFFFFFFF),
+        size_segmento
+    );
+
+    if (vista == nullptr) {
+        return false;
+    }
+
+    agregar_segmento(vista);
+    return true;
+}
+
+void MapeoMemoria::desmapear_segmento(size_t indice) {
+    UnmapViewOfFile(segmentos[indice]);
+}
+
+bool MapeoMemoria::abrir (const std::string& ruta, size_t initial_size, const OpcionesMapeo& opciones) {
+
+    this->opciones = opciones;
 
     /*
     La documentacion de microsoft nos dice que:
@@ -55,67 +194,37 @@ bool MapeoMemoria::abrir (const std::string& ruta, size_t initial_size) {
         // Si el archivo está vacío y initial_size es 0, no podemos crear un mapeo válido
         if (tamano_mapeo == 0) {
             CloseHandle(archivo_handle);
+            archivo_handle = INVALID_HANDLE_VALUE;
             return false;
         }
     }
 
-    /*
-    Sacado de la documentacion de microsoft
+    size_segmento = potencia_de_dos_arriba(std::max(opciones.size_segmento, granularidad_mapeo()));
+    bits_segmento = log2_exacto(size_segmento);
 
-    HANDLE CreateFileMappingA(
-        [in]           HANDLE                hFile,
-        [in, optional] LPSECURITY_ATTRIBUTES lpFileMappingAttributes,
-        [in]           DWORD                 flProtect,
-        [in]           DWORD                 dwMaximumSizeHigh,
-        [in]           DWORD                 dwMaximumSizeLow,
-        [in, optional] LPCSTR                lpName
-    );
-    */
+    // Una vista no puede pasar del final del objeto de mapeo. Para que el ultimo segmento
+    // tenga su tamaño completo (y no haya que remapearlo al crecer) el archivo crece
+    // siempre en segmentos enteros.
+    tamano_mapeo = redondear_arriba(tamano_mapeo, size_segmento);
 
-    // DWORD es un tipo de dato definido por Windows en la API de Win32.
-    // WORD = 16 bits, DWORD = 32bits
-    // DWORD = unsigned long con un rango de (0......4,294,967,295)
-    mapeo_handle = CreateFileMappingA(
-        archivo_handle,                    // Handle que creamos antes
-        NULL,                              // Sin atributos de seguridad
-        PAGE_READWRITE,                    // Poder leer y escribir
-        // Algunas funciones de windows solo aceptan 64bits dividido en dos valores de 32 bits. High-order DWORD & Low-order DWORD
-        (DWORD)(tamano_mapeo >> 32),       // Tamaño alto (64-bit)
-        (DWORD)(tamano_mapeo & 0xFFFFFFFF), // Tamaño bajo (32-bit)
-        NULL
-        );
+    mapeo_handle = crear_mapeo(archivo_handle, tamano_mapeo);
 
     // La documentacion dice que si falla CreateFileMappingA devuelve un NULL
     if (mapeo_handle == NULL) {
         CloseHandle(archivo_handle);
+        archivo_handle = INVALID_HANDLE_VALUE;
         return false;
     }
 
-    /*
-    LPVOID MapViewOfFile(
-        [in] HANDLE hFileMappingObject,
-        [in] DWORD  dwDesiredAccess,
-        [in] DWORD  dwFileOffsetHigh,
-        [in] DWORD  dwFileOffsetLow,
-        [in] SIZE_T dwNumberOfBytesToMap
-    );
-    */
-
-    datos = (char*)MapViewOfFile( // Asignamos directamente el valor a la variable global "datos" de la clase
-        mapeo_handle,
-        FILE_MAP_ALL_ACCESS,
-        0,
-        0,
-        tamano_mapeo
-    );
-
-    if (datos == nullptr) {
-        CloseHandle(archivo_handle);
-        CloseHandle(mapeo_handle);
-        return false;
+    size_t num_segmentos = segmentos_para(tamano_mapeo, size_segmento);
+    for (size_t i = 0; i < num_segmentos; i++) {
+        if (!mapear_segmento(i)) {
+            cerrar();
+            return false;
+        }
     }
 
-    // Actualizamos las variables globales de la clase para guardar datos y tamano
+    // Actualizamos las variables globales de la clase para guardar el tamano
     // si no cuando retornemos la funcion perdemos estos datos
     size = tamano_mapeo;
 
@@ -125,15 +234,20 @@ bool MapeoMemoria::abrir (const std::string& ruta, size_t initial_size) {
 
 bool MapeoMemoria::cerrar () {
 
-    if (archivo_handle == INVALID_HANDLE_VALUE || mapeo_handle == NULL|| datos == nullptr) {
+    if (archivo_handle == INVALID_HANDLE_VALUE || mapeo_handle == NULL) {
         return false;
     }
 
-    UnmapViewOfFile(datos);
+    for (size_t i = 0; i < segmentos.size(); i++) {
+        desmapear_segmento(i);
+    }
+    segmentos.clear();
+    tabla = nullptr;
+    capacidad_tabla = 0;
+    tablas.clear();
     CloseHandle(mapeo_handle);
     CloseHandle(archivo_handle);
 
-    datos = nullptr;
     size = 0;
     archivo_handle = INVALID_HANDLE_VALUE;
     mapeo_handle = NULL;
@@ -143,59 +257,565 @@ bool MapeoMemoria::cerrar () {
 
 bool MapeoMemoria::redimensionar (size_t nuevo_size) {
 
-    if (archivo_handle == INVALID_HANDLE_VALUE || mapeo_handle == NULL|| datos == nullptr) {
+    if (archivo_handle == INVALID_HANDLE_VALUE || mapeo_handle == NULL) {
         return false;
     }
 
+    nuevo_size = redondear_arriba(nuevo_size, size_segmento);
+
     if (nuevo_size == size) {
         return true;
     }
 
-    HANDLE mapeo_viejo = mapeo_handle;
-    char* datos_viejos = datos;
-    // size_t size_viejo = size; // Unused variable
+    if (nuevo_size < size) {
+        // Windows no deja truncar un archivo con vistas o mapeos abiertos sobre el,
+        // asi que soltamos todo, truncamos y volvemos a mapear. Aqui los punteros si cambian.
+        for (size_t i = 0; i < segmentos.size(); i++) {
+            desmapear_segmento(i);
+        }
+        segmentos.clear();
+        CloseHandle(mapeo_handle);
+        mapeo_handle = NULL;
 
-    HANDLE mapeo_nuevo = CreateFileMappingA(
-        archivo_handle,
-        NULL,
-        PAGE_READWRITE,
-        (DWORD)(nuevo_size >> 32),
-        (DWORD)(nuevo_size & 0xFFFFFFFF),
-        NULL
-    );
+        LARGE_INTEGER nuevo_fin;
+        nuevo_fin.QuadPart = static_cast<LONGLONG>(nuevo_size);
+        bool truncado = SetFilePointerEx(archivo_handle, nuevo_fin, NULL, FILE_BEGIN) && SetEndOfFile(archivo_handle);
+        size_t size_final = truncado ? nuevo_size : size;
+
+        mapeo_handle = crear_mapeo(archivo_handle, size_final);
+        if (mapeo_handle == NULL) {
+            return false;
+        }
+        for (size_t i = 0; i < segmentos_para(size_final, size_segmento); i++) {
+            if (!mapear_segmento(i)) {
+                return false;
+            }
+        }
+        size = size_final;
+        return truncado;
+    }
+
+    // Un objeto de mapeo nuevo del tamaño nuevo hace crecer el archivo. Las vistas del
+    // objeto viejo siguen siendo validas aunque cerremos su handle (la vista lo mantiene vivo).
+    HANDLE mapeo_nuevo = crear_mapeo(archivo_handle, nuevo_size);
 
     if (mapeo_nuevo == NULL) {
         return false; //Mantenemos el mapeo_handle antiguo
     }
 
-    char* datos_nuevos = (char*)MapViewOfFile(
-        mapeo_nuevo,
-        FILE_MAP_ALL_ACCESS,
-        0,
-        0,
-        nuevo_size
-    );
+    CloseHandle(mapeo_handle);
+    mapeo_handle = mapeo_nuevo;
+
+    size_t num_segmentos = segmentos_para(nuevo_size, size_segmento);
+    for (size_t i = segmentos.size(); i < num_segmentos; i++) {
+        if (!mapear_segmento(i)) {
+            return false;
+        }
+    }
+
+    size = nuevo_size;
 
-    if (datos_nuevos == nullptr) {
-        CloseHandle(mapeo_nuevo);
+    return true;
+}
+
+bool MapeoMemoria::perforar (size_t offset, size_t longitud) {
+
+    // El archivo tiene que ser disperso para que Windows suelte los bloques en cero
+    DWORD bytes = 0;
+    if (!DeviceIoControl(archivo_handle, FSCTL_SET_SPARSE, NULL, 0, NULL, 0, &bytes, NULL)) {
         return false;
     }
 
-    // Cerramos el mapeo viejo
-    UnmapViewOfFile(datos_viejos);
-    CloseHandle(mapeo_viejo);
+    FILE_ZERO_DATA_INFORMATION rango;
+    rango.FileOffset.QuadPart = static_cast<LONGLONG>(offset);
+    rango.BeyondFinalZero.QuadPart = static_cast<LONGLONG>(offset + longitud);
+    return DeviceIoControl(archivo_handle, FSCTL_SET_ZERO_DATA, &rango, sizeof(rango), NULL, 0, &bytes, NULL) != 0;
+}
+
+bool MapeoMemoria::aconsejar (PatronAcceso /*patron*/, size_t /*offset*/, size_t /*longitud*/) {
+    // Windows no tiene un equivalente directo de madvise, el readahead lo decide el sistema
+    return !segmentos.empty();
+}
+
+bool MapeoMemoria::escribir (size_t offset, size_t longitud) {
+
+    if (segmentos.empty() || offset + longitud > size) {
+        return false;
+    }
+
+    // El rango puede cruzar segmentos
+    size_t fin = offset + longitud;
+    while (offset < fin) {
+        size_t limite_segmento = std::min(fin, ((offset >> bits_segmento) + 1) << bits_segmento);
+        if (!escribir_desde(offset, obtener_puntero(offset), limite_segmento - offset)) {
+            return false;
+        }
+        offset = limite_segmento;
+    }
+    return true;
+}
+
+bool MapeoMemoria::escribir_desde (size_t offset, const char* buffer, size_t longitud) {
+
+    // WriteFile escribe a lo sumo 4 GB por llamada
+    while (longitud > 0) {
+        DWORD bytes = static_cast<DWORD>(std::min<size_t>(longitud, 1u << 30));
+
+        OVERLAPPED posicion = {};
+        posicion.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+        posicion.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD escritos = 0;
+        if (!WriteFile(archivo_handle, buffer, bytes, &escritos, &posicion) || escritos == 0) {
+            return false;
+        }
+        buffer += escritos;
+        offset += escritos;
+        longitud -= escritos;
+    }
+    return true;
+}
+
+// Windows no tiene como soltar las copias privadas de una vista: quedan hasta cerrar
+void MapeoMemoria::soltar_copias (size_t /*offset*/, size_t /*longitud*/) {
+}
+
+bool MapeoMemoria::sincronizar_archivo () {
+    return FlushFileBuffers(archivo_handle) != 0;
+}
+
+bool MapeoMemoria::sincronizar () {
+
+    if (segmentos.empty()) {
+        return false;
+    }
+
+    if (opciones.copia_privada) {
+        return FlushFileBuffers(archivo_handle) != 0;
+    }
+
+    // FlushViewOfFile manda las paginas de la vista al archivo; FlushFileBuffers las baja al disco
+    bool exito = true;
+    for (size_t i = 0; i < segmentos.size() && i * size_segmento < size; i++) {
+        size_t inicio = i * size_segmento;
+        size_t bytes = std::min(size_segmento, size - inicio);
+        exito = FlushViewOfFile(segmentos[i], bytes) != 0 && exito;
+    }
+
+    return FlushFileBuffers(archivo_handle) != 0 && exito;
+}
+
+bool MapeoMemoria::sincronizar_rango (size_t offset, size_t longitud, bool esperar) {
+
+    if (segmentos.empty() || opciones.copia_privada || offset + longitud > size) {
+        return false;
+    }
+
+    bool exito = true;
+    size_t fin = offset + longitud;
+    while (offset < fin) {
+        size_t limite_segmento = std::min(fin, ((offset >> bits_segmento) + 1) << bits_segmento);
+        exito = FlushViewOfFile(obtener_puntero(offset), limite_segmento - offset) != 0 && exito;
+        offset = limite_segmento;
+    }
+
+    // FlushViewOfFile no espera a que el disco confirme la escritura
+    if (esperar) {
+        exito = FlushFileBuffers(archivo_handle) != 0 && exito;
+    }
+    return exito;
+}
+
+#else
+
+// Traduce nuestro patron de acceso a la constante de madvise
+static int a_madvise(PatronAcceso patron) {
+    switch (patron) {
+        case PatronAcceso::ALEATORIO:  return MADV_RANDOM;
+        case PatronAcceso::SECUENCIAL: return MADV_SEQUENTIAL;
+        case PatronAcceso::PRECARGAR:  return MADV_WILLNEED;
+        case PatronAcceso::NORMAL:
+        default:                       return MADV_NORMAL;
+    }
+}
+
+static size_t pagina_sistema() {
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Hace crecer el archivo de size_actual a nuevo_size. Con fallocate los bloques quedan
+// reservados en disco de una vez (menos fragmentacion y sin sorpresas de espacio lleno
+// al escribir en el mapeo). Si el sistema de archivos no lo soporta usamos ftruncate.
+static bool extender_archivo(int fd, size_t size_actual, size_t nuevo_size) {
+    #ifdef __linux__
+        if (fallocate(fd, 0, static_cast<off_t>(size_actual), static_cast<off_t>(nuevo_size - size_actual)) == 0) {
+            return true;
+        }
+    #else
+        (void)size_actual;
+    #endif
+    return ftruncate(fd, static_cast<off_t>(nuevo_size)) == 0;
+}
+
+// Reserva un rango de direcciones virtuales sin memoria ni archivo detras (PROT_NONE).
+// No consume RAM: solo evita que otra llamada a mmap use esas direcciones.
+static char* reservar_rango(char* direccion, size_t bytes) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+    if (direccion != nullptr) {
+        flags |= MAP_FIXED;
+    }
+    void* rango = mmap(direccion, bytes, PROT_NONE, flags, -1, 0);
+    return rango == MAP_FAILED ? nullptr : static_cast<char*>(rango);
+}
+
+// Cada segmento se mapea con su tamaño completo aunque el archivo todavia no llegue al final
+// del segmento: mmap lo permite y, mientras solo toquemos bytes dentro del archivo, no hay
+// SIGBUS. Asi crecer dentro del ultimo segmento solo necesita extender el archivo.
+bool MapeoMemoria::mapear_segmento(size_t indice) {
+    size_t offset = indice * size_segmento;
+
+    // Dentro de la reserva cada segmento va en su lugar fijo, asi el archivo queda contiguo en memoria
+    char* direccion = nullptr;
+    int flags = opciones.copia_privada ? MAP_PRIVATE : MAP_SHARED;
+    if (reserva != nullptr && offset + size_segmento <= reserva_size) {
+        direccion = reserva + offset;
+        flags |= MAP_FIXED;
+    }
+    #ifdef MAP_POPULATE
+        if (opciones.pre_poblar) {
+            flags |= MAP_POPULATE;
+        }
+    #endif
+
+    void* segmento = mmap(direccion, size_segmento, PROT_READ | PROT_WRITE, flags, archivo_fd, static_cast<off_t>(offset));
+    if (segmento == MAP_FAILED) {
+        return false;
+    }
+
+    // La pista es solo una optimizacion, si el kernel la rechaza seguimos funcionando
+    if (opciones.patron != PatronAcceso::NORMAL) {
+        madvise(segmento, size_segmento, a_madvise(opciones.patron));
+    }
+
+    agregar_segmento(static_cast<char*>(segmento));
+    return true;
+}
+
+void MapeoMemoria::desmapear_segmento(size_t indice) {
+    char* segmento = segmentos[indice];
+    if (reserva != nullptr && segmento >= reserva && segmento < reserva + reserva_size) {
+        // Devolvemos el hueco a la reserva en lugar de liberarlo
+        reservar_rango(segmento, size_segmento);
+    } else {
+        munmap(segmento, size_segmento);
+    }
+}
+
+bool MapeoMemoria::abrir (const std::string& ruta, size_t initial_size, const OpcionesMapeo& opciones) {
+
+    this->opciones = opciones;
+
+    // O_CREAT equivale al OPEN_ALWAYS de Windows: abre si existe, crea si no existe
+    archivo_fd = ::open(ruta.c_str(), O_RDWR | O_CREAT, 0644);
+
+    if (archivo_fd < 0) { return false; }
+
+    struct stat info;
+    if (fstat(archivo_fd, &info) != 0) {
+        ::close(archivo_fd);
+        archivo_fd = -1;
+        return false;
+    }
+
+    size_t size_archivo = static_cast<size_t>(info.st_size);
+
+    // Si initial_size es 0, usar el tamaño del archivo existente
+    size_t tamano_mapeo = initial_size != 0 ? initial_size : size_archivo;
+    if (tamano_mapeo == 0) {
+        ::close(archivo_fd);
+        archivo_fd = -1;
+        return false;
+    }
+
+    // A diferencia de CreateFileMappingA, mmap no hace crecer el archivo.
+    // Si tocamos memoria mapeada mas alla del final recibimos SIGBUS, asi que lo extendemos antes.
+    if (size_archivo < tamano_mapeo && !extender_archivo(archivo_fd, size_archivo, tamano_mapeo)) {
+        ::close(archivo_fd);
+        archivo_fd = -1;
+        return false;
+    }
+
+    size_segmento = potencia_de_dos_arriba(std::max(opciones.size_segmento, pagina_sistema()));
+    bits_segmento = log2_exacto(size_segmento);
+
+    // Si podemos, reservamos un rango grande para que los segmentos queden uno tras otro
+    reserva = nullptr;
+    reserva_size = 0;
+    if (opciones.reserva_bytes > 0) {
+        size_t bytes = redondear_arriba(std::max(opciones.reserva_bytes, tamano_mapeo), size_segmento);
+        reserva = reservar_rango(nullptr, bytes);
+        if (reserva != nullptr) {
+            reserva_size = bytes;
+        }
+    }
+
+    size_t num_segmentos = segmentos_para(tamano_mapeo, size_segmento);
+    for (size_t i = 0; i < num_segmentos; i++) {
+        if (!mapear_segmento(i)) {
+            size = tamano_mapeo;
+            cerrar();
+            return false;
+        }
+    }
+
+    size = tamano_mapeo;
+
+    return true;
+}
+
+
+bool MapeoMemoria::cerrar () {
+
+    if (archivo_fd < 0) {
+        return false;
+    }
+
+    // Los segmentos que viven dentro de la reserva se liberan junto con ella
+    for (size_t i = 0; i < segmentos.size(); i++) {
+        char* segmento = segmentos[i];
+        if (reserva == nullptr || segmento < reserva || segmento >= reserva + reserva_size) {
+            munmap(segmento, size_segmento);
+        }
+    }
+    if (reserva != nullptr) {
+        munmap(reserva, reserva_size);
+    }
+    segmentos.clear();
+    tabla = nullptr;
+    capacidad_tabla = 0;
+    tablas.clear();
+    ::close(archivo_fd);
+
+    size = 0;
+    reserva = nullptr;
+    reserva_size = 0;
+    archivo_fd = -1;
+
+    return true;
+}
+
+bool MapeoMemoria::redimensionar (size_t nuevo_size) {
+
+    if (archivo_fd < 0) {
+        return false;
+    }
+
+    if (nuevo_size == size) {
+        return true;
+    }
+
+    size_t num_segmentos = segmentos_para(nuevo_size, size_segmento);
+
+    if (nuevo_size < size) {
+        // Achicar: soltamos los segmentos que quedan enteros fuera del archivo antes de truncar
+        while (segmentos.size() > num_segmentos) {
+            desmapear_segmento(segmentos.size() - 1);
+            segmentos.pop_back();
+        }
+        if (ftruncate(archivo_fd, static_cast<off_t>(nuevo_size)) != 0) {
+            return false;
+        }
+        size = nuevo_size;
+        return true;
+    }
+
+    // Primero cambiamos el tamaño del archivo y luego agregamos los segmentos que falten.
+    // Los segmentos existentes no se tocan.
+    if (!extender_archivo(archivo_fd, size, nuevo_size)) {
+        return false;
+    }
+
+    while (segmentos.size() < num_segmentos) {
+        if (!mapear_segmento(segmentos.size())) {
+            ftruncate(archivo_fd, static_cast<off_t>(size)); // Dejamos el archivo como estaba
+            return false;
+        }
+    }
 
-    mapeo_handle = mapeo_nuevo;
-    datos = datos_nuevos;
     size = nuevo_size;
 
     return true;
 }
 
-char* MapeoMemoria::obtener_datos() {
-    return datos;
+bool MapeoMemoria::aconsejar (PatronAcceso patron, size_t offset, size_t longitud) {
+
+    if (segmentos.empty() || offset >= size) {
+        return false;
+    }
+
+    if (longitud == 0 || offset + longitud > size) {
+        longitud = size - offset;
+    }
+
+    // madvise exige que la direccion este alineada a la pagina del sistema
+    size_t inicio = offset - (offset % pagina_sistema());
+    size_t fin = offset + longitud;
+
+    // Un rango puede cruzar varios segmentos que no necesariamente estan contiguos
+    bool exito = true;
+    while (inicio < fin) {
+        size_t limite_segmento = std::min(fin, ((inicio >> bits_segmento) + 1) << bits_segmento);
+        exito = madvise(obtener_puntero(inicio), limite_segmento - inicio, a_madvise(patron)) == 0 && exito;
+        inicio = limite_segmento;
+    }
+
+    return exito;
+}
+
+bool MapeoMemoria::perforar (size_t offset, size_t longitud) {
+
+    #if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+        return fallocate(archivo_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, static_cast<off_t>(offset), static_cast<off_t>(longitud)) == 0;
+    #else
+        (void)offset;
+        (void)longitud;
+        return false;
+    #endif
 }
 
+bool MapeoMemoria::escribir (size_t offset, size_t longitud) {
+
+    if (segmentos.empty() || offset + longitud > size) {
+        return false;
+    }
+
+    // Un rango puede cruzar varios segmentos que no necesariamente estan contiguos
+    size_t inicio = offset;
+    size_t fin = offset + longitud;
+    while (offset < fin) {
+        size_t limite_segmento = std::min(fin, ((offset >> bits_segmento) + 1) << bits_segmento);
+        if (!escribir_desde(offset, obtener_puntero(offset), limite_segmento - offset)) {
+            return false;
+        }
+        offset = limite_segmento;
+    }
+
+    soltar_copias(inicio, longitud);
+    return true;
+}
+
+bool MapeoMemoria::escribir_desde (size_t offset, const char* buffer, size_t longitud) {
+
+    size_t hecho = 0;
+    while (hecho < longitud) {
+        ssize_t n = pwrite(archivo_fd, buffer + hecho, longitud - hecho, static_cast<off_t>(offset + hecho));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        hecho += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// En un mapeo privado MADV_DONTNEED descarta las copias y el rango vuelve a leerse del
+// archivo. Sin esto cada pagina modificada seguiria ocupando memoria anonima hasta cerrar.
+// Los bordes que no son paginas enteras del sistema se dejan como estan.
+void MapeoMemoria::soltar_copias (size_t offset, size_t longitud) {
+
+    if (!opciones.copia_privada || segmentos.empty() || offset + longitud > size) {
+        return;
+    }
+
+    size_t pagina = pagina_sistema();
+    size_t fin = offset + longitud;
+    while (offset < fin) {
+        size_t limite_segmento = std::min(fin, ((offset >> bits_segmento) + 1) << bits_segmento);
+        size_t inicio = redondear_arriba(offset, pagina);
+        size_t final_paginas = limite_segmento - (limite_segmento % pagina);
+        if (inicio < final_paginas) {
+            madvise(obtener_puntero(inicio), final_paginas - inicio, MADV_DONTNEED);
+        }
+        offset = limite_segmento;
+    }
+}
+
+bool MapeoMemoria::sincronizar_archivo () {
+    #ifdef __linux__
+        return fdatasync(archivo_fd) == 0;
+    #else
+        return fsync(archivo_fd) == 0;
+    #endif
+}
+
+bool MapeoMemoria::sincronizar () {
+
+    if (segmentos.empty()) {
+        return false;
+    }
+
+    if (opciones.copia_privada) {
+        #ifdef __linux__
+            return fdatasync(archivo_fd) == 0;
+        #else
+            return fsync(archivo_fd) == 0;
+        #endif
+    }
+
+    // msync trabaja por segmento porque no necesariamente estan contiguos
+    bool exito = true;
+    for (size_t i = 0; i < segmentos.size() && i * size_segmento < size; i++) {
+        size_t inicio = i * size_segmento;
+        size_t bytes = std::min(size_segmento, size - inicio);
+        exito = msync(segmentos[i], bytes, MS_SYNC) == 0 && exito;
+    }
+
+    return exito;
+}
+
+bool MapeoMemoria::sincronizar_rango (size_t offset, size_t longitud, bool esperar) {
+
+    if (segmentos.empty() || opciones.copia_privada || offset + longitud > size) {
+        return false;
+    }
+
+    // msync pide una direccion alineada a la pagina del sistema
+    size_t fin = offset + longitud;
+    offset -= offset % pagina_sistema();
+
+    #ifdef __linux__
+        // En Linux MS_ASYNC no hace nada (el kernel ya sabe que paginas del mapeo estan sucias);
+        // sync_file_range si pone el rango en cola de escritura
+        if (!esperar) {
+            return sync_file_range(archivo_fd, static_cast<off_t>(offset), static_cast<off_t>(fin - offset), SYNC_FILE_RANGE_WRITE) == 0;
+        }
+    #endif
+
+    bool exito = true;
+    while (offset < fin) {
+        size_t limite_segmento = std::min(fin, ((offset >> bits_segmento) + 1) << bits_segmento);
+        exito = msync(obtener_puntero(offset), limite_segmento - offset, esperar ? MS_SYNC : MS_ASYNC) == 0 && exito;
+        offset = limite_segmento;
+    }
+    return exito;
+}
+
+#endif
+
 size_t MapeoMemoria::get_size () const {
     return size;
-}
\ No newline at end of file
+}
+
+size_t MapeoMemoria::get_size_reservado () const {
+    #ifdef _WIN32
+        return size;
+    #else
+        return reserva != nullptr ? reserva_size : size;
+    #endif
+}
+
+size_t MapeoMemoria::get_num_segmentos () const {
+    return segmentos.size();
+}
@@ -0,0 +1,400 @@
+#include "almacenamiento/buffer_pool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// MSVC no tiene std::aligned_alloc
+static char* reservar_alineado(size_t bytes) {
+    #ifdef _WIN32
+        return static_cast<char*>(_aligned_malloc(bytes, PAGINA_SIZE));
+    #else
+        return static_cast<char*>(std::aligned_alloc(PAGINA_SIZE, bytes));
+    #endif
+}
+
+static void liberar_alineado(char* memoria) {
+    #ifdef _WIN32
+        _aligned_free(memoria);
+    #else
+        std::free(memoria);
+    #endif
+}
+
+BufferPool::BufferPool() {
+    archivo = nullptr;
+    memoria = nullptr;
+    size_pagina = PAGINA_SIZE;
+    manecilla = 0;
+    num_sucios = 0;
+    desalojar_sucios = true;
+    aciertos = 0;
+    fallos = 0;
+    lecturas = 0;
+    escrituras = 0;
+    desalojos = 0;
+    lotes_io = 0;
+}
+
+BufferPool::~BufferPool() {
+    cerrar();
+}
+
+bool BufferPool::abrir(ArchivoDirecto& archivo, size_t num_frames, size_t size_pagina) {
+    if (num_frames == 0 || num_frames >= TablaPaginas::VACIO || size_pagina % PAGINA_SIZE != 0) {
+        return false;
+    }
+
+    // O_DIRECT exige buffers alineados; alineamos siempre a PAGINA_SIZE para no tener dos caminos
+    memoria = reservar_alineado(num_frames * size_pagina);
+    if (memoria == nullptr) {
+        return false;
+    }
+
+    this->archivo = &archivo;
+    this->size_pagina = size_pagina;
+    frames.assign(num_frames, Frame{INVALID_PAGE_ID, 0, 0, false, false, false});
+    tabla_paginas.abrir(num_frames, archivo.get_size() / size_pagina);
+
+    // Al principio se entregan en orden: frame 0, 1, 2...
+    libres.clear();
+    libres.reserve(num_frames);
+    for (size_t i = num_frames; i > 0; i--) {
+        libres.push_back(i - 1);
+    }
+    manecilla = 0;
+    num_sucios = 0;
+
+    aciertos = 0;
+    fallos = 0;
+    lecturas = 0;
+    escrituras = 0;
+    desalojos = 0;
+    lotes_io = 0;
+
+    lote_lectura.reserve(num_frames);
+    lote_escritura.reserve(num_frames);
+    peticiones.reserve(num_frames);
+
+    return true;
+}
+
+bool BufferPool::cerrar() {
+    if (memoria == nullptr) {
+        return false;
+    }
+
+    bool exito = vaciar();
+
+    liberar_alineado(memoria);
+    memoria = nullptr;
+    archivo = nullptr;
+    frames.clear();
+    libres.clear();
+    tabla_paginas.cerrar();
+
+    return exito;
+}
+
+void BufferPool::ajustar_paginas_archivo(size_t paginas_archivo) {
+    tabla_paginas.ajustar_paginas_archivo(paginas_archivo);
+}
+
+// Primero los frames libres; si no hay, gira la manecilla bajando el contador de uso de los
+// frames sin fijar hasta encontrar uno en 0. Con USO_MAXIMO + 1 vueltas todo frame sin fijar
+// llega a 0, asi que si no encontramos nada es porque estan todos fijados (o retenidos, o
+// sucios si no se pueden desalojar).
+size_t BufferPool::elegir_victima() {
+    if (!libres.empty()) {
+        size_t frame = libres.back();
+        libres.pop_back();
+        return frame;
+    }
+
+    size_t n = frames.size();
+    for (size_t pasos = 0; pasos < n * (USO_MAXIMO + 1); pasos++) {
+        size_t frame = manecilla;
+        manecilla = (manecilla + 1 == n) ? 0 : manecilla + 1;
+
+        Frame& f = frames[frame];
+        if (f.pines > 0 || f.retenido || (f.sucio && !desalojar_sucios)) {
+            continue;
+        }
+        if (f.uso > 0) {
+            f.uso--;
+            continue;
+        }
+        return frame;
+    }
+
+    return INVALID_FRAME;
+}
+
+// Saca la pagina del frame (escribiendola antes si esta sucia). Si la escritura falla el
+// frame queda como estaba.
+bool BufferPool::desalojar(size_t frame) {
+    Frame& f = frames[frame];
+    if (f.sucio && !escribir_lote_sucios(frame)) {
+        return false;
+    }
+    tabla_paginas.eliminar(f.pagina_id);
+    f.pagina_id = INVALID_PAGE_ID;
+    desalojos++;
+    return true;
+}
+
+// Ordena el lote por pagina (asi el disco y el planificador de IO ven offsets crecientes),
+// arma una peticion por frame y las ejecuta juntas. peticiones[i].exito dice como le fue a lote[i].
+bool BufferPool::ejecutar_lote(std::vector<size_t>& lote, bool escritura) {
+    std::sort(lote.begin(), lote.end(), [this](size_t a, size_t b) {
+        return frames[a].pagina_id < frames[b].pagina_id;
+    });
+
+    peticiones.clear();
+    for (size_t frame : lote) {
+        size_t offset = static_cast<size_t>(frames[frame].pagina_id) * size_pagina;
+        peticiones.push_back(PeticionIO{offset, memoria + frame * size_pagina, size_pagina, escritura, false});
+    }
+
+    if (peticiones.empty()) {
+        return true;
+    }
+
+    lotes_io++;
+    return archivo->ejecutar_lote(peticiones.data(), peticiones.size());
+}
+
+// Escribe la victima junto con hasta LOTE_ESCRITURA - 1 paginas sucias sin fijar, con el
+// contador de uso en 0 y delante de la manecilla: son las proximas en desalojarse y asi no hay que esperar
+// una escritura por cada una. Miramos una ventana acotada para no recorrer todo el pool.
+bool BufferPool::escribir_lote_sucios(size_t victima) {
+    lote_escritura.clear();
+    lote_escritura.push_back(victima);
+
+    size_t ventana = std::min(frames.size(), LOTE_ESCRITURA * 8);
+    size_t frame = manecilla;
+    for (size_t i = 0; i < ventana && lote_escritura.size() < LOTE_ESCRITURA; i++) {
+        const Frame& f = frames[frame];
+        if (frame != victima && f.sucio && f.pines == 0 && f.uso == 0) {
+            lote_escritura.push_back(frame);
+        }
+        frame = (frame + 1 == frames.size()) ? 0 : frame + 1;
+    }
+
+    ejecutar_lote(lote_escritura, true);
+
+    for (size_t i = 0; i < lote_escritura.size(); i++) {
+        if (peticiones[i].exito) {
+            frames[lote_escritura[i]].sucio = false;
+            num_sucios--;
+            escrituras++;
+        }
+    }
+    return !frames[victima].sucio;
+}
+
+// Deja el frame vacio y lo devuelve a la lista de libres
+void BufferPool::liberar_frame(size_t frame) {
+    Frame& f = frames[frame];
+    if (f.pagina_id != INVALID_PAGE_ID) {
+        tabla_paginas.eliminar(f.pagina_id);
+    }
+    if (f.sucio) {
+        num_sucios--;
+    }
+    f = Frame{INVALID_PAGE_ID, 0, 0, false, false, false};
+    libres.push_back(frame);
+}
+
+char* BufferPool::fijar(PaginaID page_id, size_t& frame_out) {
+    uint32_t encontrado = tabla_paginas.buscar(page_id);
+
+    if (encontrado != TablaPaginas::VACIO) {
+        Frame& f = frames[encontrado];
+
+        // Si solo la habia traido precargar, este es su primer acceso real y no cuenta como reuso
+        if (f.precargado) {
+            f.precargado = false;
+        } else if (f.uso < USO_MAXIMO) {
+            f.uso++;
+        }
+
+        f.pines++;
+        aciertos++;
+        frame_out = encontrado;
+        return memoria + encontrado * size_pagina;
+    }
+
+    fallos++;
+
+    size_t frame = elegir_victima();
+    if (frame == INVALID_FRAME) {
+        return nullptr; // Todos los frames estan fijados
+    }
+
+    Frame& f = frames[frame];
+    if (f.pagina_id != INVALID_PAGE_ID && !desalojar(frame)) {
+        return nullptr; // No podemos perder la pagina sucia, dejamos el frame como estaba
+    }
+
+    char* datos = memoria + frame * size_pagina;
+    size_t offset = static_cast<size_t>(page_id) * size_pagina;
+
+    if (!archivo->leer(offset, datos, size_pagina)) {
+        liberar_frame(frame); // El frame queda libre para el siguiente
+        return nullptr;
+    }
+    lecturas++;
+
+    f = Frame{page_id, 1, 0, false, false, false};
+    tabla_paginas.insertar(page_id, static_cast<uint32_t>(frame));
+
+    frame_out = frame;
+    return datos;
+}
+
+void BufferPool::desfijar(size_t frame) {
+    if (frame < frames.size() && frames[frame].pines > 0) {
+        frames[frame].pines--;
+    }
+}
+
+void BufferPool::marcar_sucio(size_t frame) {
+    if (frame < frames.size() && !frames[frame].sucio) {
+        frames[frame].sucio = true;
+        num_sucios++;
+    }
+}
+
+size_t BufferPool::precargar(const PaginaID* paginas, size_t cantidad) {
+    lote_lectura.clear();
+
+    for (size_t i = 0; i < cantidad; i++) {
+        PaginaID page_id = paginas[i];
+        if (tabla_paginas.buscar(page_id) != TablaPaginas::VACIO) {
+            continue; // Ya esta en el pool (o repetida en el mismo lote)
+        }
+
+        size_t frame = elegir_victima();
+        if (frame == INVALID_FRAME) {
+            break;
+        }
+
+        Frame& f = frames[frame];
+        if (f.pagina_id != INVALID_PAGE_ID && !desalojar(frame)) {
+            break;
+        }
+
+        // Fijamos el frame mientras dura el lote para que elegir_victima no lo vuelva a elegir
+        f = Frame{page_id, 1, 0, false, false, false};
+        tabla_paginas.insertar(page_id, static_cast<uint32_t>(frame));
+        lote_lectura.push_back(frame);
+    }
+
+    ejecutar_lote(lote_lectura, false);
+
+    size_t leidas = 0;
+    for (size_t i = 0; i < lote_lectura.size(); i++) {
+        size_t frame = lote_lectura[i];
+        if (peticiones[i].exito) {
+            frames[frame].pines = 0;
+            frames[frame].precargado = true;
+            leidas++;
+        } else {
+            liberar_frame(frame);
+        }
+    }
+    lecturas += leidas;
+    return leidas;
+}
+
+void BufferPool::descartar(PaginaID page_id) {
+    uint32_t frame = tabla_paginas.buscar(page_id);
+    if (frame != TablaPaginas::VACIO && frames[frame].pines == 0) {
+        liberar_frame(frame);
+    }
+}
+
+void BufferPool::descartar_desde(PaginaID primera) {
+    for (size_t i = 0; i < frames.size(); i++) {
+        const Frame& f = frames[i];
+        if (f.pagina_id != INVALID_PAGE_ID && f.pagina_id >= primera && f.pines == 0) {
+            liberar_frame(i);
+        }
+    }
+}
+
+bool BufferPool::vaciar() {
+    lote_escritura.clear();
+
+    for (size_t i = 0; i < frames.size(); i++) {
+        if (frames[i].sucio) {
+            lote_escritura.push_back(i);
+        }
+    }
+
+    bool exito = ejecutar_lote(lote_escritura, true);
+
+    for (size_t i = 0; i < lote_escritura.size(); i++) {
+        if (peticiones[i].exito) {
+            frames[lote_escritura[i]].sucio = false;
+            num_sucios--;
+            escrituras++;
+        }
+    }
+    return exito;
+}
+
+void BufferPool::retener(PaginaID page_id) {
+    uint32_t frame = tabla_paginas.buscar(page_id);
+    if (frame == TablaPaginas::VACIO) {
+        return;
+    }
+    Frame& f = frames[frame];
+    if (f.sucio) {
+        f.sucio = false;
+        num_sucios--;
+    }
+    f.retenido = true;
+}
+
+void BufferPool::soltar_retenida(PaginaID page_id, bool escrita) {
+    uint32_t frame = tabla_paginas.buscar(page_id);
+    if (frame == TablaPaginas::VACIO || !frames[frame].retenido) {
+        return;
+    }
+    frames[frame].retenido = false;
+    if (!escrita) {
+        marcar_sucio(frame);
+    }
+}
+
+void BufferPool::set_desalojar_sucios(bool permitir) {
+    desalojar_sucios = permitir;
+}
+
+size_t BufferPool::get_num_sucios() const {
+    return num_sucios;
+}
+
+std::vector<PaginaID> BufferPool::get_paginas_sucias() const {
+    std::vector<PaginaID> sucias;
+    sucias.reserve(num_sucios);
+    for (const Frame& f : frames) {
+        if (f.sucio) {
+            sucias.push_back(f.pagina_id);
+        }
+    }
+    return sucias;
+}
+
+EstadisticasBufferPool BufferPool::get_estadisticas() const {
+    EstadisticasBufferPool stats{frames.size(), 0, 0, aciertos, fallos, lecturas, escrituras, desalojos, lotes_io};
+    for (const Frame& f : frames) {
+        if (f.pines > 0) stats.frames_fijados++;
+        if (f.sucio) stats.frames_sucios++;
+    }
+    return stats;
+}
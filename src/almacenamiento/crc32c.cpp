@@ -0,0 +1,55 @@
+#include "almacenamiento/crc32c.hpp"
+#include <cstring>
+
+namespace {
+
+// Slicing-by-8: tablas[k][b] es el CRC del byte b seguido de k bytes en cero, asi cada vuelta
+// procesa 8 bytes con 8 busquedas independientes en lugar de 8 busquedas encadenadas
+struct TablasCRC {
+    uint32_t t[8][256];
+
+    TablasCRC() {
+        const uint32_t polinomio = 0x82F63B78; // 0x1EDC6F41 reflejado
+        for (uint32_t b = 0; b < 256; b++) {
+            uint32_t crc = b;
+            for (int i = 0; i < 8; i++) {
+                crc = (crc >> 1) ^ ((crc & 1) ? polinomio : 0);
+            }
+            t[0][b] = crc;
+        }
+        for (uint32_t b = 0; b < 256; b++) {
+            for (int k = 1; k < 8; k++) {
+                t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xFF];
+            }
+        }
+    }
+};
+
+const TablasCRC tablas;
+
+}
+
+uint32_t crc32c(const void* datos, size_t longitud, uint32_t crc) {
+    const unsigned char* p = static_cast<const unsigned char*>(datos);
+    crc = ~crc;
+
+    while (longitud >= 8) {
+        uint32_t bajo;
+        uint32_t alto;
+        std::memcpy(&bajo, p, 4);
+        std::memcpy(&alto, p + 4, 4);
+        bajo ^= crc; // Las tablas asumen little endian, como x86 y ARM
+        crc = tablas.t[7][bajo & 0xFF] ^ tablas.t[6][(bajo >> 8) & 0xFF] ^
+              tablas.t[5][(bajo >> 16) & 0xFF] ^ tablas.t[4][bajo >> 24] ^
+              tablas.t[3][alto & 0xFF] ^ tablas.t[2][(alto >> 8) & 0xFF] ^
+              tablas.t[1][(alto >> 16) & 0xFF] ^ tablas.t[0][alto >> 24];
+        p += 8;
+        longitud -= 8;
+    }
+
+    while (longitud-- > 0) {
+        crc = (crc >> 8) ^ tablas.t[0][(crc ^ *p++) & 0xFF];
+    }
+
+    return ~crc;
+}
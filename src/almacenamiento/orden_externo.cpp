@@ -0,0 +1,198 @@
+#include "almacenamiento/orden_externo.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+// Cada archivo de tramo se lee y escribe con un buffer propio de este tamaño
+constexpr size_t BUFFER_TRAMO = size_t(1) << 20;
+
+static DNI_t dni_de(const char* serializado) {
+    DNI_t dni;
+    std::memcpy(&dni, serializado, sizeof(DNI_t));
+    return dni;
+}
+
+OrdenExterno::OrdenExterno(const std::string& prefijo_temporales, size_t memoria_tramo, CriterioOrden criterio)
+    : prefijo(prefijo_temporales), memoria_tramo(memoria_tramo), criterio(criterio), leidos_memoria(0), terminado(false), total(0) {}
+
+OrdenExterno::~OrdenExterno() {
+    for (auto& tramo : tramos) {
+        tramo->archivo.close();
+        std::remove(tramo->ruta.c_str());
+    }
+}
+
+void OrdenExterno::agregar(const char* serializado, size_t size) {
+    if (terminado) {
+        throw std::logic_error("OrdenExterno::agregar despues de terminar.");
+    }
+    if (!posiciones.empty() && datos.size() + sizeof(uint16_t) + size > memoria_tramo) {
+        volcar_tramo();
+    }
+
+    uint16_t size_registro = static_cast<uint16_t>(size);
+    posiciones.push_back(datos.size());
+    datos.insert(datos.end(), reinterpret_cast<const char*>(&size_registro), reinterpret_cast<const char*>(&size_registro) + sizeof(size_registro));
+    datos.insert(datos.end(), serializado, serializado + size);
+    total++;
+}
+
+bool OrdenExterno::registro_menor(const char* a, size_t size_a, const char* b, size_t size_b) const {
+    if (criterio == CriterioOrden::DNI) {
+        return dni_de(a) < dni_de(b);
+    }
+    int comparacion = std::memcmp(a, b, std::min(size_a, size_b));
+    return comparacion < 0 || (comparacion == 0 && size_a < size_b);
+}
+
+// Estable: con DNIs repetidos se mantiene el orden de llegada
+void OrdenExterno::ordenar_tramo() {
+    const char* base = datos.data();
+    auto size_de = [base](size_t posicion) {
+        uint16_t size;
+        std::memcpy(&size, base + posicion, sizeof(size));
+        return size;
+    };
+    std::stable_sort(posiciones.begin(), posiciones.end(), [&](size_t a, size_t b) {
+        return registro_menor(base + a + sizeof(uint16_t), size_de(a), base + b + sizeof(uint16_t), size_de(b));
+    });
+}
+
+void OrdenExterno::volcar_tramo() {
+    ordenar_tramo();
+
+    auto tramo = std::make_unique<Tramo>();
+    tramo->ruta = prefijo + "." + std::to_string(tramos.size());
+    {
+        std::vector<char> buffer(BUFFER_TRAMO);
+        std::ofstream salida;
+        salida.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+        salida.open(tramo->ruta, std::ios::binary | std::ios::trunc);
+        for (size_t posicion : posiciones) {
+            uint16_t size;
+            std::memcpy(&size, datos.data() + posicion, sizeof(size));
+            salida.write(datos.data() + posicion, sizeof(size) + size);
+        }
+        salida.close();
+        if (!salida) {
+            std::remove(tramo->ruta.c_str());
+            throw std::runtime_error("No se pudo escribir el archivo temporal " + tramo->ruta + ".");
+        }
+    }
+    tramos.push_back(std::move(tramo));
+
+    datos.clear();
+    posiciones.clear();
+}
+
+void OrdenExterno::terminar() {
+    if (terminado) {
+        return;
+    }
+    terminado = true;
+
+    if (tramos.empty()) {
+        ordenar_tramo(); // Todo entro en memoria
+        return;
+    }
+    if (!posiciones.empty()) {
+        volcar_tramo();
+    }
+    datos.clear();
+    datos.shrink_to_fit();
+    posiciones.shrink_to_fit();
+
+    // La memoria del tramo queda libre; cada archivo se lee con su propio buffer
+    for (size_t i = 0; i < tramos.size(); i++) {
+        Tramo& tramo = *tramos[i];
+        tramo.archivo.open(tramo.ruta, std::ios::binary);
+        if (!tramo.archivo) {
+            throw std::runtime_error("No se pudo abrir el archivo temporal " + tramo.ruta + ".");
+        }
+        if (leer_registro(tramo)) {
+            heap.push_back(i);
+        }
+    }
+    auto mayor = [this](size_t a, size_t b) { return menor(b, a); };
+    std::make_heap(heap.begin(), heap.end(), mayor);
+}
+
+bool OrdenExterno::leer_registro(Tramo& tramo) {
+    uint16_t size;
+    if (!tramo.archivo.read(reinterpret_cast<char*>(&size), sizeof(size))) {
+        return false; // Fin del tramo
+    }
+    tramo.registro.resize(size);
+    if (!tramo.archivo.read(tramo.registro.data(), size)) {
+        throw std::runtime_error("El archivo temporal " + tramo.ruta + " esta incompleto.");
+    }
+    if (criterio == CriterioOrden::DNI) {
+        tramo.dni = dni_de(tramo.registro.data());
+    }
+    return true;
+}
+
+// A igual DNI va primero el tramo anterior: los tramos se escribieron en orden de llegada
+bool OrdenExterno::menor(size_t a, size_t b) const {
+    const Tramo& tramo_a = *tramos[a];
+    const Tramo& tramo_b = *tramos[b];
+    if (criterio == CriterioOrden::DNI) {
+        if (tramo_a.dni != tramo_b.dni) {
+            return tramo_a.dni < tramo_b.dni;
+        }
+        return a < b;
+    }
+    if (registro_menor(tramo_a.registro.data(), tramo_a.registro.size(), tramo_b.registro.data(), tramo_b.registro.size())) {
+        return true;
+    }
+    if (registro_menor(tramo_b.registro.data(), tramo_b.registro.size(), tramo_a.registro.data(), tramo_a.registro.size())) {
+        return false;
+    }
+    return a < b;
+}
+
+bool OrdenExterno::siguiente(const char*& serializado, size_t& size) {
+    if (!terminado) {
+        throw std::logic_error("OrdenExterno::siguiente antes de terminar.");
+    }
+
+    if (tramos.empty()) {
+        if (leidos_memoria == posiciones.size()) {
+            return false;
+        }
+        size_t posicion = posiciones[leidos_memoria++];
+        uint16_t size_registro;
+        std::memcpy(&size_registro, datos.data() + posicion, sizeof(size_registro));
+        serializado = datos.data() + posicion + sizeof(size_registro);
+        size = size_registro;
+        return true;
+    }
+
+    if (heap.empty()) {
+        return false;
+    }
+    auto mayor = [this](size_t a, size_t b) { return menor(b, a); };
+    std::pop_heap(heap.begin(), heap.end(), mayor);
+    Tramo& tramo = *tramos[heap.back()];
+
+    // El registro pasa a `actual` antes de leer el siguiente del mismo tramo
+    actual.swap(tramo.registro);
+    if (leer_registro(tramo)) {
+        std::push_heap(heap.begin(), heap.end(), mayor);
+    } else {
+        heap.pop_back();
+    }
+
+    serializado = actual.data();
+    size = actual.size();
+    return true;
+}
+
+size_t OrdenExterno::get_num_tramos() const {
+    return tramos.size();
+}
+
+size_t OrdenExterno::get_total() const {
+    return total;
+}
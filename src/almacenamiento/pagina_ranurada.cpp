@@ -89,16 +89,18 @@ bool PaginaRanurada::insertar_registro_en_slot(SlotID slot_id, const char* regis
     return true;
 }
 
+// Puede leer una pagina que otro hilo esta escribiendo (ver Database::buscar_ciudadano), asi
+// que nada de lo que lee puede llevarla fuera de la pagina
 bool PaginaRanurada::leer_registro(SlotID slot_id, char* buffer, size_t& size) {
     HeaderPaginaRanurada* header = obtener_header();
 
-    if (slot_id >= header->num_registros) {
+    if (slot_id >= header->num_registros || sizeof(HeaderPaginaRanurada) + (slot_id + size_t(1)) * sizeof(Slot) > PAGINA_SIZE) {
         return false;
     }
 
     Slot* slot = obtener_slot(slot_id);
 
-    if (slot->size == 0) {
+    if (slot->size == 0 || size_t(slot->offset) + slot->size > PAGINA_SIZE) {
         return false;
     }
 
@@ -127,6 +129,27 @@ bool PaginaRanurada::borrar_registro(SlotID slot_id) {
     return true;
 }
 
+bool PaginaRanurada::descartar_ultimo(SlotID slot_id) {
+    HeaderPaginaRanurada* header = obtener_header();
+
+    if (header->num_registros == 0 || slot_id != header->num_registros - 1) {
+        return false;
+    }
+
+    Slot* slot = obtener_slot(slot_id);
+    if (slot->size == 0 || slot->offset != header->espacio_libre_fin) {
+        return false;
+    }
+
+    header->espacio_libre_fin += slot->size;
+    header->espacio_libre_inicio -= sizeof(Slot);
+    header->num_registros--;
+    slot->size = 0;
+    slot->offset = 0;
+
+    return true;
+}
+
 bool PaginaRanurada::tiene_espacio(size_t size) const {
     const HeaderPaginaRanurada* header = obtener_header();
 
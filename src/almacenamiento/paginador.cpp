@@ -1,103 +1,629 @@
 #include "almacenamiento/paginador.hpp"
+#include <algorithm>
 
-Paginador::Paginador() : cache(1024) {
+void MapaSucias::redimensionar(size_t paginas) {
+    size_t necesarias = (paginas + 63) / 64;
+    while (bloques.size() * PALABRAS_POR_BLOQUE < necesarias && bloques.size() < MAX_BLOQUES) {
+        std::unique_ptr<std::atomic<uint64_t>[]> bloque(new std::atomic<uint64_t>[PALABRAS_POR_BLOQUE]);
+        for (size_t i = 0; i < PALABRAS_POR_BLOQUE; i++) {
+            bloque[i].store(0, std::memory_order_relaxed);
+        }
+        bloques.push_back(std::move(bloque));
+    }
+    num_palabras = std::max(num_palabras, std::min(necesarias, bloques.size() * PALABRAS_POR_BLOQUE));
+}
+
+void MapaSucias::desmarcar_desde(size_t primera) {
+    for (size_t id = primera; id < num_palabras * 64; id++) {
+        desmarcar(static_cast<PaginaID>(id));
+    }
+}
+
+void MapaSucias::limpiar() {
+    for (size_t i = 0; i < num_palabras; i++) {
+        palabra(i).store(0, std::memory_order_relaxed);
+    }
+    cantidad = 0;
+}
+
+std::vector<PaginaID> MapaSucias::listar() const {
+    std::vector<PaginaID> ids;
+    ids.reserve(get_cantidad());
+    for (size_t i = 0; i < num_palabras; i++) {
+        for (uint64_t palabra = leer_palabra(i); palabra != 0; palabra &= palabra - 1) {
+            unsigned bit = 0;
+            while (((palabra >> bit) & 1) == 0) {
+                bit++;
+            }
+            ids.push_back(static_cast<PaginaID>(i * 64 + bit));
+        }
+    }
+    return ids;
+}
+
+std::vector<RangoPaginas> MapaSucias::listar_rangos() const {
+    std::vector<RangoPaginas> rangos;
+    size_t inicio = 0;
+    bool abierto = false; // Hay un rango que empezo en `inicio` y sigue hasta la pagina actual
+
+    for (size_t i = 0; i < num_palabras; i++) {
+        uint64_t palabra = leer_palabra(i);
+        // Palabras enteras iguales al estado actual no cambian nada
+        if ((palabra == 0 && !abierto) || (palabra == ~uint64_t(0) && abierto)) {
+            continue;
+        }
+        for (unsigned bit = 0; bit < 64; bit++) {
+            bool marcada = ((palabra >> bit) & 1) != 0;
+            if (marcada && !abierto) {
+                inicio = i * 64 + bit;
+                abierto = true;
+            } else if (!marcada && abierto) {
+                rangos.push_back(RangoPaginas{static_cast<PaginaID>(inicio), i * 64 + bit - inicio});
+                abierto = false;
+            }
+        }
+    }
+    if (abierto) {
+        rangos.push_back(RangoPaginas{static_cast<PaginaID>(inicio), num_palabras * 64 - inicio});
+    }
+    return rangos;
+}
+
+Paginador::Paginador() {
+    size_pagina = PAGINA_SIZE;
     num_paginas = 0;
+    capacidad_paginas = 0;
+    num_crecimientos = 0;
+    rangos_escritos = 0;
+    lotes_copias = 0;
+    tronco_libres = INVALID_PAGE_ID;
+    num_paginas_libres = 0;
 }
 
 Paginador::~Paginador() {
     cerrar();
 }
 
-bool Paginador::abrir(const std::string& ruta, size_t paginas_iniciales) {
-    size_t bytes_necesarios = paginas_iniciales * PAGINA_SIZE;
+bool Paginador::abrir(const std::string& ruta, size_t paginas_iniciales, const OpcionesPaginador& opciones) {
+    // Potencia de 2 (un segmento del mapeo tiene paginas enteras) y multiplo de PAGINA_SIZE
+    // (alineacion de O_DIRECT, y la lista de libres usa los primeros PAGINA_SIZE bytes)
+    size_t size_pagina = opciones.size_pagina;
+    if (size_pagina < PAGINA_SIZE || (size_pagina & (size_pagina - 1)) != 0) {
+        return false;
+    }
+    size_t bytes_necesarios = paginas_iniciales * size_pagina;
+    bool exito = false;
+
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        // Una operacion del arbol mantiene fijado el camino desde la raiz mas los hermanos y
+        // las paginas nuevas de una division; con menos frames podria quedarse sin ninguno libre
+        if (opciones.frames_buffer_pool < 16) {
+            return false;
+        }
 
-    bool exito = archivo.abrir(ruta, bytes_necesarios);
+        exito = archivo_directo.abrir(ruta, bytes_necesarios, opciones.io_directa);
+        if (exito && opciones.io_uring) {
+            // Si el kernel no tiene io_uring seguimos con pread/pwrite sin avisar: es solo mas lento
+            archivo_directo.activar_io_uring(opciones.profundidad_io);
+        }
+        if (exito && !pool.abrir(archivo_directo, opciones.frames_buffer_pool, size_pagina)) {
+            archivo_directo.cerrar();
+            exito = false;
+        }
+        pool.set_desalojar_sucios(!opciones.escribir_solo_al_sincronizar);
+    } else {
+        // Una pagina no puede quedar partida entre dos segmentos del mapeo
+        if (opciones.mapeo.size_segmento < size_pagina) {
+            return false;
+        }
+
+        OpcionesMapeo opciones_mapeo = opciones.mapeo;
+        opciones_mapeo.copia_privada = opciones.escribir_solo_al_sincronizar;
+        exito = archivo.abrir(ruta, bytes_necesarios, opciones_mapeo);
+    }
 
     if (!exito) {
         return false;
     }
 
+    this->opciones = opciones;
+    this->size_pagina = size_pagina;
+
     // Al abrir un archivo existente, el tamaño real puede ser mayor.
     // Calculamos el número de páginas basado en el tamaño real del archivo.
-    num_paginas = archivo.get_size() / PAGINA_SIZE;
-    paginas_libres.clear();
+    // Si parte es capacidad preasignada, fijar_num_paginas lo corrige despues.
+    capacidad_paginas = get_size_archivo() / size_pagina;
+    num_paginas = capacidad_paginas;
+    num_crecimientos = 0;
+    rangos_escritos = 0;
+    lotes_copias = 0;
+    tronco_libres = INVALID_PAGE_ID;
+    num_paginas_libres = 0;
+    sucias.limpiar();
+    sucias.redimensionar(capacidad_paginas);
+    latches.redimensionar(capacidad_paginas);
 
     return true;
 }
 
 void Paginador::cerrar() {
+    // El pool escribe sus paginas sucias al cerrarse, antes de cerrar el archivo
+    pool.cerrar();
+    archivo_directo.cerrar();
     archivo.cerrar();
     num_paginas = 0;
-    paginas_libres.clear();
-    cache.clear();
+    capacidad_paginas = 0;
+    tronco_libres = INVALID_PAGE_ID;
+    num_paginas_libres = 0;
+}
+
+bool Paginador::fijar_num_paginas(size_t paginas_usadas) {
+    if (paginas_usadas == 0 || paginas_usadas > capacidad_paginas) {
+        return false;
+    }
+    num_paginas = paginas_usadas;
+    return true;
 }
 
-PaginaID Paginador::alloc_pagina() {
+bool Paginador::asegurar_paginas(size_t paginas) {
+    while (capacidad_paginas < paginas) {
+        if (!crecer()) {
+            return false;
+        }
+    }
+    num_paginas = std::max(num_paginas.load(), paginas);
+    return true;
+}
+
+// Extiende el archivo en una extension completa en lugar de una sola pagina.
+// Crecer pagina por pagina obliga a extender el archivo (y el mapeo) en cada alloc.
+bool Paginador::crecer() {
+    size_t extension = static_cast<size_t>(capacidad_paginas * opciones.factor_crecimiento);
+    extension = std::clamp(extension, opciones.extension_minima, std::max(opciones.extension_minima, opciones.extension_maxima));
+    return crecer_hasta(capacidad_paginas + extension);
+}
 
-    if (!paginas_libres.empty()) {
-        PaginaID id = *paginas_libres.begin(); // begin() nos da un iterador al principio del set, pero queremos el valor entonces lo dereferenciamos
-        paginas_libres.erase(id);
-        return id;
+bool Paginador::crecer_hasta(size_t nueva_capacidad) {
+    // No podemos pasarnos del rango direccionable por PaginaID
+    nueva_capacidad = std::min(nueva_capacidad, static_cast<size_t>(INVALID_PAGE_ID));
+    if (nueva_capacidad <= num_paginas) {
+        return false;
     }
 
+    if (!redimensionar_archivo(nueva_capacidad)) {
+        return false;
+    }
+
+    // En Windows el archivo mapeado crece en segmentos enteros, la capacidad real puede ser mayor
+    capacidad_paginas = std::min(get_size_archivo() / size_pagina, static_cast<size_t>(INVALID_PAGE_ID));
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        pool.ajustar_paginas_archivo(capacidad_paginas);
+    } else {
+        sucias.redimensionar(capacidad_paginas);
+    }
+    latches.redimensionar(capacidad_paginas);
+    num_crecimientos++;
+    return true;
+}
+
+// Crecer solo agrega segmentos al mapeo: los punteros ya entregados siguen validos.
+// En modo BUFFER_POOL solo se extiende el archivo; las paginas nuevas se leen al fijarlas.
+bool Paginador::redimensionar_archivo(size_t paginas) {
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        return archivo_directo.redimensionar(paginas * size_pagina);
+    }
+    return archivo.redimensionar(paginas * size_pagina);
+}
+
+size_t Paginador::get_size_archivo() const {
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        return archivo_directo.get_size();
+    }
+    return archivo.get_size();
+}
+
+bool Paginador::aconsejar(PatronAcceso patron) {
+    // El pool decide por su cuenta que paginas tener en memoria, no hay nada que aconsejar
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        return true;
+    }
+    return archivo.aconsejar(patron);
+}
+
+bool Paginador::fijar_lista_libres(PaginaID primer_tronco, size_t cantidad) {
+    if (primer_tronco != INVALID_PAGE_ID && primer_tronco >= num_paginas) {
+        return false;
+    }
+    tronco_libres = primer_tronco;
+    num_paginas_libres = primer_tronco == INVALID_PAGE_ID ? 0 : cantidad;
+    return true;
+}
+
+PaginaID Paginador::get_primer_tronco_libres() const {
+    return tronco_libres;
+}
+
+size_t Paginador::get_num_paginas_libres() const {
+    return num_paginas_libres;
+}
+
+PaginaID Paginador::alloc_pagina(PaginaID cerca_de) {
+
+    if (tronco_libres != INVALID_PAGE_ID) {
+        PaginaFijada tronco = fijar_pagina(tronco_libres);
+
+        if (tronco) {
+            auto* lista = reinterpret_cast<TroncoLibres*>(tronco.datos());
+
+            if (lista->num_hojas > 0) {
+                // Sin pista tomamos la ultima; con pista, la mas cercana (a lo sumo MAX_HOJAS comparaciones)
+                uint32_t elegida = lista->num_hojas - 1;
+                if (cerca_de != INVALID_PAGE_ID) {
+                    auto distancia = [cerca_de](PaginaID id) {
+                        return id > cerca_de ? id - cerca_de : cerca_de - id;
+                    };
+                    for (uint32_t i = 0; i < lista->num_hojas; i++) {
+                        if (distancia(lista->hojas[i]) < distancia(lista->hojas[elegida])) {
+                            elegida = i;
+                        }
+                    }
+                }
+
+                PaginaID id = lista->hojas[elegida];
+                lista->hojas[elegida] = lista->hojas[lista->num_hojas - 1];
+                lista->num_hojas--;
+                tronco.marcar_sucia();
+                num_paginas_libres--;
+                return id;
+            }
+
+            // Tronco sin hojas: entregamos el propio tronco y la cabeza pasa al siguiente
+            PaginaID id = tronco_libres;
+            tronco_libres = lista->siguiente;
+            num_paginas_libres--;
+            return id;
+        }
+    }
+
+    return alloc_pagina_nueva();
+}
+
+PaginaID Paginador::alloc_pagina_nueva() {
     if (num_paginas >= INVALID_PAGE_ID) {
         return INVALID_PAGE_ID;
     }
 
-    // Se tuvo que poner num_paginas + 1 porque si hacemos num_paginas * PAGINA_SIZE
+    // Se tuvo que poner num_paginas + 1 porque si hacemos num_paginas * size_pagina
     // nos devuelve una cantidad justo al limite de todos los bytes posibles
     // entonces si hicieramos 10 * 4096 = 40,960 si se intenta acceder al byte 40,960
     // habra segmentation fault porque solo hay de 0 a 40,959 bytes
-    size_t bytes_necesarios = (num_paginas + 1) * PAGINA_SIZE;
-
-    if (archivo.get_size() < bytes_necesarios) {
-        bool exito = archivo.redimensionar(bytes_necesarios);
-
-        if (!exito) {
-            return INVALID_PAGE_ID;
-        }
-        // El remapeo invalida punteros cacheados, asi que limpiamos la cache
-        cache.clear();
+    if (num_paginas + 1 > capacidad_paginas && !crecer()) {
+        return INVALID_PAGE_ID;
     }
 
     return num_paginas++;
 }
 
+PaginaID Paginador::alloc_paginas_nuevas(size_t cantidad) {
+    if (cantidad == 0 || num_paginas + cantidad >= INVALID_PAGE_ID) {
+        return INVALID_PAGE_ID;
+    }
+    if (num_paginas + cantidad > capacidad_paginas && !crecer_hasta(num_paginas + cantidad)) {
+        return INVALID_PAGE_ID;
+    }
+    PaginaID primera = static_cast<PaginaID>(num_paginas.load());
+    num_paginas += cantidad;
+    return primera;
+}
+
 void Paginador::liberar_pagina(PaginaID page_id) {
     if (page_id >= num_paginas || page_id == INVALID_PAGE_ID) {
         return;
     }
 
     // No borramos ni liberamos recursos porque en realidad queremos reutilizar el espacio
-    // entonces solo lo marcamos como libre
-    paginas_libres.insert(page_id);
+    // entonces solo la anotamos en el tronco de la cabeza
+    if (tronco_libres != INVALID_PAGE_ID) {
+        PaginaFijada tronco = fijar_pagina(tronco_libres);
+        if (tronco) {
+            auto* lista = reinterpret_cast<TroncoLibres*>(tronco.datos());
+            if (lista->num_hojas < TroncoLibres::MAX_HOJAS) {
+                lista->hojas[lista->num_hojas++] = page_id;
+                tronco.marcar_sucia();
+                num_paginas_libres++;
+                return;
+            }
+        }
+    }
+
+    // No hay tronco o esta lleno: la pagina liberada pasa a ser el nuevo tronco de la cabeza
+    PaginaFijada nueva = fijar_pagina(page_id);
+    if (!nueva) {
+        return; // Sin frame para escribir el tronco la pagina se pierde (no deberia pasar)
+    }
+    auto* lista = reinterpret_cast<TroncoLibres*>(nueva.datos());
+    lista->siguiente = tronco_libres;
+    lista->num_hojas = 0;
+    nueva.marcar_sucia();
+    tronco_libres = page_id;
+    num_paginas_libres++;
+}
+
+std::vector<PaginaID> Paginador::listar_paginas_libres() {
+    std::vector<PaginaID> libres;
+    libres.reserve(num_paginas_libres);
+
+    for (PaginaID id = tronco_libres; id != INVALID_PAGE_ID; ) {
+        PaginaFijada tronco = fijar_pagina(id);
+        if (!tronco) {
+            break;
+        }
+        auto* lista = reinterpret_cast<const TroncoLibres*>(tronco.datos());
+        libres.push_back(id);
+        libres.insert(libres.end(), lista->hojas, lista->hojas + std::min<size_t>(lista->num_hojas, TroncoLibres::MAX_HOJAS));
+        id = lista->siguiente;
+    }
+
+    return libres;
+}
+
+size_t Paginador::reconstruir_lista_libres(const std::vector<PaginaID>& libres, bool perforar) {
+    tronco_libres = INVALID_PAGE_ID;
+    num_paginas_libres = 0;
+
+    // Los troncos se llenan desde el final del vector hacia el principio: cada grupo de
+    // MAX_HOJAS + 1 paginas usa su primera como tronco y el resto como hojas
+    size_t perforadas = 0;
+    for (size_t inicio = 0; inicio < libres.size(); inicio += TroncoLibres::MAX_HOJAS + 1) {
+        size_t fin = std::min(libres.size(), inicio + TroncoLibres::MAX_HOJAS + 1);
+
+        PaginaFijada tronco = fijar_pagina(libres[inicio]);
+        if (!tronco) {
+            continue; // Esas paginas se pierden hasta el proximo vacuum
+        }
+        auto* lista = reinterpret_cast<TroncoLibres*>(tronco.datos());
+        lista->siguiente = tronco_libres;
+        lista->num_hojas = static_cast<uint32_t>(fin - inicio - 1);
+        std::copy(libres.begin() + inicio + 1, libres.begin() + fin, lista->hojas);
+        tronco.marcar_sucia();
+
+        tronco_libres = libres[inicio];
+        num_paginas_libres += fin - inicio;
+
+        if (!perforar) {
+            continue;
+        }
+        for (size_t i = inicio + 1; i < fin; i++) {
+            size_t offset = static_cast<size_t>(libres[i]) * size_pagina;
+            bool perforada;
+            if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+                // Si quedara en el pool, al desalojarla se volveria a escribir y ocuparia disco otra vez
+                pool.descartar(libres[i]);
+                perforada = archivo_directo.perforar(offset, size_pagina);
+            } else {
+                sucias.desmarcar(libres[i]);
+                perforada = archivo.perforar(offset, size_pagina);
+            }
+            if (perforada) {
+                perforadas++;
+            }
+        }
+    }
+
+    return perforadas;
 }
 
-char* Paginador::get_pagina(PaginaID page_id) {
+bool Paginador::truncar(size_t paginas) {
+    if (paginas == 0 || paginas > num_paginas) {
+        return false;
+    }
+
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        pool.descartar_desde(static_cast<PaginaID>(paginas));
+        if (!archivo_directo.redimensionar(paginas * size_pagina)) {
+            return false;
+        }
+    } else {
+        sucias.desmarcar_desde(paginas);
+        if (!archivo.redimensionar(paginas * size_pagina)) {
+            return false;
+        }
+    }
+
+    num_paginas = paginas;
+    // En Windows el mapeo redondea a segmentos enteros, la capacidad puede quedar mayor
+    capacidad_paginas = std::min(get_size_archivo() / size_pagina, static_cast<size_t>(INVALID_PAGE_ID));
+    return true;
+}
+
+PaginaFijada Paginador::fijar_pagina(PaginaID page_id) {
     if (page_id >= num_paginas || page_id == INVALID_PAGE_ID) {
-        return nullptr;
+        return PaginaFijada();
     }
 
-    // Primero verificar en caché
-    char* cached = cache.get(page_id);
-    if (cached != nullptr) {
-        return cached;
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        size_t frame = INVALID_FRAME;
+        char* datos = pool.fijar(page_id, frame);
+        if (datos == nullptr) {
+            return PaginaFijada();
+        }
+        return PaginaFijada(&pool, frame, page_id, datos);
     }
 
-    // PAGINA SIZE = 4096 bytes entonces 10 x 4096 = 40960
+    // Con paginas de 4096 bytes: 10 x 4096 = 40960
     // Sabemos que empezando desde ese offset esta la informacion perteneciente a esa pagina
-    size_t offset = page_id * PAGINA_SIZE;
+    size_t offset = static_cast<size_t>(page_id) * size_pagina;
 
-    // obtener_datos retorna un puntero al byte 0 de datos, datos es un arreglo de bytes
-    // usando el offset accedemos al espacio de memoria en donde esta la informacion perteneciente a esta pagina
-    char* pagina = archivo.obtener_datos() + offset;
+    // El mapeo esta dividido en segmentos: obtener_puntero indexa directamente la tabla de
+    // segmentos (un shift y una mascara), mas barato que cualquier cache de punteros
+    char* pagina = archivo.obtener_puntero(offset);
 
-    // Agregar al caché
-    cache.put(page_id, pagina);
+    return PaginaFijada(&sucias, page_id, pagina);
+}
+
+void Paginador::precargar(const std::vector<PaginaID>& paginas) {
+    std::vector<PaginaID> validas;
+    validas.reserve(paginas.size());
+    for (PaginaID id : paginas) {
+        if (id < num_paginas) {
+            validas.push_back(id);
+        }
+    }
 
-    return pagina;
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        pool.precargar(validas.data(), validas.size());
+        return;
+    }
+
+    for (PaginaID id : validas) {
+        archivo.aconsejar(PatronAcceso::PRECARGAR, static_cast<size_t>(id) * size_pagina, size_pagina);
+    }
+}
+
+bool Paginador::sincronizar() {
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        bool exito = pool.vaciar();
+        return archivo_directo.sincronizar() && exito;
+    }
+
+    std::vector<RangoPaginas> rangos = sucias.listar_rangos();
+    bool exito = true;
+
+    if (opciones.escribir_solo_al_sincronizar) {
+        // Con mapeo privado las paginas solo llegan al archivo si las escribimos nosotros: un
+        // pwrite por tramo y un solo fdatasync al final
+        for (const RangoPaginas& rango : rangos) {
+            exito = archivo.escribir(static_cast<size_t>(rango.primera) * size_pagina, rango.cantidad * size_pagina) && exito;
+        }
+        exito = archivo.sincronizar() && exito;
+    } else {
+        // Primero se piden todos los tramos sin esperar, asi el disco los recibe juntos y no
+        // de a uno; despues se espera cada uno
+        for (const RangoPaginas& rango : rangos) {
+            archivo.sincronizar_rango(static_cast<size_t>(rango.primera) * size_pagina, rango.cantidad * size_pagina, false);
+        }
+        for (const RangoPaginas& rango : rangos) {
+            exito = archivo.sincronizar_rango(static_cast<size_t>(rango.primera) * size_pagina, rango.cantidad * size_pagina) && exito;
+        }
+    }
+
+    rangos_escritos += rangos.size();
+    // Si algo fallo quedan todas marcadas: volver a escribir una pagina que ya llego no cuesta mas que el tramo
+    if (exito) {
+        sucias.limpiar();
+    }
+    return exito;
+}
+
+bool Paginador::sincronizar_async() {
+    if (opciones.escribir_solo_al_sincronizar) {
+        return true;
+    }
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        return pool.vaciar(); // Ya en el archivo; sincronizar() solo tiene que hacer el fdatasync
+    }
+
+    bool exito = true;
+    for (const RangoPaginas& rango : sucias.listar_rangos()) {
+        exito = archivo.sincronizar_rango(static_cast<size_t>(rango.primera) * size_pagina, rango.cantidad * size_pagina, false) && exito;
+    }
+    return exito;
+}
+
+void Paginador::retener_paginas(const std::vector<PaginaID>& ids) {
+    for (PaginaID id : ids) {
+        if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+            pool.retener(id);
+        } else {
+            sucias.desmarcar(id);
+        }
+    }
+}
+
+bool Paginador::escribir_copias(const std::vector<PaginaID>& ids, const char* copias) {
+    // Una peticion por tramo de paginas consecutivas
+    std::vector<PeticionIO> peticiones;
+    for (size_t i = 0; i < ids.size();) {
+        size_t fin = i + 1;
+        while (fin < ids.size() && ids[fin] == ids[fin - 1] + 1) {
+            fin++;
+        }
+        size_t offset = static_cast<size_t>(ids[i]) * size_pagina;
+        char* origen = const_cast<char*>(copias + i * size_pagina); // Solo se escribe desde aca
+        peticiones.push_back(PeticionIO{offset, origen, (fin - i) * size_pagina, true, false});
+        i = fin;
+    }
+
+    bool exito = true;
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        // Todos los tramos en un lote, como pool.vaciar(); con el anillo del segundo plano
+        // porque el pool puede estar usando el suyo desde otro hilo
+        if (!peticiones.empty()) {
+            exito = archivo_directo.ejecutar_lote(peticiones.data(), peticiones.size(), true);
+            lotes_copias++;
+        }
+        return archivo_directo.sincronizar() && exito;
+    }
+
+    for (const PeticionIO& peticion : peticiones) {
+        exito = archivo.escribir_desde(peticion.offset, peticion.buffer, peticion.bytes) && exito;
+    }
+    return archivo.sincronizar_archivo() && exito;
+}
+
+// En MAPEO las paginas retenidas siguen siendo copias privadas con el mismo contenido que
+// ahora tiene el archivo: las que no se volvieron a modificar se sueltan
+void Paginador::soltar_paginas_retenidas(const std::vector<PaginaID>& ids, bool escritas) {
+    for (PaginaID id : ids) {
+        if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+            pool.soltar_retenida(id, escritas);
+        } else if (!escritas) {
+            sucias.marcar(id);
+        } else if (id < num_paginas && !sucias.esta_marcada(id)) {
+            archivo.soltar_copias(static_cast<size_t>(id) * size_pagina, size_pagina);
+        }
+    }
+}
+
+size_t Paginador::get_num_paginas_sucias() const {
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        return pool.get_num_sucios();
+    }
+    return sucias.get_cantidad();
+}
+
+std::vector<PaginaID> Paginador::get_paginas_sucias() const {
+    if (opciones.modo == ModoAlmacenamiento::BUFFER_POOL) {
+        return pool.get_paginas_sucias();
+    }
+    return sucias.listar();
+}
+
+size_t Paginador::get_size_pagina() const {
+    return size_pagina;
 }
 
 size_t Paginador::get_num_paginas() const {
     return num_paginas;
 }
+
+ModoAlmacenamiento Paginador::get_modo() const {
+    return opciones.modo;
+}
+
+EstadisticasPaginador Paginador::get_estadisticas() const {
+    EstadisticasBufferPool estadisticas_pool = pool.get_estadisticas();
+    estadisticas_pool.lotes_io += lotes_copias; // Los de escribir_copias tambien van al disco en lote
+    return EstadisticasPaginador{
+        num_paginas.load(),
+        capacidad_paginas,
+        archivo.get_size_reservado(),
+        archivo.get_num_segmentos(),
+        num_crecimientos,
+        num_paginas_libres,
+        get_num_paginas_sucias(),
+        rangos_escritos,
+        estadisticas_pool,
+        archivo_directo.usa_io_uring()
+    };
+}
@@ -0,0 +1,118 @@
+#include "almacenamiento/tabla_paginas.hpp"
+
+TablaPaginas::TablaPaginas() {
+    modo_directo = true;
+    mascara = 0;
+    desplazamiento = 64;
+    max_entradas = 0;
+}
+
+void TablaPaginas::abrir(size_t max_entradas, size_t paginas_archivo) {
+    this->max_entradas = max_entradas;
+    ranuras.clear();
+    directo.clear();
+    modo_directo = true;
+
+    if (paginas_archivo > PAGINAS_MAX_INDICE_DIRECTO) {
+        pasar_a_hash();
+    } else {
+        directo.assign(paginas_archivo, VACIO);
+    }
+}
+
+void TablaPaginas::cerrar() {
+    directo.clear();
+    directo.shrink_to_fit();
+    ranuras.clear();
+    ranuras.shrink_to_fit();
+    modo_directo = true;
+    max_entradas = 0;
+}
+
+void TablaPaginas::ajustar_paginas_archivo(size_t paginas_archivo) {
+    if (!modo_directo || paginas_archivo <= directo.size()) {
+        return;
+    }
+
+    if (paginas_archivo > PAGINAS_MAX_INDICE_DIRECTO) {
+        pasar_a_hash();
+        return;
+    }
+
+    directo.resize(paginas_archivo, VACIO);
+}
+
+// Reserva la tabla hash y mueve lo que hubiera en el arreglo directo
+void TablaPaginas::pasar_a_hash() {
+    size_t capacidad = 16;
+    unsigned bits = 4;
+    while (capacidad < max_entradas * 2) {
+        capacidad <<= 1;
+        bits++;
+    }
+
+    ranuras.assign(capacidad, Ranura{INVALID_PAGE_ID, VACIO});
+    mascara = capacidad - 1;
+    desplazamiento = 64 - bits;
+    modo_directo = false;
+
+    for (size_t pagina_id = 0; pagina_id < directo.size(); pagina_id++) {
+        if (directo[pagina_id] != VACIO) {
+            insertar_en_hash(static_cast<PaginaID>(pagina_id), directo[pagina_id]);
+        }
+    }
+
+    directo.clear();
+    directo.shrink_to_fit();
+}
+
+void TablaPaginas::insertar_en_hash(PaginaID pagina_id, uint32_t frame) {
+    size_t i = posicion_inicial(pagina_id);
+    while (ranuras[i].pagina_id != INVALID_PAGE_ID) {
+        i = (i + 1) & mascara;
+    }
+    ranuras[i] = Ranura{pagina_id, frame};
+}
+
+void TablaPaginas::insertar(PaginaID pagina_id, uint32_t frame) {
+    if (modo_directo && pagina_id >= directo.size()) {
+        ajustar_paginas_archivo(static_cast<size_t>(pagina_id) + 1); // No deberia pasar: el paginador avisa al crecer
+    }
+    if (modo_directo) {
+        directo[pagina_id] = frame;
+        return;
+    }
+    insertar_en_hash(pagina_id, frame);
+}
+
+// Borrado con corrimiento hacia atras: en lugar de dejar una marca de borrado, adelantamos
+// las entradas siguientes del mismo grupo que quedarian inalcanzables. Asi las busquedas
+// nunca se alargan por borrados acumulados.
+void TablaPaginas::eliminar(PaginaID pagina_id) {
+    if (modo_directo) {
+        if (pagina_id < directo.size()) {
+            directo[pagina_id] = VACIO;
+        }
+        return;
+    }
+
+    size_t i = posicion_inicial(pagina_id);
+    while (ranuras[i].pagina_id != pagina_id) {
+        if (ranuras[i].pagina_id == INVALID_PAGE_ID) {
+            return; // No estaba
+        }
+        i = (i + 1) & mascara;
+    }
+
+    size_t hueco = i;
+    for (size_t j = (hueco + 1) & mascara; ranuras[j].pagina_id != INVALID_PAGE_ID; j = (j + 1) & mascara) {
+        // La entrada en j puede ocupar el hueco si su posicion ideal no esta en (hueco, j]
+        size_t ideal = posicion_inicial(ranuras[j].pagina_id);
+        bool ideal_entre = (hueco < j) ? (ideal > hueco && ideal <= j) : (ideal > hueco || ideal <= j);
+        if (!ideal_entre) {
+            ranuras[hueco] = ranuras[j];
+            hueco = j;
+        }
+    }
+    ranuras[hueco] = Ranura{INVALID_PAGE_ID, VACIO};
+}
@@ -0,0 +1,374 @@
+#include "almacenamiento/wal.hpp"
+#include "almacenamiento/crc32c.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t WAL_MAGICO = 0x4C415742; // "BWAL"
+constexpr uint32_t WAL_VERSION = 1;
+
+// Pasado este tamaño el buffer se escribe (sin fdatasync) aunque nadie espere un commit
+constexpr size_t LIMITE_PENDIENTE = size_t(1) << 20;
+
+struct CabeceraWAL {
+    uint32_t magico;
+    uint32_t version;
+    uint64_t lsn_inicial;
+    uint32_t crc;        // De los campos anteriores
+    uint32_t reservado;
+};
+
+struct CabeceraRegistro {
+    uint32_t crc;        // Del resto de la cabecera y los datos
+    uint32_t longitud;   // Bytes de datos despues de la cabecera
+    uint64_t lsn;
+    TipoRegistroWAL tipo;
+    uint8_t reservado[7];
+};
+static_assert(sizeof(CabeceraRegistro) == 24, "La cabecera de registro del WAL no debe tener relleno");
+
+uint32_t crc_registro(const CabeceraRegistro& cabecera, const void* datos) {
+    const char* resto = reinterpret_cast<const char*>(&cabecera) + sizeof(cabecera.crc);
+    uint32_t crc = crc32c(resto, sizeof(CabeceraRegistro) - sizeof(cabecera.crc));
+    return crc32c(datos, cabecera.longitud, crc);
+}
+
+}
+
+size_t WAL::bytes_log() const {
+    if (hay_anterior) {
+        return 2 * sizeof(CabeceraWAL) + static_cast<size_t>(lsn_siguiente - lsn_inicial_anterior);
+    }
+    return sizeof(CabeceraWAL) + static_cast<size_t>(lsn_siguiente - lsn_inicial);
+}
+
+WAL::WAL() {
+    activo = 0;
+    escribiendo = false;
+    fallo = false;
+    lsn_inicial = 0;
+    hay_anterior = false;
+    lsn_inicial_anterior = 0;
+    lsn_siguiente = 0;
+    lsn_escrito = 0;
+    lsn_durable = 0;
+    registros = 0;
+    escrituras = 0;
+    sincronizaciones = 0;
+}
+
+WAL::~WAL() {
+    cerrar();
+}
+
+bool WAL::abrir(const std::string& ruta, bool crear_nuevo) {
+    cerrar();
+
+    // Un archivo recien creado queda con la cabecera en ceros, que se lee como log vacio
+    if (!archivos[0].abrir(ruta, sizeof(CabeceraWAL), false) || !archivos[1].abrir(ruta + ".1", sizeof(CabeceraWAL), false)) {
+        cerrar();
+        return false;
+    }
+
+    uint64_t lsn_inicio[2] = {0, 0};
+    std::vector<RegistroWAL> registros_archivo[2];
+    bool valido[2] = {false, false};
+    if (!crear_nuevo) {
+        valido[0] = leer_registros(0, lsn_inicio[0], registros_archivo[0]);
+        valido[1] = leer_registros(1, lsn_inicio[1], registros_archivo[1]);
+    }
+
+    // El activo es el que empezo despues; los registros del otro van antes
+    activo = (valido[1] && (!valido[0] || lsn_inicio[1] > lsn_inicio[0])) ? 1 : 0;
+    size_t anterior = 1 - activo;
+    hay_anterior = valido[anterior];
+    lsn_inicial_anterior = lsn_inicio[anterior];
+    lsn_inicial = lsn_inicio[activo];
+
+    recuperados = std::move(registros_archivo[anterior]);
+    recuperados.insert(recuperados.end(), registros_archivo[activo].begin(), registros_archivo[activo].end());
+
+    lsn_siguiente = lsn_inicial;
+    if (!registros_archivo[activo].empty()) {
+        const RegistroWAL& ultimo = registros_archivo[activo].back();
+        lsn_siguiente = ultimo.lsn + sizeof(CabeceraRegistro) + ultimo.longitud;
+    }
+    lsn_escrito = lsn_durable = lsn_siguiente;
+
+    // Lo que sigue al ultimo registro valido se descarta para que los nuevos queden a continuacion
+    ArchivoDirecto& archivo = archivos[activo];
+    size_t fin = sizeof(CabeceraWAL) + static_cast<size_t>(lsn_siguiente - lsn_inicial);
+    if (!valido[activo] || archivo.get_size() != fin) {
+        if (!archivo.redimensionar(fin) || (!valido[activo] && !escribir_cabecera(archivo, lsn_inicial)) || !archivo.sincronizar()) {
+            cerrar();
+            return false;
+        }
+    }
+    if (crear_nuevo && !archivos[anterior].redimensionar(0)) {
+        cerrar();
+        return false;
+    }
+
+    escribiendo = false;
+    fallo = false;
+    registros = 0;
+    escrituras = 0;
+    sincronizaciones = 0;
+    return true;
+}
+
+// Una cabecera rota o de otra version se trata como log vacio (devuelve false): la cabecera
+// se escribe antes que cualquier registro del archivo y baja al disco con el primer commit,
+// asi que un archivo con registros siempre tiene su cabecera
+bool WAL::leer_registros(size_t indice, uint64_t& lsn_inicio, std::vector<RegistroWAL>& registros_leidos) {
+    ArchivoDirecto& archivo = archivos[indice];
+    std::vector<char>& contenido = contenido_recuperado[indice];
+    size_t size = archivo.get_size();
+    contenido.resize(size);
+    registros_leidos.clear();
+    if (size < sizeof(CabeceraWAL) || !archivo.leer(0, contenido.data(), size)) {
+        return false;
+    }
+
+    CabeceraWAL cabecera;
+    std::memcpy(&cabecera, contenido.data(), sizeof(cabecera));
+    if (cabecera.magico != WAL_MAGICO || cabecera.version != WAL_VERSION ||
+        cabecera.crc != crc32c(&cabecera, offsetof(CabeceraWAL, crc))) {
+        return false;
+    }
+    lsn_inicio = cabecera.lsn_inicial;
+
+    size_t posicion = sizeof(CabeceraWAL);
+    uint64_t lsn_esperado = lsn_inicio;
+    while (posicion + sizeof(CabeceraRegistro) <= size) {
+        CabeceraRegistro registro;
+        std::memcpy(&registro, contenido.data() + posicion, sizeof(registro));
+        const char* datos = contenido.data() + posicion + sizeof(registro);
+
+        if (registro.longitud > size - posicion - sizeof(registro) || registro.lsn != lsn_esperado ||
+            registro.crc != crc_registro(registro, datos)) {
+            break;
+        }
+
+        registros_leidos.push_back(RegistroWAL{registro.tipo, registro.lsn, datos, registro.longitud});
+        posicion += sizeof(registro) + registro.longitud;
+        lsn_esperado += sizeof(registro) + registro.longitud;
+    }
+    return true;
+}
+
+void WAL::cerrar() {
+    std::unique_lock<std::mutex> lock(mutex);
+    escritura_terminada.wait(lock, [this] { return !escribiendo; });
+    if (!pendiente.empty() && !fallo) {
+        escribir_pendiente(lock, true);
+    }
+    pendiente.clear();
+    archivos[0].cerrar();
+    archivos[1].cerrar();
+    hay_anterior = false;
+    lock.unlock();
+    liberar_recuperados();
+}
+
+bool WAL::escribir_cabecera(ArchivoDirecto& archivo, uint64_t lsn) {
+    CabeceraWAL cabecera = {WAL_MAGICO, WAL_VERSION, lsn, 0, 0};
+    cabecera.crc = crc32c(&cabecera, offsetof(CabeceraWAL, crc));
+    return archivo.escribir(0, reinterpret_cast<const char*>(&cabecera), sizeof(cabecera));
+}
+
+uint64_t WAL::agregar(TipoRegistroWAL tipo, const void* datos, size_t longitud) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    CabeceraRegistro cabecera = {};
+    cabecera.longitud = static_cast<uint32_t>(longitud);
+    cabecera.lsn = lsn_siguiente;
+    cabecera.tipo = tipo;
+    cabecera.crc = crc_registro(cabecera, datos);
+
+    const char* bytes = static_cast<const char*>(datos);
+    pendiente.insert(pendiente.end(), reinterpret_cast<const char*>(&cabecera), reinterpret_cast<const char*>(&cabecera) + sizeof(cabecera));
+    pendiente.insert(pendiente.end(), bytes, bytes + longitud);
+    lsn_siguiente += sizeof(cabecera) + longitud;
+    registros++;
+
+    // Con muchos registros sin commit (por ejemplo las imagenes de un checkpoint) no dejamos
+    // que el buffer crezca sin limite
+    if (pendiente.size() >= LIMITE_PENDIENTE && !escribiendo && !fallo) {
+        escribir_pendiente(lock, false);
+    }
+
+    return lsn_siguiente;
+}
+
+// Escribe todo lo pendiente sin el mutex tomado: mientras tanto otros hilos siguen agregando
+// registros, que salen en la proxima escritura. Si hubo una rotacion, la parte anterior va al
+// archivo anterior y se sincroniza primero: un registro nuevo nunca queda en el disco antes
+// que los que lo precedieron.
+bool WAL::escribir_pendiente(std::unique_lock<std::mutex>& lock, bool sincronizar) {
+    escribiendo = true;
+    en_escritura.swap(pendiente);
+    uint64_t desde = lsn_escrito;
+    uint64_t hasta = lsn_siguiente;
+    uint64_t corte = lsn_inicial;
+    uint64_t inicio_anterior = lsn_inicial_anterior;
+    bool sincronizar_anterior = sincronizar && lsn_durable < corte;
+    ArchivoDirecto& actual = archivos[activo];
+    ArchivoDirecto& anterior = archivos[1 - activo];
+    lock.unlock();
+
+    size_t bytes_anterior = desde < corte ? static_cast<size_t>(std::min(hasta, corte) - desde) : 0;
+    bool exito = true;
+    if (bytes_anterior > 0) {
+        size_t offset = sizeof(CabeceraWAL) + static_cast<size_t>(desde - inicio_anterior);
+        exito = anterior.escribir(offset, en_escritura.data(), bytes_anterior);
+    }
+    if (exito && en_escritura.size() > bytes_anterior) {
+        size_t offset = sizeof(CabeceraWAL) + static_cast<size_t>(std::max(desde, corte) - corte);
+        exito = actual.escribir(offset, en_escritura.data() + bytes_anterior, en_escritura.size() - bytes_anterior);
+    }
+    if (exito && sincronizar_anterior) {
+        exito = anterior.sincronizar();
+    }
+    if (exito && sincronizar) {
+        exito = actual.sincronizar();
+    }
+
+    lock.lock();
+    if (!en_escritura.empty()) {
+        escrituras++;
+    }
+    if (sincronizar) {
+        sincronizaciones++;
+    }
+    en_escritura.clear();
+    escribiendo = false;
+    if (exito) {
+        lsn_escrito = hasta;
+        if (sincronizar) {
+            lsn_durable = hasta;
+        }
+    } else {
+        fallo = true;
+    }
+    escritura_terminada.notify_all();
+    return exito;
+}
+
+bool WAL::esperar_durable(uint64_t lsn) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (lsn_durable < lsn) {
+        if (fallo) {
+            return false;
+        }
+        if (escribiendo) {
+            // Otro hilo esta escribiendo; si no alcanza a nuestro registro, al despertar
+            // escribimos nosotros todo lo que se acumulo mientras tanto
+            escritura_terminada.wait(lock);
+            continue;
+        }
+        if (!escribir_pendiente(lock, true)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WAL::reiniciar(uint64_t lsn_minimo) {
+    std::unique_lock<std::mutex> lock(mutex);
+    escritura_terminada.wait(lock, [this] { return !escribiendo; });
+    if (fallo) {
+        return false;
+    }
+
+    // Primero se corta y despues se escribe la cabecera: si el proceso muere en el medio queda
+    // un log vacio, que tambien es valido. El otro archivo solo puede tener registros
+    // anteriores, asi que se vacia antes.
+    ArchivoDirecto& archivo = archivos[activo];
+    lsn_inicial = std::max(lsn_siguiente, lsn_minimo);
+    pendiente.clear();
+    if (!archivos[1 - activo].redimensionar(0) || !archivo.redimensionar(0) ||
+        !escribir_cabecera(archivo, lsn_inicial) || !archivo.sincronizar()) {
+        fallo = true;
+        return false;
+    }
+    hay_anterior = false;
+    lsn_siguiente = lsn_escrito = lsn_durable = lsn_inicial;
+    return true;
+}
+
+// El otro archivo solo tiene registros ya descartados y ninguna escritura en curso lo usa
+// (descartar_anterior exige que todo lo anterior este en el disco). La cabecera nueva se
+// escribe sin fdatasync: baja con el primer commit del archivo, y si el corte no llega al
+// disco los registros viejos quedan detras con LSN fuera de orden y la lectura los ignora.
+bool WAL::rotar() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fallo || hay_anterior) {
+        return false;
+    }
+
+    size_t nuevo = 1 - activo;
+    if (!archivos[nuevo].redimensionar(0) || !escribir_cabecera(archivos[nuevo], lsn_siguiente)) {
+        fallo = true;
+        return false;
+    }
+    lsn_inicial_anterior = lsn_inicial;
+    lsn_inicial = lsn_siguiente;
+    activo = nuevo;
+    hay_anterior = true;
+    return true;
+}
+
+// Tampoco hace falta fdatasync: si el corte se pierde, los registros del archivo tienen LSN
+// menores que el del checkpoint que guarda la base y la recuperacion los saltea
+bool WAL::descartar_anterior() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!hay_anterior) {
+        return true;
+    }
+    if (fallo || lsn_durable < lsn_inicial) {
+        return false;
+    }
+    if (!archivos[1 - activo].redimensionar(0)) {
+        fallo = true;
+        return false;
+    }
+    hay_anterior = false;
+    return true;
+}
+
+const std::vector<RegistroWAL>& WAL::get_recuperados() const {
+    return recuperados;
+}
+
+void WAL::liberar_recuperados() {
+    recuperados.clear();
+    recuperados.shrink_to_fit();
+    for (std::vector<char>& contenido : contenido_recuperado) {
+        contenido.clear();
+        contenido.shrink_to_fit();
+    }
+}
+
+uint64_t WAL::get_lsn_siguiente() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lsn_siguiente;
+}
+
+// Lo que habria que leer al recuperar: los dos archivos si el anterior todavia no se descarto
+size_t WAL::get_bytes_log() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes_log();
+}
+
+EstadisticasWAL WAL::get_estadisticas() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return EstadisticasWAL{
+        lsn_siguiente,
+        bytes_log(),
+        registros,
+        escrituras,
+        sincronizaciones
+    };
+}
@@ -1,6 +1,11 @@
 #include "database.hpp"
+#include "almacenamiento/orden_externo.hpp"
 #include "almacenamiento/pagina_ranurada.hpp"
 #include "core/ciudadano.hpp"
+#include "core/prefetch.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <filesystem>
 #include <stdexcept>
 #include <vector>
@@ -10,29 +15,90 @@ namespace fs = std::filesystem;
 Database::Database() : inicializado(false), ultima_pagina_datos_id(INVALID_PAGE_ID) {}
 
 Database::~Database() {
+    std::unique_lock<std::shared_mutex> exclusivo(estructura);
+    std::unique_lock<std::mutex> lock(mutex);
     if (inicializado) {
-        cerrar();
+        detener_checkpointer_hilo(lock);
+        try {
+            cerrar();
+        } catch (const std::exception&) {
+            // Si el checkpoint final falla el log sigue en el disco: se recupera al abrir
+        }
     }
 }
 
-bool Database::abrir(const std::string& ruta) {
+bool Database::abrir(const std::string& ruta, const OpcionesDB& opciones) {
+    std::unique_lock<std::shared_mutex> exclusivo(estructura);
+    std::lock_guard<std::mutex> lock(mutex);
     if (inicializado) {
         return false; // Ya está abierta
     }
 
+    this->opciones = opciones;
+    usar_wal = opciones.wal.activo;
+    error_checkpoint.clear();
+    // Con WAL el archivo solo se escribe en los checkpoints (ver Database::checkpoint)
+    this->opciones.paginador.escribir_solo_al_sincronizar = usar_wal;
+
+    std::string ruta_wal = ruta + ".wal";
     bool db_existe = fs::exists(ruta);
+    this->ruta_db = ruta; // La migracion ordena en archivos temporales junto a la base
 
     if (!db_existe) {
+        if (usar_wal && !wal.abrir(ruta_wal, true)) {
+            throw std::runtime_error("No se pudo crear el WAL de la base de datos.");
+        }
         crear_db(ruta);
     } else {
-        if (!paginador.abrir(ruta, 0)) {
+        if (!usar_wal && fs::exists(ruta_wal)) {
+            // Sin recuperar, las operaciones del log se perderian y el archivo podria estar a medias
+            WAL pendiente;
+            if (pendiente.abrir(ruta_wal, false) && !pendiente.get_recuperados().empty()) {
+                throw std::runtime_error("La base de datos tiene operaciones en el WAL: abrirla con el WAL activo.");
+            }
+        }
+        if (usar_wal && !wal.abrir(ruta_wal, false)) {
+            throw std::runtime_error("No se pudo abrir el WAL de la base de datos.");
+        }
+        if (!paginador.abrir(ruta, 0, this->opciones.paginador)) {
             throw std::runtime_error("No se pudo abrir el archivo de la base de datos existente.");
         }
-        cargar_db();
+        if (usar_wal) {
+            recuperar();
+        } else {
+            cargar_db();
+        }
     }
 
-    this->ruta_db = ruta;
     inicializado = true;
+    if (usar_wal && this->opciones.checkpoint_en_segundo_plano) {
+        iniciar_checkpointer();
+    }
+    return true;
+}
+
+bool Database::escribir_superblock() {
+    PaginaFijada pagina_superblock = paginador.fijar_pagina(SUPERBLOCK_PAGE_ID);
+    if (!pagina_superblock) {
+        return false;
+    }
+    auto* superblock = reinterpret_cast<Superblock*>(pagina_superblock.datos());
+    superblock->raiz_indice_dni = agrupada() ? tabla->get_id_raiz() : indice_dni->get_id_raiz();
+    superblock->ultima_pagina_datos = ultima_pagina_datos_id;
+    superblock->num_paginas = paginador.get_num_paginas();
+    superblock->primer_tronco_libres = paginador.get_primer_tronco_libres();
+    superblock->num_paginas_libres = paginador.get_num_paginas_libres();
+    superblock->lsn_checkpoint = lsn_checkpoint;
+    superblock->magia = MAGIA_SUPERBLOCK;
+    superblock->version_formato = version_formato;
+    superblock->hoja_migracion = hoja_migracion;
+    superblock->raiz_indice_nombres = indice_nombres->get_id_raiz();
+    superblock->modo_tabla = static_cast<uint32_t>(modo_tabla);
+    superblock->primera_pagina_filtro = primera_pagina_filtro;
+    superblock->paginas_filtro = static_cast<uint32_t>(paginas_filtro);
+    superblock->claves_filtro = filtro ? filtro->get_num_claves() : 0;
+    superblock->filtro_al_dia = filtro_al_dia ? 1 : 0;
+    pagina_superblock.marcar_sucia();
     return true;
 }
 
@@ -40,164 +106,1748 @@ void Database::cerrar() {
     if (!inicializado) {
         return;
     }
-    char* superblock_ptr = paginador.get_pagina(SUPERBLOCK_PAGE_ID);
-    auto* superblock = reinterpret_cast<Superblock*>(superblock_ptr);
-    superblock->raiz_indice_dni = indice_dni->get_id_raiz();
-    superblock->ultima_pagina_datos = ultima_pagina_datos_id;
-    
-    paginador.cerrar();
+    reservar_paginas_filtro();
+    if (usar_wal) {
+        checkpoint(wal.get_lsn_siguiente(), true); // Cerrar deja el log vacio
+        // Con la base ya en el archivo, las paginas del filtro (que el superblock todavia no da
+        // por al dia) se escriben en su lugar, y otro checkpoint escribe el superblock que si
+        if (guardar_filtro()) {
+            checkpoint(wal.get_lsn_siguiente(), true);
+        }
+        wal.cerrar();
+    } else {
+        guardar_filtro(); // Sincroniza todo antes de que el superblock lo de por al dia
+        escribir_superblock(); // Suelta su guard antes de cerrar el paginador, que escribe las paginas sucias
+    }
+
+    // Antes que el paginador: el indice de DNIs tiene sus nodos internos fijados
     indice_dni.reset();
+    tabla.reset();
+    indice_nombres.reset();
+    filtro.reset();
+    paginador.cerrar();
     inicializado = false;
 }
 
 void Database::crear_db(const std::string& ruta) {
-    if (!paginador.abrir(ruta, 10)) {
+    if (!paginador.abrir(ruta, 10, opciones.paginador)) {
         throw std::runtime_error("No se pudo crear el archivo de la base de datos.");
     }
+    // Del archivo inicial solo usamos el superblock, el resto queda como capacidad libre
+    paginador.fijar_num_paginas(SUPERBLOCK_PAGE_ID + 1);
 
-    indice_dni = std::make_unique<BPlusTree>(paginador);
-    PaginaID raiz_id = indice_dni->inicializar(INVALID_PAGE_ID);
+    modo_tabla = opciones.modo_tabla;
+    PaginaID raiz_id;
+    if (agrupada()) {
+        tabla = std::make_unique<BPlusTreeCadenas>(paginador, ValorCadenas::BYTES);
+        raiz_id = tabla->inicializar(INVALID_PAGE_ID);
+    } else {
+        indice_dni = std::make_unique<BPlusTree>(paginador);
+        raiz_id = indice_dni->inicializar(INVALID_PAGE_ID);
+    }
+    indice_nombres = std::make_unique<BPlusTreeCadenas>(paginador);
+    PaginaID raiz_nombres_id = indice_nombres->inicializar(INVALID_PAGE_ID);
+    filtro.reset();
+    if (opciones.filtro_dni) {
+        filtro = std::make_unique<FiltroBloom>(FiltroBloom::paginas_para(0));
+    }
+    primera_pagina_filtro = INVALID_PAGE_ID;
+    paginas_filtro = 0;
+    filtro_al_dia = false;
 
-    char* superblock_ptr = paginador.get_pagina(SUPERBLOCK_PAGE_ID);
-    auto* superblock = reinterpret_cast<Superblock*>(superblock_ptr);
+    PaginaFijada pagina_superblock = paginador.fijar_pagina(SUPERBLOCK_PAGE_ID);
+    if (!pagina_superblock) {
+        throw std::runtime_error("No se pudo leer el superblock.");
+    }
+    auto* superblock = reinterpret_cast<Superblock*>(pagina_superblock.datos());
 
     superblock->raiz_indice_dni = raiz_id;
     superblock->ultima_pagina_datos = INVALID_PAGE_ID;
+    superblock->num_paginas = paginador.get_num_paginas();
+    superblock->primer_tronco_libres = INVALID_PAGE_ID;
+    superblock->reservado = 0;
+    superblock->num_paginas_libres = 0;
+    superblock->lsn_checkpoint = 0;
+    superblock->magia = MAGIA_SUPERBLOCK;
+    superblock->version_formato = VERSION_FORMATO;
+    superblock->hoja_migracion = SUPERBLOCK_PAGE_ID;
+    superblock->raiz_indice_nombres = raiz_nombres_id;
+    superblock->modo_tabla = static_cast<uint32_t>(modo_tabla);
+    superblock->primera_pagina_filtro = INVALID_PAGE_ID;
+    superblock->paginas_filtro = 0;
+    superblock->claves_filtro = 0;
+    superblock->filtro_al_dia = 0;
+    pagina_superblock.marcar_sucia();
+    pagina_superblock.soltar();
     ultima_pagina_datos_id = INVALID_PAGE_ID;
+    lsn_checkpoint = 0;
+    version_formato = VERSION_FORMATO;
+    hoja_migracion = SUPERBLOCK_PAGE_ID;
+
+    // Con WAL nada llega al archivo hasta un checkpoint: sin este, un corte ahora dejaria un
+    // archivo sin superblock
+    if (usar_wal) {
+        checkpoint(wal.get_lsn_siguiente(), true);
+    }
 }
 
 void Database::cargar_db() {
-    char* superblock_ptr = paginador.get_pagina(SUPERBLOCK_PAGE_ID);
-    const auto* superblock = reinterpret_cast<const Superblock*>(superblock_ptr);
+    PaginaFijada pagina_superblock = paginador.fijar_pagina(SUPERBLOCK_PAGE_ID);
+    if (!pagina_superblock) {
+        throw std::runtime_error("No se pudo leer el superblock.");
+    }
+    const auto* superblock = reinterpret_cast<const Superblock*>(pagina_superblock.datos());
 
-    indice_dni = std::make_unique<BPlusTree>(paginador);
-    indice_dni->inicializar(superblock->raiz_indice_dni);
+    if (superblock->magia == 0 && superblock->version_formato == 0) {
+        version_formato = 1; // Anterior a la magia y a la version
+    } else if (superblock->magia != MAGIA_SUPERBLOCK) {
+        throw std::runtime_error("El archivo no es una base de datos (superblock sin la magia esperada).");
+    } else if (superblock->version_formato == 0 || superblock->version_formato > VERSION_FORMATO) {
+        throw std::runtime_error("La base de datos tiene el formato " + std::to_string(superblock->version_formato) +
+                                 ", y esta version solo lee hasta el " + std::to_string(VERSION_FORMATO) + ".");
+    } else {
+        version_formato = superblock->version_formato;
+    }
+    hoja_migracion = version_formato < VERSION_FORMATO ? superblock->hoja_migracion : SUPERBLOCK_PAGE_ID;
+
+    if (superblock->num_paginas != 0 && !paginador.fijar_num_paginas(superblock->num_paginas)) {
+        throw std::runtime_error("El superblock indica mas paginas de las que tiene el archivo.");
+    }
+
+    // La pagina 0 es el superblock, nunca un tronco: un 0 viene de un archivo sin lista de libres
+    PaginaID primer_tronco = superblock->primer_tronco_libres;
+    if (primer_tronco != SUPERBLOCK_PAGE_ID && !paginador.fijar_lista_libres(primer_tronco, superblock->num_paginas_libres)) {
+        throw std::runtime_error("El superblock apunta a una lista de paginas libres invalida.");
+    }
+
+    // Antes de la version 4 todas las bases son ModoTabla::HEAP
+    modo_tabla = ModoTabla::HEAP;
+    if (version_formato >= 4) {
+        if (superblock->modo_tabla > static_cast<uint32_t>(ModoTabla::AGRUPADA)) {
+            throw std::runtime_error("El superblock tiene un modo de tabla desconocido (" + std::to_string(superblock->modo_tabla) + ").");
+        }
+        modo_tabla = static_cast<ModoTabla>(superblock->modo_tabla);
+    }
+    if (agrupada()) {
+        tabla = std::make_unique<BPlusTreeCadenas>(paginador, ValorCadenas::BYTES);
+        tabla->inicializar(superblock->raiz_indice_dni);
+    } else {
+        indice_dni = std::make_unique<BPlusTree>(paginador);
+        indice_dni->inicializar(superblock->raiz_indice_dni);
+    }
+    // Antes de la version 3 no hay indice de nombres: lo arma migrar_formato
+    indice_nombres = std::make_unique<BPlusTreeCadenas>(paginador);
+    if (version_formato >= 3) {
+        indice_nombres->inicializar(superblock->raiz_indice_nombres);
+    }
     ultima_pagina_datos_id = superblock->ultima_pagina_datos;
+    lsn_checkpoint = superblock->lsn_checkpoint;
+    // Antes de la version 5 no hay filtro guardado
+    primera_pagina_filtro = INVALID_PAGE_ID;
+    paginas_filtro = 0;
+    filtro_al_dia = false;
+    size_t claves_filtro = 0;
+    if (version_formato >= 5 && superblock->primera_pagina_filtro != INVALID_PAGE_ID) {
+        if (static_cast<size_t>(superblock->primera_pagina_filtro) + superblock->paginas_filtro > paginador.get_num_paginas()) {
+            throw std::runtime_error("El superblock apunta a paginas del filtro fuera del archivo.");
+        }
+        primera_pagina_filtro = superblock->primera_pagina_filtro;
+        paginas_filtro = superblock->paginas_filtro;
+        filtro_al_dia = superblock->filtro_al_dia != 0;
+        claves_filtro = superblock->claves_filtro;
+    }
+    pagina_superblock.soltar();
+
+    // Con WAL se llama desde recuperar() antes de rehacer el log, que ya usa el formato actual
+    if (version_formato < VERSION_FORMATO) {
+        migrar_formato();
+    }
+    // Despues de migrar, que puede armar el indice de nombres y no cambia los DNIs. Con WAL,
+    // antes de rehacer el log: las inserciones que se rehacen tambien van al filtro.
+    abrir_filtro(claves_filtro);
 }
 
-bool Database::insertar_ciudadano(const Ciudadano& ciudadano) {
-    if (!inicializado) {
+void Database::migrar_formato() {
+    // De la version 1 a la 2 solo cambian las hojas, y cada una se convierte en su lugar. Las
+    // tandas dejan margen en el pool, que con WAL no puede desalojar paginas sucias.
+    size_t max_hojas = std::max<size_t>(1, limite_paginas_sucias() / 2);
+    while (version_formato < VERSION_FORMATO) {
+        if (version_formato == 1) {
+            PaginaID desde = hoja_migracion == SUPERBLOCK_PAGE_ID ? INVALID_PAGE_ID : hoja_migracion;
+            PaginaID siguiente = indice_dni->migrar_hojas_v1(desde, max_hojas);
+            if (siguiente == INVALID_PAGE_ID) {
+                version_formato = 2;
+                hoja_migracion = SUPERBLOCK_PAGE_ID;
+            } else {
+                hoja_migracion = siguiente;
+            }
+        } else if (version_formato == 2) {
+            construir_indice_nombres();
+            version_formato = 3;
+        } else if (version_formato == 3) {
+            version_formato = 4; // Solo agrega modo_tabla al superblock, que es HEAP
+        } else {
+            version_formato = 5; // Solo agrega el filtro al superblock, sin paginas: se arma al abrir
+        }
+
+        if (usar_wal) {
+            // No vacia el log: la recuperacion todavia tiene que rehacerlo desde lsn_checkpoint
+            checkpoint(lsn_checkpoint, false);
+        } else if (!escribir_superblock() || !paginador.sincronizar()) {
+            throw std::runtime_error("No se pudieron escribir las hojas migradas.");
+        }
+    }
+}
+
+// Clave en el indice de nombres del registro que esta en el slot, si esta
+static std::optional<std::string> clave_nombre_registro(char* pagina_ptr, SlotID slot_id) {
+    char buffer[PAGINA_SIZE];
+    size_t size_leido = 0;
+    if (!PaginaRanurada(pagina_ptr).leer_registro(slot_id, buffer, size_leido)) {
+        return std::nullopt;
+    }
+    return clave_nombre(buffer);
+}
+
+// En ModoTabla::AGRUPADA los registros se mueven con las divisiones de las hojas: el indice de
+// nombres no guarda donde estan, y se los busca en la tabla por el DNI de la clave
+static constexpr RegistroID SIN_REGISTRO = {INVALID_PAGE_ID, 0};
+
+// Para armar el indice de nombres con construir_desde_ordenados, sus entradas se ordenan con
+// OrdenExterno (CriterioOrden::BYTES) como la clave seguida del RegistroID empaquetado
+static void agregar_nombre(OrdenExterno& orden, std::string clave, RegistroID rid) {
+    RegistroIDEmpaquetado empaquetado = RegistroIDEmpaquetado::de(rid);
+    clave.append(reinterpret_cast<const char*>(&empaquetado), sizeof(empaquetado));
+    orden.agregar(clave.data(), clave.size());
+}
+
+static bool siguiente_nombre(OrdenExterno& orden, std::string& clave, RegistroID& rid) {
+    const char* leido;
+    size_t size;
+    if (!orden.siguiente(leido, size)) {
         return false;
     }
+    RegistroIDEmpaquetado empaquetado;
+    std::memcpy(&empaquetado, leido + size - sizeof(empaquetado), sizeof(empaquetado));
+    clave.assign(leido, size - sizeof(empaquetado));
+    rid = empaquetado.desempaquetar();
+    return true;
+}
 
-    if (indice_dni->buscar(ciudadano.dni).has_value()) {
-        return false; // Ya existe, no se permiten duplicados por ahora
+void Database::construir_indice_nombres() {
+    OrdenExterno orden(ruta_db + ".nombres", OpcionesCargaMasiva().memoria_orden, CriterioOrden::BYTES);
+    for (BPlusTree::Iterador it = indice_dni->buscar_desde(0); it.valido(); it.siguiente()) {
+        RegistroID rid = it.valor();
+        PaginaFijada pagina = paginador.fijar_pagina(rid.pagina_id);
+        if (!pagina) {
+            throw std::runtime_error("No se pudo fijar la pagina de datos " + std::to_string(rid.pagina_id) + ".");
+        }
+        auto clave = clave_nombre_registro(pagina.datos(), rid.slot_id);
+        if (!clave.has_value()) {
+            continue;
+        }
+        agregar_nombre(orden, std::move(*clave), rid);
     }
+    orden.terminar();
 
+    // Las paginas nuevas van despues de num_paginas, donde el archivo todavia no las usa:
+    // escribirlas antes del checkpoint (para no llenar el pool) es seguro
+    indice_nombres->construir_desde_ordenados([&](std::string& clave, RegistroID& rid) {
+        if (paginador.get_num_paginas_sucias() >= limite_paginas_sucias() && !paginador.sincronizar()) {
+            throw std::runtime_error("No se pudieron escribir las paginas del indice de nombres.");
+        }
+        return siguiente_nombre(orden, clave, rid);
+    }, OpcionesCargaMasiva().factor_llenado);
+}
+
+// === Filtro de DNIs ===
+
+void Database::abrir_filtro(size_t claves_guardadas) {
+    filtro.reset();
+    bool publicado = filtro_al_dia;
+    filtro_al_dia = false;
+
+    if (!opciones.filtro_dni) {
+        // Sus paginas quedan libres; el superblock deja de apuntarlas en la proxima escritura
+        for (size_t i = 0; i < paginas_filtro; i++) {
+            paginador.liberar_pagina(static_cast<PaginaID>(primera_pagina_filtro + i));
+        }
+        primera_pagina_filtro = INVALID_PAGE_ID;
+        paginas_filtro = 0;
+    } else if (publicado && claves_guardadas <= FiltroBloom::capacidad_de(paginas_filtro)) {
+        filtro = std::make_unique<FiltroBloom>(paginas_filtro);
+        for (size_t i = 0; i < paginas_filtro; i++) {
+            PaginaFijada pagina = paginador.fijar_pagina(static_cast<PaginaID>(primera_pagina_filtro + i));
+            if (!pagina) {
+                throw std::runtime_error("No se pudo leer la pagina " + std::to_string(i) + " del filtro.");
+            }
+            filtro->cargar_pagina(i, pagina.datos());
+        }
+        filtro->fijar_num_claves(claves_guardadas);
+    } else {
+        // Sin cerrar bien, o pasado de su capacidad (con mas errores que los previstos)
+        armar_filtro();
+    }
+
+    if (publicado && !usar_wal) {
+        if (!escribir_superblock() || !paginador.sincronizar()) {
+            throw std::runtime_error("No se pudo escribir el superblock.");
+        }
+    }
+}
+
+// Dos recorridos de las hojas: uno cuenta los DNIs para darle al filtro el doble de lugar (lo
+// que se inserte despues entra sin volver a armarlo) y el otro los agrega
+void Database::armar_filtro() {
+    auto recorrer = [&](const std::function<void(DNI_t)>& visitar) {
+        if (agrupada()) {
+            for (BPlusTreeCadenas::Iterador it = tabla->buscar_desde(""); it.valido(); it.siguiente()) {
+                visitar(dni_de_clave(it.clave()));
+            }
+        } else {
+            for (BPlusTree::Iterador it = indice_dni->buscar_desde(0); it.valido(); it.siguiente()) {
+                visitar(it.clave());
+            }
+        }
+    };
+    size_t claves = 0;
+    recorrer([&](DNI_t) { claves++; });
+    filtro = std::make_unique<FiltroBloom>(FiltroBloom::paginas_para(2 * claves));
+    recorrer([&](DNI_t dni) { filtro->agregar(dni); });
+}
+
+// Las busquedas leen el filtro con estructura compartido: se reemplaza con estructura
+// exclusivo, que se toma antes que el mutex. Otra insercion puede haberlo agrandado mientras.
+void Database::agrandar_filtro() {
+    std::unique_lock<std::shared_mutex> exclusivo(estructura);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (inicializado && filtro_lleno()) {
+        armar_filtro();
+    }
+}
+
+void Database::reservar_paginas_filtro() {
+    size_t paginas = filtro ? filtro->get_num_paginas() : 0;
+    if (paginas == paginas_filtro) {
+        return;
+    }
+    for (size_t i = 0; i < paginas_filtro; i++) {
+        paginador.liberar_pagina(static_cast<PaginaID>(primera_pagina_filtro + i));
+    }
+    primera_pagina_filtro = INVALID_PAGE_ID;
+    paginas_filtro = 0;
+    filtro_al_dia = false;
+
+    // Seguidas al final del archivo, que crece solo lo que falta (ver alloc_paginas_nuevas)
+    if (paginas > 0) {
+        primera_pagina_filtro = paginador.alloc_paginas_nuevas(paginas);
+        if (primera_pagina_filtro == INVALID_PAGE_ID) {
+            throw std::runtime_error("No se pudieron reservar las paginas del filtro.");
+        }
+    }
+    paginas_filtro = paginas;
+    filtro->marcar_sin_guardar();
+}
+
+bool Database::guardar_filtro() {
+    if (!filtro || paginas_filtro != filtro->get_num_paginas()) {
+        return false;
+    }
+    for (size_t i = 0; i < paginas_filtro; i++) {
+        if (!filtro->pagina_cambiada(i)) {
+            continue;
+        }
+        // Con el resto de la base ya en el archivo (ver cerrar), y mientras el superblock no
+        // las de por al dia, las paginas del filtro se pueden escribir en su lugar sin el WAL
+        if (paginador.get_num_paginas_sucias() >= limite_paginas_sucias() && !paginador.sincronizar()) {
+            throw std::runtime_error("No se pudieron escribir las paginas del filtro.");
+        }
+        PaginaFijada pagina = paginador.fijar_pagina(static_cast<PaginaID>(primera_pagina_filtro + i));
+        if (!pagina) {
+            throw std::runtime_error("No se pudo fijar la pagina " + std::to_string(i) + " del filtro.");
+        }
+        filtro->copiar_pagina(i, pagina.datos());
+        pagina.marcar_sucia();
+    }
+    if (!paginador.sincronizar()) {
+        throw std::runtime_error("No se pudieron escribir las paginas del filtro.");
+    }
+    filtro->marcar_guardado();
+    filtro_al_dia = true;
+    return true;
+}
+
+// === WAL ===
+
+uint64_t Database::registrar(TipoRegistroWAL tipo, const void* datos, size_t longitud) {
+    if (!usar_wal) {
+        return 0;
+    }
+    return wal.agregar(tipo, datos, longitud);
+}
+
+// Se llama sin el mutex: mientras esperamos el fdatasync otras operaciones siguen
+// ejecutandose y sus registros bajan todos juntos en la siguiente escritura del log
+bool Database::esperar_commit(uint64_t lsn) {
+    if (!usar_wal || !opciones.wal.commit_sincrono) {
+        return true;
+    }
+    return wal.esperar_durable(lsn);
+}
+
+// En modo BUFFER_POOL una pagina sucia no puede salir del pool hasta el checkpoint: dejamos
+// frames limpios de sobra para que una operacion (que puede dividir nodos hasta la raiz)
+// siempre encuentre donde trabajar
+size_t Database::limite_paginas_sucias() const {
+    size_t limite = opciones.checkpoint_paginas_sucias;
+    if (paginador.get_modo() == ModoAlmacenamiento::BUFFER_POOL) {
+        size_t frames = opciones.paginador.frames_buffer_pool;
+        limite = std::min(limite, frames - std::min<size_t>(64, frames / 2));
+    }
+    return limite;
+}
+
+void Database::checkpoint_si_hace_falta(uint64_t lsn_aplicado, bool reiniciar_log) {
+    if (!usar_wal) {
+        return;
+    }
+    if (paginador.get_num_paginas_sucias() > limite_paginas_sucias() || wal.get_bytes_log() > opciones.checkpoint_bytes_log) {
+        checkpoint(lsn_aplicado, reiniciar_log);
+    }
+}
+
+// Copia las paginas sucias (superblock incluido) a copias_checkpoint, en orden de PaginaID, y
+// devuelve donde empiezan: alineado a PAGINA_SIZE para que el paginador pueda escribirlas con
+// O_DIRECT
+char* Database::copiar_paginas_sucias(std::vector<PaginaID>& ids) {
+    ids = paginador.get_paginas_sucias();
+    // Las que quedaron fuera del archivo (vacuum lo esta cortando) no hace falta recuperarlas
+    size_t num_paginas = paginador.get_num_paginas();
+    ids.erase(std::remove_if(ids.begin(), ids.end(), [num_paginas](PaginaID id) { return id >= num_paginas; }), ids.end());
+    std::sort(ids.begin(), ids.end());
+
+    copias_checkpoint.resize((ids.size() + 1) * PAGINA_SIZE);
+    size_t desalineado = reinterpret_cast<uintptr_t>(copias_checkpoint.data()) % PAGINA_SIZE;
+    char* copias = copias_checkpoint.data() + (desalineado == 0 ? 0 : PAGINA_SIZE - desalineado);
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        PaginaFijada pagina = paginador.fijar_pagina(ids[i]);
+        if (!pagina) {
+            throw std::runtime_error("No se pudo fijar la pagina " + std::to_string(ids[i]) + " en el checkpoint.");
+        }
+        std::memcpy(copias + i * PAGINA_SIZE, pagina.datos(), PAGINA_SIZE);
+    }
+    return copias;
+}
+
+// Agrega al log las imagenes y el registro CHECKPOINT; devuelve el LSN a esperar. No necesita
+// el mutex (el WAL tiene el suyo).
+uint64_t Database::registrar_imagenes(uint64_t lsn_aplicado, const std::vector<PaginaID>& ids, const char* copias) {
+    std::vector<char> imagen(sizeof(lsn_aplicado) + sizeof(PaginaID) + PAGINA_SIZE);
+    std::memcpy(imagen.data(), &lsn_aplicado, sizeof(lsn_aplicado));
+    for (size_t i = 0; i < ids.size(); i++) {
+        std::memcpy(imagen.data() + sizeof(lsn_aplicado), &ids[i], sizeof(PaginaID));
+        std::memcpy(imagen.data() + sizeof(lsn_aplicado) + sizeof(PaginaID), copias + i * PAGINA_SIZE, PAGINA_SIZE);
+        wal.agregar(TipoRegistroWAL::IMAGEN_PAGINA, imagen.data(), imagen.size());
+    }
+    return wal.agregar(TipoRegistroWAL::CHECKPOINT, &lsn_aplicado, sizeof(lsn_aplicado));
+}
+
+// Lleva el archivo al estado actual, con el mutex tomado de principio a fin y sin un checkpoint
+// en segundo plano a medias. Como con WAL nada llega al archivo fuera de aqui, entre
+// checkpoints el archivo queda como en el anterior; las paginas se escriben dos veces (double
+// write) para que un corte mientras se escriben en su lugar no deje paginas a medias:
+//  1. Las imagenes de las paginas sucias (superblock incluido) y un registro CHECKPOINT
+//     van al log, con fdatasync.
+//  2. Las paginas se escriben en su lugar, con fdatasync.
+//  3. Se vacia el log.
+// Si el proceso muere en 2, la recuperacion vuelve a copiar las imagenes. Todas las
+// operaciones con LSN < lsn_aplicado quedan reflejadas en el archivo.
+void Database::checkpoint(uint64_t lsn_aplicado, bool reiniciar_log) {
+    lsn_checkpoint = lsn_aplicado;
+    if (!escribir_superblock()) {
+        throw std::runtime_error("No se pudo escribir el superblock en el checkpoint.");
+    }
+
+    std::vector<PaginaID> ids;
+    const char* copias = copiar_paginas_sucias(ids);
+    if (!wal.esperar_durable(registrar_imagenes(lsn_aplicado, ids, copias))) {
+        throw std::runtime_error("No se pudo escribir el WAL.");
+    }
+    if (!paginador.sincronizar()) {
+        throw std::runtime_error("No se pudieron escribir las paginas del checkpoint.");
+    }
+    if (reiniciar_log && !wal.reiniciar(lsn_aplicado)) {
+        throw std::runtime_error("No se pudo vaciar el WAL.");
+    }
+    ultimo_checkpoint = std::chrono::steady_clock::now();
+}
+
+// === Checkpoint en segundo plano ===
+
+void Database::iniciar_checkpointer() {
+    detener_checkpointer = false;
+    checkpoint_pedido = false;
+    ultimo_checkpoint = std::chrono::steady_clock::now();
+    checkpointer = std::thread(&Database::bucle_checkpointer, this);
+}
+
+// Se llama con el mutex tomado; lo suelta mientras el hilo termina el checkpoint que tenga en curso
+void Database::detener_checkpointer_hilo(std::unique_lock<std::mutex>& lock) {
+    if (!checkpointer.joinable()) {
+        return;
+    }
+    detener_checkpointer = true;
+    aviso_checkpointer.notify_all();
+    lock.unlock();
+    checkpointer.join();
+    lock.lock();
+    detener_checkpointer = false;
+}
+
+void Database::bucle_checkpointer() {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto intervalo = std::chrono::milliseconds(opciones.intervalo_checkpoint_ms);
+
+    while (!detener_checkpointer) {
+        auto despertar = [this] { return detener_checkpointer || checkpoint_pedido; };
+        if (intervalo.count() == 0) {
+            aviso_checkpointer.wait(lock, despertar); // Solo por los limites de paginas y de log
+        } else {
+            aviso_checkpointer.wait_for(lock, intervalo, despertar);
+        }
+        if (detener_checkpointer) {
+            break;
+        }
+        // Por tiempo solo si hay algo que escribir: una base quieta no hace checkpoints
+        bool vencido = intervalo.count() > 0 && std::chrono::steady_clock::now() - ultimo_checkpoint >= intervalo;
+        if (!checkpoint_pedido && !(vencido && paginador.get_num_paginas_sucias() > 0)) {
+            continue;
+        }
+        checkpoint_pedido = false;
+
+        try {
+            checkpoint_en_segundo_plano(lock);
+        } catch (const std::exception& e) {
+            // Las operaciones siguientes fallan con este error; el log conserva todo lo necesario
+            error_checkpoint = std::string("Fallo un checkpoint en segundo plano: ") + e.what();
+            checkpoint_terminado.notify_all();
+            return;
+        }
+    }
+}
+
+// Como checkpoint(), pero el mutex solo se tiene para copiar y retener las paginas sucias y
+// rotar el log en el LSN de la copia. Sin el mutex, mientras las operaciones siguen:
+//  1. Las imagenes y el CHECKPOINT van al log (mezclados con los registros nuevos), con fdatasync.
+//  2. Las copias se escriben en su lugar, con fdatasync.
+// Al terminar se descarta el archivo del log anterior a la rotacion: las operaciones de ese
+// archivo ya estan en la base. Si el proceso muere antes de que el CHECKPOINT llegue al log,
+// la base sigue como en el checkpoint anterior y el log tiene todo desde entonces.
+void Database::checkpoint_en_segundo_plano(std::unique_lock<std::mutex>& lock) {
+    uint64_t lsn_aplicado = wal.get_lsn_siguiente();
+    lsn_checkpoint = lsn_aplicado;
+    if (!escribir_superblock()) {
+        throw std::runtime_error("No se pudo escribir el superblock.");
+    }
+
+    std::vector<PaginaID> ids;
+    const char* copias = copiar_paginas_sucias(ids);
+    paginador.retener_paginas(ids);
+    if (!wal.rotar()) {
+        paginador.soltar_paginas_retenidas(ids, false);
+        throw std::runtime_error("No se pudo rotar el WAL.");
+    }
+    checkpoint_en_curso = true;
+    paginas_en_checkpoint = ids.size();
+    lock.unlock();
+
+    bool exito = wal.esperar_durable(registrar_imagenes(lsn_aplicado, ids, copias)) && paginador.escribir_copias(ids, copias);
+
+    lock.lock();
+    paginador.soltar_paginas_retenidas(ids, exito);
+    checkpoint_en_curso = false;
+    paginas_en_checkpoint = 0;
+    ultimo_checkpoint = std::chrono::steady_clock::now();
+    checkpoint_terminado.notify_all();
+
+    if (!exito) {
+        throw std::runtime_error("No se pudieron escribir las paginas.");
+    }
+    if (!wal.descartar_anterior()) {
+        throw std::runtime_error("No se pudo recortar el WAL.");
+    }
+}
+
+void Database::esperar_checkpoint_en_curso(std::unique_lock<std::mutex>& lock) {
+    checkpoint_terminado.wait(lock, [this] { return !checkpoint_en_curso; });
+}
+
+// Antes de cada operacion que modifica. Sin hilo, el checkpoint se hace aca. Con hilo solo se
+// espera si este no da abasto: el log o las paginas sucias llegaron al doble de los limites,
+// o en BUFFER_POOL quedan pocos frames que se puedan desalojar.
+void Database::antes_de_operar(std::unique_lock<std::mutex>& lock) {
+    if (!error_checkpoint.empty()) {
+        throw std::runtime_error(error_checkpoint);
+    }
+    if (!usar_wal) {
+        return;
+    }
+    if (!checkpointer.joinable()) {
+        checkpoint_si_hace_falta(wal.get_lsn_siguiente(), true);
+        return;
+    }
+
+    size_t limite_retenidas = paginador.get_modo() == ModoAlmacenamiento::BUFFER_POOL
+        ? limite_paginas_sucias()
+        : 2 * opciones.checkpoint_paginas_sucias;
+    while (paginador.get_num_paginas_sucias() + paginas_en_checkpoint > limite_retenidas ||
+           wal.get_bytes_log() > 2 * opciones.checkpoint_bytes_log) {
+        checkpoint_pedido = true;
+        aviso_checkpointer.notify_one();
+        checkpoint_terminado.wait(lock);
+        if (!error_checkpoint.empty()) {
+            throw std::runtime_error(error_checkpoint);
+        }
+    }
+}
+
+// Despues de cada operacion que modifica: si se paso algun limite, despierta al hilo
+void Database::despues_de_operar() {
+    if (!usar_wal || !checkpointer.joinable() || checkpoint_pedido) {
+        return;
+    }
+    size_t limite_sucias = opciones.checkpoint_paginas_sucias;
+    if (paginador.get_modo() == ModoAlmacenamiento::BUFFER_POOL) {
+        limite_sucias = std::min(limite_sucias, limite_paginas_sucias() / 2);
+    }
+    if (paginador.get_num_paginas_sucias() >= limite_sucias || wal.get_bytes_log() >= opciones.checkpoint_bytes_log) {
+        checkpoint_pedido = true;
+        aviso_checkpointer.notify_one();
+    }
+}
+
+// Redo desde el ultimo checkpoint:
+//  1. Si el log tiene un checkpoint completo, se copian sus imagenes (el proceso pudo haber
+//     muerto mientras las escribia en su lugar).
+//  2. Se vuelven a aplicar las operaciones con LSN >= lsn_checkpoint del superblock. Gracias a
+//     la politica no-steal el archivo estaba exactamente como en ese checkpoint.
+//  3. Un checkpoint final deja todo en el archivo y el log vacio.
+void Database::recuperar() {
+    const std::vector<RegistroWAL>& registros = wal.get_recuperados();
+
+    // Las imagenes del ultimo checkpoint completo son las anteriores a su registro CHECKPOINT
+    // que llevan su LSN: con el checkpoint en segundo plano quedan mezcladas con operaciones
+    // y, si un checkpoint anterior no llego a terminar, con imagenes suyas
+    size_t fin_checkpoint = registros.size();
+    uint64_t lsn_imagenes = 0;
+    for (size_t i = 0; i < registros.size(); i++) {
+        if (registros[i].tipo == TipoRegistroWAL::CHECKPOINT && registros[i].longitud == sizeof(uint64_t)) {
+            std::memcpy(&lsn_imagenes, registros[i].datos, sizeof(uint64_t));
+            fin_checkpoint = i;
+        }
+    }
+
+    if (fin_checkpoint < registros.size()) {
+        constexpr size_t LONGITUD_IMAGEN = sizeof(uint64_t) + sizeof(PaginaID) + PAGINA_SIZE;
+        for (size_t i = 0; i < fin_checkpoint; i++) {
+            const RegistroWAL& registro = registros[i];
+            if (registro.tipo != TipoRegistroWAL::IMAGEN_PAGINA || registro.longitud != LONGITUD_IMAGEN) {
+                continue;
+            }
+            uint64_t lsn_imagen;
+            std::memcpy(&lsn_imagen, registro.datos, sizeof(uint64_t));
+            if (lsn_imagen != lsn_imagenes) {
+                continue;
+            }
+            PaginaID id;
+            std::memcpy(&id, registro.datos + sizeof(uint64_t), sizeof(PaginaID));
+            if (!paginador.asegurar_paginas(static_cast<size_t>(id) + 1)) {
+                throw std::runtime_error("No se pudo extender el archivo para recuperar la pagina " + std::to_string(id) + ".");
+            }
+
+            PaginaFijada pagina = paginador.fijar_pagina(id);
+            if (!pagina) {
+                throw std::runtime_error("No se pudo fijar la pagina " + std::to_string(id) + " al recuperar.");
+            }
+            std::memcpy(pagina.datos(), registro.datos + sizeof(uint64_t) + sizeof(PaginaID), PAGINA_SIZE);
+            pagina.marcar_sucia();
+            pagina.soltar();
+
+            // Las imagenes siguen en el log: escribirlas en su lugar antes de terminar es seguro
+            if (paginador.get_num_paginas_sucias() > limite_paginas_sucias() && !paginador.sincronizar()) {
+                throw std::runtime_error("No se pudieron escribir las paginas recuperadas.");
+            }
+        }
+        if (!paginador.sincronizar()) {
+            throw std::runtime_error("No se pudieron escribir las paginas recuperadas.");
+        }
+    }
+
+    cargar_db();
+
+    for (const RegistroWAL& registro : registros) {
+        if (registro.lsn < lsn_checkpoint || registro.longitud < sizeof(DNI_t)) {
+            continue;
+        }
+        DNI_t dni;
+        std::memcpy(&dni, registro.datos, sizeof(DNI_t));
+
+        // Los checkpoints intermedios no vacian el log: todavia lo estamos leyendo
+        switch (registro.tipo) {
+            case TipoRegistroWAL::INSERTAR:
+                checkpoint_si_hace_falta(registro.lsn, false);
+                aplicar_insertar(dni, registro.datos, registro.longitud);
+                break;
+            case TipoRegistroWAL::MODIFICAR:
+                checkpoint_si_hace_falta(registro.lsn, false);
+                aplicar_modificar(dni, registro.datos, registro.longitud);
+                break;
+            case TipoRegistroWAL::ELIMINAR:
+                checkpoint_si_hace_falta(registro.lsn, false);
+                aplicar_eliminar(dni);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // abrir tiene estructura exclusivo: el filtro se puede rearmar aca mismo
+    if (filtro_lleno()) {
+        armar_filtro();
+    }
+    checkpoint(std::max(wal.get_lsn_siguiente(), lsn_checkpoint), true);
+    wal.liberar_recuperados();
+}
+
+// === Operaciones ===
+
+bool Database::insertar_ciudadano(const Ciudadano& ciudadano) {
     std::vector<char> buffer(PAGINA_SIZE);
     size_t size_serializado = serializar(ciudadano, buffer.data());
 
-    PaginaID pagina_datos_id = INVALID_PAGE_ID;
+    uint64_t lsn;
+    bool filtro_pasado;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!inicializado) {
+            return false;
+        }
+        antes_de_operar(lock);
+        if (!aplicar_insertar(ciudadano.dni, buffer.data(), size_serializado)) {
+            return false;
+        }
+        lsn = registrar(TipoRegistroWAL::INSERTAR, buffer.data(), size_serializado);
+        despues_de_operar();
+        filtro_pasado = filtro_lleno();
+    }
+    bool durable = esperar_commit(lsn);
+    if (filtro_pasado) {
+        agrandar_filtro();
+    }
+    return durable;
+}
+
+// El registro se escribe antes de saber si el DNI ya esta, para que el indice lo resuelva en
+// la misma bajada que inserta; en el caso raro de un repetido, el registro se descarta
+bool Database::aplicar_insertar(DNI_t dni, const char* serializado, size_t size_serializado) {
+    if (agrupada()) {
+        return aplicar_insertar_agrupada(dni, serializado, size_serializado);
+    }
+    auto rid = escribir_registro(serializado, size_serializado);
+    if (!rid.has_value()) {
+        return false;
+    }
+    // Al filtro solo si entro: un repetido no cuenta como clave nueva. Hasta agregarlo, una
+    // busqueda puede no ver el DNI, igual que antes de la insercion, que todavia no termino.
+    if (!indice_dni->insertar_si_no_existe(dni, *rid).has_value()) {
+        if (filtro) {
+            filtro->agregar(dni);
+        }
+        indice_nombres->insertar(clave_nombre(serializado), *rid);
+        return true;
+    }
+
+    PaginaFijada pagina = paginador.fijar_pagina(rid->pagina_id);
+    BloqueoLatch bloqueo(paginador.latch(rid->pagina_id));
+    if (pagina && PaginaRanurada(pagina.datos()).descartar_ultimo(rid->slot_id)) {
+        pagina.marcar_sucia();
+    }
+    return false; // Ya existe, no se permiten duplicados por ahora
+}
+
+// Los registros que no entran en una entrada de la tabla se rechazan, como en HEAP los que no
+// entran en una pagina
+bool Database::aplicar_insertar_agrupada(DNI_t dni, const char* serializado, size_t size_serializado) {
+    if (sizeof(DNI_t) + size_serializado > BPlusTreeCadenas::MAX_ENTRADA) {
+        return false;
+    }
+    if (!tabla->insertar(clave_dni(dni), serializado, size_serializado)) {
+        return false;
+    }
+    if (filtro) {
+        filtro->agregar(dni);
+    }
+    indice_nombres->insertar(clave_nombre(serializado), SIN_REGISTRO);
+    return true;
+}
+
+std::optional<RegistroID> Database::escribir_registro(const char* serializado, size_t size_serializado) {
+    PaginaFijada pagina_datos;
 
     // Intentar insertar en la última página de datos conocida.
     if (ultima_pagina_datos_id != INVALID_PAGE_ID) {
-        char* pagina_ptr = paginador.get_pagina(ultima_pagina_datos_id);
-        PaginaRanurada pagina_ranurada(pagina_ptr);
-        if (pagina_ranurada.tiene_espacio(sizeof(Slot) + size_serializado)) {
-            pagina_datos_id = ultima_pagina_datos_id;
+        pagina_datos = paginador.fijar_pagina(ultima_pagina_datos_id);
+        if (pagina_datos && !PaginaRanurada(pagina_datos.datos()).tiene_espacio(sizeof(Slot) + size_serializado)) {
+            pagina_datos.soltar();
         }
     }
 
     // Si no hay última página o si está llena, asignamos una nueva.
-    if (pagina_datos_id == INVALID_PAGE_ID) {
-        pagina_datos_id = paginador.alloc_pagina();
-        if (pagina_datos_id == INVALID_PAGE_ID) {
-            return false;
+    if (!pagina_datos) {
+        // Cerca de la ultima pagina de datos, para que los registros sigan agrupados en el archivo
+        PaginaID nueva_pagina_id = paginador.alloc_pagina(ultima_pagina_datos_id);
+        if (nueva_pagina_id == INVALID_PAGE_ID) {
+            return std::nullopt;
+        }
+        pagina_datos = paginador.fijar_pagina(nueva_pagina_id);
+        if (!pagina_datos) {
+            return std::nullopt;
         }
-        char* nueva_pagina_ptr = paginador.get_pagina(pagina_datos_id);
-        PaginaRanurada pagina_nueva(nueva_pagina_ptr);
+        BloqueoLatch bloqueo(paginador.latch(nueva_pagina_id)); // Pudo ser un nodo que alguien todavia lee
+        PaginaRanurada pagina_nueva(pagina_datos.datos());
         pagina_nueva.inicializar();
-        ultima_pagina_datos_id = pagina_datos_id;
+        pagina_datos.marcar_sucia();
+        ultima_pagina_datos_id = nueva_pagina_id;
     }
 
-    char* pagina_ptr = paginador.get_pagina(pagina_datos_id);
-    PaginaRanurada pagina_ranurada(pagina_ptr);
+    PaginaRanurada pagina_ranurada(pagina_datos.datos());
 
-    SlotID slot_id = pagina_ranurada.insertar_registro(buffer.data(), size_serializado);
+    // Las busquedas leen la pagina sin el mutex (ver buscar_ciudadano)
+    BloqueoLatch bloqueo(paginador.latch(pagina_datos.id()));
+    SlotID slot_id = pagina_ranurada.insertar_registro(serializado, size_serializado);
     if (slot_id == INVALID_SLOT_ID) {
-        return false;
+        return std::nullopt;
+    }
+    pagina_datos.marcar_sucia();
+    return RegistroID{pagina_datos.id(), slot_id}; // Se suelta: el indice puede necesitar todos los frames para dividir nodos
+}
+
+// Ciudadanos por tanda de insertar_lote. Entre tandas puede hacerse un checkpoint; en
+// BUFFER_POOL con WAL, ademas, lo que ensucia una tanda tiene que entrar en los frames limpios
+// que deja limite_paginas_sucias (cada ciudadano puede ensuciar una hoja de cada indice, sus
+// divisiones y una pagina de datos).
+static constexpr size_t CIUDADANOS_POR_TANDA = 1024;
+
+size_t Database::insertar_lote(const std::vector<Ciudadano>& ciudadanos) {
+    // En orden de DNI, que es como los recibe el arbol, y sin repetidos (queda el primero)
+    std::vector<size_t> orden(ciudadanos.size());
+    for (size_t i = 0; i < orden.size(); i++) {
+        orden[i] = i;
+    }
+    std::stable_sort(orden.begin(), orden.end(), [&](size_t a, size_t b) {
+        return ciudadanos[a].dni < ciudadanos[b].dni;
+    });
+    orden.erase(std::unique(orden.begin(), orden.end(), [&](size_t a, size_t b) {
+        return ciudadanos[a].dni == ciudadanos[b].dni;
+    }), orden.end());
+
+    // Se serializa fuera del mutex
+    std::vector<char> serializados;
+    std::vector<size_t> inicios;
+    inicios.reserve(orden.size() + 1);
+    std::vector<char> buffer(PAGINA_SIZE);
+    for (size_t i : orden) {
+        size_t size_serializado = serializar(ciudadanos[i], buffer.data());
+        inicios.push_back(serializados.size());
+        serializados.insert(serializados.end(), buffer.data(), buffer.data() + size_serializado);
     }
+    inicios.push_back(serializados.size());
+
+    size_t insertados = 0;
+    uint64_t lsn = 0;
+    bool filtro_pasado;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!inicializado) {
+            return 0;
+        }
 
-    RegistroID rid = {pagina_datos_id, slot_id};
-    return indice_dni->insertar(ciudadano.dni, rid);
+        size_t tanda = CIUDADANOS_POR_TANDA;
+        if (usar_wal && paginador.get_modo() == ModoAlmacenamiento::BUFFER_POOL) {
+            size_t frames_limpios = opciones.paginador.frames_buffer_pool - limite_paginas_sucias();
+            tanda = std::max<size_t>(1, std::min(tanda, frames_limpios / 6));
+        }
+
+        std::vector<DNI_t> dnis;
+        std::vector<std::pair<DNI_t, RegistroID>> entradas;
+        bool sin_espacio = false;
+        for (size_t desde = 0; desde < orden.size() && !sin_espacio; desde += tanda) {
+            size_t hasta = std::min(orden.size(), desde + tanda);
+            antes_de_operar(lock);
+
+            // La tabla agrupada no tiene insercion por lotes: cada ciudadano va por su lado
+            if (agrupada()) {
+                for (size_t k = desde; k < hasta; k++) {
+                    const char* serializado = serializados.data() + inicios[k];
+                    size_t size_serializado = inicios[k + 1] - inicios[k];
+                    if (aplicar_insertar_agrupada(ciudadanos[orden[k]].dni, serializado, size_serializado)) {
+                        insertados++;
+                        lsn = registrar(TipoRegistroWAL::INSERTAR, serializado, size_serializado);
+                    }
+                }
+                despues_de_operar();
+                continue;
+            }
+
+            // Solo los DNIs que el filtro no descarta se buscan en el indice
+            dnis.clear();
+            for (size_t k = desde; k < hasta; k++) {
+                if (puede_estar(ciudadanos[orden[k]].dni)) {
+                    dnis.push_back(ciudadanos[orden[k]].dni);
+                }
+            }
+            auto existentes = indice_dni->buscar_lote(dnis);
+            size_t buscado = 0;
+
+            // Los registros primero y despues las claves de toda la tanda en el arbol; cada
+            // ciudadano queda en el WAL como un INSERTAR comun, que la recuperacion rehace uno
+            // por uno
+            entradas.clear();
+            for (size_t k = desde; k < hasta; k++) {
+                DNI_t dni = ciudadanos[orden[k]].dni;
+                if (buscado < dnis.size() && dnis[buscado] == dni && existentes[buscado++].has_value()) {
+                    continue;
+                }
+                const char* serializado = serializados.data() + inicios[k];
+                size_t size_serializado = inicios[k + 1] - inicios[k];
+                auto rid = escribir_registro(serializado, size_serializado);
+                if (!rid.has_value()) {
+                    sin_espacio = true;
+                    break;
+                }
+                if (filtro) {
+                    filtro->agregar(dni);
+                }
+                entradas.emplace_back(dni, *rid);
+                // El indice de nombres no se beneficia del orden por DNI: va de a una clave
+                indice_nombres->insertar(clave_nombre(serializado), *rid);
+                lsn = registrar(TipoRegistroWAL::INSERTAR, serializado, size_serializado);
+            }
+            insertados += indice_dni->insertar_lote(entradas);
+            despues_de_operar();
+        }
+        filtro_pasado = filtro_lleno();
+    }
+    if (!esperar_commit(lsn)) {
+        throw std::runtime_error("No se pudo hacer durable el WAL de insertar_lote.");
+    }
+    if (filtro_pasado) {
+        agrandar_filtro();
+    }
+    return insertados;
 }
 
+// En MAPEO, sin el mutex: el indice se lee con buscar (optimista) y la pagina de datos igual,
+// validando su latch antes de deserializar. Si la pagina cambio mientras la leiamos se lee de
+// nuevo. Las escrituras cambian primero el indice y despues borran el registro, asi que un
+// slot vacio quiere decir que el indice ya no apunta ahi.
 std::optional<Ciudadano> Database::buscar_ciudadano(DNI_t dni) {
+    std::shared_lock<std::shared_mutex> compartido(estructura);
     if (!inicializado) return std::nullopt;
+    // Un DNI que el filtro descarta no esta: vuelve sin el mutex y sin bajar por el indice
+    if (!puede_estar(dni)) return std::nullopt;
 
-    auto rid_optional = indice_dni->buscar(dni);
-    if (!rid_optional.has_value()) {
-        return std::nullopt;
+    bool optimista = paginador.get_modo() == ModoAlmacenamiento::MAPEO && !agrupada();
+    std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+    if (!optimista) {
+        lock.lock();
     }
 
-    RegistroID rid = rid_optional.value();
-
-    char* pagina_ptr = paginador.get_pagina(rid.pagina_id);
-    PaginaRanurada pagina_ranurada(pagina_ptr);
+    // La hoja de la tabla ya tiene el registro: no hay pagina de datos que leer
+    if (agrupada()) {
+        auto registro = tabla->buscar_bytes(clave_dni(dni));
+        if (!registro.has_value()) {
+            return std::nullopt;
+        }
+        return deserializar(registro->data(), registro->size());
+    }
 
     std::vector<char> buffer(PAGINA_SIZE);
-    size_t size_leido = 0;
+    std::optional<RegistroID> rid = indice_dni->buscar(dni);
+    while (rid.has_value()) {
+        PaginaFijada pagina = paginador.fijar_pagina(rid->pagina_id);
+        if (!pagina) {
+            return std::nullopt;
+        }
+        LatchOptimista& latch = paginador.latch(rid->pagina_id);
+        uint64_t version = latch.leer_version();
+        size_t size_leido = 0;
+        bool leido = PaginaRanurada(pagina.datos()).leer_registro(rid->slot_id, buffer.data(), size_leido);
+        if (!latch.validar(version)) {
+            continue;
+        }
+        if (leido) {
+            return deserializar(buffer.data(), size_leido);
+        }
 
-    if (pagina_ranurada.leer_registro(rid.slot_id, buffer.data(), size_leido)) {
-        return deserializar(buffer.data(), size_leido);
+        std::optional<RegistroID> actual = optimista ? indice_dni->buscar(dni) : std::nullopt;
+        if (actual == rid) {
+            return std::nullopt;
+        }
+        rid = actual;
     }
 
     return std::nullopt;
 }
 
-bool Database::modificar_ciudadano(const Ciudadano& ciudadano) {
-    if (!inicializado) return false;
+// Paginas de datos distintas que buscar_lote pide juntas (como NODOS_POR_TANDA en el arbol)
+constexpr size_t PAGINAS_DATOS_POR_TANDA = 16;
 
-    auto rid_optional = indice_dni->buscar(ciudadano.dni);
-    if (!rid_optional.has_value()) {
-        return false; // No se puede modificar un ciudadano que no existe.
+std::vector<std::optional<Ciudadano>> Database::buscar_lote(const std::vector<DNI_t>& dnis) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::optional<Ciudadano>> resultados(dnis.size());
+    if (!inicializado) return resultados;
+
+    if (agrupada()) {
+        for (size_t i = 0; i < dnis.size(); i++) {
+            if (!puede_estar(dnis[i])) {
+                continue;
+            }
+            auto registro = tabla->buscar_bytes(clave_dni(dnis[i]));
+            if (registro.has_value()) {
+                resultados[i] = deserializar(registro->data(), registro->size());
+            }
+        }
+        return resultados;
     }
 
-    RegistroID rid = rid_optional.value();
+    // Al indice van solo los que el filtro no descarta, con su posicion en dnis
+    std::vector<DNI_t> buscados;
+    std::vector<size_t> posiciones;
+    for (size_t i = 0; i < dnis.size(); i++) {
+        if (puede_estar(dnis[i])) {
+            buscados.push_back(dnis[i]);
+            posiciones.push_back(i);
+        }
+    }
+    std::vector<std::optional<RegistroID>> rids = indice_dni->buscar_lote(buscados);
+
+    // Los encontrados en orden de pagina y slot, con su posicion en dnis
+    std::vector<std::pair<RegistroID, size_t>> encontrados;
+    for (size_t i = 0; i < rids.size(); i++) {
+        if (rids[i].has_value()) {
+            encontrados.emplace_back(*rids[i], posiciones[i]);
+        }
+    }
+    std::sort(encontrados.begin(), encontrados.end(), [](const auto& a, const auto& b) {
+        if (a.first.pagina_id != b.first.pagina_id) return a.first.pagina_id < b.first.pagina_id;
+        return a.first.slot_id < b.first.slot_id;
+    });
+
+    bool leer_en_lote = paginador.get_modo() == ModoAlmacenamiento::BUFFER_POOL;
+    std::vector<PaginaID> ids;
+    std::vector<PaginaFijada> paginas;
+    std::vector<char*> pagina_de;   // Pagina de cada registro de la tanda
+    std::vector<char> buffer(PAGINA_SIZE);
+
+    for (size_t inicio = 0; inicio < encontrados.size(); ) {
+        // La tanda: los registros de las proximas PAGINAS_DATOS_POR_TANDA paginas
+        size_t fin = inicio;
+        ids.clear();
+        while (fin < encontrados.size()) {
+            PaginaID id = encontrados[fin].first.pagina_id;
+            if (ids.empty() || ids.back() != id) {
+                if (ids.size() == PAGINAS_DATOS_POR_TANDA) break;
+                ids.push_back(id);
+            }
+            fin++;
+        }
+
+        // 1. Fijar las paginas y pedir la entrada del slot de cada registro
+        if (leer_en_lote) {
+            paginador.precargar(ids);
+        }
+        paginas.clear();
+        for (PaginaID id : ids) {
+            paginas.push_back(paginador.fijar_pagina(id));
+        }
+        pagina_de.clear();
+        for (size_t k = inicio, j = 0; k < fin; k++) {
+            if (encontrados[k].first.pagina_id != ids[j]) j++;
+            pagina_de.push_back(paginas[j].datos());
+            if (pagina_de.back() != nullptr) {
+                prefetch_linea(PaginaRanurada(pagina_de.back()).obtener_slot_const(encontrados[k].first.slot_id));
+            }
+        }
+
+        // 2. Con los slots en cache, pedir los registros
+        for (size_t k = inicio; k < fin; k++) {
+            char* pagina_ptr = pagina_de[k - inicio];
+            PaginaRanurada pagina_ranurada(pagina_ptr);
+            SlotID slot_id = encontrados[k].first.slot_id;
+            if (pagina_ptr != nullptr && slot_id < pagina_ranurada.get_num_registros()) {
+                const Slot* slot = pagina_ranurada.obtener_slot_const(slot_id);
+                prefetch_linea(pagina_ptr + slot->offset);
+                prefetch_linea(pagina_ptr + slot->offset + slot->size - 1);
+            }
+        }
+
+        // 3. Leer
+        for (size_t k = inicio; k < fin; k++) {
+            char* pagina_ptr = pagina_de[k - inicio];
+            size_t size_leido = 0;
+            if (pagina_ptr != nullptr && PaginaRanurada(pagina_ptr).leer_registro(encontrados[k].first.slot_id, buffer.data(), size_leido)) {
+                resultados[encontrados[k].second] = deserializar(buffer.data(), size_leido);
+            }
+        }
+        inicio = fin;
+    }
+    return resultados;
+}
+
+size_t Database::buscar_rango(DNI_t dni_desde, DNI_t dni_hasta, const std::function<bool(const Ciudadano&)>& visitar) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!inicializado || dni_desde > dni_hasta) return 0;
+
+    std::vector<char> buffer(PAGINA_SIZE);
+    size_t visitados = 0;
 
+    if (agrupada()) {
+        // Los registros estan en las hojas, uno detras del otro
+        for (BPlusTreeCadenas::Iterador it = tabla->buscar_desde(clave_dni(dni_desde)); it.valido(); it.siguiente()) {
+            size_t size = 0;
+            const char* registro = it.valor_bytes(size);
+            DNI_t dni;
+            std::memcpy(&dni, registro, sizeof(DNI_t));
+            if (dni > dni_hasta) {
+                break;
+            }
+            visitados++;
+            if (!visitar(deserializar(registro, size))) {
+                break;
+            }
+        }
+        return visitados;
+    }
+
+    // De a tandas, como en buscar_lote: los registros de las proximas PAGINAS_DATOS_POR_TANDA
+    // paginas de datos, que en BUFFER_POOL se piden juntas antes de leerlos (las hojas las
+    // pide juntas el iterador)
+    bool leer_en_lote = paginador.get_modo() == ModoAlmacenamiento::BUFFER_POOL;
+    std::vector<RegistroID> tanda;
+    std::vector<PaginaID> ids;
+    BPlusTree::Iterador it = indice_dni->buscar_desde(dni_desde);
+    while (it.valido() && it.clave() <= dni_hasta) {
+        tanda.clear();
+        ids.clear();
+        for (; it.valido() && it.clave() <= dni_hasta; it.siguiente()) {
+            RegistroID rid = it.valor();
+            if (std::find(ids.begin(), ids.end(), rid.pagina_id) == ids.end()) {
+                if (ids.size() == PAGINAS_DATOS_POR_TANDA) break;
+                ids.push_back(rid.pagina_id);
+            }
+            tanda.push_back(rid);
+        }
+        if (leer_en_lote) {
+            paginador.precargar(ids);
+        }
+
+        for (const RegistroID& rid : tanda) {
+            PaginaFijada pagina = paginador.fijar_pagina(rid.pagina_id);
+            if (!pagina) {
+                throw std::runtime_error("No se pudo fijar la pagina de datos " + std::to_string(rid.pagina_id) + ".");
+            }
+            PaginaRanurada pagina_ranurada(pagina.datos());
+
+            size_t size_leido = 0;
+            if (!pagina_ranurada.leer_registro(rid.slot_id, buffer.data(), size_leido)) {
+                continue;
+            }
+            pagina.soltar();
+            visitados++;
+            if (!visitar(deserializar(buffer.data(), size_leido))) {
+                return visitados;
+            }
+        }
+    }
+    return visitados;
+}
+
+size_t Database::buscar_por_nombre(const std::string& apellidos, const std::string& nombres, const std::function<bool(const Ciudadano&)>& visitar) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!inicializado) return 0;
+
+    // Las claves empiezan con los apellidos normalizados y el separador: con nombres, los
+    // apellidos tienen que ser esos completos
+    std::string prefijo = normalizar_nombre(apellidos);
+    std::string nombres_normalizados = normalizar_nombre(nombres);
+    if (!nombres_normalizados.empty()) {
+        prefijo += SEPARADOR_NOMBRES;
+        prefijo += nombres_normalizados;
+    }
+
+    std::vector<char> buffer(PAGINA_SIZE);
+    size_t visitados = 0;
+
+    for (BPlusTreeCadenas::Iterador it = indice_nombres->buscar_desde(prefijo); it.valido() && it.clave_empieza_con(prefijo); it.siguiente()) {
+        if (agrupada()) {
+            auto registro = tabla->buscar_bytes(clave_dni(dni_de_clave(it.clave())));
+            if (!registro.has_value()) {
+                continue;
+            }
+            visitados++;
+            if (!visitar(deserializar(registro->data(), registro->size()))) {
+                break;
+            }
+            continue;
+        }
+
+        RegistroID rid = it.valor();
+        PaginaFijada pagina = paginador.fijar_pagina(rid.pagina_id);
+        if (!pagina) {
+            throw std::runtime_error("No se pudo fijar la pagina de datos " + std::to_string(rid.pagina_id) + ".");
+        }
+        PaginaRanurada pagina_ranurada(pagina.datos());
+
+        size_t size_leido = 0;
+        if (!pagina_ranurada.leer_registro(rid.slot_id, buffer.data(), size_leido)) {
+            continue;
+        }
+        pagina.soltar();
+        visitados++;
+        if (!visitar(deserializar(buffer.data(), size_leido))) {
+            break;
+        }
+    }
+    return visitados;
+}
+
+bool Database::modificar_ciudadano(const Ciudadano& ciudadano) {
     // Serializar el nuevo ciudadano para saber su tamaño
     std::vector<char> buffer_nuevo(PAGINA_SIZE);
     size_t nuevo_size = serializar(ciudadano, buffer_nuevo.data());
 
-    char* pagina_ptr = paginador.get_pagina(rid.pagina_id);
-    PaginaRanurada pagina_ranurada(pagina_ptr);
+    uint64_t lsn;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!inicializado) return false;
+
+        antes_de_operar(lock);
+        if (!aplicar_modificar(ciudadano.dni, buffer_nuevo.data(), nuevo_size)) {
+            return false;
+        }
+        lsn = registrar(TipoRegistroWAL::MODIFICAR, buffer_nuevo.data(), nuevo_size);
+        despues_de_operar();
+    }
+    return esperar_commit(lsn);
+}
+
+size_t Database::carga_masiva(const std::function<bool(Ciudadano&)>& siguiente, const OpcionesCargaMasiva& opciones_carga) {
+    std::unique_lock<std::shared_mutex> exclusivo(estructura);
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!inicializado) return 0;
+    if (!error_checkpoint.empty()) {
+        throw std::runtime_error(error_checkpoint);
+    }
+    esperar_checkpoint_en_curso(lock);
+    if (agrupada() ? tabla->buscar_desde("").valido() : indice_dni->buscar_desde(0).valido()) {
+        throw std::runtime_error("La carga masiva necesita una base vacia.");
+    }
+
+    OrdenExterno orden(ruta_db + ".carga", opciones_carga.memoria_orden);
+    // Las claves del indice de nombres (seguidas del RegistroID empaquetado) salen de la carga
+    // de los datos, cuando ya se sabe donde quedo cada registro
+    OrdenExterno orden_nombres(ruta_db + ".carga_nombres", opciones_carga.memoria_orden, CriterioOrden::BYTES);
+    std::vector<char> buffer(PAGINA_SIZE);
+    Ciudadano ciudadano;
+    while (siguiente(ciudadano)) {
+        orden.agregar(buffer.data(), serializar(ciudadano, buffer.data()));
+    }
+    orden.terminar();
+    // El filtro de la base vacia se reemplaza por uno con lugar para el doble de lo que se carga
+    if (filtro) {
+        filtro = std::make_unique<FiltroBloom>(FiltroBloom::paginas_para(2 * orden.get_total()));
+    }
+
+    // Las paginas de la carga se escriben en su lugar sin imagenes en el log, asi que nada mas
+    // puede quedar sucio: con el archivo como en el checkpoint y las paginas nuevas despues de
+    // num_paginas, un corte antes del checkpoint final deja la base vacia que habia
+    if (usar_wal) {
+        checkpoint(wal.get_lsn_siguiente(), true);
+    }
+
+    PaginaFijada pagina_datos;
+    PaginaID ultima_pagina_carga = INVALID_PAGE_ID;
+    DNI_t dni_anterior = 0;
+    size_t cargados = 0;
+
+    auto siguiente_entrada = [&](DNI_t& dni, RegistroID& rid) {
+        const char* serializado;
+        size_t size;
+        while (orden.siguiente(serializado, size)) {
+            std::memcpy(&dni, serializado, sizeof(DNI_t));
+            if (cargados > 0 && dni == dni_anterior) {
+                continue;
+            }
+
+            if (!pagina_datos || !PaginaRanurada(pagina_datos.datos()).tiene_espacio(sizeof(Slot) + size)) {
+                pagina_datos.soltar();
+                // Con WAL nada llega al archivo fuera de sincronizar(): lo llamamos cada tanto
+                // para no llenar el pool ni la memoria con paginas sucias
+                if (paginador.get_num_paginas_sucias() >= limite_paginas_sucias() && !paginador.sincronizar()) {
+                    throw std::runtime_error("No se pudieron escribir las paginas de la carga masiva.");
+                }
+                ultima_pagina_carga = paginador.alloc_pagina_nueva();
+                if (ultima_pagina_carga == INVALID_PAGE_ID) {
+                    throw std::runtime_error("No se pudo asignar una pagina de datos para la carga masiva.");
+                }
+                pagina_datos = paginador.fijar_pagina(ultima_pagina_carga);
+                if (!pagina_datos) {
+                    throw std::runtime_error("No se pudo fijar la pagina de datos " + std::to_string(ultima_pagina_carga) + ".");
+                }
+                PaginaRanurada(pagina_datos.datos()).inicializar();
+            }
+
+            SlotID slot_id = PaginaRanurada(pagina_datos.datos()).insertar_registro(serializado, size);
+            if (slot_id == INVALID_SLOT_ID) {
+                throw std::runtime_error("El ciudadano " + std::to_string(dni) + " no entra en una pagina.");
+            }
+            pagina_datos.marcar_sucia();
+
+            rid = {ultima_pagina_carga, slot_id};
+            agregar_nombre(orden_nombres, clave_nombre(serializado), rid);
+            if (filtro) {
+                filtro->agregar(dni);
+            }
+            dni_anterior = dni;
+            cargados++;
+            return true;
+        }
+        return false;
+    };
+
+    // En ModoTabla::AGRUPADA los registros van derecho a las hojas de la tabla
+    auto siguiente_registro = [&](std::string& clave, std::string& registro) {
+        const char* serializado;
+        size_t size;
+        while (orden.siguiente(serializado, size)) {
+            DNI_t dni;
+            std::memcpy(&dni, serializado, sizeof(DNI_t));
+            if (cargados > 0 && dni == dni_anterior) {
+                continue;
+            }
+            if (sizeof(DNI_t) + size > BPlusTreeCadenas::MAX_ENTRADA) {
+                throw std::runtime_error("El ciudadano " + std::to_string(dni) + " no entra en una hoja de la tabla.");
+            }
+            if (paginador.get_num_paginas_sucias() >= limite_paginas_sucias() && !paginador.sincronizar()) {
+                throw std::runtime_error("No se pudieron escribir las paginas de la carga masiva.");
+            }
+
+            clave = clave_dni(dni);
+            registro.assign(serializado, size);
+            agregar_nombre(orden_nombres, clave_nombre(serializado), SIN_REGISTRO);
+            if (filtro) {
+                filtro->agregar(dni);
+            }
+            dni_anterior = dni;
+            cargados++;
+            return true;
+        }
+        return false;
+    };
+
+    PaginaID raiz_anterior;
+    if (agrupada()) {
+        raiz_anterior = tabla->construir_desde_ordenados(siguiente_registro, opciones_carga.factor_llenado);
+    } else {
+        raiz_anterior = indice_dni->construir_desde_ordenados(siguiente_entrada, opciones_carga.factor_llenado);
+        pagina_datos.soltar();
+    }
+
+    orden_nombres.terminar();
+    PaginaID raiz_nombres_anterior = indice_nombres->construir_desde_ordenados([&](std::string& clave, RegistroID& rid) {
+        if (paginador.get_num_paginas_sucias() >= limite_paginas_sucias() && !paginador.sincronizar()) {
+            throw std::runtime_error("No se pudieron escribir las paginas de la carga masiva.");
+        }
+        return siguiente_nombre(orden_nombres, clave, rid);
+    }, opciones_carga.factor_llenado);
+
+    // Las raices vacias y la pagina de datos de la base vacia ya no se usan
+    paginador.liberar_pagina(raiz_anterior);
+    paginador.liberar_pagina(raiz_nombres_anterior);
+    if (ultima_pagina_carga != INVALID_PAGE_ID) {
+        if (ultima_pagina_datos_id != INVALID_PAGE_ID) {
+            paginador.liberar_pagina(ultima_pagina_datos_id);
+        }
+        ultima_pagina_datos_id = ultima_pagina_carga;
+    }
+
+    if (!escribir_superblock()) {
+        throw std::runtime_error("No se pudo escribir el superblock.");
+    }
+    if (usar_wal) {
+        checkpoint(wal.get_lsn_siguiente(), true);
+    }
+    return cargados;
+}
+
+bool Database::aplicar_modificar(DNI_t dni, const char* serializado, size_t nuevo_size) {
+    if (!puede_estar(dni)) {
+        return false;
+    }
+    if (agrupada()) {
+        return aplicar_modificar_agrupada(dni, serializado, nuevo_size);
+    }
+    auto rid_optional = indice_dni->buscar(dni);
+    if (!rid_optional.has_value()) {
+        return false; // No se puede modificar un ciudadano que no existe.
+    }
+
+    RegistroID rid = rid_optional.value();
+
+    PaginaFijada pagina = paginador.fijar_pagina(rid.pagina_id);
+    if (!pagina) {
+        return false;
+    }
+    PaginaRanurada pagina_ranurada(pagina.datos());
 
     // Obtener el tamaño del registro antiguo
     const Slot* slot_antiguo = pagina_ranurada.obtener_slot_const(rid.slot_id);
     if (!slot_antiguo) return false;
     size_t antiguo_size = slot_antiguo->size;
 
-    // Versión simple: solo permitimos modificar si el nuevo tamaño es <= al antiguo.
-    if (nuevo_size > antiguo_size) {
-        // TODO: Implementar la lógica para manejar registros que crecen.
-        return false;
+    // Si el registro crece, o la pagina no tiene donde reescribirlo, se escribe uno nuevo (como
+    // en un insert) y el indice pasa a apuntarlo, en una segunda bajada que solo paga este caso
+    // El indice de nombres cambia si cambian los nombres o el registro se mueve
+    auto clave_antigua = clave_nombre_registro(pagina.datos(), rid.slot_id);
+    std::string clave_nueva = clave_nombre(serializado);
+
+    if (nuevo_size > antiguo_size || !pagina_ranurada.tiene_espacio(nuevo_size)) {
+        pagina.soltar();
+        auto nuevo_rid = escribir_registro(serializado, nuevo_size);
+        if (!nuevo_rid.has_value()) {
+            return false;
+        }
+        indice_dni->upsert(dni, *nuevo_rid); // Devuelve rid, que ya tenemos
+        if (clave_antigua.has_value()) {
+            indice_nombres->eliminar(*clave_antigua);
+        }
+        indice_nombres->insertar(clave_nueva, *nuevo_rid);
+
+        pagina = paginador.fijar_pagina(rid.pagina_id);
+        BloqueoLatch bloqueo(paginador.latch(rid.pagina_id));
+        if (pagina && PaginaRanurada(pagina.datos()).borrar_registro(rid.slot_id)) {
+            pagina.marcar_sucia();
+        }
+        return true;
+    }
+
+    if (clave_antigua != clave_nueva) {
+        if (clave_antigua.has_value()) {
+            indice_nombres->eliminar(*clave_antigua);
+        }
+        indice_nombres->insertar(clave_nueva, rid);
     }
 
-    // Borrar el registro de datos y luego insertarlo de nuevo en el mismo slot.
+    // Borrar el registro de datos y luego insertarlo de nuevo en el mismo slot. Con el latch,
+    // una busqueda nunca ve el slot vacio en el medio.
+    BloqueoLatch bloqueo(paginador.latch(rid.pagina_id));
     if (!pagina_ranurada.borrar_registro(rid.slot_id)) {
         return false;
     }
-    return pagina_ranurada.insertar_registro_en_slot(rid.slot_id, buffer_nuevo.data(), nuevo_size);
+    pagina.marcar_sucia();
+    return pagina_ranurada.insertar_registro_en_slot(rid.slot_id, serializado, nuevo_size);
+}
+
+bool Database::aplicar_modificar_agrupada(DNI_t dni, const char* serializado, size_t nuevo_size) {
+    if (sizeof(DNI_t) + nuevo_size > BPlusTreeCadenas::MAX_ENTRADA) {
+        return false;
+    }
+    // La misma bajada que cambia el valor devuelve el anterior, con el nombre viejo
+    auto anterior = tabla->reemplazar(clave_dni(dni), serializado, nuevo_size);
+    if (!anterior.has_value()) {
+        return false;
+    }
+
+    std::string clave_antigua = clave_nombre(anterior->data());
+    std::string clave_nueva = clave_nombre(serializado);
+    if (clave_antigua != clave_nueva) {
+        indice_nombres->eliminar(clave_antigua);
+        indice_nombres->insertar(clave_nueva, SIN_REGISTRO);
+    }
+    return true;
 }
 
 bool Database::eliminar_ciudadano(DNI_t dni) {
-    if (!inicializado) return false;
+    uint64_t lsn;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!inicializado) return false;
 
-    auto rid_optional = indice_dni->buscar(dni);
+        antes_de_operar(lock);
+        if (!aplicar_eliminar(dni)) {
+            return false;
+        }
+        lsn = registrar(TipoRegistroWAL::ELIMINAR, &dni, sizeof(dni));
+        despues_de_operar();
+    }
+    return esperar_commit(lsn);
+}
+
+bool Database::aplicar_eliminar(DNI_t dni) {
+    if (!puede_estar(dni)) {
+        return false;
+    }
+    if (agrupada()) {
+        return aplicar_eliminar_agrupada(dni);
+    }
+    // La misma bajada que saca la clave del indice devuelve donde estaba el registro
+    auto rid_optional = indice_dni->eliminar_y_devolver(dni);
     if (!rid_optional.has_value()) {
         return false; 
     }
     RegistroID rid = rid_optional.value();
 
-    char* pagina_ptr = paginador.get_pagina(rid.pagina_id);
-    if (!pagina_ptr) {
-        return false;
+    PaginaFijada pagina = paginador.fijar_pagina(rid.pagina_id);
+    if (!pagina) {
+        return true;
     }
-    PaginaRanurada pagina_ranurada(pagina_ptr);
-    if (!pagina_ranurada.borrar_registro(rid.slot_id)) {
+    auto clave = clave_nombre_registro(pagina.datos(), rid.slot_id);
+    if (clave.has_value()) {
+        indice_nombres->eliminar(*clave);
+    }
+    BloqueoLatch bloqueo(paginador.latch(rid.pagina_id));
+    if (PaginaRanurada(pagina.datos()).borrar_registro(rid.slot_id)) {
+        pagina.marcar_sucia();
+    }
+    return true;
+}
+
+bool Database::aplicar_eliminar_agrupada(DNI_t dni) {
+    auto anterior = tabla->eliminar(clave_dni(dni));
+    if (!anterior.has_value()) {
         return false;
     }
+    indice_nombres->eliminar(clave_nombre(anterior->data()));
+    return true;
+}
+
+ResultadoVacuum Database::vacuum(ModoVacuum modo) {
+    std::unique_lock<std::shared_mutex> exclusivo(estructura);
+    std::unique_lock<std::mutex> lock(mutex);
+    ResultadoVacuum resultado = {0, 0, 0, 0};
+    if (!inicializado) {
+        return resultado;
+    }
+    if (!error_checkpoint.empty()) {
+        throw std::runtime_error(error_checkpoint);
+    }
+    // Vacuum hace sus propios checkpoints y corta el archivo: no puede haber escrituras del hilo
+    // en curso. Mientras tenemos el mutex el hilo no empieza otro.
+    esperar_checkpoint_en_curso(lock);
+
+    size_t paginas_antes = paginador.get_num_paginas();
+    size_t capacidad_antes = paginador.get_estadisticas().capacidad_paginas;
+
+    if (modo == ModoVacuum::COMPACTAR) {
+        resultado.paginas_movidas = compactar();
+    } else {
+        resultado.paginas_perforadas = perforar_libres();
+    }
+
+    // Si el filtro necesito mas paginas de las que habia libres el archivo pudo crecer: ahi no
+    // se recupero nada, y lo que vacuum deja ya no vuelve a crecer al cerrar
+    size_t paginas_despues = paginador.get_num_paginas();
+    size_t capacidad_despues = paginador.get_estadisticas().capacidad_paginas;
+    resultado.paginas_truncadas = paginas_antes > paginas_despues ? paginas_antes - paginas_despues : 0;
+    size_t paginas_cortadas = capacidad_antes > capacidad_despues ? capacidad_antes - capacidad_despues : 0;
+    resultado.bytes_recuperados = (paginas_cortadas + resultado.paginas_perforadas) * PAGINA_SIZE;
+    return resultado;
+}
+
+// Deja las K paginas vivas en [0, K): cada pagina viva en [K, num_paginas) se copia a un hueco
+// de [0, K) y despues se corrigen los punteros del indice. Las paginas de datos que quedaron sin
+// registros no tienen RIDs que las apunten, asi que tambien se recuperan.
+//
+// Con WAL se hacen checkpoints por el camino para no juntar mas paginas sucias de las que
+// entran. Si el proceso muere entre dos, el arbol queda con parte de los punteros traducidos,
+// pero las paginas viejas siguen intactas hasta cortar el archivo: cada puntero lleva a una
+// copia valida y lo que no se alcance se recupera en el siguiente vacuum.
+size_t Database::compactar() {
+    size_t num_paginas = paginador.get_num_paginas();
+
+    std::vector<bool> vivas(num_paginas, false);
+    vivas[SUPERBLOCK_PAGE_ID] = true;
+    if (ultima_pagina_datos_id != INVALID_PAGE_ID) {
+        vivas[ultima_pagina_datos_id] = true; // Sigue recibiendo inserciones aunque este vacia
+    }
+    if (agrupada()) {
+        tabla->marcar_paginas_vivas(vivas);
+    } else {
+        indice_dni->marcar_paginas_vivas(vivas);
+    }
+    indice_nombres->marcar_paginas_vivas(vivas);
+    // Las paginas del filtro no se mueven: se vuelven a escribir al cerrar. Su rango se
+    // recupera con las libres y se reserva de nuevo, del largo del filtro, justo despues de
+    // las vivas (ver abajo), asi el archivo no tiene que volver a crecer al cerrar
+    size_t paginas_del_filtro = filtro ? filtro->get_num_paginas() : 0;
+    primera_pagina_filtro = INVALID_PAGE_ID;
+    paginas_filtro = 0;
+    filtro_al_dia = false;
+
+    // Todo lo que no esta vivo queda despues de K: la lista de libres ya no tiene sentido, y
+    // los huecos que vamos a ocupar no pueden seguir en ella si hay un checkpoint en el medio
+    paginador.fijar_lista_libres(INVALID_PAGE_ID, 0);
+    checkpoint_si_hace_falta(wal.get_lsn_siguiente(), true);
+
+    size_t paginas_vivas = static_cast<size_t>(std::count(vivas.begin(), vivas.end(), true));
+
+    std::vector<PaginaID> nuevo_id(num_paginas);
+    for (size_t i = 0; i < num_paginas; i++) {
+        nuevo_id[i] = static_cast<PaginaID>(i);
+    }
+
+    size_t movidas = 0;
+    size_t hueco = 0;
+    for (size_t origen = paginas_vivas; origen < num_paginas; origen++) {
+        if (!vivas[origen]) {
+            continue;
+        }
+        while (vivas[hueco]) {
+            hueco++;
+        }
+        nuevo_id[origen] = static_cast<PaginaID>(hueco);
+
+        PaginaFijada pagina_origen = paginador.fijar_pagina(static_cast<PaginaID>(origen));
+        PaginaFijada pagina_destino = paginador.fijar_pagina(static_cast<PaginaID>(hueco));
+        if (!pagina_origen || !pagina_destino) {
+            throw std::runtime_error("No se pudo fijar la pagina " + std::to_string(origen) + " para moverla.");
+        }
+        std::memcpy(pagina_destino.datos(), pagina_origen.datos(), PAGINA_SIZE);
+        pagina_destino.marcar_sucia();
+        pagina_origen.soltar();
+        pagina_destino.soltar();
+
+        hueco++;
+        movidas++;
+        checkpoint_si_hace_falta(wal.get_lsn_siguiente(), true);
+    }
+
+    if (movidas > 0) {
+        // Cada nodo traducido queda sucio: con WAL los lotes no pasan del limite del checkpoint
+        auto lote = [&]() {
+            size_t sucias = paginador.get_num_paginas_sucias();
+            size_t limite = limite_paginas_sucias();
+            return sucias < limite ? limite - sucias : 1;
+        };
+        std::vector<PaginaID> pendientes;
+        if (agrupada()) {
+            pendientes = tabla->reubicar_raiz(nuevo_id);
+            while (!pendientes.empty()) {
+                tabla->reubicar_nodos(nuevo_id, pendientes, lote());
+                checkpoint_si_hace_falta(wal.get_lsn_siguiente(), true);
+            }
+        } else {
+            pendientes = indice_dni->reubicar_raiz(nuevo_id);
+            while (!pendientes.empty()) {
+                indice_dni->reubicar_nodos(nuevo_id, pendientes, lote());
+                checkpoint_si_hace_falta(wal.get_lsn_siguiente(), true);
+            }
+        }
+        pendientes = indice_nombres->reubicar_raiz(nuevo_id);
+        while (!pendientes.empty()) {
+            indice_nombres->reubicar_nodos(nuevo_id, pendientes, lote());
+            checkpoint_si_hace_falta(wal.get_lsn_siguiente(), true);
+        }
+    }
+    if (ultima_pagina_datos_id != INVALID_PAGE_ID) {
+        ultima_pagina_datos_id = nuevo_id[ultima_pagina_datos_id];
+    }
+
+    // Lo que hay en [paginas_vivas, num_paginas) ya no se usa: el filtro va al principio. Si
+    // no entra (el filtro crecio desde que se guardo, o nunca se guardo), el archivo crece
+    // ahora solo lo que falta, en lugar de crecer al cerrar con la extension de siempre.
+    size_t paginas_finales = paginas_vivas;
+    if (paginas_del_filtro > 0) {
+        size_t en_uso = paginador.get_num_paginas();
+        if (paginas_vivas + paginas_del_filtro > en_uso &&
+            paginador.alloc_paginas_nuevas(paginas_vivas + paginas_del_filtro - en_uso) == INVALID_PAGE_ID) {
+            throw std::runtime_error("No se pudieron reservar las paginas del filtro.");
+        }
+        paginas_finales += paginas_del_filtro;
+        primera_pagina_filtro = static_cast<PaginaID>(paginas_vivas);
+        paginas_filtro = paginas_del_filtro;
+        filtro->marcar_sin_guardar();
+    }
+
+    cortar_archivo(paginas_finales);
+    return movidas;
+}
+
+// Sin mover paginas: las libres del final se cortan y el resto se perfora en el archivo
+size_t Database::perforar_libres() {
+    // El rango del filtro se reserva ahora y no al cerrar: si cambio de largo, el viejo queda
+    // en la lista de libres y se corta o se perfora con las demas
+    reservar_paginas_filtro();
+    size_t num_paginas = paginador.get_num_paginas();
+
+    std::vector<PaginaID> libres = paginador.listar_paginas_libres();
+    std::vector<bool> es_libre(num_paginas, false);
+    for (PaginaID id : libres) {
+        if (id >= num_paginas) {
+            throw std::runtime_error("La lista de paginas libres apunta fuera del archivo.");
+        }
+        es_libre[id] = true;
+    }
+
+    size_t paginas_usadas = num_paginas;
+    while (paginas_usadas > SUPERBLOCK_PAGE_ID + 1 && es_libre[paginas_usadas - 1]) {
+        paginas_usadas--;
+    }
+
+    // La lista vieja ocupa troncos que se van a perforar: con WAL, el archivo no puede
+    // apuntar a ella en un checkpoint intermedio
+    if (usar_wal) {
+        paginador.fijar_lista_libres(INVALID_PAGE_ID, 0);
+        checkpoint(wal.get_lsn_siguiente(), true);
+    }
+
+    libres.erase(std::remove_if(libres.begin(), libres.end(),
+        [paginas_usadas](PaginaID id) { return id >= paginas_usadas; }), libres.end());
+    std::sort(libres.begin(), libres.end());
+
+    size_t perforadas = paginador.reconstruir_lista_libres(libres, true);
+    cortar_archivo(paginas_usadas);
+    return perforadas;
+}
+
+// El superblock nuevo llega al disco antes de cortar: si el proceso muere en el medio, el
+// archivo queda mas largo de lo que dice el superblock, que es un estado valido
+void Database::cortar_archivo(size_t paginas) {
+    size_t paginas_antes = paginador.get_num_paginas();
+    paginador.fijar_num_paginas(paginas);
+    if (usar_wal) {
+        // Las imagenes del log no pueden apuntar a paginas que estamos por cortar
+        checkpoint(wal.get_lsn_siguiente(), true);
+    } else {
+        escribir_superblock();
+        paginador.sincronizar();
+    }
+
+    if (!paginador.truncar(paginas)) {
+        paginador.fijar_num_paginas(paginas_antes);
+        escribir_superblock();
+        throw std::runtime_error("No se pudo achicar el archivo de la base de datos.");
+    }
+}
+
+EstadisticasPaginador Database::get_estadisticas_paginador() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return paginador.get_estadisticas();
+}
 
-    // Finalmente, eliminar la clave del índice
-    return indice_dni->eliminar(dni);
+EstadisticasWAL Database::get_estadisticas_wal() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return wal.get_estadisticas();
 }
@@ -1,228 +1,1091 @@
 #include "index/bplustree.hpp"
+#include "index/busqueda_nodo.hpp"
+#include "core/prefetch.hpp"
 #include <algorithm>
+#include <cstring>
+#include <numeric>
 #include <stdexcept>
+#include <string>
 
-BPlusTree::BPlusTree(Paginador& paginador)
-    : paginador(paginador), id_raiz(INVALID_PAGE_ID) {}
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::mover_entradas(const char* origen, size_t desde, char* destino, size_t hasta, size_t n) {
+    std::memmove(Hoja::claves(destino) + hasta, Hoja::claves(origen) + desde, n * sizeof(Clave));
+    std::memmove(Hoja::valores(destino) + hasta, Hoja::valores(origen) + desde, n * sizeof(Guardado));
+}
 
-PaginaID BPlusTree::inicializar(PaginaID id_raiz) {
-    this->id_raiz = id_raiz;
-    if (this->id_raiz == INVALID_PAGE_ID) {
-        PaginaID nueva_raiz_id = paginador.alloc_pagina();
-        if (nueva_raiz_id == INVALID_PAGE_ID) {
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::BPlusTreeGenerico(Paginador& paginador)
+    : paginador(paginador), id_raiz(INVALID_PAGE_ID), hoja_derecha(INVALID_PAGE_ID), cache(paginador, Interno::ORDEN) {
+    if (paginador.get_size_pagina() != TAM_PAGINA) {
+        throw std::runtime_error("El paginador tiene paginas de " + std::to_string(paginador.get_size_pagina()) +
+                                 " bytes y este B+ Tree usa paginas de " + std::to_string(TAM_PAGINA) + ".");
+    }
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+class BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::CambioEstructura {
+    BPlusTreeGenerico& arbol;
+    std::lock_guard<std::mutex> lock;
+
+public:
+    explicit CambioEstructura(BPlusTreeGenerico& arbol) : arbol(arbol), lock(arbol.mutex_estructura) {}
+
+    // Tambien si se lanzo a la mitad: lo que quedo escrito lo validan los lectores
+    ~CambioEstructura() {
+        for (PaginaID id : arbol.bloqueadas) {
+            arbol.paginador.latch(id).desbloquear();
+        }
+        arbol.bloqueadas.clear();
+    }
+};
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::bloquear(PaginaID id_pagina) {
+    // Un cambio toca pocos nodos (el camino y algun hermano): buscar en el vector alcanza
+    if (std::find(bloqueadas.begin(), bloqueadas.end(), id_pagina) != bloqueadas.end()) {
+        return;
+    }
+    paginador.latch(id_pagina).bloquear();
+    bloqueadas.push_back(id_pagina);
+}
+
+// Todas las operaciones del arbol pasan por aqui: si el paginador no puede darnos la pagina
+// (en modo buffer pool, todos los frames fijados) no hay forma razonable de seguir
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+PaginaFijada BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::fijar(PaginaID id_pagina) {
+    PaginaFijada pagina = paginador.fijar_pagina(id_pagina);
+    if (!pagina) {
+        throw std::runtime_error("No se pudo fijar la pagina " + std::to_string(id_pagina) + " del B+ Tree.");
+    }
+    return pagina;
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+PaginaID BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::inicializar(PaginaID id_raiz) {
+    hoja_derecha = INVALID_PAGE_ID;
+    cache.vaciar();
+    if (id_raiz == INVALID_PAGE_ID) {
+        id_raiz = paginador.alloc_pagina();
+        if (id_raiz == INVALID_PAGE_ID) {
             throw std::runtime_error("No se pudo asignar una pagina para la nueva raiz del B+ Tree.");
         }
-        this->id_raiz = nueva_raiz_id;
 
-        char* pagina_ptr = paginador.get_pagina(this->id_raiz);
+        PaginaFijada pagina = fijar(id_raiz);
+        char* pagina_ptr = pagina.datos();
         auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
         header->tipo = TipoNodo::Hoja;
         header->num_claves = 0;
 
         PaginaID* sig_hoja_ptr = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
         *sig_hoja_ptr = INVALID_PAGE_ID;
+        pagina.marcar_sucia();
     }
-    return this->id_raiz;
+    // Recien ahora la ven las busquedas
+    this->id_raiz.store(id_raiz, std::memory_order_release);
+    return id_raiz;
 }
 
-PaginaID BPlusTree::get_id_raiz() const {
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+PaginaID BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::get_id_raiz() const {
     return this->id_raiz;
 }
 
-PaginaID BPlusTree::buscar_hoja(DNI_t clave) {
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+size_t BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::get_num_nodos_fijados() {
+    return cache.get_num_nodos();
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::marcar_paginas_vivas(std::vector<bool>& vivas) {
+    std::vector<PaginaID> pendientes = {id_raiz};
+
+    while (!pendientes.empty()) {
+        PaginaID id_pagina = pendientes.back();
+        pendientes.pop_back();
+        if (id_pagina >= vivas.size()) {
+            throw std::runtime_error("El B+ Tree apunta a la pagina " + std::to_string(id_pagina) + ", fuera del archivo.");
+        }
+        vivas[id_pagina] = true;
+
+        PaginaFijada pagina = fijar(id_pagina);
+        char* pagina_ptr = pagina.datos();
+        auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+
+        if (header->tipo == TipoNodo::Interno) {
+            auto hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+            pendientes.insert(pendientes.end(), hijos, hijos + header->num_claves + 1);
+            continue;
+        }
+
+        // Otros valores no apuntan a paginas
+        if constexpr (std::is_same<Valor, RegistroID>::value) {
+            auto valores = Hoja::valores(pagina_ptr);
+            for (int i = 0; i < header->num_claves; i++) {
+                PaginaID id_datos = ValorHoja<Valor>::leer(valores[i]).pagina_id;
+                if (id_datos >= vivas.size()) {
+                    throw std::runtime_error("Un RID apunta a la pagina " + std::to_string(id_datos) + ", fuera del archivo.");
+                }
+                vivas[id_datos] = true;
+            }
+        }
+    }
+}
+
+// Cada nivel junta sus entradas pendientes y escribe un nodo de `llenado` entradas recien
+// cuando tiene mas de 2 * llenado: asi, al terminar, las que quedan (mas de llenado si el
+// nivel ya escribio algun nodo) entran en uno o dos nodos de al menos la mitad de capacidad.
+// Cada nodo escrito sube al nivel de arriba con su clave minima.
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+struct BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::CargaAscendente {
+    struct Nivel {
+        std::vector<std::pair<Clave, PaginaID>> pendientes; // Clave minima del subarbol, hijo
+        size_t escritos = 0;
+    };
+
+    BPlusTreeGenerico& arbol;
+    size_t llenado_hoja;      // Entradas por hoja
+    size_t llenado_interno;   // Hijos por nodo interno
+
+    std::vector<Clave> claves;       // Entradas que todavia no se escribieron
+    std::vector<Valor> valores;
+    size_t hojas_escritas = 0;
+    PaginaID hoja_anterior = INVALID_PAGE_ID;
+    std::vector<Nivel> internos; // internos[0] es el nivel sobre las hojas
+
+    CargaAscendente(BPlusTreeGenerico& arbol, double factor_llenado) : arbol(arbol) {
+        auto llenado = [factor_llenado](size_t capacidad, size_t minimo) {
+            size_t n = static_cast<size_t>(capacidad * factor_llenado);
+            return std::clamp(n, minimo, capacidad);
+        };
+        llenado_hoja = llenado(Hoja::MAX_CLAVES, Hoja::MAX_CLAVES / 2);
+        llenado_interno = llenado(Interno::ORDEN, Interno::MAX_CLAVES / 2 + 1);
+    }
+
+    PaginaFijada nueva_pagina(PaginaID& id) {
+        id = arbol.paginador.alloc_pagina_nueva();
+        if (id == INVALID_PAGE_ID) {
+            throw std::runtime_error("No se pudo asignar una pagina para la carga masiva.");
+        }
+        return arbol.fijar(id);
+    }
+
+    void agregar_entrada(Clave clave, Valor valor) {
+        if (!claves.empty() && !arbol.comparar(claves.back(), clave)) {
+            throw std::runtime_error("La carga masiva necesita claves en orden creciente y sin repetir.");
+        }
+        claves.push_back(clave);
+        valores.push_back(valor);
+        if (claves.size() > 2 * llenado_hoja) {
+            escribir_hoja(llenado_hoja);
+        }
+    }
+
+    void escribir_hoja(size_t n) {
+        PaginaID id;
+        PaginaFijada pagina = nueva_pagina(id);
+        char* pagina_ptr = pagina.datos();
+        auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+        header->tipo = TipoNodo::Hoja;
+        header->num_claves = static_cast<uint16_t>(n);
+        *reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader)) = INVALID_PAGE_ID;
+        std::copy(claves.begin(), claves.begin() + n, Hoja::claves(pagina_ptr));
+        std::transform(valores.begin(), valores.begin() + n, Hoja::valores(pagina_ptr), ValorHoja<Valor>::guardar);
+        pagina.marcar_sucia();
+        pagina.soltar();
+
+        if (hoja_anterior != INVALID_PAGE_ID) {
+            PaginaFijada anterior = arbol.fijar(hoja_anterior);
+            *reinterpret_cast<PaginaID*>(anterior.datos() + sizeof(BPlusTreeHeader)) = id;
+            anterior.marcar_sucia();
+        }
+        hoja_anterior = id;
+        hojas_escritas++;
+
+        Clave minima = n > 0 ? claves[0] : Clave{};
+        claves.erase(claves.begin(), claves.begin() + n);
+        valores.erase(valores.begin(), valores.begin() + n);
+        agregar_hijo(0, minima, id);
+    }
+
+    void agregar_hijo(size_t nivel, Clave minima, PaginaID hijo) {
+        if (nivel == internos.size()) {
+            internos.emplace_back();
+        }
+        internos[nivel].pendientes.emplace_back(minima, hijo);
+        if (internos[nivel].pendientes.size() > 2 * llenado_interno) {
+            escribir_interno(nivel, llenado_interno);
+        }
+    }
+
+    void escribir_interno(size_t nivel, size_t n) {
+        PaginaID id;
+        PaginaFijada pagina = nueva_pagina(id);
+        char* pagina_ptr = pagina.datos();
+        auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+        auto hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+        auto claves = reinterpret_cast<Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
+
+        // La clave minima del primer hijo no va en el nodo: es la que sube al padre
+        auto& pendientes = internos[nivel].pendientes;
+        header->tipo = TipoNodo::Interno;
+        header->num_claves = static_cast<uint16_t>(n - 1);
+        for (size_t i = 0; i < n; i++) {
+            hijos[i] = pendientes[i].second;
+            if (i > 0) {
+                claves[i - 1] = pendientes[i].first;
+            }
+        }
+        pagina.marcar_sucia();
+        internos[nivel].escritos++;
+
+        Clave minima = pendientes[0].first;
+        pendientes.erase(pendientes.begin(), pendientes.begin() + n);
+        agregar_hijo(nivel + 1, minima, id);
+    }
+
+    // Escribe lo que quedo en cada nivel, de abajo hacia arriba, y devuelve la raiz
+    PaginaID terminar() {
+        size_t restantes = claves.size();
+        if (restantes > static_cast<size_t>(Hoja::MAX_CLAVES)) {
+            escribir_hoja(restantes / 2);
+        }
+        escribir_hoja(claves.size()); // Sin entradas queda una hoja vacia como raiz
+        if (hojas_escritas == 1) {
+            return hoja_anterior;
+        }
+
+        for (size_t nivel = 0; ; nivel++) {
+            auto& pendientes = internos[nivel].pendientes;
+            if (internos[nivel].escritos == 0 && pendientes.size() == 1) {
+                return pendientes[0].second;
+            }
+            restantes = pendientes.size();
+            if (restantes > static_cast<size_t>(Interno::ORDEN)) {
+                escribir_interno(nivel, restantes / 2);
+            }
+            escribir_interno(nivel, internos[nivel].pendientes.size());
+        }
+    }
+};
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+PaginaID BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::construir_desde_ordenados(const std::function<bool(Clave&, Valor&)>& siguiente, double factor_llenado) {
+    CargaAscendente carga(*this, factor_llenado);
+    Clave clave{};
+    Valor valor{};
+    while (siguiente(clave, valor)) {
+        carga.agregar_entrada(clave, valor);
+    }
+
+    PaginaID raiz_anterior = id_raiz;
+    id_raiz = carga.terminar();
+    hoja_derecha = INVALID_PAGE_ID;
+    cache.vaciar();
+    return raiz_anterior;
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+std::vector<PaginaID> BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::reubicar_raiz(const std::vector<PaginaID>& nuevo_id) {
+    id_raiz = nuevo_id[id_raiz];
+    hoja_derecha = INVALID_PAGE_ID;
+    cache.vaciar(); // Los nodos fijados son las paginas de antes de copiarlas
+    return {id_raiz};
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::reubicar_nodos(const std::vector<PaginaID>& nuevo_id, std::vector<PaginaID>& pendientes, size_t max_nodos) {
+    // Los nodos ya estan en su lugar nuevo; recorremos desde la raiz nueva traduciendo lo que apuntan
+    for (size_t procesados = 0; procesados < max_nodos && !pendientes.empty(); procesados++) {
+        PaginaFijada pagina = fijar(pendientes.back());
+        pendientes.pop_back();
+        char* pagina_ptr = pagina.datos();
+        auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+
+        if (header->tipo == TipoNodo::Interno) {
+            auto hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+            for (int i = 0; i <= header->num_claves; i++) {
+                hijos[i] = nuevo_id[hijos[i]];
+                pendientes.push_back(hijos[i]);
+            }
+        } else {
+            auto sig_hoja_ptr = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+            if (*sig_hoja_ptr != INVALID_PAGE_ID) {
+                *sig_hoja_ptr = nuevo_id[*sig_hoja_ptr];
+            }
+            if constexpr (std::is_same<Valor, RegistroID>::value) {
+                auto valores = Hoja::valores(pagina_ptr);
+                for (int i = 0; i < header->num_claves; i++) {
+                    RegistroID rid = ValorHoja<Valor>::leer(valores[i]);
+                    rid.pagina_id = nuevo_id[rid.pagina_id];
+                    valores[i] = ValorHoja<Valor>::guardar(rid);
+                }
+            }
+        }
+        pagina.marcar_sucia();
+    }
+}
+
+// Formato 1 de las hojas: entradas de 12 bytes (RegistroID con su relleno) desde OFFSET_CLAVES.
+// Con 340 entradas como maximo (MAX_CLAVES_HOJA_V1), las mismas entradas siempre entran en el formato actual.
+struct EntradaHojaV1 {
+    DNI_t clave;
+    RegistroID valor;
+};
+static_assert(sizeof(EntradaHojaV1) == 12, "El formato 1 de las hojas tiene entradas de 12 bytes");
+constexpr size_t MAX_CLAVES_HOJA_V1 = (PAGINA_SIZE - BPlusTree::Hoja::OFFSET_CLAVES) / sizeof(EntradaHojaV1);
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+PaginaID BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::migrar_hojas_v1(PaginaID desde, size_t max_hojas) {
+    // El formato 1 solo existio para el indice de DNIs
+    if constexpr (!std::is_same<BPlusTreeGenerico, BPlusTree>::value) {
+        throw std::runtime_error("Solo el indice de DNIs tiene hojas del formato 1.");
+    } else {
+        hoja_derecha = INVALID_PAGE_ID;
+        PaginaID id_hoja = desde;
+        if (id_hoja == INVALID_PAGE_ID) {
+            // La primera hoja: bajando siempre por el primer hijo (los internos no cambian de formato)
+            id_hoja = id_raiz;
+            while (true) {
+                PaginaFijada pagina = fijar(id_hoja);
+                if (reinterpret_cast<BPlusTreeHeader*>(pagina.datos())->tipo == TipoNodo::Hoja) {
+                    break;
+                }
+                id_hoja = reinterpret_cast<PaginaID*>(pagina.datos() + sizeof(BPlusTreeHeader))[0];
+            }
+        }
+
+        std::vector<EntradaHojaV1> entradas;
+        for (size_t convertidas = 0; convertidas < max_hojas && id_hoja != INVALID_PAGE_ID; convertidas++) {
+            PaginaFijada pagina = fijar(id_hoja);
+            char* pagina_ptr = pagina.datos();
+            auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+            if (header->tipo != TipoNodo::Hoja || header->num_claves > MAX_CLAVES_HOJA_V1) {
+                throw std::runtime_error("La pagina " + std::to_string(id_hoja) + " no es una hoja valida del formato 1.");
+            }
+
+            auto viejas = reinterpret_cast<const EntradaHojaV1*>(pagina_ptr + Hoja::OFFSET_CLAVES);
+            entradas.assign(viejas, viejas + header->num_claves);
+            for (size_t i = 0; i < entradas.size(); i++) {
+                Hoja::claves(pagina_ptr)[i] = entradas[i].clave;
+                Hoja::valores(pagina_ptr)[i] = ValorHoja<Valor>::guardar(entradas[i].valor);
+            }
+            pagina.marcar_sucia();
+
+            id_hoja = *reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+        }
+        return id_hoja;
+    }
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+PaginaID BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::buscar_hoja(Clave clave) {
+    PaginaID id_raiz_actual = id_raiz;
+    PaginaID id_pagina_actual = id_raiz_actual;
+    // Mientras los nodos esten en la cache no se pasa por el paginador (ver CacheInternos)
+    NodoFijado* nodo = cache.raiz(id_raiz_actual);
+    uint32_t altura = 0;
+    while (true) {
+        PaginaFijada pagina;
+        const char* pagina_ptr;
+        if (nodo != nullptr) {
+            pagina_ptr = nodo->datos;
+        } else {
+            pagina = fijar(id_pagina_actual);
+            pagina_ptr = pagina.datos();
+            if (reinterpret_cast<const BPlusTreeHeader*>(pagina_ptr)->tipo == TipoNodo::Hoja) {
+                break;
+            }
+        }
+        auto header = reinterpret_cast<const BPlusTreeHeader*>(pagina_ptr);
+        auto claves = reinterpret_cast<const Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
+        auto hijos = reinterpret_cast<const PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+
+        size_t pos = posicion_superior(claves, header->num_claves, clave);
+        id_pagina_actual = hijos[pos];
+        altura++;
+        if (nodo != nullptr) {
+            if (nodo->nivel == 1) {
+                return id_pagina_actual;
+            }
+            nodo = cache.hijo(nodo, pos, id_pagina_actual);
+        }
+    }
+    if (altura > 0 && cache.raiz(id_raiz_actual) == nullptr) {
+        cache.anotar_raiz(id_raiz_actual, altura, paginador.latch(id_raiz_actual).leer_version());
+    }
+    return id_pagina_actual;
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+bool BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::bajar_optimista(Clave clave, Bajada& bajada) {
+    PaginaID id_pagina = id_raiz.load(std::memory_order_acquire);
+    if (id_pagina == INVALID_PAGE_ID) {
+        return false;
+    }
+    uint64_t version = paginador.latch(id_pagina).leer_version();
+    // Si la raiz cambio antes de leer su version, la que tenemos ya no es la raiz
+    if (id_pagina != id_raiz.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    bajada.es_raiz = true;
+    bajada.borde_derecho = true;
+    // Los nodos de la cache se leen en su lugar, sin pasar por el paginador, y se validan
+    // igual que los demas. Al dejar la cache (no entraban mas) se sigue por el paginador.
+    PaginaID id_raiz_leida = id_pagina;
+    uint64_t version_raiz = version;
+    NodoFijado* nodo = cache.raiz(id_pagina);
+    uint32_t altura = 0;
+    while (true) {
+        PaginaFijada pagina;
+        const char* pagina_ptr;
+        if (nodo != nullptr) {
+            pagina_ptr = nodo->datos;
+        } else {
+            pagina = fijar(id_pagina);
+            pagina_ptr = pagina.datos();
+            if (reinterpret_cast<const BPlusTreeHeader*>(pagina_ptr)->tipo == TipoNodo::Hoja) {
+                break;
+            }
+        }
+        auto header = reinterpret_cast<const BPlusTreeHeader*>(pagina_ptr);
+
+        // Hasta validar, num_claves puede ser cualquier cosa: no leer fuera de la pagina
+        size_t num_claves = std::min<size_t>(header->num_claves, Interno::MAX_CLAVES);
+        auto claves = reinterpret_cast<const Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
+        auto hijos = reinterpret_cast<const PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+        size_t pos = posicion_superior(claves, num_claves, clave);
+        PaginaID id_hijo = hijos[pos];
+
+        LatchOptimista& latch = nodo != nullptr ? *nodo->latch : paginador.latch(id_pagina);
+        if (!latch.validar(version)) {
+            return false;
+        }
+        uint64_t version_hijo = paginador.latch(id_hijo).leer_version();
+        // Si el hijo se dividio antes de leer su version, el padre tambien cambio
+        if (!latch.validar(version)) {
+            return false;
+        }
+
+        bajada.es_raiz = false;
+        bajada.borde_derecho = bajada.borde_derecho && pos == num_claves;
+        id_pagina = id_hijo;
+        version = version_hijo;
+        altura++;
+        if (nodo != nullptr) {
+            if (nodo->nivel == 1) {
+                break;
+            }
+            // Con el padre validado: nunca se fija un hijo leido de un nodo a medio escribir
+            nodo = cache.hijo(nodo, pos, id_hijo);
+        }
+    }
+
+    // La altura de una raiz que no cambio desde que empezamos es la que medimos
+    if (altura > 0 && cache.raiz(id_raiz_leida) == nullptr) {
+        cache.anotar_raiz(id_raiz_leida, altura, version_raiz);
+    }
+
+    bajada.id_hoja = id_pagina;
+    bajada.version = version;
+    return true;
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+std::optional<Valor> BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::buscar(Clave clave) {
+    if (id_raiz.load(std::memory_order_acquire) == INVALID_PAGE_ID) {
+        return std::nullopt;
+    }
+    while (true) {
+        Bajada bajada;
+        if (!bajar_optimista(clave, bajada)) {
+            continue;
+        }
+        PaginaFijada pagina = fijar(bajada.id_hoja);
+        const char* pagina_ptr = pagina.datos();
+        auto header = reinterpret_cast<const BPlusTreeHeader*>(pagina_ptr);
+        auto claves = Hoja::claves(pagina_ptr);
+
+        size_t num_claves = std::min<size_t>(header->num_claves, Hoja::MAX_CLAVES);
+        size_t pos = posicion_inferior(claves, num_claves, clave);
+        std::optional<Valor> resultado;
+        if (pos < num_claves && iguales(claves[pos], clave)) {
+            resultado = ValorHoja<Valor>::leer(Hoja::valores(pagina_ptr)[pos]);
+        }
+
+        if (paginador.latch(bajada.id_hoja).validar(bajada.version)) {
+            return resultado;
+        }
+    }
+}
+
+// Nodos de un nivel que buscar_lote pide juntos: del orden de los fallos de cache que el
+// procesador puede tener en vuelo a la vez, y pocos frames fijados en BUFFER_POOL
+constexpr size_t NODOS_POR_TANDA = 16;
+
+// Las lineas que la busqueda va a leer primero. Todavia no sabemos si el nodo es interno u
+// hoja, asi que se piden el header y la mitad del arreglo de claves de los dos formatos.
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::prefetch_nodo(const char* pagina_ptr) {
+    prefetch_linea(pagina_ptr);
+    prefetch_linea(Hoja::claves(pagina_ptr) + Hoja::MAX_CLAVES / 2);
+    prefetch_linea(pagina_ptr + Interno::OFFSET_CLAVES + Interno::MAX_CLAVES / 2 * sizeof(Clave));
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+std::vector<std::optional<Valor>> BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::buscar_lote(const std::vector<Clave>& claves) {
+    std::vector<std::optional<Valor>> resultados(claves.size());
+    if (claves.empty() || id_raiz == INVALID_PAGE_ID) {
+        return resultados;
+    }
+
+    // Las claves ordenadas, con su posicion original: las que caen en el mismo nodo quedan juntas
+    std::vector<size_t> orden(claves.size());
+    std::iota(orden.begin(), orden.end(), 0);
+    std::sort(orden.begin(), orden.end(), [this, &claves](size_t a, size_t b) { return comparar(claves[a], claves[b]); });
+    std::vector<Clave> ordenadas(claves.size());
+    for (size_t i = 0; i < orden.size(); i++) {
+        ordenadas[i] = claves[orden[i]];
+    }
+
+    // Cada nodo de un nivel con el tramo [desde, hasta) de ordenadas que baja por el
+    struct Grupo {
+        PaginaID id;
+        size_t desde;
+        size_t hasta;
+    };
+    std::vector<Grupo> nivel = {{id_raiz, 0, ordenadas.size()}};
+    std::vector<Grupo> siguiente_nivel;
+    std::vector<PaginaID> ids;
+    std::vector<PaginaFijada> paginas(NODOS_POR_TANDA);
+    bool leer_en_lote = paginador.get_modo() == ModoAlmacenamiento::BUFFER_POOL;
+
+    while (!nivel.empty()) {
+        siguiente_nivel.clear();
+        for (size_t inicio = 0; inicio < nivel.size(); inicio += NODOS_POR_TANDA) {
+            size_t fin = std::min(nivel.size(), inicio + NODOS_POR_TANDA);
+
+            // 1. Pedir todos los nodos de la tanda. En MAPEO no se usa precargar: un madvise
+            //    por pagina cuesta mas que la busqueda cuando el archivo ya esta en memoria.
+            if (leer_en_lote) {
+                ids.clear();
+                for (size_t i = inicio; i < fin; i++) {
+                    ids.push_back(nivel[i].id);
+                }
+                paginador.precargar(ids);
+            }
+            for (size_t i = inicio; i < fin; i++) {
+                paginas[i - inicio] = fijar(nivel[i].id);
+                prefetch_nodo(paginas[i - inicio].datos());
+            }
+
+            // 2. Buscar. Con las claves en orden, cada busqueda empieza donde termino la anterior.
+            for (size_t i = inicio; i < fin; i++) {
+                const Grupo& grupo = nivel[i];
+                char* pagina_ptr = paginas[i - inicio].datos();
+                auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+                size_t num_claves = header->num_claves;
+                size_t pos = 0;
+
+                if (header->tipo == TipoNodo::Hoja) {
+                    const Clave* claves_hoja = Hoja::claves(pagina_ptr);
+                    for (size_t k = grupo.desde; k < grupo.hasta; k++) {
+                        pos += posicion_inferior(claves_hoja + pos, num_claves - pos, ordenadas[k]);
+                        if (pos < num_claves && iguales(claves_hoja[pos], ordenadas[k])) {
+                            resultados[orden[k]] = ValorHoja<Valor>::leer(Hoja::valores(pagina_ptr)[pos]);
+                        }
+                    }
+                } else {
+                    auto claves_nodo = reinterpret_cast<Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
+                    auto hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+                    for (size_t k = grupo.desde; k < grupo.hasta; k++) {
+                        pos += posicion_superior(claves_nodo + pos, num_claves - pos, ordenadas[k]);
+                        if (!siguiente_nivel.empty() && siguiente_nivel.back().id == hijos[pos]) {
+                            siguiente_nivel.back().hasta = k + 1;
+                        } else {
+                            siguiente_nivel.push_back(Grupo{hijos[pos], k, k + 1});
+                        }
+                    }
+                }
+                paginas[i - inicio].soltar();
+            }
+        }
+        std::swap(nivel, siguiente_nivel);
+    }
+    return resultados;
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+PaginaID BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::buscar_hoja_anterior(Clave clave) {
     PaginaID id_pagina_actual = id_raiz;
+    PaginaID subarbol_izquierdo = INVALID_PAGE_ID;
     while (true) {
-        char* pagina_ptr = paginador.get_pagina(id_pagina_actual);
+        PaginaFijada pagina = fijar(id_pagina_actual);
+        char* pagina_ptr = pagina.datos();
         auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+        if (header->tipo == TipoNodo::Hoja) {
+            break;
+        }
+
+        auto claves = reinterpret_cast<Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
+        auto hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
 
+        size_t pos = posicion_superior(claves, header->num_claves, clave);
+        if (pos > 0) {
+            subarbol_izquierdo = hijos[pos - 1];
+        }
+        id_pagina_actual = hijos[pos];
+    }
+
+    if (subarbol_izquierdo == INVALID_PAGE_ID) {
+        return INVALID_PAGE_ID;
+    }
+    id_pagina_actual = subarbol_izquierdo;
+    while (true) {
+        PaginaFijada pagina = fijar(id_pagina_actual);
+        char* pagina_ptr = pagina.datos();
+        auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
         if (header->tipo == TipoNodo::Hoja) {
             return id_pagina_actual;
         }
-
-        auto claves = reinterpret_cast<DNI_t*>(pagina_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
         auto hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+        id_pagina_actual = hijos[header->num_claves];
+    }
+}
 
-        auto it = std::upper_bound(claves, claves + header->num_claves, clave);
-        size_t pos = std::distance(claves, it);
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::hojas_siguientes(Clave clave, size_t maximo, std::vector<PaginaID>& ids) {
+    ids.clear();
+    PaginaID id_pagina_actual = id_raiz;
+    while (true) {
+        PaginaFijada pagina = fijar(id_pagina_actual);
+        const char* pagina_ptr = pagina.datos();
+        auto header = reinterpret_cast<const BPlusTreeHeader*>(pagina_ptr);
+        if (header->tipo == TipoNodo::Hoja) {
+            return; // ids quedo con los hermanos de la hoja en el ultimo interno
+        }
+
+        auto claves = reinterpret_cast<const Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
+        auto hijos = reinterpret_cast<const PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+
+        size_t pos = posicion_superior(claves, header->num_claves, clave);
+        ids.clear();
+        for (size_t i = pos + 1; i <= header->num_claves && ids.size() < maximo; i++) {
+            ids.push_back(hijos[i]);
+        }
         id_pagina_actual = hijos[pos];
     }
 }
 
-std::optional<RegistroID> BPlusTree::buscar(DNI_t clave) {
-    PaginaID id_hoja = buscar_hoja(clave);
-    char* pagina_ptr = paginador.get_pagina(id_hoja);
+// === Iterador ===
 
-    auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
-    auto entradas = reinterpret_cast<Hoja::Entrada*>(pagina_ptr + sizeof(BPlusTreeHeader) + sizeof(PaginaID));
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::Iterador::Iterador(BPlusTreeGenerico* arbol, PaginaFijada hoja, int posicion)
+    : arbol(arbol), hoja(std::move(hoja)), posicion(posicion), siguiente_proxima(0), ventana(0) {}
 
-    auto it = std::lower_bound(entradas, entradas + header->num_claves, clave,
-        [](const Hoja::Entrada& a, DNI_t b) {
-            return a.clave < b;
-        });
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+int BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::Iterador::num_claves() const {
+    return reinterpret_cast<const BPlusTreeHeader*>(hoja.datos())->num_claves;
+}
 
-    if (it != entradas + header->num_claves && it->clave == clave) {
-        return it->valor;
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::Iterador::saltar_hojas_agotadas() {
+    while (hoja && posicion >= num_claves()) {
+        PaginaID id_siguiente = *reinterpret_cast<const PaginaID*>(hoja.datos() + sizeof(BPlusTreeHeader));
+        hoja.soltar();
+        if (id_siguiente != INVALID_PAGE_ID) {
+            hoja = arbol->fijar(id_siguiente);
+            posicion = 0;
+            precargar_hojas(id_siguiente);
+        }
     }
+}
 
-    return std::nullopt;
+// En BUFFER_POOL las hojas que siguen se piden al pool en un lote (ver Paginador::precargar),
+// de las que cuelgan del padre de la actual: asi un recorrido no espera una lectura por hoja.
+// La cadena sigue mandando: si la hoja no es la que se habia pedido (el arbol cambio) se
+// descarta lo pedido y se vuelve a pedir desde ella. En MAPEO no hace falta (ver buscar_lote).
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::Iterador::precargar_hojas(PaginaID id_hoja) {
+    if (arbol->paginador.get_modo() != ModoAlmacenamiento::BUFFER_POOL) {
+        return;
+    }
+    if (siguiente_proxima < proximas.size() && proximas[siguiente_proxima] == id_hoja) {
+        siguiente_proxima++;
+    } else {
+        proximas.clear();
+        siguiente_proxima = 0;
+    }
+    if (siguiente_proxima < proximas.size() || num_claves() == 0) {
+        return;
+    }
+
+    ventana = ventana == 0 ? HOJAS_PRECARGA_INICIAL : std::min(2 * ventana, HOJAS_PRECARGA_MAX);
+    arbol->hojas_siguientes(Hoja::claves(hoja.datos())[num_claves() - 1], ventana, proximas);
+    siguiente_proxima = 0;
+    arbol->paginador.precargar(proximas);
 }
 
-bool BPlusTree::insertar(DNI_t clave, RegistroID valor) {
-    if (id_raiz == INVALID_PAGE_ID) {
-        this->id_raiz = inicializar(INVALID_PAGE_ID);
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::Iterador::siguiente() {
+    posicion++;
+    saltar_hojas_agotadas();
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::Iterador::anterior() {
+    if (posicion > 0) {
+        posicion--;
+        return;
+    }
+    // Solo la raiz puede ser una hoja vacia, y entonces no hay a donde volver
+    if (num_claves() == 0) {
+        hoja.soltar();
+        return;
+    }
+    Clave primera = Hoja::claves(hoja.datos())[0];
+    hoja.soltar();
+    PaginaID id_anterior = arbol->buscar_hoja_anterior(primera);
+    if (id_anterior != INVALID_PAGE_ID) {
+        hoja = arbol->fijar(id_anterior);
+        posicion = num_claves() - 1;
+    }
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+auto BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::buscar_desde(Clave clave) -> Iterador {
+    PaginaFijada pagina = fijar(buscar_hoja(clave));
+    char* pagina_ptr = pagina.datos();
+    auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+
+    size_t pos = posicion_inferior(Hoja::claves(pagina_ptr), header->num_claves, clave);
+
+    // Si todas las claves de la hoja son menores, la primera mayor esta en la siguiente
+    Iterador iterador(this, std::move(pagina), static_cast<int>(pos));
+    iterador.saltar_hojas_agotadas();
+    return iterador;
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+auto BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::buscar_hasta(Clave clave) -> Iterador {
+    PaginaFijada pagina = fijar(buscar_hoja(clave));
+    char* pagina_ptr = pagina.datos();
+    auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+
+    size_t pos = posicion_superior(Hoja::claves(pagina_ptr), header->num_claves, clave);
+
+    // Parados justo despues de la ultima clave <= clave; anterior() retrocede (de hoja si hace falta)
+    Iterador iterador(this, std::move(pagina), static_cast<int>(pos));
+    iterador.anterior();
+    return iterador;
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+bool BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::insertar(Clave clave, Valor valor) {
+    return !insertar_si_no_existe(clave, valor).has_value();
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+std::optional<Valor> BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::insertar_si_no_existe(Clave clave, Valor valor) {
+    return insertar_o_reemplazar(clave, valor, SiExiste::DEJAR);
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+std::optional<Valor> BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::upsert(Clave clave, Valor valor) {
+    return insertar_o_reemplazar(clave, valor, SiExiste::REEMPLAZAR);
+}
+
+// Los DNIs nuevos llegan casi siempre en orden creciente: la clave suele ser mayor que todas
+// las del arbol y va al final de la ultima hoja, que tenemos anotada
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+std::optional<Valor> BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::insertar_o_reemplazar(Clave clave, Valor valor, SiExiste si_existe) {
+    if (agregar_al_final(clave, valor)) {
+        return std::nullopt;
+    }
+    std::optional<Valor> anterior;
+    if (insertar_sin_dividir(clave, valor, si_existe, anterior)) {
+        return anterior;
     }
 
-    auto resultado = insertar_en_nodo(id_raiz, clave, valor);
+    // Hay que dividir: se repite la insercion desde la raiz con la estructura para nosotros
+    CambioEstructura cambio(*this);
+    if (id_raiz == INVALID_PAGE_ID) {
+        inicializar(INVALID_PAGE_ID);
+    }
+    auto resultado = insertar_en_nodo(id_raiz, clave, valor, si_existe, anterior, true);
 
     if (resultado.has_value()) {
-        PaginaID nueva_raiz_id = paginador.alloc_pagina();
+        PaginaID nueva_raiz_id = paginador.alloc_pagina(id_raiz);
         if (nueva_raiz_id == INVALID_PAGE_ID) {
-            return false;
+            throw std::runtime_error("No se pudo asignar una pagina para la nueva raiz del B+ Tree.");
         }
-        char* nueva_raiz_ptr = paginador.get_pagina(nueva_raiz_id);
+        bloquear(nueva_raiz_id);
+        PaginaFijada nueva_raiz = fijar(nueva_raiz_id);
+        char* nueva_raiz_ptr = nueva_raiz.datos();
         auto header = reinterpret_cast<BPlusTreeHeader*>(nueva_raiz_ptr);
         header->tipo = TipoNodo::Interno;
         header->num_claves = 1;
 
         auto hijos = reinterpret_cast<PaginaID*>(nueva_raiz_ptr + sizeof(BPlusTreeHeader));
-        auto claves = reinterpret_cast<DNI_t*>(nueva_raiz_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+        auto claves = reinterpret_cast<Clave*>(nueva_raiz_ptr + Interno::OFFSET_CLAVES);
 
         hijos[0] = id_raiz;
         claves[0] = resultado->clave_promocionada;
         hijos[1] = resultado->id_nueva_pagina;
+        nueva_raiz.marcar_sucia();
 
-        id_raiz = nueva_raiz_id;
+        id_raiz.store(nueva_raiz_id, std::memory_order_release);
     }
 
-    return true;
+    return anterior;
 }
 
-std::optional<BPlusTree::ResultadoDivision> BPlusTree::insertar_en_nodo(PaginaID id_pagina, DNI_t clave, RegistroID valor) {
-    char* pagina_ptr = paginador.get_pagina(id_pagina);
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+bool BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::agregar_al_final(Clave clave, Valor valor) {
+    PaginaID id_hoja = hoja_derecha.load(std::memory_order_acquire);
+    if (id_hoja == INVALID_PAGE_ID) {
+        return false;
+    }
+    PaginaFijada pagina = fijar(id_hoja);
+    BloqueoLatch bloqueo(paginador.latch(id_hoja));
+    // Quien la divide o la libera la invalida con el latch tomado: si sigue anotada, sigue
+    // siendo la ultima
+    if (hoja_derecha.load(std::memory_order_relaxed) != id_hoja) {
+        return false;
+    }
+    char* pagina_ptr = pagina.datos();
     auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+    // Una hoja vacia solo puede ser la raiz, y ahi conviene bajar igual (es un solo nivel)
+    if (header->num_claves == 0 || header->num_claves == Hoja::MAX_CLAVES || !comparar(Hoja::claves(pagina_ptr)[header->num_claves - 1], clave)) {
+        return false;
+    }
+    Hoja::claves(pagina_ptr)[header->num_claves] = clave;
+    Hoja::valores(pagina_ptr)[header->num_claves] = ValorHoja<Valor>::guardar(valor);
+    header->num_claves++;
+    pagina.marcar_sucia();
+    return true;
+}
 
-    if (header->tipo == TipoNodo::Hoja) {
-        insertar_en_hoja(pagina_ptr, clave, valor);
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+bool BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::insertar_sin_dividir(Clave clave, Valor valor, SiExiste si_existe, std::optional<Valor>& anterior) {
+    if (id_raiz.load(std::memory_order_acquire) == INVALID_PAGE_ID) {
+        return false;
+    }
+    while (true) {
+        Bajada bajada;
+        if (!bajar_optimista(clave, bajada)) {
+            continue;
+        }
+        PaginaFijada pagina = fijar(bajada.id_hoja);
+        LatchOptimista& latch = paginador.latch(bajada.id_hoja);
+        // Si la hoja no cambio desde que la encontramos, sigue siendo la de la clave
+        if (!latch.subir(bajada.version)) {
+            continue;
+        }
 
-        if (header->num_claves > Hoja::MAX_CLAVES) {
-            PaginaID nueva_hoja_id = paginador.alloc_pagina();
-            if (nueva_hoja_id == INVALID_PAGE_ID) {
-                throw std::runtime_error("No se pudo asignar una nueva pagina para la division de hoja.");
+        char* pagina_ptr = pagina.datos();
+        auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+        size_t pos = posicion_inferior(Hoja::claves(pagina_ptr), header->num_claves, clave);
+        bool hecho = true;
+        if (pos < header->num_claves && iguales(Hoja::claves(pagina_ptr)[pos], clave)) {
+            anterior = ValorHoja<Valor>::leer(Hoja::valores(pagina_ptr)[pos]);
+            if (si_existe == SiExiste::REEMPLAZAR) {
+                Hoja::valores(pagina_ptr)[pos] = ValorHoja<Valor>::guardar(valor);
+                pagina.marcar_sucia();
             }
+        } else if (header->num_claves < Hoja::MAX_CLAVES) {
+            insertar_en_hoja(pagina_ptr, clave, valor);
+            pagina.marcar_sucia();
+            if (bajada.borde_derecho) {
+                hoja_derecha.store(bajada.id_hoja, std::memory_order_release);
+            }
+        } else {
+            hecho = false;
+        }
+        latch.desbloquear();
+        return hecho;
+    }
+}
 
-            // El remapeo invalida punteros previos, refrescamos antes de usarlos
-            pagina_ptr = paginador.get_pagina(id_pagina);
-            header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
-
-            char* nueva_pagina_ptr = paginador.get_pagina(nueva_hoja_id);
-            auto nuevo_header = reinterpret_cast<BPlusTreeHeader*>(nueva_pagina_ptr);
-            nuevo_header->tipo = TipoNodo::Hoja;
-
-            auto entradas = reinterpret_cast<Hoja::Entrada*>(pagina_ptr + sizeof(BPlusTreeHeader) + sizeof(PaginaID));
-            auto nuevas_entradas = reinterpret_cast<Hoja::Entrada*>(nueva_pagina_ptr + sizeof(BPlusTreeHeader) + sizeof(PaginaID));
-
-            size_t punto_medio = header->num_claves / 2;
-            DNI_t clave_promocionada = entradas[punto_medio].clave;
+// Fraccion de las entradas que quedan a la izquierda al dividir el ultimo nodo de un nivel
+// cuando la clave nueva va al final: con claves crecientes la izquierda ya no recibe mas, y
+// el 10% libre deja lugar para las que lleguen un poco fuera de orden
+constexpr size_t LLENADO_BORDE_DERECHO_PORCENTAJE = 90;
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+auto BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::insertar_en_nodo(PaginaID id_pagina, Clave clave, Valor valor, SiExiste si_existe, std::optional<Valor>& anterior, bool borde_derecho) -> std::optional<ResultadoDivision> {
+    // La pagina queda fijada mientras bajamos por el arbol: su puntero sigue valido despues
+    // de alloc_pagina y de la recursion (el mapeo no se mueve y el pool no desaloja frames fijados)
+    PaginaFijada pagina = fijar(id_pagina);
+    char* pagina_ptr = pagina.datos();
+    auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
 
-            std::copy(entradas + punto_medio, entradas + header->num_claves, nuevas_entradas);
-            nuevo_header->num_claves = header->num_claves - punto_medio;
-            header->num_claves = punto_medio;
+    if (header->tipo == TipoNodo::Hoja) {
+        // Las hojas cambian tambien por los caminos rapidos: bloquearla antes de leerla
+        bloquear(id_pagina);
+
+        // La clave ya esta: la misma bajada sirve para devolver su valor (y reemplazarlo)
+        size_t pos = posicion_inferior(Hoja::claves(pagina_ptr), header->num_claves, clave);
+        if (pos < header->num_claves && iguales(Hoja::claves(pagina_ptr)[pos], clave)) {
+            anterior = ValorHoja<Valor>::leer(Hoja::valores(pagina_ptr)[pos]);
+            if (si_existe == SiExiste::REEMPLAZAR) {
+                Hoja::valores(pagina_ptr)[pos] = ValorHoja<Valor>::guardar(valor);
+                pagina.marcar_sucia();
+            }
+            return std::nullopt;
+        }
 
-            auto sig_ptr = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
-            auto nuevo_sig_ptr = reinterpret_cast<PaginaID*>(nueva_pagina_ptr + sizeof(BPlusTreeHeader));
-            *nuevo_sig_ptr = *sig_ptr;
-            *sig_ptr = nueva_hoja_id;
+        if (borde_derecho) {
+            hoja_derecha.store(id_pagina, std::memory_order_release);
+        }
+        if (header->num_claves < Hoja::MAX_CLAVES) {
+            insertar_en_hoja(pagina_ptr, clave, valor);
+            pagina.marcar_sucia();
+            return std::nullopt;
+        }
 
-            return ResultadoDivision{clave_promocionada, nueva_hoja_id};
+        // Hoja llena: dividimos primero y despues insertamos en la mitad que corresponde.
+        // Insertar antes de dividir escribiria la entrada MAX_CLAVES + 1 fuera de la pagina.
+        // La nueva hoja cerca de la que se divide: un recorrido de hojas lee paginas vecinas
+        PaginaID nueva_hoja_id = paginador.alloc_pagina(id_pagina);
+        if (nueva_hoja_id == INVALID_PAGE_ID) {
+            throw std::runtime_error("No se pudo asignar una nueva pagina para la division de hoja.");
         }
-        return std::nullopt;
+        bloquear(nueva_hoja_id);
+
+        PaginaFijada nueva_pagina = fijar(nueva_hoja_id);
+        char* nueva_pagina_ptr = nueva_pagina.datos();
+        auto nuevo_header = reinterpret_cast<BPlusTreeHeader*>(nueva_pagina_ptr);
+        nuevo_header->tipo = TipoNodo::Hoja;
+
+        // Cuantas entradas quedan en la hoja izquierda contando la nueva
+        size_t punto_medio = (header->num_claves + 1) / 2;
+        bool al_final = borde_derecho && pos == header->num_claves;
+        if (al_final) {
+            punto_medio = header->num_claves * LLENADO_BORDE_DERECHO_PORCENTAJE / 100;
+        }
+        bool va_a_la_izquierda = pos < punto_medio;
+        size_t primera_movida = va_a_la_izquierda ? punto_medio - 1 : punto_medio;
+
+        mover_entradas(pagina_ptr, primera_movida, nueva_pagina_ptr, 0, header->num_claves - primera_movida);
+        nuevo_header->num_claves = header->num_claves - primera_movida;
+        header->num_claves = primera_movida;
+
+        insertar_en_hoja(va_a_la_izquierda ? pagina_ptr : nueva_pagina_ptr, clave, valor);
+        Clave clave_promocionada = Hoja::claves(nueva_pagina_ptr)[0];
+
+        auto sig_ptr = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+        auto nuevo_sig_ptr = reinterpret_cast<PaginaID*>(nueva_pagina_ptr + sizeof(BPlusTreeHeader));
+        *nuevo_sig_ptr = *sig_ptr;
+        *sig_ptr = nueva_hoja_id;
+        if (borde_derecho) {
+            hoja_derecha.store(nueva_hoja_id, std::memory_order_release);
+        }
+
+        pagina.marcar_sucia();
+        nueva_pagina.marcar_sucia();
+        return ResultadoDivision{clave_promocionada, nueva_hoja_id};
     }
 
     // NODO INTERNO
-    auto claves = reinterpret_cast<DNI_t*>(pagina_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+    auto claves = reinterpret_cast<Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
     auto hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
 
-    auto it = std::lower_bound(claves, claves + header->num_claves, clave);
+    auto it = claves + posicion_inferior(claves, header->num_claves, clave);
     size_t pos = std::distance(claves, it);
     PaginaID id_hijo;
 
-    if (it != claves + header->num_claves && *it == clave) {
+    if (it != claves + header->num_claves && iguales(*it, clave)) {
         id_hijo = hijos[pos + 1];
     } else {
         id_hijo = hijos[pos];
     }
 
-    auto resultado_division = insertar_en_nodo(id_hijo, clave, valor);
+    bool hijo_en_borde = borde_derecho && id_hijo == hijos[header->num_claves];
+    auto resultado_division = insertar_en_nodo(id_hijo, clave, valor, si_existe, anterior, hijo_en_borde);
 
-    if (resultado_division.has_value()) {
-        // El remapeo pudo ocurrir en el subarbol, refrescamos punteros antes de usarlos
-        pagina_ptr = paginador.get_pagina(id_pagina);
-        header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
-        claves = reinterpret_cast<DNI_t*>(pagina_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
-        hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+    if (!resultado_division.has_value()) {
+        return std::nullopt;
+    }
 
+    bloquear(id_pagina);
+    if (header->num_claves < Interno::MAX_CLAVES) {
         insertar_en_interno(pagina_ptr, resultado_division->clave_promocionada, resultado_division->id_nueva_pagina);
+        pagina.marcar_sucia();
+        return std::nullopt;
+    }
 
-        if (header->num_claves > Interno::MAX_CLAVES) {
-            PaginaID nueva_pagina_id = paginador.alloc_pagina();
-            if (nueva_pagina_id == INVALID_PAGE_ID) {
-                throw std::runtime_error("No se pudo asignar una nueva pagina para la division de nodo interno.");
-            }
+    // Nodo interno lleno. Con MAX_CLAVES + 1 claves el arreglo de hijos se pisaria con el de
+    // claves dentro de la pagina, asi que armamos el nodo combinado en buffers temporales.
+    PaginaID nueva_pagina_id = paginador.alloc_pagina(id_pagina);
+    if (nueva_pagina_id == INVALID_PAGE_ID) {
+        throw std::runtime_error("No se pudo asignar una nueva pagina para la division de nodo interno.");
+    }
+    bloquear(nueva_pagina_id);
 
-            // El remapeo invalida punteros previos, refrescamos antes de usarlos
-            pagina_ptr = paginador.get_pagina(id_pagina);
-            header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
-            claves = reinterpret_cast<DNI_t*>(pagina_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
-            hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+    Clave claves_tmp[Interno::MAX_CLAVES + 1];
+    PaginaID hijos_tmp[Interno::ORDEN + 1];
+    size_t total_claves = header->num_claves + 1;
 
-            char* nueva_pagina_ptr = paginador.get_pagina(nueva_pagina_id);
-            auto nuevo_header = reinterpret_cast<BPlusTreeHeader*>(nueva_pagina_ptr);
-            nuevo_header->tipo = TipoNodo::Interno;
+    auto it_tmp = claves + posicion_inferior(claves, header->num_claves, resultado_division->clave_promocionada);
+    size_t pos_tmp = std::distance(claves, it_tmp);
 
-            auto claves_viejas = reinterpret_cast<DNI_t*>(pagina_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
-            auto hijos_viejos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
-            auto nuevas_claves = reinterpret_cast<DNI_t*>(nueva_pagina_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
-            auto nuevos_hijos = reinterpret_cast<PaginaID*>(nueva_pagina_ptr + sizeof(BPlusTreeHeader));
+    std::copy(claves, claves + pos_tmp, claves_tmp);
+    claves_tmp[pos_tmp] = resultado_division->clave_promocionada;
+    std::copy(claves + pos_tmp, claves + header->num_claves, claves_tmp + pos_tmp + 1);
 
-            size_t punto_medio_idx = header->num_claves / 2;
-            DNI_t clave_promocionada = claves_viejas[punto_medio_idx];
+    std::copy(hijos, hijos + pos_tmp + 1, hijos_tmp);
+    hijos_tmp[pos_tmp + 1] = resultado_division->id_nueva_pagina;
+    std::copy(hijos + pos_tmp + 1, hijos + header->num_claves + 1, hijos_tmp + pos_tmp + 2);
 
-            std::copy(claves_viejas + punto_medio_idx + 1, claves_viejas + header->num_claves, nuevas_claves);
-            std::copy(hijos_viejos + punto_medio_idx + 1, hijos_viejos + header->num_claves + 1, nuevos_hijos);
+    PaginaFijada nueva_pagina = fijar(nueva_pagina_id);
+    char* nueva_pagina_ptr = nueva_pagina.datos();
+    auto nuevo_header = reinterpret_cast<BPlusTreeHeader*>(nueva_pagina_ptr);
+    nuevo_header->tipo = TipoNodo::Interno;
 
-            nuevo_header->num_claves = header->num_claves - punto_medio_idx - 1;
-            header->num_claves = punto_medio_idx;
+    auto nuevas_claves = reinterpret_cast<Clave*>(nueva_pagina_ptr + Interno::OFFSET_CLAVES);
+    auto nuevos_hijos = reinterpret_cast<PaginaID*>(nueva_pagina_ptr + sizeof(BPlusTreeHeader));
 
-            return ResultadoDivision{clave_promocionada, nueva_pagina_id};
-        }
+    size_t punto_medio_idx = total_claves / 2;
+    if (borde_derecho && pos_tmp == header->num_claves) {
+        punto_medio_idx = header->num_claves * LLENADO_BORDE_DERECHO_PORCENTAJE / 100;
     }
+    Clave clave_promocionada = claves_tmp[punto_medio_idx];
 
-    return std::nullopt;
+    // Izquierda: claves [0, punto_medio), la clave del medio sube al padre, derecha: el resto
+    std::copy(claves_tmp, claves_tmp + punto_medio_idx, claves);
+    std::copy(hijos_tmp, hijos_tmp + punto_medio_idx + 1, hijos);
+    header->num_claves = punto_medio_idx;
+
+    std::copy(claves_tmp + punto_medio_idx + 1, claves_tmp + total_claves, nuevas_claves);
+    std::copy(hijos_tmp + punto_medio_idx + 1, hijos_tmp + total_claves + 1, nuevos_hijos);
+    nuevo_header->num_claves = total_claves - punto_medio_idx - 1;
+
+    pagina.marcar_sucia();
+    nueva_pagina.marcar_sucia();
+    return ResultadoDivision{clave_promocionada, nueva_pagina_id};
 }
 
-void BPlusTree::insertar_en_hoja(char* pagina_ptr, DNI_t clave, RegistroID valor) {
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::insertar_en_hoja(char* pagina_ptr, Clave clave, Valor valor) {
     auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
-    auto entradas = reinterpret_cast<Hoja::Entrada*>(pagina_ptr + sizeof(BPlusTreeHeader) + sizeof(PaginaID));
-
-    auto it = std::lower_bound(entradas, entradas + header->num_claves, clave,
-        [](const Hoja::Entrada& a, DNI_t b) {
-            return a.clave < b;
-        });
 
-    size_t pos = std::distance(entradas, it);
+    size_t pos = posicion_inferior(Hoja::claves(pagina_ptr), header->num_claves, clave);
 
-    std::move_backward(entradas + pos, entradas + header->num_claves, entradas + header->num_claves + 1);
+    mover_entradas(pagina_ptr, pos, pagina_ptr, pos + 1, header->num_claves - pos);
 
-    entradas[pos] = {clave, valor};
+    Hoja::claves(pagina_ptr)[pos] = clave;
+    Hoja::valores(pagina_ptr)[pos] = ValorHoja<Valor>::guardar(valor);
     header->num_claves++;
 }
 
-void BPlusTree::insertar_en_interno(char* pagina_ptr, DNI_t clave, PaginaID id_hijo_derecho) {
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::insertar_en_interno(char* pagina_ptr, Clave clave, PaginaID id_hijo_derecho) {
     auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
-    auto claves = reinterpret_cast<DNI_t*>(pagina_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+    auto claves = reinterpret_cast<Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
     auto hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
 
-    auto it = std::lower_bound(claves, claves + header->num_claves, clave);
+    auto it = claves + posicion_inferior(claves, header->num_claves, clave);
     size_t pos = std::distance(claves, it);
 
     std::move_backward(claves + pos, claves + header->num_claves, claves + header->num_claves + 1);
@@ -233,48 +1096,320 @@ void BPlusTree::insertar_en_interno(char* pagina_ptr, DNI_t clave, PaginaID id_h
     header->num_claves++;
 }
 
-bool BPlusTree::eliminar(DNI_t clave) {
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+size_t BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::insertar_lote(const std::vector<std::pair<Clave, Valor>>& entradas) {
+    for (size_t i = 1; i < entradas.size(); i++) {
+        if (comparar(entradas[i].first, entradas[i - 1].first)) {
+            throw std::runtime_error("insertar_lote necesita las entradas ordenadas por clave.");
+        }
+    }
+    if (entradas.empty()) {
+        return 0;
+    }
+    CambioEstructura cambio(*this);
     if (id_raiz == INVALID_PAGE_ID) {
-        return false;
+        inicializar(INVALID_PAGE_ID);
+    }
+
+    size_t insertadas = 0;
+    auto divisiones = insertar_lote_en_nodo(id_raiz, entradas.data(), entradas.size(), insertadas);
+
+    // La raiz se dividio: una raiz nueva, con la anterior como unico hijo, recibe las
+    // divisiones como cualquier interno (y si son mas de las que entran, se divide otra vez)
+    while (!divisiones.empty()) {
+        PaginaID nueva_raiz_id = paginador.alloc_pagina(id_raiz);
+        if (nueva_raiz_id == INVALID_PAGE_ID) {
+            throw std::runtime_error("No se pudo asignar una pagina para la nueva raiz del B+ Tree.");
+        }
+        bloquear(nueva_raiz_id);
+        PaginaFijada nueva_raiz = fijar(nueva_raiz_id);
+        auto header = reinterpret_cast<BPlusTreeHeader*>(nueva_raiz.datos());
+        header->tipo = TipoNodo::Interno;
+        header->num_claves = 0;
+        reinterpret_cast<PaginaID*>(nueva_raiz.datos() + sizeof(BPlusTreeHeader))[0] = id_raiz;
+
+        divisiones = agregar_divisiones(nueva_raiz, divisiones);
+        id_raiz.store(nueva_raiz_id, std::memory_order_release);
+    }
+    return insertadas;
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+auto BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::insertar_lote_en_nodo(PaginaID id_pagina, const std::pair<Clave, Valor>* entradas, size_t n, size_t& insertadas) -> std::vector<ResultadoDivision> {
+    // Como en insertar_en_nodo, la pagina queda fijada mientras se procesan los hijos
+    PaginaFijada pagina = fijar(id_pagina);
+    char* pagina_ptr = pagina.datos();
+    auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+    if (header->tipo == TipoNodo::Hoja) {
+        bloquear(id_pagina); // Antes de leer num_claves: la cambian tambien los caminos rapidos
+    }
+    size_t num_claves = header->num_claves;
+
+    if (header->tipo == TipoNodo::Hoja) {
+        // Mezcla de las entradas de la hoja con las del lote. A igual clave va primero la de
+        // la hoja, y la del lote se descarta por repetida.
+        const Clave* claves_hoja = Hoja::claves(pagina_ptr);
+        const Guardado* valores_hoja = Hoja::valores(pagina_ptr);
+        std::vector<Clave> claves;
+        std::vector<Guardado> valores;
+        claves.reserve(num_claves + n);
+        valores.reserve(num_claves + n);
+
+        size_t nuevas = 0;
+        for (size_t i = 0, j = 0; i < num_claves || j < n; ) {
+            if (j == n || (i < num_claves && !comparar(entradas[j].first, claves_hoja[i]))) {
+                claves.push_back(claves_hoja[i]);
+                valores.push_back(valores_hoja[i]);
+                i++;
+            } else {
+                if (claves.empty() || !iguales(claves.back(), entradas[j].first)) {
+                    claves.push_back(entradas[j].first);
+                    valores.push_back(ValorHoja<Valor>::guardar(entradas[j].second));
+                    nuevas++;
+                }
+                j++;
+            }
+        }
+        if (nuevas == 0) {
+            return {};
+        }
+        insertadas += nuevas;
+        return repartir_hoja(pagina, claves, valores);
+    }
+
+    // NODO INTERNO: cada hijo recibe de una vez el tramo de entradas que cae en el
+    auto claves = reinterpret_cast<Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
+    auto hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+
+    std::vector<ResultadoDivision> divisiones;
+    for (size_t j = 0; j < n; ) {
+        size_t pos = posicion_superior(claves, num_claves, entradas[j].first);
+        size_t fin = n;
+        if (pos < num_claves) {
+            // Hasta la primera entrada >= la clave que separa este hijo del siguiente
+            fin = std::lower_bound(entradas + j, entradas + n, claves[pos], [this](const std::pair<Clave, Valor>& entrada, const Clave& clave) {
+                return comparar(entrada.first, clave);
+            }) - entradas;
+        }
+        auto divisiones_hijo = insertar_lote_en_nodo(hijos[pos], entradas + j, fin - j, insertadas);
+        divisiones.insert(divisiones.end(), divisiones_hijo.begin(), divisiones_hijo.end());
+        j = fin;
+    }
+
+    if (divisiones.empty()) {
+        return {};
+    }
+    return agregar_divisiones(pagina, divisiones);
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+auto BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::agregar_divisiones(PaginaFijada& pagina, const std::vector<ResultadoDivision>& divisiones) -> std::vector<ResultadoDivision> {
+    bloquear(pagina.id());
+    char* pagina_ptr = pagina.datos();
+    auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+    auto claves_nodo = reinterpret_cast<Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
+    auto hijos_nodo = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+    size_t num_claves = header->num_claves;
+
+    // Cada clave va seguida del hijo a su derecha: la clave promocionada de una division es
+    // mayor que la que separa al hijo dividido de su izquierdo y menor que la siguiente, asi
+    // que basta mezclar por clave
+    std::vector<Clave> claves;
+    std::vector<PaginaID> hijos = {hijos_nodo[0]};
+    claves.reserve(num_claves + divisiones.size());
+    hijos.reserve(num_claves + divisiones.size() + 1);
+    for (size_t i = 0, j = 0; i < num_claves || j < divisiones.size(); ) {
+        if (j == divisiones.size() || (i < num_claves && comparar(claves_nodo[i], divisiones[j].clave_promocionada))) {
+            claves.push_back(claves_nodo[i]);
+            hijos.push_back(hijos_nodo[i + 1]);
+            i++;
+        } else {
+            claves.push_back(divisiones[j].clave_promocionada);
+            hijos.push_back(divisiones[j].id_nueva_pagina);
+            j++;
+        }
+    }
+    return repartir_interno(pagina, claves, hijos);
+}
+
+// Con total > MAX_CLAVES * (partes - 1), cada parte queda con mas de MAX_CLAVES / 2 entradas
+// (o hijos, en los internos): ninguna arranca por debajo del minimo de eliminar
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+auto BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::repartir_hoja(PaginaFijada& pagina, const std::vector<Clave>& claves, const std::vector<Guardado>& valores) -> std::vector<ResultadoDivision> {
+    size_t total = claves.size();
+    size_t partes = std::max<size_t>(1, (total + Hoja::MAX_CLAVES - 1) / Hoja::MAX_CLAVES);
+    PaginaID siguiente_original = *reinterpret_cast<PaginaID*>(pagina.datos() + sizeof(BPlusTreeHeader));
+    if (partes > 1) {
+        // Si era la de mas a la derecha deja de serlo. Tenemos su latch (ver agregar_al_final).
+        PaginaID esperada = pagina.id();
+        hoja_derecha.compare_exchange_strong(esperada, INVALID_PAGE_ID);
+    }
+
+    std::vector<ResultadoDivision> divisiones;
+    PaginaFijada fijada_anterior; // Las partes nuevas quedan fijadas hasta encadenar la siguiente
+    char* anterior_ptr = nullptr;
+    PaginaID anterior_id = pagina.id();
+    for (size_t parte = 0, desde = 0; parte < partes; parte++) {
+        size_t hasta = total * (parte + 1) / partes;
+        PaginaFijada actual;
+        char* destino = pagina.datos();
+        PaginaID actual_id = pagina.id();
+        if (parte > 0) {
+            // Cada hoja nueva cerca de la anterior: un recorrido de hojas lee paginas vecinas
+            actual_id = paginador.alloc_pagina(anterior_id);
+            if (actual_id == INVALID_PAGE_ID) {
+                throw std::runtime_error("No se pudo asignar una nueva pagina para la division de hoja.");
+            }
+            bloquear(actual_id);
+            actual = fijar(actual_id);
+            destino = actual.datos();
+            reinterpret_cast<BPlusTreeHeader*>(destino)->tipo = TipoNodo::Hoja;
+            *reinterpret_cast<PaginaID*>(anterior_ptr + sizeof(BPlusTreeHeader)) = actual_id;
+            divisiones.push_back(ResultadoDivision{claves[desde], actual_id});
+            actual.marcar_sucia();
+        }
+
+        reinterpret_cast<BPlusTreeHeader*>(destino)->num_claves = static_cast<uint16_t>(hasta - desde);
+        std::copy(claves.begin() + desde, claves.begin() + hasta, Hoja::claves(destino));
+        std::copy(valores.begin() + desde, valores.begin() + hasta, Hoja::valores(destino));
+        *reinterpret_cast<PaginaID*>(destino + sizeof(BPlusTreeHeader)) = siguiente_original; // Hasta que haya otra parte
+
+        anterior_ptr = destino;
+        anterior_id = actual_id;
+        fijada_anterior = std::move(actual);
+        desde = hasta;
     }
-    eliminar_interno(id_raiz, clave, INVALID_PAGE_ID, -1);
+    pagina.marcar_sucia();
+    return divisiones;
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+auto BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::repartir_interno(PaginaFijada& pagina, const std::vector<Clave>& claves, const std::vector<PaginaID>& hijos) -> std::vector<ResultadoDivision> {
+    size_t total = hijos.size();
+    size_t partes = std::max<size_t>(1, (total + Interno::ORDEN - 1) / Interno::ORDEN);
+
+    std::vector<ResultadoDivision> divisiones;
+    for (size_t parte = 0, desde = 0; parte < partes; parte++) {
+        size_t hasta = total * (parte + 1) / partes;
+        PaginaFijada actual;
+        char* destino = pagina.datos();
+        if (parte > 0) {
+            // La clave entre el ultimo hijo de la parte anterior y el primero de esta sube al padre
+            PaginaID actual_id = paginador.alloc_pagina(pagina.id());
+            if (actual_id == INVALID_PAGE_ID) {
+                throw std::runtime_error("No se pudo asignar una nueva pagina para la division de nodo interno.");
+            }
+            bloquear(actual_id);
+            actual = fijar(actual_id);
+            destino = actual.datos();
+            reinterpret_cast<BPlusTreeHeader*>(destino)->tipo = TipoNodo::Interno;
+            divisiones.push_back(ResultadoDivision{claves[desde - 1], actual_id});
+            actual.marcar_sucia();
+        }
+
+        reinterpret_cast<BPlusTreeHeader*>(destino)->num_claves = static_cast<uint16_t>(hasta - desde - 1);
+        std::copy(hijos.begin() + desde, hijos.begin() + hasta, reinterpret_cast<PaginaID*>(destino + sizeof(BPlusTreeHeader)));
+        std::copy(claves.begin() + desde, claves.begin() + hasta - 1, reinterpret_cast<Clave*>(destino + Interno::OFFSET_CLAVES));
+        desde = hasta;
+    }
+    pagina.marcar_sucia();
+    return divisiones;
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+bool BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::eliminar(Clave clave) {
+    return eliminar_y_devolver(clave).has_value();
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+std::optional<Valor> BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::eliminar_y_devolver(Clave clave) {
+    if (id_raiz.load(std::memory_order_acquire) == INVALID_PAGE_ID) {
+        return std::nullopt;
+    }
+    std::optional<Valor> eliminado;
+    if (eliminar_sin_fusionar(clave, eliminado)) {
+        return eliminado;
+    }
+
+    // La hoja queda por debajo del minimo: se repite desde la raiz con la estructura para nosotros
+    CambioEstructura cambio(*this);
+    eliminar_interno(id_raiz, clave, INVALID_PAGE_ID, -1, eliminado);
 
     // Si la raiz queda vacia despues de una fusion, la eliminamos
     // y la nueva raiz es su unico hijo.
-    char* raiz_ptr = paginador.get_pagina(id_raiz);
+    PaginaFijada raiz = fijar(id_raiz);
+    char* raiz_ptr = raiz.datos();
     auto header_raiz = reinterpret_cast<BPlusTreeHeader*>(raiz_ptr);
     if (header_raiz->tipo == TipoNodo::Interno && header_raiz->num_claves == 0) {
         auto hijos_raiz = reinterpret_cast<PaginaID*>(raiz_ptr + sizeof(BPlusTreeHeader));
         PaginaID nueva_raiz_id = hijos_raiz[0];
+        bloquear(id_raiz);
+        cache.olvidar(id_raiz);
         paginador.liberar_pagina(id_raiz);
-        id_raiz = nueva_raiz_id;
+        id_raiz.store(nueva_raiz_id, std::memory_order_release);
     }
 
-    return true;
+    return eliminado;
 }
 
-void BPlusTree::eliminar_interno(PaginaID id_pagina, DNI_t clave, PaginaID id_padre, int indice_en_padre) {
-    char* pagina_ptr = paginador.get_pagina(id_pagina);
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+bool BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::eliminar_sin_fusionar(Clave clave, std::optional<Valor>& eliminado) {
+    while (true) {
+        Bajada bajada;
+        if (!bajar_optimista(clave, bajada)) {
+            continue;
+        }
+        PaginaFijada pagina = fijar(bajada.id_hoja);
+        LatchOptimista& latch = paginador.latch(bajada.id_hoja);
+        if (!latch.subir(bajada.version)) {
+            continue;
+        }
+
+        char* pagina_ptr = pagina.datos();
+        auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
+        size_t pos = posicion_inferior(Hoja::claves(pagina_ptr), header->num_claves, clave);
+        bool hecho = true;
+        if (pos < header->num_claves && iguales(Hoja::claves(pagina_ptr)[pos], clave)) {
+            // La raiz puede quedar con cualquier cantidad
+            if (bajada.es_raiz || header->num_claves - 1 >= Hoja::MAX_CLAVES / 2) {
+                eliminado = ValorHoja<Valor>::leer(Hoja::valores(pagina_ptr)[pos]);
+                mover_entradas(pagina_ptr, pos + 1, pagina_ptr, pos, header->num_claves - pos - 1);
+                header->num_claves--;
+                pagina.marcar_sucia();
+            } else {
+                hecho = false;
+            }
+        }
+        latch.desbloquear();
+        return hecho;
+    }
+}
+
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::eliminar_interno(PaginaID id_pagina, Clave clave, PaginaID id_padre, int indice_en_padre, std::optional<Valor>& eliminado) {
+    PaginaFijada pagina = fijar(id_pagina);
+    char* pagina_ptr = pagina.datos();
     auto header = reinterpret_cast<BPlusTreeHeader*>(pagina_ptr);
 
     if (header->tipo == TipoNodo::Hoja) {
-        auto entradas = reinterpret_cast<Hoja::Entrada*>(pagina_ptr + sizeof(BPlusTreeHeader) + sizeof(PaginaID));
-        auto it = std::lower_bound(entradas, entradas + header->num_claves, clave, [](const Hoja::Entrada& a, DNI_t b) { return a.clave < b; });
+        bloquear(id_pagina);
+        auto claves = Hoja::claves(pagina_ptr);
+        size_t pos = posicion_inferior(claves, header->num_claves, clave);
 
-        if (it == entradas + header->num_claves || it->clave != clave) {
+        if (pos == header->num_claves || !iguales(claves[pos], clave)) {
             return; // La clave no existe
         }
+        eliminado = ValorHoja<Valor>::leer(Hoja::valores(pagina_ptr)[pos]);
 
-        size_t pos = std::distance(entradas, it);
-        std::move(entradas + pos + 1, entradas + header->num_claves, entradas + pos);
+        mover_entradas(pagina_ptr, pos + 1, pagina_ptr, pos, header->num_claves - pos - 1);
         header->num_claves--;
+        pagina.marcar_sucia();
 
     } else { // Nodo Interno
-        auto claves = reinterpret_cast<DNI_t*>(pagina_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+        auto claves = reinterpret_cast<Clave*>(pagina_ptr + Interno::OFFSET_CLAVES);
         auto hijos = reinterpret_cast<PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
-        auto it = std::upper_bound(claves, claves + header->num_claves, clave);
-        size_t pos = std::distance(claves, it);
-        eliminar_interno(hijos[pos], clave, id_pagina, static_cast<int>(pos));
+        size_t pos = posicion_superior(claves, header->num_claves, clave);
+        eliminar_interno(hijos[pos], clave, id_pagina, static_cast<int>(pos), eliminado);
     }
 
     // Verificar underflow (solo si no es la raiz)
@@ -288,12 +1423,22 @@ void BPlusTree::eliminar_interno(PaginaID id_pagina, DNI_t clave, PaginaID id_pa
     if (!info_hermano_opt.has_value()) return; // No deberia pasar si no es la raiz
 
     auto info_hermano = info_hermano_opt.value();
-    char* padre_ptr = paginador.get_pagina(id_padre);
-    char* hermano_ptr = paginador.get_pagina(info_hermano.id);
+    bloquear(id_padre);
+    bloquear(info_hermano.id);
+    bloquear(id_pagina);
+    PaginaFijada padre = fijar(id_padre);
+    PaginaFijada hermano = fijar(info_hermano.id);
+    char* padre_ptr = padre.datos();
+    char* hermano_ptr = hermano.datos();
     auto header_hermano = reinterpret_cast<BPlusTreeHeader*>(hermano_ptr);
 
     size_t min_hermano = (header_hermano->tipo == TipoNodo::Hoja) ? (Hoja::MAX_CLAVES / 2) : (Interno::MAX_CLAVES / 2);
 
+    // Redistribuir y fusionar modifican las tres paginas
+    pagina.marcar_sucia();
+    padre.marcar_sucia();
+    hermano.marcar_sucia();
+
     if (header_hermano->num_claves > min_hermano) {
         // Redistribucion
         if (header->tipo == TipoNodo::Hoja) {
@@ -305,16 +1450,23 @@ void BPlusTree::eliminar_interno(PaginaID id_pagina, DNI_t clave, PaginaID id_pa
         // Fusion
         if (header->tipo == TipoNodo::Hoja) {
             fusionar_hojas(hermano_ptr, pagina_ptr, info_hermano.direccion, padre_ptr, info_hermano.indice_en_padre);
-            paginador.liberar_pagina(info_hermano.direccion == DireccionHermano::Derecho ? info_hermano.id : id_pagina);
+            PaginaID liberada = info_hermano.direccion == DireccionHermano::Derecho ? info_hermano.id : id_pagina;
+            PaginaID anotada = liberada;
+            hoja_derecha.compare_exchange_strong(anotada, INVALID_PAGE_ID); // Tenemos su latch
+            paginador.liberar_pagina(liberada);
         } else {
             fusionar_internos(hermano_ptr, pagina_ptr, info_hermano.direccion, padre_ptr, info_hermano.indice_en_padre);
-            paginador.liberar_pagina(info_hermano.direccion == DireccionHermano::Derecho ? info_hermano.id : id_pagina);
+            PaginaID liberada = info_hermano.direccion == DireccionHermano::Derecho ? info_hermano.id : id_pagina;
+            cache.olvidar(liberada);
+            paginador.liberar_pagina(liberada);
         }
     }
 }
 
-std::optional<BPlusTree::InfoHermano> BPlusTree::buscar_hermano(PaginaID id_padre, int indice_en_padre) {
-    char* padre_ptr = paginador.get_pagina(id_padre);
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+auto BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::buscar_hermano(PaginaID id_padre, int indice_en_padre) -> std::optional<InfoHermano> {
+    PaginaFijada padre = fijar(id_padre);
+    char* padre_ptr = padre.datos();
     auto header_padre = reinterpret_cast<BPlusTreeHeader*>(padre_ptr);
     auto hijos = reinterpret_cast<PaginaID*>(padre_ptr + sizeof(BPlusTreeHeader));
 
@@ -327,45 +1479,41 @@ std::optional<BPlusTree::InfoHermano> BPlusTree::buscar_hermano(PaginaID id_padr
     return std::nullopt;
 }
 
-void BPlusTree::redistribuir_hojas(char* pagina_hermano_ptr, char* pagina_actual_ptr, DireccionHermano direccion, char* pagina_padre_ptr, int indice_padre) {
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::redistribuir_hojas(char* pagina_hermano_ptr, char* pagina_actual_ptr, DireccionHermano direccion, char* pagina_padre_ptr, int indice_padre) {
     auto header_actual = reinterpret_cast<BPlusTreeHeader*>(pagina_actual_ptr);
     auto header_hermano = reinterpret_cast<BPlusTreeHeader*>(pagina_hermano_ptr);
-    auto entradas_actuales = reinterpret_cast<Hoja::Entrada*>(pagina_actual_ptr + sizeof(BPlusTreeHeader) + sizeof(PaginaID));
-    auto entradas_hermano = reinterpret_cast<Hoja::Entrada*>(pagina_hermano_ptr + sizeof(BPlusTreeHeader) + sizeof(PaginaID));
-    auto claves_padre = reinterpret_cast<DNI_t*>(pagina_padre_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+    auto claves_padre = reinterpret_cast<Clave*>(pagina_padre_ptr + Interno::OFFSET_CLAVES);
 
     if (direccion == DireccionHermano::Izquierdo) { // Hermano a la izquierda
         // Mover la ultima entrada del hermano al principio del nodo actual
-        Hoja::Entrada& entrada_prestada = entradas_hermano[header_hermano->num_claves - 1];
-        std::move_backward(entradas_actuales, entradas_actuales + header_actual->num_claves, entradas_actuales + header_actual->num_claves + 1);
-        entradas_actuales[0] = entrada_prestada;
+        mover_entradas(pagina_actual_ptr, 0, pagina_actual_ptr, 1, header_actual->num_claves);
+        mover_entradas(pagina_hermano_ptr, header_hermano->num_claves - 1, pagina_actual_ptr, 0, 1);
         header_hermano->num_claves--;
         header_actual->num_claves++;
         // Actualizar clave en el padre
-        claves_padre[indice_padre] = entradas_actuales[0].clave;
+        claves_padre[indice_padre] = Hoja::claves(pagina_actual_ptr)[0];
     } else { // Hermano a la derecha
         // Mover la primera entrada del hermano al final del nodo actual
-        Hoja::Entrada& entrada_prestada = entradas_hermano[0];
-        entradas_actuales[header_actual->num_claves] = entrada_prestada;
-        std::move(entradas_hermano + 1, entradas_hermano + header_hermano->num_claves, entradas_hermano);
+        mover_entradas(pagina_hermano_ptr, 0, pagina_actual_ptr, header_actual->num_claves, 1);
+        mover_entradas(pagina_hermano_ptr, 1, pagina_hermano_ptr, 0, header_hermano->num_claves - 1);
         header_hermano->num_claves--;
         header_actual->num_claves++;
         // Actualizar clave en el padre
-        claves_padre[indice_padre] = entradas_hermano[0].clave;
+        claves_padre[indice_padre] = Hoja::claves(pagina_hermano_ptr)[0];
     }
 }
 
-void BPlusTree::fusionar_hojas(char* pagina_hermano_ptr, char* pagina_actual_ptr, DireccionHermano direccion, char* pagina_padre_ptr, int indice_padre) {
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::fusionar_hojas(char* pagina_hermano_ptr, char* pagina_actual_ptr, DireccionHermano direccion, char* pagina_padre_ptr, int indice_padre) {
     char* nodo_izq_ptr = (direccion == DireccionHermano::Izquierdo) ? pagina_hermano_ptr : pagina_actual_ptr;
     char* nodo_der_ptr = (direccion == DireccionHermano::Izquierdo) ? pagina_actual_ptr : pagina_hermano_ptr;
 
     auto header_izq = reinterpret_cast<BPlusTreeHeader*>(nodo_izq_ptr);
     auto header_der = reinterpret_cast<BPlusTreeHeader*>(nodo_der_ptr);
-    auto entradas_izq = reinterpret_cast<Hoja::Entrada*>(nodo_izq_ptr + sizeof(BPlusTreeHeader) + sizeof(PaginaID));
-    auto entradas_der = reinterpret_cast<Hoja::Entrada*>(nodo_der_ptr + sizeof(BPlusTreeHeader) + sizeof(PaginaID));
 
     // Copiar todas las entradas del nodo derecho al final del nodo izquierdo
-    std::copy(entradas_der, entradas_der + header_der->num_claves, entradas_izq + header_izq->num_claves);
+    mover_entradas(nodo_der_ptr, 0, nodo_izq_ptr, header_izq->num_claves, header_der->num_claves);
     header_izq->num_claves += header_der->num_claves;
 
     // Actualizar puntero de la lista enlazada de hojas
@@ -374,7 +1522,7 @@ void BPlusTree::fusionar_hojas(char* pagina_hermano_ptr, char* pagina_actual_ptr
     *sig_ptr_izq = *sig_ptr_der;
 
     // Eliminar la clave y el puntero del padre
-    auto claves_padre = reinterpret_cast<DNI_t*>(pagina_padre_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+    auto claves_padre = reinterpret_cast<Clave*>(pagina_padre_ptr + Interno::OFFSET_CLAVES);
     auto hijos_padre = reinterpret_cast<PaginaID*>(pagina_padre_ptr + sizeof(BPlusTreeHeader));
     auto header_padre = reinterpret_cast<BPlusTreeHeader*>(pagina_padre_ptr);
 
@@ -383,14 +1531,15 @@ void BPlusTree::fusionar_hojas(char* pagina_hermano_ptr, char* pagina_actual_ptr
     header_padre->num_claves--;
 }
 
-void BPlusTree::redistribuir_internos(char* pagina_hermano_ptr, char* pagina_actual_ptr, DireccionHermano direccion, char* pagina_padre_ptr, int indice_padre) {
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::redistribuir_internos(char* pagina_hermano_ptr, char* pagina_actual_ptr, DireccionHermano direccion, char* pagina_padre_ptr, int indice_padre) {
     auto header_actual = reinterpret_cast<BPlusTreeHeader*>(pagina_actual_ptr);
     auto header_hermano = reinterpret_cast<BPlusTreeHeader*>(pagina_hermano_ptr);
-    auto claves_actuales = reinterpret_cast<DNI_t*>(pagina_actual_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+    auto claves_actuales = reinterpret_cast<Clave*>(pagina_actual_ptr + Interno::OFFSET_CLAVES);
     auto hijos_actuales = reinterpret_cast<PaginaID*>(pagina_actual_ptr + sizeof(BPlusTreeHeader));
-    auto claves_hermano = reinterpret_cast<DNI_t*>(pagina_hermano_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+    auto claves_hermano = reinterpret_cast<Clave*>(pagina_hermano_ptr + Interno::OFFSET_CLAVES);
     auto hijos_hermano = reinterpret_cast<PaginaID*>(pagina_hermano_ptr + sizeof(BPlusTreeHeader));
-    auto claves_padre = reinterpret_cast<DNI_t*>(pagina_padre_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+    auto claves_padre = reinterpret_cast<Clave*>(pagina_padre_ptr + Interno::OFFSET_CLAVES);
 
     if (direccion == DireccionHermano::Izquierdo) {
         // Mover clave del padre al inicio del nodo actual
@@ -425,17 +1574,18 @@ void BPlusTree::redistribuir_internos(char* pagina_hermano_ptr, char* pagina_act
     }
 }
 
-void BPlusTree::fusionar_internos(char* pagina_hermano_ptr, char* pagina_actual_ptr, DireccionHermano direccion, char* pagina_padre_ptr, int indice_padre) {
+template <typename Clave, typename Valor, size_t TAM_PAGINA, typename Comparar>
+void BPlusTreeGenerico<Clave, Valor, TAM_PAGINA, Comparar>::fusionar_internos(char* pagina_hermano_ptr, char* pagina_actual_ptr, DireccionHermano direccion, char* pagina_padre_ptr, int indice_padre) {
     char* nodo_izq_ptr = (direccion == DireccionHermano::Izquierdo) ? pagina_hermano_ptr : pagina_actual_ptr;
     char* nodo_der_ptr = (direccion == DireccionHermano::Izquierdo) ? pagina_actual_ptr : pagina_hermano_ptr;
 
     auto header_izq = reinterpret_cast<BPlusTreeHeader*>(nodo_izq_ptr);
     auto header_der = reinterpret_cast<BPlusTreeHeader*>(nodo_der_ptr);
-    auto claves_izq = reinterpret_cast<DNI_t*>(nodo_izq_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+    auto claves_izq = reinterpret_cast<Clave*>(nodo_izq_ptr + Interno::OFFSET_CLAVES);
     auto hijos_izq = reinterpret_cast<PaginaID*>(nodo_izq_ptr + sizeof(BPlusTreeHeader));
-    auto claves_der = reinterpret_cast<DNI_t*>(nodo_der_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+    auto claves_der = reinterpret_cast<Clave*>(nodo_der_ptr + Interno::OFFSET_CLAVES);
     auto hijos_der = reinterpret_cast<PaginaID*>(nodo_der_ptr + sizeof(BPlusTreeHeader));
-    auto claves_padre = reinterpret_cast<DNI_t*>(pagina_padre_ptr + sizeof(BPlusTreeHeader) + Interno::ORDEN * sizeof(PaginaID));
+    auto claves_padre = reinterpret_cast<Clave*>(pagina_padre_ptr + Interno::OFFSET_CLAVES);
     auto hijos_padre = reinterpret_cast<PaginaID*>(pagina_padre_ptr + sizeof(BPlusTreeHeader));
     auto header_padre = reinterpret_cast<BPlusTreeHeader*>(pagina_padre_ptr);
 
@@ -453,3 +1603,11 @@ void BPlusTree::fusionar_internos(char* pagina_hermano_ptr, char* pagina_actual_
     std::move(hijos_padre + indice_padre + 2, hijos_padre + header_padre->num_claves + 1, hijos_padre + indice_padre + 1);
     header_padre->num_claves--;
 }
+
+// Las variantes que se compilan. Otra combinacion de clave, valor y tamaño de pagina se agrega aca.
+template class BPlusTreeGenerico<DNI_t, RegistroID, PAGINA_SIZE>;
+template class BPlusTreeGenerico<DNI_t, RegistroID, 4 * PAGINA_SIZE>;
+template class BPlusTreeGenerico<DNI_t, RegistroID, 16 * PAGINA_SIZE>;
+template class BPlusTreeGenerico<uint64_t, RegistroID, PAGINA_SIZE>;
+template class BPlusTreeGenerico<uint64_t, RegistroID, 4 * PAGINA_SIZE>;
+template class BPlusTreeGenerico<uint64_t, RegistroID, 16 * PAGINA_SIZE>;
@@ -0,0 +1,825 @@
+#include "index/bplustree_cadenas.hpp"
+#include "core/latch_optimista.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+static_assert(sizeof(NodoCadenasHeader) == 16, "NodoCadenasHeader no debe tener relleno");
+static_assert(sizeof(SlotCadena) == 8, "SlotCadena no debe tener relleno");
+static_assert(PAGINA_SIZE <= UINT16_MAX + 1, "Los offsets de los nodos son de 16 bits");
+
+// === Formato de los nodos ===
+
+static NodoCadenasHeader* header_de(char* pagina_ptr) {
+    return reinterpret_cast<NodoCadenasHeader*>(pagina_ptr);
+}
+
+static const NodoCadenasHeader* header_de(const char* pagina_ptr) {
+    return reinterpret_cast<const NodoCadenasHeader*>(pagina_ptr);
+}
+
+static const char* prefijo_de(const char* pagina_ptr) {
+    return pagina_ptr + sizeof(NodoCadenasHeader);
+}
+
+// Los slots empiezan despues del prefijo, alineados para leer la cabeza
+static size_t inicio_slots(size_t size_prefijo) {
+    return (sizeof(NodoCadenasHeader) + size_prefijo + alignof(SlotCadena) - 1) & ~(alignof(SlotCadena) - 1);
+}
+
+static SlotCadena* slots_de(char* pagina_ptr) {
+    return reinterpret_cast<SlotCadena*>(pagina_ptr + inicio_slots(header_de(pagina_ptr)->size_prefijo));
+}
+
+static const SlotCadena* slots_de(const char* pagina_ptr) {
+    return reinterpret_cast<const SlotCadena*>(pagina_ptr + inicio_slots(header_de(pagina_ptr)->size_prefijo));
+}
+
+// Bytes que ocupa en el nodo el valor de una entrada: el hijo en los internos, y en las hojas
+// el valor, precedido por su largo con ValorCadenas::BYTES
+static size_t size_valor_en_nodo(TipoNodo tipo, bool con_largo, size_t size_valor) {
+    if (tipo == TipoNodo::Interno) {
+        return sizeof(PaginaID);
+    }
+    return (con_largo ? sizeof(uint16_t) : 0) + size_valor;
+}
+
+static size_t espacio_libre(const char* pagina_ptr) {
+    const NodoCadenasHeader* header = header_de(pagina_ptr);
+    size_t fin_slots = inicio_slots(header->size_prefijo) + header->num_claves * sizeof(SlotCadena);
+    return header->inicio_entradas - fin_slots;
+}
+
+static uint32_t cabeza_de(const char* sufijo, size_t size) {
+    uint32_t cabeza = 0;
+    for (size_t i = 0; i < 4; i++) {
+        cabeza = (cabeza << 8) | (i < size ? static_cast<uint8_t>(sufijo[i]) : 0);
+    }
+    return cabeza;
+}
+
+static RegistroID rid_de(const char* pagina_ptr, const SlotCadena& slot) {
+    RegistroIDEmpaquetado empaquetado;
+    std::memcpy(&empaquetado, pagina_ptr + slot.offset + slot.size, sizeof(empaquetado));
+    return empaquetado.desempaquetar();
+}
+
+// Valor de una entrada de hoja, sin el largo
+static const char* valor_de(const char* pagina_ptr, const SlotCadena& slot, bool con_largo, size_t& size) {
+    const char* valor = pagina_ptr + slot.offset + slot.size;
+    if (!con_largo) {
+        size = sizeof(RegistroIDEmpaquetado);
+        return valor;
+    }
+    uint16_t largo;
+    std::memcpy(&largo, valor, sizeof(largo));
+    size = largo;
+    return valor + sizeof(largo);
+}
+
+static void escribir_valor(char* destino, const std::string& valor, bool con_largo) {
+    if (con_largo) {
+        uint16_t largo = static_cast<uint16_t>(valor.size());
+        std::memcpy(destino, &largo, sizeof(largo));
+        destino += sizeof(largo);
+    }
+    std::memcpy(destino, valor.data(), valor.size());
+}
+
+// Bytes de la entrada del slot: el sufijo y el valor
+static size_t size_entrada(const char* pagina_ptr, const SlotCadena& slot, TipoNodo tipo, bool con_largo) {
+    size_t size_valor = 0;
+    if (tipo == TipoNodo::Hoja) {
+        valor_de(pagina_ptr, slot, con_largo, size_valor);
+    }
+    return slot.size + size_valor_en_nodo(tipo, con_largo, size_valor);
+}
+
+static PaginaID hijo_de(const char* pagina_ptr, const SlotCadena& slot) {
+    PaginaID hijo;
+    std::memcpy(&hijo, pagina_ptr + slot.offset + slot.size, sizeof(PaginaID));
+    return hijo;
+}
+
+static void escribir_hijo(char* pagina_ptr, const SlotCadena& slot, PaginaID hijo) {
+    std::memcpy(pagina_ptr + slot.offset + slot.size, &hijo, sizeof(PaginaID));
+}
+
+// Hijo i de un nodo interno (0 es enlace, i > 0 el de la derecha de la clave i - 1)
+static PaginaID hijo_en(const char* pagina_ptr, size_t i) {
+    return i == 0 ? header_de(pagina_ptr)->enlace : hijo_de(pagina_ptr, slots_de(pagina_ptr)[i - 1]);
+}
+
+// < 0, 0 o > 0 segun el sufijo del slot sea menor, igual o mayor que el buscado
+static int comparar_slot(const char* pagina_ptr, const SlotCadena& slot, const char* sufijo, size_t size, uint32_t cabeza) {
+    if (slot.cabeza != cabeza) {
+        return slot.cabeza < cabeza ? -1 : 1;
+    }
+    // Con la misma cabeza los primeros min(4, largo) bytes son iguales: decide el resto
+    size_t comunes = std::min<size_t>(slot.size, size);
+    if (comunes > 4) {
+        int comparacion = std::memcmp(pagina_ptr + slot.offset + 4, sufijo + 4, comunes - 4);
+        if (comparacion != 0) {
+            return comparacion;
+        }
+    }
+    return (slot.size > size) - (slot.size < size);
+}
+
+// Primera posicion con clave >= clave (o > clave con superior). igual dice si la de esa
+// posicion es la clave buscada.
+static size_t posicion_en_nodo(const char* pagina_ptr, const std::string& clave, bool superior, bool& igual) {
+    const NodoCadenasHeader* header = header_de(pagina_ptr);
+    size_t num_claves = header->num_claves;
+    size_t size_prefijo = header->size_prefijo;
+    igual = false;
+
+    // Una clave que no empieza con el prefijo del nodo va antes o despues de todas
+    int comparacion = std::memcmp(clave.data(), prefijo_de(pagina_ptr), std::min(clave.size(), size_prefijo));
+    if (comparacion < 0 || (comparacion == 0 && clave.size() < size_prefijo)) {
+        return 0;
+    }
+    if (comparacion > 0) {
+        return num_claves;
+    }
+
+    const char* sufijo = clave.data() + size_prefijo;
+    size_t size = clave.size() - size_prefijo;
+    uint32_t cabeza = cabeza_de(sufijo, size);
+    const SlotCadena* slots = slots_de(pagina_ptr);
+    size_t desde = 0;
+    size_t hasta = num_claves;
+    while (desde < hasta) {
+        size_t mitad = desde + (hasta - desde) / 2;
+        int resultado = comparar_slot(pagina_ptr, slots[mitad], sufijo, size, cabeza);
+        if (resultado < 0 || (superior && resultado == 0)) {
+            desde = mitad + 1;
+        } else {
+            hasta = mitad;
+        }
+    }
+    igual = !superior && desde < num_claves && comparar_slot(pagina_ptr, slots[desde], sufijo, size, cabeza) == 0;
+    return desde;
+}
+
+static size_t prefijo_comun(const std::string& a, const std::string& b) {
+    size_t n = std::min(a.size(), b.size());
+    size_t i = 0;
+    while (i < n && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+// El separador mas corto s con anterior < s <= siguiente: un prefijo de siguiente
+static std::string separador_truncado(const std::string& anterior, const std::string& siguiente) {
+    return siguiente.substr(0, prefijo_comun(anterior, siguiente) + 1);
+}
+
+// Bytes que ocupan las entradas [desde, hasta) escritas en un nodo, con su prefijo comun
+template <typename Entradas>
+static size_t size_nodo(const Entradas& entradas, size_t desde, size_t hasta, TipoNodo tipo, bool con_largo) {
+    size_t prefijo = hasta > desde ? prefijo_comun(entradas[desde].clave, entradas[hasta - 1].clave) : 0;
+    size_t size = inicio_slots(prefijo) + (hasta - desde) * sizeof(SlotCadena);
+    for (size_t i = desde; i < hasta; i++) {
+        size += entradas[i].clave.size() - prefijo + size_valor_en_nodo(tipo, con_largo, entradas[i].valor.size());
+    }
+    return size;
+}
+
+// Escribe un nodo con las entradas [desde, hasta), que tienen que entrar (ver size_nodo).
+// Como estan ordenadas, su prefijo comun es el de la primera y la ultima.
+template <typename Entradas>
+static void escribir_nodo(char* pagina_ptr, TipoNodo tipo, bool con_largo, PaginaID enlace, const Entradas& entradas, size_t desde, size_t hasta) {
+    size_t prefijo = hasta > desde ? prefijo_comun(entradas[desde].clave, entradas[hasta - 1].clave) : 0;
+    NodoCadenasHeader* header = header_de(pagina_ptr);
+    std::memset(header, 0, sizeof(NodoCadenasHeader));
+    header->tipo = tipo;
+    header->num_claves = static_cast<uint16_t>(hasta - desde);
+    header->size_prefijo = static_cast<uint16_t>(prefijo);
+    header->enlace = enlace;
+    if (prefijo > 0) {
+        std::memcpy(pagina_ptr + sizeof(NodoCadenasHeader), entradas[desde].clave.data(), prefijo);
+    }
+
+    SlotCadena* slots = slots_de(pagina_ptr);
+    size_t inicio = PAGINA_SIZE;
+    for (size_t i = desde; i < hasta; i++) {
+        const auto& entrada = entradas[i];
+        size_t size = entrada.clave.size() - prefijo;
+        inicio -= size + size_valor_en_nodo(tipo, con_largo, entrada.valor.size());
+        std::memcpy(pagina_ptr + inicio, entrada.clave.data() + prefijo, size);
+        if (tipo == TipoNodo::Hoja) {
+            escribir_valor(pagina_ptr + inicio + size, entrada.valor, con_largo);
+        } else {
+            std::memcpy(pagina_ptr + inicio + size, &entrada.hijo, sizeof(PaginaID));
+        }
+        slots[i - desde] = SlotCadena{static_cast<uint16_t>(inicio), static_cast<uint16_t>(size), cabeza_de(entrada.clave.data() + prefijo, size)};
+    }
+    header->inicio_entradas = static_cast<uint16_t>(inicio);
+}
+
+// === Arbol ===
+
+BPlusTreeCadenas::BPlusTreeCadenas(Paginador& paginador, ValorCadenas tipo_valor)
+    : paginador(paginador), id_raiz(INVALID_PAGE_ID), tipo_valor(tipo_valor) {
+    if (paginador.get_size_pagina() != PAGINA_SIZE) {
+        throw std::runtime_error("El B+ Tree de cadenas usa paginas de " + std::to_string(PAGINA_SIZE) + " bytes.");
+    }
+}
+
+PaginaFijada BPlusTreeCadenas::fijar(PaginaID id_pagina) {
+    PaginaFijada pagina = paginador.fijar_pagina(id_pagina);
+    if (!pagina) {
+        throw std::runtime_error("No se pudo fijar la pagina " + std::to_string(id_pagina) + " del B+ Tree de cadenas.");
+    }
+    return pagina;
+}
+
+PaginaFijada BPlusTreeCadenas::nueva_pagina(TipoNodo tipo, PaginaID& id) {
+    id = paginador.alloc_pagina(id_raiz);
+    if (id == INVALID_PAGE_ID) {
+        throw std::runtime_error("No se pudo asignar una pagina para el B+ Tree de cadenas.");
+    }
+    PaginaFijada pagina = fijar(id);
+    {
+        BloqueoLatch bloqueo(paginador.latch(id));
+        std::vector<Entrada> ninguna;
+        escribir_nodo(pagina.datos(), tipo, false, INVALID_PAGE_ID, ninguna, 0, 0);
+    }
+    pagina.marcar_sucia();
+    return pagina;
+}
+
+PaginaID BPlusTreeCadenas::inicializar(PaginaID id_raiz) {
+    if (id_raiz == INVALID_PAGE_ID) {
+        nueva_pagina(TipoNodo::Hoja, id_raiz);
+    }
+    this->id_raiz = id_raiz;
+    return id_raiz;
+}
+
+PaginaID BPlusTreeCadenas::get_id_raiz() const {
+    return id_raiz;
+}
+
+PaginaFijada BPlusTreeCadenas::bajar(const std::string& clave) {
+    PaginaFijada pagina = fijar(id_raiz);
+    while (header_de(pagina.datos())->tipo == TipoNodo::Interno) {
+        bool igual;
+        size_t pos = posicion_en_nodo(pagina.datos(), clave, true, igual);
+        pagina = fijar(hijo_en(pagina.datos(), pos));
+    }
+    return pagina;
+}
+
+void BPlusTreeCadenas::hojas_siguientes(const std::string& clave, size_t maximo, std::vector<PaginaID>& ids) {
+    ids.clear();
+    PaginaFijada pagina = fijar(id_raiz);
+    while (header_de(pagina.datos())->tipo == TipoNodo::Interno) {
+        bool igual;
+        size_t pos = posicion_en_nodo(pagina.datos(), clave, true, igual);
+        size_t num_claves = header_de(pagina.datos())->num_claves;
+        ids.clear();
+        for (size_t i = pos + 1; i <= num_claves && ids.size() < maximo; i++) {
+            ids.push_back(hijo_en(pagina.datos(), i));
+        }
+        pagina = fijar(hijo_en(pagina.datos(), pos));
+    }
+}
+
+std::optional<RegistroID> BPlusTreeCadenas::buscar(const std::string& clave) {
+    PaginaFijada hoja = bajar(clave);
+    bool igual;
+    size_t pos = posicion_en_nodo(hoja.datos(), clave, false, igual);
+    if (!igual) {
+        return std::nullopt;
+    }
+    return rid_de(hoja.datos(), slots_de(hoja.datos())[pos]);
+}
+
+std::optional<std::string> BPlusTreeCadenas::buscar_bytes(const std::string& clave) {
+    PaginaFijada hoja = bajar(clave);
+    bool igual;
+    size_t pos = posicion_en_nodo(hoja.datos(), clave, false, igual);
+    if (!igual) {
+        return std::nullopt;
+    }
+    return valor_en_hoja(hoja.datos(), pos);
+}
+
+auto BPlusTreeCadenas::buscar_desde(const std::string& clave) -> Iterador {
+    PaginaFijada hoja = bajar(clave);
+    bool igual;
+    size_t pos = posicion_en_nodo(hoja.datos(), clave, false, igual);
+    Iterador iterador(this, std::move(hoja), static_cast<int>(pos));
+    iterador.saltar_hojas_agotadas();
+    return iterador;
+}
+
+bool BPlusTreeCadenas::insertar(const std::string& clave, RegistroID valor) {
+    RegistroIDEmpaquetado empaquetado = RegistroIDEmpaquetado::de(valor);
+    return insertar_valor(clave, std::string(reinterpret_cast<const char*>(&empaquetado), sizeof(empaquetado)));
+}
+
+bool BPlusTreeCadenas::insertar(const std::string& clave, const char* valor, size_t size) {
+    return insertar_valor(clave, std::string(valor, size));
+}
+
+bool BPlusTreeCadenas::insertar_valor(const std::string& clave, std::string valor) {
+    if (clave.size() + valor.size() > MAX_ENTRADA) {
+        throw std::runtime_error("La entrada tiene " + std::to_string(clave.size() + valor.size()) + " bytes y el maximo es " + std::to_string(MAX_ENTRADA) + ".");
+    }
+    bool insertada = false;
+    auto division = insertar_en_nodo(id_raiz, clave, valor, insertada);
+    if (division.has_value()) {
+        PaginaID nueva_raiz_id;
+        PaginaFijada nueva_raiz = nueva_pagina(TipoNodo::Interno, nueva_raiz_id);
+        std::vector<Entrada> entradas = {Entrada{division->separador, std::string(), division->id_nueva_pagina}};
+        escribir_nodo(nueva_raiz.datos(), TipoNodo::Interno, false, id_raiz, entradas, 0, 1);
+        id_raiz = nueva_raiz_id;
+    }
+    return insertada;
+}
+
+auto BPlusTreeCadenas::insertar_en_nodo(PaginaID id_pagina, const std::string& clave, std::string& valor, bool& insertada) -> std::optional<ResultadoDivision> {
+    PaginaFijada pagina = fijar(id_pagina);
+    bool igual;
+
+    if (header_de(pagina.datos())->tipo == TipoNodo::Hoja) {
+        size_t pos = posicion_en_nodo(pagina.datos(), clave, false, igual);
+        if (igual) {
+            return std::nullopt;
+        }
+        insertada = true;
+        return insertar_entrada(pagina, pos, Entrada{clave, std::move(valor), INVALID_PAGE_ID});
+    }
+
+    size_t pos = posicion_en_nodo(pagina.datos(), clave, true, igual);
+    auto division = insertar_en_nodo(hijo_en(pagina.datos(), pos), clave, valor, insertada);
+    if (!division.has_value()) {
+        return std::nullopt;
+    }
+    // El hijo nuevo queda a la derecha del que se dividio: su separador va en la posicion pos
+    return insertar_entrada(pagina, pos, Entrada{std::move(division->separador), std::string(), division->id_nueva_pagina});
+}
+
+auto BPlusTreeCadenas::insertar_entrada(PaginaFijada& pagina, size_t pos, Entrada entrada) -> std::optional<ResultadoDivision> {
+    char* pagina_ptr = pagina.datos();
+    NodoCadenasHeader* header = header_de(pagina_ptr);
+    TipoNodo tipo = header->tipo;
+    bool con_largo = tipo_valor == ValorCadenas::BYTES;
+    size_t size_prefijo = header->size_prefijo;
+    pagina.marcar_sucia();
+
+    // Lo comun: la clave comparte el prefijo del nodo y hay lugar libre. Se agrega la entrada
+    // al principio de las entradas y su slot en la posicion que le toca.
+    size_t size = entrada.clave.size() - std::min(entrada.clave.size(), size_prefijo);
+    size_t size_valor = size_valor_en_nodo(tipo, con_largo, entrada.valor.size());
+    size_t necesario = sizeof(SlotCadena) + size + size_valor;
+    if (entrada.clave.size() >= size_prefijo && std::memcmp(entrada.clave.data(), prefijo_de(pagina_ptr), size_prefijo) == 0 &&
+        espacio_libre(pagina_ptr) >= necesario) {
+        SlotCadena* slots = slots_de(pagina_ptr);
+        std::memmove(slots + pos + 1, slots + pos, (header->num_claves - pos) * sizeof(SlotCadena));
+        header->inicio_entradas -= static_cast<uint16_t>(size + size_valor);
+        slots[pos] = SlotCadena{header->inicio_entradas, static_cast<uint16_t>(size), cabeza_de(entrada.clave.data() + size_prefijo, size)};
+        std::memcpy(pagina_ptr + header->inicio_entradas, entrada.clave.data() + size_prefijo, size);
+        if (tipo == TipoNodo::Hoja) {
+            escribir_valor(pagina_ptr + header->inicio_entradas + size, entrada.valor, con_largo);
+        } else {
+            escribir_hijo(pagina_ptr, slots[pos], entrada.hijo);
+        }
+        header->num_claves++;
+        return std::nullopt;
+    }
+
+    // Si no, se reescribe el nodo entero: con un prefijo mas corto, sin los huecos de las
+    // entradas borradas, o dividido en dos si no alcanza
+    std::vector<Entrada> entradas;
+    entradas.reserve(header->num_claves + 1);
+    const SlotCadena* slots = slots_de(pagina_ptr);
+    std::string prefijo(prefijo_de(pagina_ptr), size_prefijo);
+    for (size_t i = 0; i < header->num_claves; i++) {
+        Entrada actual{prefijo + std::string(pagina_ptr + slots[i].offset, slots[i].size), std::string(), INVALID_PAGE_ID};
+        if (tipo == TipoNodo::Hoja) {
+            size_t size_actual;
+            const char* valor = valor_de(pagina_ptr, slots[i], con_largo, size_actual);
+            actual.valor.assign(valor, size_actual);
+        } else {
+            actual.hijo = hijo_de(pagina_ptr, slots[i]);
+        }
+        entradas.push_back(std::move(actual));
+    }
+    entradas.insert(entradas.begin() + pos, std::move(entrada));
+
+    if (size_nodo(entradas, 0, entradas.size(), tipo, con_largo) <= PAGINA_SIZE) {
+        escribir_nodo(pagina_ptr, tipo, con_largo, header->enlace, entradas, 0, entradas.size());
+        return std::nullopt;
+    }
+    return dividir(pagina, entradas);
+}
+
+// Los nodos se dividen por bytes. Entre los puntos de division cercanos a la mitad se elige
+// el que deja el separador mas corto: en las hojas el prefijo minimo que distingue las dos
+// claves vecinas, y en los internos la clave que sube.
+auto BPlusTreeCadenas::dividir(PaginaFijada& pagina, std::vector<Entrada>& entradas) -> ResultadoDivision {
+    char* pagina_ptr = pagina.datos();
+    TipoNodo tipo = header_de(pagina_ptr)->tipo;
+    bool con_largo = tipo_valor == ValorCadenas::BYTES;
+    PaginaID enlace = header_de(pagina_ptr)->enlace;
+    size_t n = entradas.size();
+
+    size_t total = 0;
+    for (const Entrada& entrada : entradas) {
+        total += entrada.clave.size();
+    }
+    size_t mitad = 1;
+    for (size_t acumulado = entradas[0].clave.size(); mitad < n - 1 && acumulado < total / 2; mitad++) {
+        acumulado += entradas[mitad].clave.size();
+    }
+
+    auto size_separador = [&](size_t m) {
+        return tipo == TipoNodo::Hoja ? prefijo_comun(entradas[m - 1].clave, entradas[m].clave) + 1 : entradas[m].clave.size();
+    };
+    auto entra = [&](size_t m) {
+        size_t inicio_derecha = tipo == TipoNodo::Hoja ? m : m + 1;
+        return size_nodo(entradas, 0, m, tipo, con_largo) <= PAGINA_SIZE && size_nodo(entradas, inicio_derecha, n, tipo, con_largo) <= PAGINA_SIZE;
+    };
+
+    size_t ventana = std::max<size_t>(1, n / 8);
+    size_t elegido = mitad;
+    for (size_t m = std::max<size_t>(1, mitad > ventana ? mitad - ventana : 1); m <= std::min(n - 1, mitad + ventana); m++) {
+        if (entra(m) && (!entra(elegido) || size_separador(m) < size_separador(elegido))) {
+            elegido = m;
+        }
+    }
+    if (!entra(elegido)) {
+        throw std::logic_error("Ninguna division del nodo del B+ Tree de cadenas entra en dos paginas.");
+    }
+
+    PaginaID nueva_id;
+    PaginaFijada nueva = nueva_pagina(tipo, nueva_id);
+    ResultadoDivision resultado;
+    resultado.id_nueva_pagina = nueva_id;
+    if (tipo == TipoNodo::Hoja) {
+        resultado.separador = separador_truncado(entradas[elegido - 1].clave, entradas[elegido].clave);
+        escribir_nodo(nueva.datos(), tipo, con_largo, enlace, entradas, elegido, n);
+        escribir_nodo(pagina_ptr, tipo, con_largo, nueva_id, entradas, 0, elegido);
+    } else {
+        // La clave del medio sube y su hijo pasa a ser el primero del nodo nuevo
+        resultado.separador = entradas[elegido].clave;
+        escribir_nodo(nueva.datos(), tipo, con_largo, entradas[elegido].hijo, entradas, elegido + 1, n);
+        escribir_nodo(pagina_ptr, tipo, con_largo, enlace, entradas, 0, elegido);
+    }
+    nueva.marcar_sucia();
+    return resultado;
+}
+
+std::optional<std::string> BPlusTreeCadenas::eliminar(const std::string& clave) {
+    PaginaFijada hoja = bajar(clave);
+    char* pagina_ptr = hoja.datos();
+    bool igual;
+    size_t pos = posicion_en_nodo(pagina_ptr, clave, false, igual);
+    if (!igual) {
+        return std::nullopt;
+    }
+    std::string anterior = valor_en_hoja(pagina_ptr, pos);
+    sacar_de_hoja(pagina_ptr, pos);
+    hoja.marcar_sucia();
+    return anterior;
+}
+
+std::optional<std::string> BPlusTreeCadenas::reemplazar(const std::string& clave, const char* valor, size_t size) {
+    if (clave.size() + size > MAX_ENTRADA) {
+        throw std::runtime_error("La entrada tiene " + std::to_string(clave.size() + size) + " bytes y el maximo es " + std::to_string(MAX_ENTRADA) + ".");
+    }
+    std::string anterior;
+    {
+        PaginaFijada hoja = bajar(clave);
+        char* pagina_ptr = hoja.datos();
+        bool igual;
+        size_t pos = posicion_en_nodo(pagina_ptr, clave, false, igual);
+        if (!igual) {
+            return std::nullopt;
+        }
+        size_t size_actual;
+        const char* actual = valor_de(pagina_ptr, slots_de(pagina_ptr)[pos], tipo_valor == ValorCadenas::BYTES, size_actual);
+        anterior.assign(actual, size_actual);
+        // Del mismo largo (lo comun) se pisa en su lugar
+        if (size_actual == size) {
+            std::memcpy(const_cast<char*>(actual), valor, size);
+            hoja.marcar_sucia();
+            return anterior;
+        }
+        sacar_de_hoja(pagina_ptr, pos);
+        hoja.marcar_sucia();
+    }
+    // Puede dividir nodos: vuelve a bajar desde la raiz
+    insertar_valor(clave, std::string(valor, size));
+    return anterior;
+}
+
+std::string BPlusTreeCadenas::valor_en_hoja(const char* pagina_ptr, size_t pos) const {
+    size_t size;
+    const char* valor = valor_de(pagina_ptr, slots_de(pagina_ptr)[pos], tipo_valor == ValorCadenas::BYTES, size);
+    return std::string(valor, size);
+}
+
+// El espacio de la entrada queda como hueco hasta la proxima compactacion del nodo
+void BPlusTreeCadenas::sacar_de_hoja(char* pagina_ptr, size_t pos) {
+    NodoCadenasHeader* header = header_de(pagina_ptr);
+    SlotCadena* slots = slots_de(pagina_ptr);
+    header->bytes_huecos += static_cast<uint16_t>(size_entrada(pagina_ptr, slots[pos], TipoNodo::Hoja, tipo_valor == ValorCadenas::BYTES));
+    std::memmove(slots + pos, slots + pos + 1, (header->num_claves - pos - 1) * sizeof(SlotCadena));
+    header->num_claves--;
+}
+
+// === Iterador ===
+
+BPlusTreeCadenas::Iterador::Iterador(BPlusTreeCadenas* arbol, PaginaFijada hoja, int posicion)
+    : arbol(arbol), hoja(std::move(hoja)), posicion(posicion), siguiente_proxima(0), ventana(0) {}
+
+std::string BPlusTreeCadenas::Iterador::clave() const {
+    const char* pagina_ptr = hoja.datos();
+    const SlotCadena& slot = slots_de(pagina_ptr)[posicion];
+    std::string clave(prefijo_de(pagina_ptr), header_de(pagina_ptr)->size_prefijo);
+    clave.append(pagina_ptr + slot.offset, slot.size);
+    return clave;
+}
+
+RegistroID BPlusTreeCadenas::Iterador::valor() const {
+    const char* pagina_ptr = hoja.datos();
+    return rid_de(pagina_ptr, slots_de(pagina_ptr)[posicion]);
+}
+
+const char* BPlusTreeCadenas::Iterador::valor_bytes(size_t& size) const {
+    const char* pagina_ptr = hoja.datos();
+    return valor_de(pagina_ptr, slots_de(pagina_ptr)[posicion], arbol->tipo_valor == ValorCadenas::BYTES, size);
+}
+
+bool BPlusTreeCadenas::Iterador::clave_empieza_con(const std::string& prefijo) const {
+    const char* pagina_ptr = hoja.datos();
+    const SlotCadena& slot = slots_de(pagina_ptr)[posicion];
+    size_t size_prefijo = header_de(pagina_ptr)->size_prefijo;
+    if (prefijo.size() > size_prefijo + slot.size) {
+        return false;
+    }
+    size_t en_prefijo = std::min(prefijo.size(), size_prefijo);
+    return std::memcmp(prefijo.data(), prefijo_de(pagina_ptr), en_prefijo) == 0 &&
+           std::memcmp(prefijo.data() + en_prefijo, pagina_ptr + slot.offset, prefijo.size() - en_prefijo) == 0;
+}
+
+void BPlusTreeCadenas::Iterador::saltar_hojas_agotadas() {
+    while (hoja && posicion >= header_de(hoja.datos())->num_claves) {
+        PaginaID id_siguiente = header_de(hoja.datos())->enlace;
+        hoja.soltar();
+        if (id_siguiente != INVALID_PAGE_ID) {
+            hoja = arbol->fijar(id_siguiente);
+            posicion = 0;
+            precargar_hojas(id_siguiente);
+        }
+    }
+}
+
+// Ver BPlusTree::Iterador::precargar_hojas
+void BPlusTreeCadenas::Iterador::precargar_hojas(PaginaID id_hoja) {
+    if (arbol->paginador.get_modo() != ModoAlmacenamiento::BUFFER_POOL) {
+        return;
+    }
+    if (siguiente_proxima < proximas.size() && proximas[siguiente_proxima] == id_hoja) {
+        siguiente_proxima++;
+    } else {
+        proximas.clear();
+        siguiente_proxima = 0;
+    }
+    size_t num_claves = header_de(hoja.datos())->num_claves;
+    if (siguiente_proxima < proximas.size() || num_claves == 0) {
+        return;
+    }
+
+    ventana = ventana == 0 ? HOJAS_PRECARGA_INICIAL : std::min(2 * ventana, HOJAS_PRECARGA_MAX);
+    // La ultima clave de la hoja, para bajar hasta su padre
+    const char* pagina_ptr = hoja.datos();
+    const SlotCadena& slot = slots_de(pagina_ptr)[num_claves - 1];
+    std::string ultima(prefijo_de(pagina_ptr), header_de(pagina_ptr)->size_prefijo);
+    ultima.append(pagina_ptr + slot.offset, slot.size);
+    arbol->hojas_siguientes(ultima, ventana, proximas);
+    siguiente_proxima = 0;
+    arbol->paginador.precargar(proximas);
+}
+
+void BPlusTreeCadenas::Iterador::siguiente() {
+    posicion++;
+    saltar_hojas_agotadas();
+}
+
+// === Carga masiva ===
+
+// Como BPlusTree::CargaAscendente, pero los nodos se cierran por bytes: una entrada que no
+// entra en el nodo que se esta llenando lo escribe y abre el siguiente. Cada nodo escrito
+// sube al nivel de arriba con su separador: para las hojas el truncado entre la ultima clave
+// de la anterior y su primera, y para los internos el de su primer hijo.
+struct BPlusTreeCadenas::CargaAscendente {
+    struct Nivel {
+        std::vector<Entrada> pendientes;  // Separador antes de cada hijo (el del primero sube)
+        size_t escritos = 0;
+    };
+
+    BPlusTreeCadenas& arbol;
+    size_t limite;                   // Bytes de cada nodo que se llenan
+    bool con_largo;
+
+    std::vector<Entrada> hoja;       // Entradas de la hoja que se esta llenando
+    std::string ultima_anterior;     // Ultima clave de la hoja anterior
+    size_t hojas_escritas = 0;
+    PaginaID hoja_anterior = INVALID_PAGE_ID;
+    std::vector<Nivel> internos;     // internos[0] es el nivel sobre las hojas
+
+    CargaAscendente(BPlusTreeCadenas& arbol, double factor_llenado)
+        : arbol(arbol), limite(static_cast<size_t>(PAGINA_SIZE * std::clamp(factor_llenado, 0.5, 1.0))),
+          con_largo(arbol.tipo_valor == ValorCadenas::BYTES) {}
+
+    PaginaFijada nueva_pagina(PaginaID& id) {
+        id = arbol.paginador.alloc_pagina_nueva();
+        if (id == INVALID_PAGE_ID) {
+            throw std::runtime_error("No se pudo asignar una pagina para la carga masiva.");
+        }
+        return arbol.fijar(id);
+    }
+
+    void agregar_entrada(const std::string& clave, const std::string& valor) {
+        const std::string& anterior = hoja.empty() ? ultima_anterior : hoja.back().clave;
+        if ((!hoja.empty() || hojas_escritas > 0) && !(anterior < clave)) {
+            throw std::runtime_error("La carga masiva necesita claves en orden creciente y sin repetir.");
+        }
+        if (clave.size() + valor.size() > MAX_ENTRADA) {
+            throw std::runtime_error("La entrada tiene " + std::to_string(clave.size() + valor.size()) + " bytes y el maximo es " + std::to_string(MAX_ENTRADA) + ".");
+        }
+        hoja.push_back(Entrada{clave, valor, INVALID_PAGE_ID});
+        if (hoja.size() > 1 && size_nodo(hoja, 0, hoja.size(), TipoNodo::Hoja, con_largo) > limite) {
+            Entrada ultima = std::move(hoja.back());
+            hoja.pop_back();
+            escribir_hoja();
+            hoja.push_back(std::move(ultima));
+        }
+    }
+
+    void escribir_hoja() {
+        PaginaID id;
+        PaginaFijada pagina = nueva_pagina(id);
+        escribir_nodo(pagina.datos(), TipoNodo::Hoja, con_largo, INVALID_PAGE_ID, hoja, 0, hoja.size());
+        pagina.marcar_sucia();
+        pagina.soltar();
+
+        if (hoja_anterior != INVALID_PAGE_ID) {
+            PaginaFijada anterior = arbol.fijar(hoja_anterior);
+            header_de(anterior.datos())->enlace = id;
+            anterior.marcar_sucia();
+        }
+        std::string separador = hojas_escritas > 0 && !hoja.empty() ? separador_truncado(ultima_anterior, hoja[0].clave) : std::string();
+        if (!hoja.empty()) {
+            ultima_anterior = hoja.back().clave;
+        }
+        hoja_anterior = id;
+        hojas_escritas++;
+        hoja.clear();
+        agregar_hijo(0, std::move(separador), id);
+    }
+
+    void agregar_hijo(size_t nivel, std::string separador, PaginaID hijo) {
+        if (nivel == internos.size()) {
+            internos.emplace_back();
+        }
+        auto& pendientes = internos[nivel].pendientes;
+        pendientes.push_back(Entrada{std::move(separador), std::string(), hijo});
+        // Las claves del nodo son los separadores desde el segundo hijo
+        if (pendientes.size() > 2 && size_nodo(pendientes, 1, pendientes.size(), TipoNodo::Interno, false) > limite) {
+            Entrada ultimo = std::move(pendientes.back());
+            pendientes.pop_back();
+            escribir_interno(nivel);
+            internos[nivel].pendientes.push_back(std::move(ultimo));
+        }
+    }
+
+    void escribir_interno(size_t nivel) {
+        PaginaID id;
+        PaginaFijada pagina = nueva_pagina(id);
+        auto& pendientes = internos[nivel].pendientes;
+        escribir_nodo(pagina.datos(), TipoNodo::Interno, false, pendientes[0].hijo, pendientes, 1, pendientes.size());
+        pagina.marcar_sucia();
+        internos[nivel].escritos++;
+
+        std::string separador = std::move(pendientes[0].clave);
+        pendientes.clear();
+        agregar_hijo(nivel + 1, std::move(separador), id);
+    }
+
+    // Escribe lo que quedo en cada nivel, de abajo hacia arriba, y devuelve la raiz
+    PaginaID terminar() {
+        escribir_hoja(); // Sin entradas queda una hoja vacia como raiz
+        if (hojas_escritas == 1) {
+            return hoja_anterior;
+        }
+        for (size_t nivel = 0; ; nivel++) {
+            if (internos[nivel].escritos == 0 && internos[nivel].pendientes.size() == 1) {
+                return internos[nivel].pendientes[0].hijo;
+            }
+            escribir_interno(nivel);
+        }
+    }
+};
+
+PaginaID BPlusTreeCadenas::construir_desde_ordenados(const std::function<bool(std::string&, RegistroID&)>& siguiente, double factor_llenado) {
+    RegistroID rid{};
+    return construir_desde_ordenados([&](std::string& clave, std::string& valor) {
+        if (!siguiente(clave, rid)) {
+            return false;
+        }
+        RegistroIDEmpaquetado empaquetado = RegistroIDEmpaquetado::de(rid);
+        valor.assign(reinterpret_cast<const char*>(&empaquetado), sizeof(empaquetado));
+        return true;
+    }, factor_llenado);
+}
+
+PaginaID BPlusTreeCadenas::construir_desde_ordenados(const std::function<bool(std::string&, std::string&)>& siguiente, double factor_llenado) {
+    CargaAscendente carga(*this, factor_llenado);
+    std::string clave;
+    std::string valor;
+    while (siguiente(clave, valor)) {
+        carga.agregar_entrada(clave, valor);
+    }
+
+    PaginaID raiz_anterior = id_raiz;
+    id_raiz = carga.terminar();
+    return raiz_anterior;
+}
+
+// === Compactacion ===
+
+void BPlusTreeCadenas::marcar_paginas_vivas(std::vector<bool>& vivas) {
+    std::vector<PaginaID> pendientes = {id_raiz};
+    while (!pendientes.empty()) {
+        PaginaID id_pagina = pendientes.back();
+        pendientes.pop_back();
+        if (id_pagina >= vivas.size()) {
+            throw std::runtime_error("El B+ Tree de cadenas apunta a la pagina " + std::to_string(id_pagina) + ", fuera del archivo.");
+        }
+        vivas[id_pagina] = true;
+
+        PaginaFijada pagina = fijar(id_pagina);
+        const char* pagina_ptr = pagina.datos();
+        const NodoCadenasHeader* header = header_de(pagina_ptr);
+        for (size_t i = 0; i <= header->num_claves; i++) {
+            if (header->tipo == TipoNodo::Interno) {
+                pendientes.push_back(hijo_en(pagina_ptr, i));
+            } else if (i < header->num_claves && tipo_valor == ValorCadenas::REGISTRO_ID) {
+                PaginaID id_datos = rid_de(pagina_ptr, slots_de(pagina_ptr)[i]).pagina_id;
+                if (id_datos == INVALID_PAGE_ID) {
+                    continue;
+                }
+                if (id_datos >= vivas.size()) {
+                    throw std::runtime_error("Un RID apunta a la pagina " + std::to_string(id_datos) + ", fuera del archivo.");
+                }
+                vivas[id_datos] = true;
+            }
+        }
+    }
+}
+
+std::vector<PaginaID> BPlusTreeCadenas::reubicar_raiz(const std::vector<PaginaID>& nuevo_id) {
+    id_raiz = nuevo_id[id_raiz];
+    return {id_raiz};
+}
+
+void BPlusTreeCadenas::reubicar_nodos(const std::vector<PaginaID>& nuevo_id, std::vector<PaginaID>& pendientes, size_t max_nodos) {
+    for (size_t procesados = 0; procesados < max_nodos && !pendientes.empty(); procesados++) {
+        PaginaFijada pagina = fijar(pendientes.back());
+        pendientes.pop_back();
+        char* pagina_ptr = pagina.datos();
+        NodoCadenasHeader* header = header_de(pagina_ptr);
+        SlotCadena* slots = slots_de(pagina_ptr);
+
+        if (header->enlace != INVALID_PAGE_ID) {
+            header->enlace = nuevo_id[header->enlace];
+        }
+        if (header->tipo == TipoNodo::Interno) {
+            pendientes.push_back(header->enlace);
+            for (size_t i = 0; i < header->num_claves; i++) {
+                PaginaID hijo = nuevo_id[hijo_de(pagina_ptr, slots[i])];
+                escribir_hijo(pagina_ptr, slots[i], hijo);
+                pendientes.push_back(hijo);
+            }
+        } else if (tipo_valor == ValorCadenas::REGISTRO_ID) {
+            for (size_t i = 0; i < header->num_claves; i++) {
+                RegistroID rid = rid_de(pagina_ptr, slots[i]);
+                if (rid.pagina_id == INVALID_PAGE_ID) {
+                    continue;
+                }
+                rid.pagina_id = nuevo_id[rid.pagina_id];
+                RegistroIDEmpaquetado empaquetado = RegistroIDEmpaquetado::de(rid);
+                std::memcpy(pagina_ptr + slots[i].offset + slots[i].size, &empaquetado, sizeof(empaquetado));
+            }
+        }
+        pagina.marcar_sucia();
+    }
+}
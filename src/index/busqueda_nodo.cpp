@@ -0,0 +1,217 @@
+#include "index/busqueda_nodo.hpp"
+#include "core/prefetch.hpp"
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BUSQUEDA_SSE2
+#include <emmintrin.h>
+// AVX2 se compila solo para estas funciones (target) y se usa si el procesador lo tiene;
+// en MSVC no hay target por funcion, asi que ahi se queda en SSE2
+#if defined(__GNUC__)
+#define BUSQUEDA_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+// Todos los kernels cuentan cuantas de las len claves son menores que clave
+
+static size_t contar_escalar(const DNI_t* claves, size_t len, DNI_t clave) {
+    size_t cuenta = 0;
+    for (size_t i = 0; i < len; i++) {
+        cuenta += claves[i] < clave;
+    }
+    return cuenta;
+}
+
+static size_t contar_escalar_64(const uint64_t* claves, size_t len, uint64_t clave) {
+    size_t cuenta = 0;
+    for (size_t i = 0; i < len; i++) {
+        cuenta += claves[i] < clave;
+    }
+    return cuenta;
+}
+
+#ifdef BUSQUEDA_SSE2
+
+// SSE2 y AVX2 solo comparan enteros con signo: invertir el bit de signo de los dos lados
+// conserva el orden sin signo
+static size_t contar_sse2(const DNI_t* claves, size_t len, DNI_t clave) {
+    const __m128i signo = _mm_set1_epi32(INT32_MIN);
+    const __m128i buscada = _mm_xor_si128(_mm_set1_epi32(static_cast<int32_t>(clave)), signo);
+    __m128i acumulado = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m128i v = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(claves + i)), signo);
+        acumulado = _mm_sub_epi32(acumulado, _mm_cmpgt_epi32(buscada, v)); // Cada menor suma 1 (resta -1)
+    }
+
+    alignas(16) uint32_t cuentas[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(cuentas), acumulado);
+    return cuentas[0] + cuentas[1] + cuentas[2] + cuentas[3] + contar_escalar(claves + i, len - i, clave);
+}
+
+#endif
+
+#ifdef BUSQUEDA_AVX2
+
+__attribute__((target("avx2")))
+static size_t contar_avx2(const DNI_t* claves, size_t len, DNI_t clave) {
+    const __m256i signo = _mm256_set1_epi32(INT32_MIN);
+    const __m256i buscada = _mm256_xor_si256(_mm256_set1_epi32(static_cast<int32_t>(clave)), signo);
+    __m256i acumulado = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(claves + i));
+        acumulado = _mm256_sub_epi32(acumulado, _mm256_cmpgt_epi32(buscada, _mm256_xor_si256(v, signo)));
+    }
+
+    __m128i suma = _mm_add_epi32(_mm256_castsi256_si128(acumulado), _mm256_extracti128_si256(acumulado, 1));
+    suma = _mm_add_epi32(suma, _mm_shuffle_epi32(suma, _MM_SHUFFLE(1, 0, 3, 2)));
+    suma = _mm_add_epi32(suma, _mm_shuffle_epi32(suma, _MM_SHUFFLE(2, 3, 0, 1)));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(suma)) + contar_escalar(claves + i, len - i, clave);
+}
+
+// Claves de 8 bytes: 4 por comparacion. SSE2 no compara enteros de 64 bits (recien SSE4.2),
+// asi que con el kernel SSE2 estas claves se cuentan con el escalar.
+__attribute__((target("avx2")))
+static size_t contar_avx2_64(const uint64_t* claves, size_t len, uint64_t clave) {
+    const __m256i signo = _mm256_set1_epi64x(INT64_MIN);
+    const __m256i buscada = _mm256_xor_si256(_mm256_set1_epi64x(static_cast<int64_t>(clave)), signo);
+    __m256i acumulado = _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 4 <= len; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(claves + i));
+        acumulado = _mm256_sub_epi64(acumulado, _mm256_cmpgt_epi64(buscada, _mm256_xor_si256(v, signo)));
+    }
+
+    alignas(32) uint64_t cuentas[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(cuentas), acumulado);
+    return cuentas[0] + cuentas[1] + cuentas[2] + cuentas[3] + contar_escalar_64(claves + i, len - i, clave);
+}
+
+#endif
+
+using FuncionContar = size_t (*)(const DNI_t*, size_t, DNI_t);
+using FuncionContar64 = size_t (*)(const uint64_t*, size_t, uint64_t);
+
+static bool soporta(KernelBusqueda kernel) {
+    switch (kernel) {
+        case KernelBusqueda::ESCALAR:
+            return true;
+        case KernelBusqueda::SSE2:
+#ifdef BUSQUEDA_SSE2
+            return true;
+#else
+            return false;
+#endif
+        case KernelBusqueda::AVX2:
+#ifdef BUSQUEDA_AVX2
+            __builtin_cpu_init(); // Nos llaman desde un inicializador estatico
+            return __builtin_cpu_supports("avx2");
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+static FuncionContar funcion_de(KernelBusqueda kernel) {
+    switch (kernel) {
+#ifdef BUSQUEDA_AVX2
+        case KernelBusqueda::AVX2:
+            return contar_avx2;
+#endif
+#ifdef BUSQUEDA_SSE2
+        case KernelBusqueda::SSE2:
+            return contar_sse2;
+#endif
+        default:
+            return contar_escalar;
+    }
+}
+
+static FuncionContar64 funcion_64_de(KernelBusqueda kernel) {
+#ifdef BUSQUEDA_AVX2
+    if (kernel == KernelBusqueda::AVX2) {
+        return contar_avx2_64;
+    }
+#endif
+    (void)kernel;
+    return contar_escalar_64;
+}
+
+static KernelBusqueda elegir_kernel() {
+    if (soporta(KernelBusqueda::AVX2)) return KernelBusqueda::AVX2;
+    if (soporta(KernelBusqueda::SSE2)) return KernelBusqueda::SSE2;
+    return KernelBusqueda::ESCALAR;
+}
+
+static KernelBusqueda kernel_actual = elegir_kernel();
+static FuncionContar contar = funcion_de(kernel_actual);
+static FuncionContar64 contar_64 = funcion_64_de(kernel_actual);
+
+template <typename Clave, typename Contar>
+static size_t posicion_inferior_con(const Clave* claves, size_t n, Clave clave, Contar contar_ventana) {
+    // Invariante: la respuesta esta en [base, base + len]. Si base[mitad] < clave la
+    // respuesta esta despues de mitad; si no, a lo sumo en mitad <= len - mitad.
+    const Clave* base = claves;
+    size_t len = n;
+    while (len > VENTANA_BUSQUEDA) {
+        size_t mitad = len / 2;
+        // Sin saltos el procesador no adelanta la proxima lectura: se piden las dos posibles
+        prefetch_linea(base + mitad / 2);
+        prefetch_linea(base + mitad + mitad / 2);
+        base = base[mitad] < clave ? base + mitad : base;
+        len -= mitad;
+    }
+    return static_cast<size_t>(base - claves) + contar_ventana(base, len, clave);
+}
+
+size_t posicion_inferior(const DNI_t* claves, size_t n, DNI_t clave) {
+    return posicion_inferior_con(claves, n, clave, contar);
+}
+
+size_t posicion_superior(const DNI_t* claves, size_t n, DNI_t clave) {
+    // La primera clave > clave es la primera >= clave + 1
+    if (clave == UINT32_MAX) {
+        return n;
+    }
+    return posicion_inferior(claves, n, clave + 1);
+}
+
+size_t posicion_inferior(const uint64_t* claves, size_t n, uint64_t clave) {
+    return posicion_inferior_con(claves, n, clave, contar_64);
+}
+
+size_t posicion_superior(const uint64_t* claves, size_t n, uint64_t clave) {
+    if (clave == UINT64_MAX) {
+        return n;
+    }
+    return posicion_inferior(claves, n, clave + 1);
+}
+
+bool usar_kernel_busqueda(KernelBusqueda kernel) {
+    if (!soporta(kernel)) {
+        return false;
+    }
+    kernel_actual = kernel;
+    contar = funcion_de(kernel);
+    contar_64 = funcion_64_de(kernel);
+    return true;
+}
+
+KernelBusqueda get_kernel_busqueda() {
+    return kernel_actual;
+}
+
+const char* nombre_kernel_busqueda(KernelBusqueda kernel) {
+    switch (kernel) {
+        case KernelBusqueda::ESCALAR: return "escalar";
+        case KernelBusqueda::SSE2: return "sse2";
+        case KernelBusqueda::AVX2: return "avx2";
+    }
+    return "?";
+}
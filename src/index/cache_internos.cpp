@@ -0,0 +1,113 @@
+#include "index/cache_internos.hpp"
+#include <algorithm>
+
+// La parte de los frames que pueden quedar fijados con nodos internos
+constexpr size_t FRACCION_FRAMES = 32;
+
+CacheInternos::CacheInternos(Paginador& paginador, size_t max_hijos)
+    : paginador(paginador), max_hijos(max_hijos), max_nodos(0), llena(false), raiz_actual(nullptr) {}
+
+void CacheInternos::anotar_raiz(PaginaID id_raiz, uint32_t altura, uint64_t version) {
+    if (altura == 0) {
+        return; // La raiz es una hoja
+    }
+    if (paginador.get_modo() != ModoAlmacenamiento::BUFFER_POOL) {
+        return; // En MAPEO fijar una pagina ya es una suma: la cache solo agregaria indirecciones
+    }
+    if (llena.load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!paginador.latch(id_raiz).validar(version)) {
+        return;
+    }
+    NodoFijado* nodo = fijar_nodo(id_raiz, altura);
+    if (nodo != nullptr) {
+        raiz_actual.store(nodo, std::memory_order_release);
+    }
+}
+
+NodoFijado* CacheInternos::resolver(NodoFijado* padre, size_t pos, PaginaID id_hijo) {
+    if (padre->nivel <= 1 || llena.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    NodoFijado* nodo = fijar_nodo(id_hijo, padre->nivel - 1);
+    if (nodo != nullptr) {
+        padre->hijos[pos].store(nodo, std::memory_order_release);
+    }
+    return nodo;
+}
+
+NodoFijado* CacheInternos::fijar_nodo(PaginaID id, uint32_t nivel) {
+    auto it = nodos.find(id);
+    if (it != nodos.end()) {
+        if (it->second->nivel == nivel) {
+            return it->second.get();
+        }
+        // La pagina se libero sin pasar por olvidar y volvio como otro nodo
+        olvidar_nodo(it);
+    }
+
+    if (max_nodos == 0) {
+        max_nodos = std::max<size_t>(1, paginador.get_estadisticas().buffer_pool.num_frames / FRACCION_FRAMES);
+    }
+    if (nodos.size() >= max_nodos) {
+        llena.store(true, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    PaginaFijada pagina = paginador.fijar_pagina(id);
+    if (!pagina) {
+        return nullptr;
+    }
+    auto nodo = std::make_unique<NodoFijado>();
+    nodo->id.store(id, std::memory_order_relaxed);
+    nodo->nivel = nivel;
+    nodo->datos = pagina.datos();
+    nodo->latch = &paginador.latch(id);
+    nodo->hijos.reset(new std::atomic<NodoFijado*>[max_hijos]);
+    for (size_t i = 0; i < max_hijos; i++) {
+        nodo->hijos[i].store(nullptr, std::memory_order_relaxed);
+    }
+    nodo->pagina = std::move(pagina);
+
+    NodoFijado* resultado = nodo.get();
+    nodos.emplace(id, std::move(nodo));
+    return resultado;
+}
+
+void CacheInternos::olvidar_nodo(std::unordered_map<PaginaID, std::unique_ptr<NodoFijado>>::iterator it) {
+    NodoFijado* nodo = it->second.get();
+    // Los punteros que todavia lo tengan ya no coinciden con ningun id
+    nodo->id.store(INVALID_PAGE_ID, std::memory_order_release);
+    nodo->pagina.soltar();
+    if (raiz_actual.load(std::memory_order_relaxed) == nodo) {
+        raiz_actual.store(nullptr, std::memory_order_release);
+    }
+    olvidados.push_back(std::move(it->second));
+    nodos.erase(it);
+    llena.store(false, std::memory_order_relaxed);
+}
+
+void CacheInternos::olvidar(PaginaID id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = nodos.find(id);
+    if (it != nodos.end()) {
+        olvidar_nodo(it);
+    }
+}
+
+void CacheInternos::vaciar() {
+    std::lock_guard<std::mutex> lock(mutex);
+    raiz_actual.store(nullptr, std::memory_order_release);
+    nodos.clear();
+    olvidados.clear();
+    max_nodos = 0;
+    llena.store(false, std::memory_order_relaxed);
+}
+
+size_t CacheInternos::get_num_nodos() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return nodos.size();
+}
@@ -0,0 +1,88 @@
+#include "index/filtro_bloom.hpp"
+#include <algorithm>
+#include <cstring>
+
+constexpr size_t PALABRAS_BLOQUE = FiltroBloom::BYTES_BLOQUE / sizeof(uint32_t);
+
+// Impares: cada una elige el bit de una palabra del bloque con otros bits del hash
+static constexpr uint32_t SALES[PALABRAS_BLOQUE] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U,
+};
+
+// Los DNIs son casi consecutivos: se mezclan para que bloques y bits queden repartidos
+static uint64_t mezclar(uint64_t clave) {
+    clave ^= clave >> 33;
+    clave *= 0xff51afd7ed558ccdULL;
+    clave ^= clave >> 33;
+    clave *= 0xc4ceb9fe1a85ec53ULL;
+    clave ^= clave >> 33;
+    return clave;
+}
+
+size_t FiltroBloom::paginas_para(size_t capacidad) {
+    size_t bits_pagina = BLOQUES_POR_PAGINA * BYTES_BLOQUE * 8;
+    size_t bits = std::max(capacidad, MIN_CLAVES) * BITS_POR_CLAVE;
+    return (bits + bits_pagina - 1) / bits_pagina;
+}
+
+FiltroBloom::FiltroBloom(size_t num_paginas)
+    : num_paginas(num_paginas), num_bloques(num_paginas * BLOQUES_POR_PAGINA), num_claves(0),
+      palabras(new std::atomic<uint32_t>[num_bloques * PALABRAS_BLOQUE]), cambiadas(num_paginas, true) {
+    for (size_t i = 0; i < num_bloques * PALABRAS_BLOQUE; i++) {
+        palabras[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void FiltroBloom::agregar(uint64_t clave) {
+    uint64_t hash = mezclar(clave);
+    size_t bloque = static_cast<size_t>(((hash >> 32) * num_bloques) >> 32);
+    uint32_t bits = static_cast<uint32_t>(hash);
+    std::atomic<uint32_t>* palabra = &palabras[bloque * PALABRAS_BLOQUE];
+    for (size_t i = 0; i < PALABRAS_BLOQUE; i++) {
+        // Release: quien vea la clave en el arbol despues de esto ve tambien sus bits
+        palabra[i].fetch_or(uint32_t(1) << ((bits * SALES[i]) >> 27), std::memory_order_release);
+    }
+    cambiadas[bloque / BLOQUES_POR_PAGINA] = true;
+    num_claves++;
+}
+
+bool FiltroBloom::puede_estar(uint64_t clave) const {
+    uint64_t hash = mezclar(clave);
+    size_t bloque = static_cast<size_t>(((hash >> 32) * num_bloques) >> 32);
+    uint32_t bits = static_cast<uint32_t>(hash);
+    const std::atomic<uint32_t>* palabra = &palabras[bloque * PALABRAS_BLOQUE];
+    for (size_t i = 0; i < PALABRAS_BLOQUE; i++) {
+        uint32_t bit = uint32_t(1) << ((bits * SALES[i]) >> 27);
+        if ((palabra[i].load(std::memory_order_acquire) & bit) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FiltroBloom::copiar_pagina(size_t pagina, char* destino) const {
+    const std::atomic<uint32_t>* desde = &palabras[pagina * BLOQUES_POR_PAGINA * PALABRAS_BLOQUE];
+    for (size_t i = 0; i < BLOQUES_POR_PAGINA * PALABRAS_BLOQUE; i++) {
+        uint32_t palabra = desde[i].load(std::memory_order_relaxed);
+        std::memcpy(destino + i * sizeof(uint32_t), &palabra, sizeof(uint32_t));
+    }
+}
+
+void FiltroBloom::cargar_pagina(size_t pagina, const char* origen) {
+    std::atomic<uint32_t>* hasta = &palabras[pagina * BLOQUES_POR_PAGINA * PALABRAS_BLOQUE];
+    for (size_t i = 0; i < BLOQUES_POR_PAGINA * PALABRAS_BLOQUE; i++) {
+        uint32_t palabra;
+        std::memcpy(&palabra, origen + i * sizeof(uint32_t), sizeof(uint32_t));
+        hasta[i].store(palabra, std::memory_order_relaxed);
+    }
+    cambiadas[pagina] = false;
+}
+
+void FiltroBloom::marcar_guardado() {
+    std::fill(cambiadas.begin(), cambiadas.end(), false);
+}
+
+void FiltroBloom::marcar_sin_guardar() {
+    std::fill(cambiadas.begin(), cambiadas.end(), true);
+}
@@ -16,7 +16,8 @@ void mostrar_menu() {
     std::cout << "3. Modificar ciudadano\n";
     std::cout << "4. Eliminar ciudadano\n";
     std::cout << "5. Carga masiva de datos\n";
-    std::cout << "6. Salir\n";
+    std::cout << "6. Buscar ciudadanos por apellidos\n";
+    std::cout << "7. Salir\n";
     std::cout << "================================================================\n";
     std::cout << "Seleccione una opcion: ";
 }
@@ -70,6 +71,37 @@ void buscar_ciudadano(Database& db) {
     }
 }
 
+void buscar_por_nombre(Database& db) {
+    const size_t MAX_MOSTRADOS = 20;
+    std::string apellidos, nombres;
+
+    std::cout << "\n--- Buscar Ciudadanos por Apellidos ---\n";
+    std::cout << "Apellidos (o su comienzo si no se indican nombres): ";
+    std::getline(std::cin, apellidos);
+
+    std::cout << "Nombres (Enter para todos): ";
+    std::getline(std::cin, nombres);
+
+    // Se visita uno mas de los que se muestran para saber si hay mas
+    size_t mostrados = 0;
+    size_t visitados = db.buscar_por_nombre(apellidos, nombres, [&](const Ciudadano& c) {
+        if (mostrados == MAX_MOSTRADOS) {
+            return false;
+        }
+        std::cout << "\n" << c.dni << "  " << c.apellidos << ", " << c.nombres << "  (" << c.direccion << ")";
+        mostrados++;
+        return true;
+    });
+
+    if (visitados == 0) {
+        std::cout << "\nNo se encontro ningun ciudadano con esos apellidos.\n";
+    } else if (visitados > mostrados) {
+        std::cout << "\n\nSe muestran los primeros " << mostrados << ": precise los apellidos o los nombres para ver el resto.\n";
+    } else {
+        std::cout << "\n\n" << mostrados << " ciudadano(s) encontrado(s).\n";
+    }
+}
+
 void modificar_ciudadano(Database& db) {
     DNI_t dni;
 
@@ -179,16 +211,22 @@ void carga_masiva(Database& db) {
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Uso: " << argv[0] << " <archivo.db>" << std::endl;
+    // --agrupada solo cuenta al crear la base (ver ModoTabla)
+    bool agrupada = argc == 3 && std::string(argv[2]) == "--agrupada";
+    if (argc != 2 && !agrupada) {
+        std::cerr << "Uso: " << argv[0] << " <archivo.db> [--agrupada]" << std::endl;
         return 1;
     }
 
     std::string db_path = argv[1];
     Database db;
+    OpcionesDB opciones;
+    if (agrupada) {
+        opciones.modo_tabla = ModoTabla::AGRUPADA;
+    }
 
     try {
-        if (!db.abrir(db_path)) {
+        if (!db.abrir(db_path, opciones)) {
             std::cerr << "Error: No se pudo abrir o crear el archivo de la base de datos: " << db_path << std::endl;
             return 1;
         }
@@ -227,11 +265,14 @@ int main(int argc, char* argv[]) {
                     carga_masiva(db);
                     break;
                 case 6:
+                    buscar_por_nombre(db);
+                    break;
+                case 7:
                     salir = true;
                     std::cout << "\nHasta luego!\n";
                     break;
                 default:
-                    std::cout << "\nOpcion invalida. Seleccione una opcion del 1 al 6.\n";
+                    std::cout << "\nOpcion invalida. Seleccione una opcion del 1 al 7.\n";
             }
         }
 
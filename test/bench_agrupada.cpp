@@ -0,0 +1,120 @@
+#include "database.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmark de la tabla agrupada (ver ModoTabla). Carga la misma base con carga_masiva en los
+// dos modos, en BUFFER_POOL con un pool chico para que las paginas se lean del disco, y mide:
+//  - busquedas de DNIs al azar con buscar_ciudadano
+//  - recorridos por rango de DNIs con buscar_rango
+// mostrando el tiempo y las paginas fijadas y leidas del disco (ver EstadisticasBufferPool)
+// por ciudadano.
+
+static const std::vector<std::string> nombres = {
+    "Juan", "Maria", "Carlos", "Ana", "Luis", "Rosa", "Jorge", "Carmen",
+    "Pedro", "Lucia", "Miguel", "Sofia", "Jose", "Isabel", "Ricardo"
+};
+
+static const std::vector<std::string> apellidos = {
+    "Garcia", "Rodriguez", "Martinez", "Fernandez", "Lopez", "Gonzalez",
+    "Sanchez", "Perez", "Gomez", "Torres", "Quispe", "Mamani", "Huaman"
+};
+
+static double us_desde(std::chrono::steady_clock::time_point inicio) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+static void mostrar(const char* titulo, double us, size_t ciudadanos, const EstadisticasBufferPool& antes, const EstadisticasBufferPool& despues) {
+    double fijadas = static_cast<double>(despues.aciertos + despues.fallos - antes.aciertos - antes.fallos);
+    double leidas = static_cast<double>(despues.lecturas - antes.lecturas);
+    std::cout << std::left << std::setw(24) << titulo << std::right << std::fixed
+              << std::setprecision(3) << std::setw(14) << us / ciudadanos
+              << std::setw(12) << fijadas / ciudadanos << std::setw(12) << leidas / ciudadanos << std::endl;
+}
+
+static bool medir(ModoTabla modo, size_t cantidad, size_t frames, size_t num_busquedas, size_t num_rangos, size_t largo_rango) {
+    std::string ruta = "bench_agrupada.db";
+    std::remove(ruta.c_str());
+    std::remove((ruta + ".wal").c_str());
+    std::remove((ruta + ".wal.1").c_str());
+
+    OpcionesDB opciones;
+    opciones.modo_tabla = modo;
+    opciones.paginador.modo = ModoAlmacenamiento::BUFFER_POOL;
+    opciones.paginador.frames_buffer_pool = frames;
+    opciones.wal.activo = false;
+
+    bool bien = true;
+    {
+        Database db;
+        if (!db.abrir(ruta, opciones)) {
+            std::cerr << "No se pudo crear " << ruta << std::endl;
+            return false;
+        }
+
+        std::mt19937 gen(7);
+        auto al_azar = [&](const std::vector<std::string>& lista) { return lista[gen() % lista.size()]; };
+        size_t generados = 0;
+        db.carga_masiva([&](Ciudadano& c) {
+            if (generados == cantidad) return false;
+            // DNIs de dos en dos: la mitad de las busquedas no encuentra nada
+            c = Ciudadano(static_cast<DNI_t>(10000000 + 2 * generados), al_azar(nombres) + " " + al_azar(nombres),
+                          al_azar(apellidos) + " " + al_azar(apellidos), "Av. Arequipa " + std::to_string(gen() % 9000 + 100));
+            generados++;
+            return true;
+        });
+        std::cout << (modo == ModoTabla::AGRUPADA ? "AGRUPADA" : "HEAP") << ": "
+                  << db.get_estadisticas_paginador().num_paginas << " paginas" << std::endl;
+
+        std::vector<DNI_t> dnis;
+        for (size_t i = 0; i < num_busquedas; i++) {
+            dnis.push_back(static_cast<DNI_t>(10000000 + gen() % (2 * cantidad)));
+        }
+        size_t encontrados = 0;
+        EstadisticasBufferPool antes = db.get_estadisticas_paginador().buffer_pool;
+        auto inicio = std::chrono::steady_clock::now();
+        for (DNI_t dni : dnis) {
+            encontrados += db.buscar_ciudadano(dni).has_value();
+        }
+        double us = us_desde(inicio);
+        mostrar("  buscar_ciudadano", us, num_busquedas, antes, db.get_estadisticas_paginador().buffer_pool);
+
+        size_t visitados = 0;
+        antes = db.get_estadisticas_paginador().buffer_pool;
+        inicio = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < num_rangos; i++) {
+            DNI_t desde = static_cast<DNI_t>(10000000 + gen() % (2 * cantidad));
+            visitados += db.buscar_rango(desde, desde + static_cast<DNI_t>(2 * largo_rango - 1), [](const Ciudadano&) { return true; });
+        }
+        us = us_desde(inicio);
+        mostrar("  buscar_rango", us, std::max<size_t>(1, visitados), antes, db.get_estadisticas_paginador().buffer_pool);
+
+        // Para comparar los dos modos: con la misma semilla encuentran lo mismo
+        std::cout << "  encontrados " << encontrados << ", visitados " << visitados << std::endl;
+        bien = encontrados > 0 && visitados > 0;
+    }
+
+    std::remove(ruta.c_str());
+    std::remove((ruta + ".wal").c_str());
+    std::remove((ruta + ".wal.1").c_str());
+    return bien;
+}
+
+int main(int argc, char* argv[]) {
+    size_t cantidad = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t frames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024;
+    size_t num_busquedas = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 200000;
+    size_t num_rangos = 2000;
+    size_t largo_rango = 100;
+
+    std::cout << cantidad << " ciudadanos, pool de " << frames << " frames" << std::endl;
+    std::cout << std::left << std::setw(24) << "" << std::right << std::setw(14) << "us/ciudadano"
+              << std::setw(12) << "fijadas" << std::setw(12) << "leidas" << std::endl;
+    bool bien = medir(ModoTabla::HEAP, cantidad, frames, num_busquedas, num_rangos, largo_rango) &&
+                medir(ModoTabla::AGRUPADA, cantidad, frames, num_busquedas, num_rangos, largo_rango);
+    return bien ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+#include "index/bplustree.hpp"
+#include "index/busqueda_nodo.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Microbenchmark de la busqueda dentro de un nodo (ver index/busqueda_nodo.hpp).
+//  1. Por nodo: nodos internos (510 claves) y hojas (408 claves) llenos, con std::upper_bound
+//     como referencia y cada kernel. Para las hojas la referencia es ademas std::lower_bound
+//     sobre el formato anterior, con entradas {clave, RegistroID} de 12 bytes.
+//  2. Por nivel del arbol: un B+ Tree cargado con construir_desde_ordenados y busquedas de
+//     claves al azar con cada kernel; el tiempo se divide por la altura.
+
+static const KernelBusqueda KERNELS[] = {KernelBusqueda::ESCALAR, KernelBusqueda::SSE2, KernelBusqueda::AVX2};
+
+// Evita que el compilador descarte los resultados
+static volatile size_t sumidero;
+
+template <typename Funcion>
+static double medir_ns(size_t repeticiones, Funcion&& funcion) {
+    auto inicio = std::chrono::steady_clock::now();
+    size_t suma = 0;
+    for (size_t i = 0; i < repeticiones; i++) {
+        suma += funcion(i);
+    }
+    auto fin = std::chrono::steady_clock::now();
+    sumidero = suma;
+    return std::chrono::duration<double, std::nano>(fin - inicio).count() / repeticiones;
+}
+
+static void imprimir(const std::string& nombre, double ns, double referencia) {
+    std::cout << "  " << std::left << std::setw(22) << nombre << std::right << std::fixed << std::setprecision(1)
+              << std::setw(8) << ns << " ns" << std::setw(8) << std::setprecision(2) << referencia / ns << "x" << std::endl;
+}
+
+// Hojas del formato 1 (ver migrar_hojas_v1)
+struct EntradaHojaV1 {
+    DNI_t clave;
+    RegistroID valor;
+};
+
+static void bench_nodos(size_t num_nodos, size_t repeticiones) {
+    std::mt19937 gen(42);
+    const size_t n_interno = BPlusTree::Interno::MAX_CLAVES;
+    const size_t n_hoja = BPlusTree::Hoja::MAX_CLAVES;
+
+    // num_nodos nodos distintos: con muchos, cada busqueda paga ademas los fallos de cache
+    std::vector<DNI_t> internos(num_nodos * n_interno);
+    std::vector<DNI_t> hojas(num_nodos * n_hoja);
+    std::vector<EntradaHojaV1> hojas_v1(num_nodos * n_hoja);
+    for (size_t nodo = 0; nodo < num_nodos; nodo++) {
+        std::vector<DNI_t> claves(n_interno);
+        for (auto& clave : claves) clave = 10000000 + gen() % 90000000;
+        std::sort(claves.begin(), claves.end());
+        std::copy(claves.begin(), claves.end(), internos.begin() + nodo * n_interno);
+        for (size_t i = 0; i < n_hoja; i++) {
+            hojas[nodo * n_hoja + i] = claves[i * n_interno / n_hoja];
+            hojas_v1[nodo * n_hoja + i] = EntradaHojaV1{hojas[nodo * n_hoja + i], RegistroID{0, 0}};
+        }
+    }
+    std::vector<DNI_t> buscadas(1 << 16);
+    std::vector<uint32_t> nodos(buscadas.size());
+    for (size_t i = 0; i < buscadas.size(); i++) {
+        buscadas[i] = 10000000 + gen() % 90000000;
+        nodos[i] = gen() % num_nodos;
+    }
+    const size_t mascara = buscadas.size() - 1;
+
+    std::cout << "\nNodo interno (" << n_interno << " claves), " << num_nodos << " nodos distintos:" << std::endl;
+    double referencia = medir_ns(repeticiones, [&](size_t i) {
+        const DNI_t* claves = &internos[nodos[i & mascara] * n_interno];
+        return static_cast<size_t>(std::upper_bound(claves, claves + n_interno, buscadas[i & mascara]) - claves);
+    });
+    imprimir("std::upper_bound", referencia, referencia);
+    for (KernelBusqueda kernel : KERNELS) {
+        if (!usar_kernel_busqueda(kernel)) continue;
+        double ns = medir_ns(repeticiones, [&](size_t i) {
+            return posicion_superior(&internos[nodos[i & mascara] * n_interno], n_interno, buscadas[i & mascara]);
+        });
+        imprimir(nombre_kernel_busqueda(kernel), ns, referencia);
+    }
+
+    std::cout << "Hoja (" << n_hoja << " claves), " << num_nodos << " nodos distintos:" << std::endl;
+    referencia = medir_ns(repeticiones, [&](size_t i) {
+        const EntradaHojaV1* entradas = &hojas_v1[nodos[i & mascara] * n_hoja];
+        return static_cast<size_t>(std::lower_bound(entradas, entradas + n_hoja, buscadas[i & mascara],
+            [](const EntradaHojaV1& a, DNI_t b) { return a.clave < b; }) - entradas);
+    });
+    imprimir("lower_bound formato 1", referencia, referencia);
+    double ns_lower_bound = medir_ns(repeticiones, [&](size_t i) {
+        const DNI_t* claves = &hojas[nodos[i & mascara] * n_hoja];
+        return static_cast<size_t>(std::lower_bound(claves, claves + n_hoja, buscadas[i & mascara]) - claves);
+    });
+    imprimir("std::lower_bound", ns_lower_bound, referencia);
+    for (KernelBusqueda kernel : KERNELS) {
+        if (!usar_kernel_busqueda(kernel)) continue;
+        double ns = medir_ns(repeticiones, [&](size_t i) {
+            return posicion_inferior(&hojas[nodos[i & mascara] * n_hoja], n_hoja, buscadas[i & mascara]);
+        });
+        imprimir(nombre_kernel_busqueda(kernel), ns, referencia);
+    }
+}
+
+static void bench_arbol(size_t cantidad, size_t repeticiones) {
+    std::string ruta = "bench_busqueda_nodo.tmp";
+    std::remove(ruta.c_str());
+
+    Paginador paginador;
+    if (!paginador.abrir(ruta, 10)) {
+        std::cerr << "No se pudo crear " << ruta << std::endl;
+        return;
+    }
+    paginador.fijar_num_paginas(1);
+    BPlusTree arbol(paginador);
+    arbol.inicializar(INVALID_PAGE_ID);
+
+    // Claves separadas por 7 para que la mitad de las busquedas caigan entre dos claves
+    size_t siguiente = 0;
+    arbol.construir_desde_ordenados([&](DNI_t& clave, RegistroID& valor) {
+        if (siguiente == cantidad) return false;
+        clave = static_cast<DNI_t>(10000000 + 7 * siguiente);
+        valor = RegistroID{static_cast<PaginaID>(siguiente), 0};
+        siguiente++;
+        return true;
+    }, 0.9);
+
+    size_t altura = 1;
+    for (PaginaID id = arbol.get_id_raiz(); ; altura++) {
+        PaginaFijada pagina = paginador.fijar_pagina(id);
+        if (reinterpret_cast<BPlusTreeHeader*>(pagina.datos())->tipo == TipoNodo::Hoja) break;
+        id = reinterpret_cast<PaginaID*>(pagina.datos() + sizeof(BPlusTreeHeader))[0];
+    }
+
+    std::mt19937 gen(7);
+    std::vector<DNI_t> buscadas(1 << 16);
+    for (auto& clave : buscadas) clave = static_cast<DNI_t>(10000000 + gen() % (7 * cantidad));
+    const size_t mascara = buscadas.size() - 1;
+
+    std::cout << "\nB+ Tree con " << cantidad << " claves, altura " << altura << " (tiempo por busqueda / por nivel):" << std::endl;
+    double referencia = 0;
+    for (KernelBusqueda kernel : KERNELS) {
+        if (!usar_kernel_busqueda(kernel)) continue;
+        double ns = medir_ns(repeticiones, [&](size_t i) {
+            return static_cast<size_t>(arbol.buscar(buscadas[i & mascara]).has_value());
+        });
+        if (referencia == 0) referencia = ns;
+        std::cout << "  " << std::left << std::setw(22) << nombre_kernel_busqueda(kernel) << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(8) << ns << " ns" << std::setw(8) << ns / altura << " ns/nivel"
+                  << std::setw(8) << std::setprecision(2) << referencia / ns << "x" << std::endl;
+    }
+
+    paginador.cerrar();
+    std::remove(ruta.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    size_t cantidad = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    size_t repeticiones = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+
+    KernelBusqueda detectado = get_kernel_busqueda();
+    std::cout << "Kernel elegido al arrancar: " << nombre_kernel_busqueda(detectado) << std::endl;
+
+    bench_nodos(1, repeticiones);      // Un nodo, siempre en cache
+    bench_nodos(4096, repeticiones);   // ~8 MB de nodos internos: fallos de cache como en un arbol real
+    bench_arbol(cantidad, repeticiones);
+
+    usar_kernel_busqueda(detectado);
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "index/bplustree.hpp"
+#include "index/busqueda_nodo.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmark de la cache de nodos internos del B+ Tree (ver index/cache_internos.hpp). Arma un
+// arbol con construir_desde_ordenados en BUFFER_POOL, con frames para todo el arbol (se mide
+// lo que cuesta pasar por el pool, no el disco), y busca claves al azar:
+//  - con la bajada de antes de la cache, fijando cada nodo en el paginador
+//  - con BPlusTree::buscar, que baja por los nodos fijados y solo pide la hoja al paginador
+// mostrando el tiempo y las paginas fijadas por busqueda.
+
+// Evita que el compilador descarte los resultados
+static volatile size_t sumidero;
+
+using Interno = BPlusTree::Interno;
+using Hoja = BPlusTree::Hoja;
+
+// La bajada de siempre, nodo por nodo por el paginador
+static bool buscar_por_paginador(Paginador& paginador, PaginaID id_raiz, DNI_t clave) {
+    PaginaID id = id_raiz;
+    while (true) {
+        PaginaFijada pagina = paginador.fijar_pagina(id);
+        const char* pagina_ptr = pagina.datos();
+        auto header = reinterpret_cast<const BPlusTreeHeader*>(pagina_ptr);
+        if (header->tipo == TipoNodo::Hoja) {
+            const DNI_t* claves = Hoja::claves(pagina_ptr);
+            size_t pos = posicion_inferior(claves, header->num_claves, clave);
+            return pos < header->num_claves && claves[pos] == clave;
+        }
+        auto claves = reinterpret_cast<const DNI_t*>(pagina_ptr + Interno::OFFSET_CLAVES);
+        auto hijos = reinterpret_cast<const PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+        id = hijos[posicion_superior(claves, header->num_claves, clave)];
+    }
+}
+
+template <typename Funcion>
+static void medir(Paginador& paginador, const char* titulo, size_t repeticiones, Funcion&& funcion) {
+    size_t fijadas_antes = paginador.get_estadisticas().buffer_pool.aciertos + paginador.get_estadisticas().buffer_pool.fallos;
+    auto inicio = std::chrono::steady_clock::now();
+    size_t suma = 0;
+    for (size_t i = 0; i < repeticiones; i++) {
+        suma += funcion(i);
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - inicio).count() / repeticiones;
+    sumidero = suma;
+    size_t fijadas = paginador.get_estadisticas().buffer_pool.aciertos + paginador.get_estadisticas().buffer_pool.fallos - fijadas_antes;
+
+    std::cout << "  " << std::left << std::setw(26) << titulo << std::right << std::fixed << std::setprecision(1)
+              << std::setw(8) << ns << " ns" << std::setw(8) << std::setprecision(2)
+              << static_cast<double>(fijadas) / repeticiones << " paginas fijadas" << std::endl;
+}
+
+static void bench(size_t cantidad, size_t repeticiones) {
+    std::string ruta = "bench_cache_internos.tmp";
+    std::remove(ruta.c_str());
+
+    OpcionesPaginador opciones;
+    opciones.modo = ModoAlmacenamiento::BUFFER_POOL;
+    opciones.frames_buffer_pool = cantidad / 200 + 1024; // Todo el arbol, con hojas al 90%
+    Paginador paginador;
+    if (!paginador.abrir(ruta, 10, opciones)) {
+        std::cerr << "No se pudo crear " << ruta << std::endl;
+        return;
+    }
+    paginador.fijar_num_paginas(1);
+    {
+        BPlusTree arbol(paginador);
+        arbol.inicializar(INVALID_PAGE_ID);
+
+        // Claves separadas por 7 para que la mitad de las busquedas caigan entre dos claves
+        size_t siguiente = 0;
+        arbol.construir_desde_ordenados([&](DNI_t& clave, RegistroID& valor) {
+            if (siguiente == cantidad) return false;
+            clave = static_cast<DNI_t>(10000000 + 7 * siguiente);
+            valor = RegistroID{static_cast<PaginaID>(siguiente), 0};
+            siguiente++;
+            return true;
+        }, 0.9);
+
+        std::mt19937 gen(7);
+        std::vector<DNI_t> buscadas(1 << 16);
+        for (auto& clave : buscadas) clave = static_cast<DNI_t>(10000000 + gen() % (7 * cantidad));
+        const size_t mascara = buscadas.size() - 1;
+
+        // Todas las paginas ya en el pool para las dos mediciones
+        for (size_t i = 0; i < buscadas.size(); i++) {
+            sumidero = arbol.buscar(buscadas[i]).has_value();
+        }
+
+        std::cout << cantidad << " claves, " << paginador.get_num_paginas() << " paginas, "
+                  << arbol.get_num_nodos_fijados() << " nodos internos fijados:" << std::endl;
+        PaginaID id_raiz = arbol.get_id_raiz();
+        medir(paginador, "por el paginador", repeticiones, [&](size_t i) {
+            return static_cast<size_t>(buscar_por_paginador(paginador, id_raiz, buscadas[i & mascara]));
+        });
+        medir(paginador, "BPlusTree::buscar", repeticiones, [&](size_t i) {
+            return static_cast<size_t>(arbol.buscar(buscadas[i & mascara]).has_value());
+        });
+    }
+
+    paginador.cerrar();
+    std::remove(ruta.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    size_t cantidad = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t repeticiones = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 3000000;
+
+    bench(cantidad, repeticiones);
+    return 0;
+}
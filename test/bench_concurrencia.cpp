@@ -0,0 +1,177 @@
+#include "index/bplustree.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Benchmark de concurrencia del B+ Tree (ver "Concurrencia" en index/bplustree.hpp).
+// Arma un arbol con construir_desde_ordenados (claves pares) y mide operaciones por segundo
+// con 1, 2, 4... hilos para tres mezclas de operaciones, de dos maneras:
+//  - latches: el arbol tal cual, con busquedas optimistas y escrituras que bloquean la hoja
+//  - mutex global: cada operacion con un std::mutex compartido, como hacia la Database
+// Cada hilo inserta claves impares propias (clave % hilos == hilo) y borra solo las que
+// inserto, asi el tamaño del arbol se mantiene y al final se puede verificar todo.
+
+struct Mezcla {
+    const char* nombre;
+    unsigned porcentaje_insertar;
+    unsigned porcentaje_eliminar; // El resto son busquedas
+};
+
+static const Mezcla MEZCLAS[] = {
+    {"solo busquedas", 0, 0},
+    {"90% busquedas", 5, 5},
+    {"50% busquedas", 25, 25},
+};
+
+struct Resultado {
+    double mops;
+    bool correcto;
+};
+
+static Resultado medir(BPlusTree& arbol, size_t cantidad, const Mezcla& mezcla, unsigned hilos, double segundos, bool mutex_global) {
+    std::mutex mutex;
+    std::atomic<bool> parar{false};
+    std::atomic<bool> correcto{true};
+    std::vector<size_t> operaciones(hilos, 0);
+    std::vector<std::vector<DNI_t>> insertadas(hilos);
+
+    // Con mutex_global la operacion entera va con el mutex tomado
+    auto ejecutar = [&](auto&& operacion) {
+        if (mutex_global) {
+            std::lock_guard<std::mutex> lock(mutex);
+            return operacion();
+        }
+        return operacion();
+    };
+
+    std::vector<std::thread> trabajadores;
+    for (unsigned h = 0; h < hilos; h++) {
+        trabajadores.emplace_back([&, h] {
+            std::mt19937_64 gen(h * 7919 + 1);
+            std::vector<DNI_t>& propias = insertadas[h];
+            size_t hechas = 0;
+            while (!parar.load(std::memory_order_relaxed)) {
+                // De a 64 operaciones entre consultas a parar
+                for (int i = 0; i < 64; i++) {
+                    unsigned dado = static_cast<unsigned>(gen() % 100);
+                    if (dado < mezcla.porcentaje_insertar) {
+                        DNI_t clave = static_cast<DNI_t>((gen() % cantidad) / hilos * hilos + h) * 2 + 1;
+                        RegistroID valor{clave, 1};
+                        if (ejecutar([&] { return arbol.insertar(clave, valor); })) {
+                            propias.push_back(clave);
+                        }
+                    } else if (dado < mezcla.porcentaje_insertar + mezcla.porcentaje_eliminar) {
+                        if (propias.empty()) continue;
+                        size_t elegida = gen() % propias.size();
+                        DNI_t clave = propias[elegida];
+                        if (!ejecutar([&] { return arbol.eliminar(clave); })) {
+                            correcto = false;
+                        }
+                        propias[elegida] = propias.back();
+                        propias.pop_back();
+                    } else {
+                        DNI_t clave = static_cast<DNI_t>(gen() % cantidad) * 2;
+                        auto valor = ejecutar([&] { return arbol.buscar(clave); });
+                        if (!valor.has_value() || valor->pagina_id != clave / 2) {
+                            correcto = false;
+                        }
+                    }
+                    hechas++;
+                }
+            }
+            operaciones[h] = hechas;
+        });
+    }
+
+    auto inicio = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::duration<double>(segundos));
+    parar = true;
+    for (auto& trabajador : trabajadores) {
+        trabajador.join();
+    }
+    double transcurrido = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+    // Cada hilo encuentra sus claves; despues se borran para dejar el arbol como estaba
+    size_t total = 0;
+    for (unsigned h = 0; h < hilos; h++) {
+        total += operaciones[h];
+        for (DNI_t clave : insertadas[h]) {
+            auto valor = arbol.buscar(clave);
+            if (!valor.has_value() || valor->pagina_id != clave || !arbol.eliminar(clave)) {
+                correcto = false;
+            }
+        }
+    }
+    return Resultado{total / transcurrido / 1e6, correcto.load()};
+}
+
+int main(int argc, char* argv[]) {
+    size_t cantidad = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000000;
+    double segundos = argc > 2 ? std::strtod(argv[2], nullptr) : 1.0;
+    unsigned max_hilos = argc > 3 ? static_cast<unsigned>(std::strtoul(argv[3], nullptr, 10)) : std::max(1u, std::thread::hardware_concurrency());
+
+    std::string ruta = "bench_concurrencia.tmp";
+    std::remove(ruta.c_str());
+
+    Paginador paginador;
+    if (!paginador.abrir(ruta, 10)) {
+        std::cerr << "No se pudo crear " << ruta << std::endl;
+        return 1;
+    }
+    paginador.fijar_num_paginas(1);
+    BPlusTree arbol(paginador);
+    arbol.inicializar(INVALID_PAGE_ID);
+
+    // Claves pares con el valor clave / 2; las impares quedan para insertar. Con hojas al 70%
+    // las inserciones dividen poco y casi todas van por el camino que bloquea solo la hoja.
+    size_t siguiente = 0;
+    arbol.construir_desde_ordenados([&](DNI_t& clave, RegistroID& valor) {
+        if (siguiente == cantidad) return false;
+        clave = static_cast<DNI_t>(siguiente * 2);
+        valor = RegistroID{static_cast<PaginaID>(siguiente), 0};
+        siguiente++;
+        return true;
+    }, 0.7);
+
+    std::vector<unsigned> hilos;
+    for (unsigned h = 1; h < max_hilos; h *= 2) {
+        hilos.push_back(h);
+    }
+    hilos.push_back(max_hilos);
+
+    std::cout << "Arbol con " << cantidad << " claves, " << segundos << " s por medicion, hasta "
+              << max_hilos << " hilos (Mops/s y aceleracion respecto de 1 hilo)" << std::endl;
+
+    bool todo_correcto = true;
+    for (const Mezcla& mezcla : MEZCLAS) {
+        std::cout << "\n" << mezcla.nombre << ":" << std::endl;
+        std::cout << std::setw(8) << "hilos" << std::setw(22) << "latches" << std::setw(22) << "mutex global" << std::endl;
+        double base_latches = 0;
+        double base_mutex = 0;
+        for (unsigned h : hilos) {
+            Resultado latches = medir(arbol, cantidad, mezcla, h, segundos, false);
+            Resultado mutex = medir(arbol, cantidad, mezcla, h, segundos, true);
+            todo_correcto = todo_correcto && latches.correcto && mutex.correcto;
+            if (base_latches == 0) {
+                base_latches = latches.mops;
+                base_mutex = mutex.mops;
+            }
+            std::cout << std::setw(8) << h << std::fixed << std::setprecision(2)
+                      << std::setw(12) << latches.mops << std::setw(8) << latches.mops / base_latches << "x  "
+                      << std::setw(12) << mutex.mops << std::setw(8) << mutex.mops / base_mutex << "x" << std::endl;
+        }
+    }
+
+    std::cout << "\nVerificacion: " << (todo_correcto ? "correcto" : "ERROR") << std::endl;
+    paginador.cerrar();
+    std::remove(ruta.c_str());
+    return todo_correcto ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+#include "database.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmark del filtro de DNIs (ver OpcionesDB::filtro_dni). Carga la misma base con
+// carga_masiva con y sin filtro, en BUFFER_POOL, y mide:
+//  - abrir la base ya cerrada (con filtro lo lee de sus paginas)
+//  - buscar_ciudadano de DNIs que no estan
+//  - buscar_ciudadano de DNIs que estan
+//  - insertar_lote de ciudadanos nuevos, cuya comprobacion de repetidos el filtro se ahorra
+// mostrando el tiempo y las paginas fijadas por operacion (ver EstadisticasBufferPool).
+// Despues llena una base nueva de a un ciudadano con insertar_ciudadano, bastante mas alla de
+// la capacidad con la que se crea el filtro (FiltroBloom::MIN_CLAVES), y mide en la misma
+// sesion las busquedas de DNIs que no estan: el filtro tiene que haber crecido y seguir
+// descartandolas sin fijar paginas.
+
+static double us_desde(std::chrono::steady_clock::time_point inicio) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+static void mostrar(const char* titulo, double us, size_t operaciones, const EstadisticasBufferPool& antes, const EstadisticasBufferPool& despues) {
+    double fijadas = static_cast<double>(despues.aciertos + despues.fallos - antes.aciertos - antes.fallos);
+    std::cout << std::left << std::setw(24) << titulo << std::right << std::fixed
+              << std::setprecision(3) << std::setw(14) << us / operaciones
+              << std::setw(12) << fijadas / operaciones << std::endl;
+}
+
+static Ciudadano ciudadano(DNI_t dni) {
+    return Ciudadano(dni, "Juan Carlos", "Quispe Mamani", "Av. Arequipa " + std::to_string(dni % 9000 + 100));
+}
+
+static bool medir(bool con_filtro, size_t cantidad, size_t frames, size_t num_busquedas) {
+    std::string ruta = "bench_filtro.db";
+    std::remove(ruta.c_str());
+    std::remove((ruta + ".wal").c_str());
+    std::remove((ruta + ".wal.1").c_str());
+
+    OpcionesDB opciones;
+    opciones.filtro_dni = con_filtro;
+    opciones.paginador.modo = ModoAlmacenamiento::BUFFER_POOL;
+    opciones.paginador.frames_buffer_pool = frames;
+
+    // DNIs pares: los impares no estan
+    {
+        Database db;
+        if (!db.abrir(ruta, opciones)) {
+            std::cerr << "No se pudo crear " << ruta << std::endl;
+            return false;
+        }
+        size_t generados = 0;
+        db.carga_masiva([&](Ciudadano& c) {
+            if (generados == cantidad) return false;
+            c = ciudadano(static_cast<DNI_t>(10000000 + 2 * generados));
+            generados++;
+            return true;
+        });
+    }
+
+    std::cout << (con_filtro ? "Con filtro" : "Sin filtro") << std::endl;
+    bool bien = false;
+    {
+        auto inicio = std::chrono::steady_clock::now();
+        Database db;
+        if (!db.abrir(ruta, opciones)) {
+            std::cerr << "No se pudo abrir " << ruta << std::endl;
+            return false;
+        }
+        std::cout << "  abrir: " << std::fixed << std::setprecision(1) << us_desde(inicio) / 1000 << " ms" << std::endl;
+
+        std::mt19937 gen(7);
+        std::vector<DNI_t> ausentes, presentes;
+        for (size_t i = 0; i < num_busquedas; i++) {
+            ausentes.push_back(static_cast<DNI_t>(10000000 + 2 * (gen() % cantidad) + 1));
+            presentes.push_back(static_cast<DNI_t>(10000000 + 2 * (gen() % cantidad)));
+        }
+
+        size_t encontrados = 0;
+        EstadisticasBufferPool antes = db.get_estadisticas_paginador().buffer_pool;
+        inicio = std::chrono::steady_clock::now();
+        for (DNI_t dni : ausentes) {
+            encontrados += db.buscar_ciudadano(dni).has_value();
+        }
+        mostrar("  buscar (no estan)", us_desde(inicio), num_busquedas, antes, db.get_estadisticas_paginador().buffer_pool);
+
+        antes = db.get_estadisticas_paginador().buffer_pool;
+        inicio = std::chrono::steady_clock::now();
+        for (DNI_t dni : presentes) {
+            encontrados += db.buscar_ciudadano(dni).has_value();
+        }
+        mostrar("  buscar (estan)", us_desde(inicio), num_busquedas, antes, db.get_estadisticas_paginador().buffer_pool);
+
+        // Los impares que no se buscaron: nuevos, repartidos por todo el arbol
+        std::vector<Ciudadano> nuevos;
+        for (size_t i = 0; i < num_busquedas; i++) {
+            nuevos.push_back(ciudadano(static_cast<DNI_t>(10000000 + 2 * (gen() % cantidad) + 1)));
+        }
+        antes = db.get_estadisticas_paginador().buffer_pool;
+        inicio = std::chrono::steady_clock::now();
+        size_t insertados = db.insertar_lote(nuevos);
+        mostrar("  insertar_lote", us_desde(inicio), num_busquedas, antes, db.get_estadisticas_paginador().buffer_pool);
+
+        // Para comparar: con y sin filtro encuentran e insertan lo mismo
+        std::cout << "  encontrados " << encontrados << ", insertados " << insertados << std::endl;
+        bien = encontrados == num_busquedas && insertados > 0;
+    }
+
+    std::remove(ruta.c_str());
+    std::remove((ruta + ".wal").c_str());
+    std::remove((ruta + ".wal.1").c_str());
+    return bien;
+}
+
+static void borrar(const std::string& ruta) {
+    std::remove(ruta.c_str());
+    std::remove((ruta + ".wal").c_str());
+    std::remove((ruta + ".wal.1").c_str());
+}
+
+static bool medir_insertando(size_t cantidad, size_t frames, size_t num_busquedas) {
+    std::string ruta = "bench_filtro.db";
+    borrar(ruta);
+
+    // Sin WAL: cada insertar_ciudadano esperaria su fdatasync
+    OpcionesDB opciones;
+    opciones.wal.activo = false;
+    opciones.paginador.modo = ModoAlmacenamiento::BUFFER_POOL;
+    opciones.paginador.frames_buffer_pool = frames;
+
+    std::cout << "Con filtro, " << cantidad << " insertar_ciudadano en una base nueva" << std::endl;
+    bool bien = false;
+    {
+        Database db;
+        if (!db.abrir(ruta, opciones)) {
+            std::cerr << "No se pudo crear " << ruta << std::endl;
+            return false;
+        }
+        // DNIs pares al azar; cada tanto uno repetido, que no tiene que contar en el filtro
+        std::mt19937 gen(11);
+        std::vector<DNI_t> dnis(cantidad);
+        for (size_t i = 0; i < cantidad; i++) {
+            dnis[i] = static_cast<DNI_t>(10000000 + 2 * i);
+        }
+        std::shuffle(dnis.begin(), dnis.end(), gen);
+        auto inicio = std::chrono::steady_clock::now();
+        size_t insertados = 0;
+        for (size_t i = 0; i < cantidad; i++) {
+            insertados += db.insertar_ciudadano(ciudadano(dnis[i]));
+            if (i % 16 == 15) {
+                db.insertar_ciudadano(ciudadano(dnis[i - 15]));
+            }
+        }
+        std::cout << "  insertar: " << std::fixed << std::setprecision(1) << us_desde(inicio) / 1000 << " ms" << std::endl;
+
+        size_t encontrados = 0;
+        EstadisticasBufferPool antes = db.get_estadisticas_paginador().buffer_pool;
+        inicio = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < num_busquedas; i++) {
+            encontrados += db.buscar_ciudadano(static_cast<DNI_t>(10000000 + 2 * (gen() % cantidad) + 1)).has_value();
+        }
+        EstadisticasBufferPool despues = db.get_estadisticas_paginador().buffer_pool;
+        mostrar("  buscar (no estan)", us_desde(inicio), num_busquedas, antes, despues);
+
+        // Con ~1% de falsos positivos casi ninguna busqueda baja por el arbol (cada bajada fija
+        // dos o tres paginas); con el filtro saturado serian casi todas
+        double fijadas = static_cast<double>(despues.aciertos + despues.fallos - antes.aciertos - antes.fallos) / num_busquedas;
+        bien = insertados == cantidad && encontrados == 0 && fijadas < 0.1;
+        if (!bien) {
+            std::cerr << "  El filtro no descarta los DNIs que no estan (" << fijadas << " paginas fijadas por busqueda)" << std::endl;
+        }
+    }
+    borrar(ruta);
+    return bien;
+}
+
+int main(int argc, char* argv[]) {
+    size_t cantidad = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t frames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1024;
+    size_t num_busquedas = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 200000;
+    size_t cantidad_insertando = argc > 4 ? std::strtoull(argv[4], nullptr, 10) : 600000;
+
+    std::cout << cantidad << " ciudadanos, pool de " << frames << " frames" << std::endl;
+    std::cout << std::left << std::setw(24) << "" << std::right << std::setw(14) << "us/operacion"
+              << std::setw(12) << "fijadas" << std::endl;
+    bool bien = medir(false, cantidad, frames, num_busquedas) && medir(true, cantidad, frames, num_busquedas) &&
+                medir_insertando(cantidad_insertando, frames, num_busquedas);
+    return bien ? 0 : 1;
+}
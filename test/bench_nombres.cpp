@@ -0,0 +1,134 @@
+#include "database.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmark del indice de apellidos y nombres (ver Database::buscar_por_nombre). Carga una
+// base con carga_masiva y compara, para las mismas busquedas:
+//  - buscar_por_nombre, que baja por el indice y lee solo los registros que coinciden
+//  - un recorrido de toda la base (buscar_rango de todos los DNIs) filtrando los apellidos,
+//    que es lo que habia que hacer sin el indice
+// Las busquedas son por los dos apellidos completos, por el primero solo, y por los dos
+// apellidos mas el comienzo del nombre.
+
+static const std::vector<std::string> nombres = {
+    "Juan", "Maria", "Carlos", "Ana", "Luis", "Rosa", "Jorge", "Carmen",
+    "Pedro", "Lucia", "Miguel", "Sofia", "Jose", "Isabel", "Ricardo",
+    "Elena", "Fernando", "Patricia", "Roberto", "Teresa"
+};
+
+static const std::vector<std::string> apellidos = {
+    "Garcia", "Rodriguez", "Martinez", "Fernandez", "Lopez", "Gonzalez",
+    "Sanchez", "Perez", "Gomez", "Torres", "Ramirez", "Flores", "Rivera",
+    "Silva", "Mendoza", "Castro", "Chavez", "Rojas", "Vargas", "Quispe",
+    "Mamani", "Huaman", "Condori", "Ccahuana", "Apaza", "Choque", "Ticona",
+    "Huanca", "Layme", "Yupanqui"
+};
+
+struct Busqueda {
+    std::string apellidos;
+    std::string nombres;
+};
+
+static double ms_desde(std::chrono::steady_clock::time_point inicio) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+static bool medir(Database& db, const char* titulo, const std::vector<Busqueda>& busquedas, size_t recorridos) {
+    std::vector<size_t> encontrados;
+    auto inicio = std::chrono::steady_clock::now();
+    for (const Busqueda& busqueda : busquedas) {
+        encontrados.push_back(db.buscar_por_nombre(busqueda.apellidos, busqueda.nombres, [](const Ciudadano&) { return true; }));
+    }
+    double ms_indice = ms_desde(inicio) / busquedas.size();
+
+    // El recorrido completo cuesta lo mismo para cualquier busqueda: se mide con las primeras,
+    // y de paso se verifica que el indice encuentre los mismos
+    bool iguales = true;
+    inicio = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < recorridos; i++) {
+        size_t encontrados_recorrido = 0;
+        std::string apellidos_buscados = normalizar_nombre(busquedas[i].apellidos);
+        std::string nombres_buscados = normalizar_nombre(busquedas[i].nombres);
+        db.buscar_rango(0, UINT32_MAX, [&](const Ciudadano& c) {
+            std::string a = normalizar_nombre(c.apellidos);
+            bool coincide = nombres_buscados.empty() ? a.compare(0, apellidos_buscados.size(), apellidos_buscados) == 0
+                                                     : a == apellidos_buscados && normalizar_nombre(c.nombres).compare(0, nombres_buscados.size(), nombres_buscados) == 0;
+            encontrados_recorrido += coincide;
+            return true;
+        });
+        iguales = iguales && encontrados_recorrido == encontrados[i];
+    }
+    double ms_recorrido = ms_desde(inicio) / recorridos;
+
+    size_t total = 0;
+    for (size_t n : encontrados) total += n;
+    std::cout << std::left << std::setw(28) << titulo << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << static_cast<double>(total) / busquedas.size()
+              << std::setprecision(3) << std::setw(14) << ms_indice
+              << std::setprecision(1) << std::setw(14) << ms_recorrido
+              << std::setw(10) << ms_recorrido / ms_indice << "x" << std::endl;
+    if (!iguales) {
+        std::cerr << "El indice y el recorrido no encontraron los mismos ciudadanos" << std::endl;
+    }
+    return iguales;
+}
+
+int main(int argc, char* argv[]) {
+    size_t cantidad = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    size_t num_busquedas = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200;
+    size_t recorridos = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 3;
+    recorridos = std::max<size_t>(1, std::min(recorridos, num_busquedas));
+
+    std::string ruta = "bench_nombres.db";
+    std::remove(ruta.c_str());
+    std::remove((ruta + ".wal").c_str());
+    std::remove((ruta + ".wal.1").c_str());
+
+    bool bien = false;
+    std::mt19937 gen(7);
+    auto al_azar = [&](const std::vector<std::string>& lista) { return lista[gen() % lista.size()]; };
+    {
+        Database db;
+        if (!db.abrir(ruta)) {
+            std::cerr << "No se pudo crear " << ruta << std::endl;
+            return 1;
+        }
+
+        size_t generados = 0;
+        auto inicio = std::chrono::steady_clock::now();
+        db.carga_masiva([&](Ciudadano& c) {
+            if (generados == cantidad) return false;
+            c = Ciudadano(static_cast<DNI_t>(10000000 + generados), al_azar(nombres) + " " + al_azar(nombres),
+                          al_azar(apellidos) + " " + al_azar(apellidos), "Av. Arequipa " + std::to_string(gen() % 9000 + 100));
+            generados++;
+            return true;
+        });
+        std::cout << cantidad << " ciudadanos cargados en " << std::fixed << std::setprecision(0) << ms_desde(inicio) << " ms, "
+                  << db.get_estadisticas_paginador().num_paginas << " paginas" << std::endl;
+
+        std::vector<Busqueda> completos, primero, con_nombre;
+        for (size_t i = 0; i < num_busquedas; i++) {
+            std::string apellido1 = al_azar(apellidos);
+            std::string apellido2 = al_azar(apellidos);
+            completos.push_back({apellido1 + " " + apellido2, ""});
+            primero.push_back({apellido1, ""});
+            con_nombre.push_back({apellido1 + " " + apellido2, al_azar(nombres).substr(0, 3)});
+        }
+
+        std::cout << std::left << std::setw(28) << "busqueda" << std::right << std::setw(12) << "resultados"
+                  << std::setw(14) << "indice ms" << std::setw(14) << "recorrido ms" << std::setw(11) << "mejora" << std::endl;
+        bien = medir(db, "apellidos completos", completos, recorridos) &&
+               medir(db, "primer apellido", primero, recorridos) &&
+               medir(db, "apellidos y nombre", con_nombre, recorridos);
+    }
+
+    std::remove(ruta.c_str());
+    std::remove((ruta + ".wal").c_str());
+    std::remove((ruta + ".wal.1").c_str());
+    return bien ? 0 : 1;
+}
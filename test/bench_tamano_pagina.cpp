@@ -0,0 +1,116 @@
+#include "index/bplustree.hpp"
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmark del tamaño de pagina y de clave del B+ Tree (ver BPlusTreeGenerico).
+// Para cada variante compilada en bplustree.cpp (paginas de 4, 16 y 64 KB; claves de 4 y
+// 8 bytes) arma el mismo arbol con construir_desde_ordenados y mide:
+//  - busquedas puntuales de claves al azar (la mitad no esta)
+//  - recorridos: buscar_desde una clave al azar y avanzar el iterador un tramo fijo
+// Las paginas grandes dejan el arbol mas bajo y las hojas mas largas: menos niveles por
+// busqueda, pero mas claves que mirar en cada nodo.
+
+// Evita que el compilador descarte los resultados
+static volatile size_t sumidero;
+
+template <typename Funcion>
+static double medir_ns(size_t repeticiones, Funcion&& funcion) {
+    auto inicio = std::chrono::steady_clock::now();
+    size_t suma = 0;
+    for (size_t i = 0; i < repeticiones; i++) {
+        suma += funcion(i);
+    }
+    auto fin = std::chrono::steady_clock::now();
+    sumidero = suma;
+    return std::chrono::duration<double, std::nano>(fin - inicio).count() / repeticiones;
+}
+
+template <typename Clave, size_t TAM_PAGINA>
+static bool medir(size_t cantidad, size_t busquedas, size_t tramo) {
+    using Arbol = BPlusTreeGenerico<Clave, RegistroID, TAM_PAGINA>;
+    std::string ruta = "bench_tamano_pagina.tmp";
+    std::remove(ruta.c_str());
+
+    OpcionesPaginador opciones;
+    opciones.size_pagina = TAM_PAGINA;
+    Paginador paginador;
+    if (!paginador.abrir(ruta, 10, opciones)) {
+        std::cerr << "No se pudo crear " << ruta << std::endl;
+        return false;
+    }
+    paginador.fijar_num_paginas(1);
+    Arbol arbol(paginador);
+    arbol.inicializar(INVALID_PAGE_ID);
+
+    // Claves separadas por 2 para que la mitad de las busquedas caigan entre dos claves
+    size_t siguiente = 0;
+    auto inicio = std::chrono::steady_clock::now();
+    arbol.construir_desde_ordenados([&](Clave& clave, RegistroID& valor) {
+        if (siguiente == cantidad) return false;
+        clave = static_cast<Clave>(2 * siguiente);
+        valor = RegistroID{static_cast<PaginaID>(siguiente), 0};
+        siguiente++;
+        return true;
+    }, 0.9);
+    double carga_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - inicio).count();
+
+    size_t altura = 1;
+    for (PaginaID id = arbol.get_id_raiz(); ; altura++) {
+        PaginaFijada pagina = paginador.fijar_pagina(id);
+        if (reinterpret_cast<BPlusTreeHeader*>(pagina.datos())->tipo == TipoNodo::Hoja) break;
+        id = reinterpret_cast<PaginaID*>(pagina.datos() + sizeof(BPlusTreeHeader))[0];
+    }
+
+    std::mt19937_64 gen(7);
+    std::vector<Clave> buscadas(1 << 16);
+    for (auto& clave : buscadas) clave = static_cast<Clave>(gen() % (2 * cantidad));
+    const size_t mascara = buscadas.size() - 1;
+
+    double ns_busqueda = medir_ns(busquedas, [&](size_t i) {
+        return static_cast<size_t>(arbol.buscar(buscadas[i & mascara]).has_value());
+    });
+    size_t recorridos = std::max<size_t>(1, busquedas / tramo);
+    double ns_recorrido = medir_ns(recorridos, [&](size_t i) {
+        size_t leidas = 0;
+        for (auto it = arbol.buscar_desde(buscadas[i & mascara]); it.valido() && leidas < tramo; it.siguiente()) {
+            leidas += it.valor().slot_id + 1;
+        }
+        return leidas;
+    });
+
+    double mb = static_cast<double>(paginador.get_num_paginas()) * TAM_PAGINA / (1 << 20);
+    std::cout << std::setw(6) << TAM_PAGINA / 1024 << " KB" << std::setw(7) << sizeof(Clave) << " B"
+              << std::setw(9) << Arbol::Interno::MAX_CLAVES + 1 << std::setw(8) << Arbol::Hoja::MAX_CLAVES
+              << std::setw(7) << altura << std::fixed << std::setprecision(1)
+              << std::setw(10) << mb << std::setw(10) << carga_ms
+              << std::setw(12) << ns_busqueda << std::setw(12) << ns_recorrido / tramo << std::endl;
+
+    paginador.cerrar();
+    std::remove(ruta.c_str());
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t cantidad = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10000000;
+    size_t busquedas = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 2000000;
+    size_t tramo = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000;
+
+    std::cout << "Arbol con " << cantidad << " claves, " << busquedas << " busquedas, recorridos de "
+              << tramo << " claves (ns por busqueda y por clave recorrida)" << std::endl;
+    std::cout << std::setw(9) << "pagina" << std::setw(9) << "clave" << std::setw(9) << "hijos" << std::setw(8) << "hoja"
+              << std::setw(7) << "altura" << std::setw(10) << "MB" << std::setw(10) << "carga ms"
+              << std::setw(12) << "busqueda" << std::setw(12) << "recorrido" << std::endl;
+
+    bool bien = medir<DNI_t, PAGINA_SIZE>(cantidad, busquedas, tramo) &&
+                medir<DNI_t, 4 * PAGINA_SIZE>(cantidad, busquedas, tramo) &&
+                medir<DNI_t, 16 * PAGINA_SIZE>(cantidad, busquedas, tramo) &&
+                medir<uint64_t, PAGINA_SIZE>(cantidad, busquedas, tramo) &&
+                medir<uint64_t, 4 * PAGINA_SIZE>(cantidad, busquedas, tramo) &&
+                medir<uint64_t, 16 * PAGINA_SIZE>(cantidad, busquedas, tramo);
+    return bien ? 0 : 1;
+}
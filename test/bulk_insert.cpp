@@ -70,8 +70,8 @@ Ciudadano generar_ciudadano_aleatorio(DNI_t dni) {
 }
 
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Uso: " << argv[0] << " <archivo.db> <cantidad_registros>" << std::endl;
+    if (argc < 3) {
+        std::cerr << "Uso: " << argv[0] << " <archivo.db> <cantidad_registros> [--pool <frames>] [--directo] [--sin-wal] [--sincrono] [--carga-masiva [factor]]" << std::endl;
         std::cerr << "Ejemplo: " << argv[0] << " test.db 1000000" << std::endl;
         return 1;
     }
@@ -79,6 +79,35 @@ int main(int argc, char* argv[]) {
     std::string db_path = argv[1];
     int cantidad = std::atoi(argv[2]);
 
+    // Por defecto se usa el mapeo; --pool cambia al buffer pool con la cantidad de frames indicada.
+    // Cada insercion se registra en el WAL, pero sin esperar su fdatasync: si el programa se corta
+    // se pierden las ultimas, no la base. --sincrono espera el commit de cada una.
+    OpcionesDB opciones;
+    opciones.wal.commit_sincrono = false;
+    bool usar_carga_masiva = false;
+    OpcionesCargaMasiva opciones_carga;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--pool" && i + 1 < argc) {
+            opciones.paginador.modo = ModoAlmacenamiento::BUFFER_POOL;
+            opciones.paginador.frames_buffer_pool = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--directo") {
+            opciones.paginador.io_directa = true;
+        } else if (arg == "--sin-wal") {
+            opciones.wal.activo = false;
+        } else if (arg == "--sincrono") {
+            opciones.wal.commit_sincrono = true;
+        } else if (arg == "--carga-masiva") {
+            usar_carga_masiva = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                opciones_carga.factor_llenado = std::strtod(argv[++i], nullptr);
+            }
+        } else {
+            std::cerr << "Argumento desconocido: " << arg << std::endl;
+            return 1;
+        }
+    }
+
     if (cantidad <= 0) {
         std::cerr << "Error: La cantidad debe ser mayor a 0" << std::endl;
         return 1;
@@ -89,7 +118,7 @@ int main(int argc, char* argv[]) {
     Database db;
 
     try {
-        if (!db.abrir(db_path)) {
+        if (!db.abrir(db_path, opciones)) {
             std::cerr << "Error: No se pudo abrir o crear la base de datos" << std::endl;
             return 1;
         }
@@ -103,7 +132,21 @@ int main(int argc, char* argv[]) {
         int insertados = 0;
         int fallidos = 0;
 
-        for (int i = 0; i < cantidad; i++) {
+        if (usar_carga_masiva) {
+            // Los DNIs repetidos se descartan en la carga: cuentan como fallidos
+            int generados = 0;
+            insertados = static_cast<int>(db.carga_masiva([&](Ciudadano& c) {
+                if (generados == cantidad) {
+                    return false;
+                }
+                generados++;
+                c = generar_ciudadano_aleatorio(generar_dni());
+                return true;
+            }, opciones_carga));
+            fallidos = cantidad - insertados;
+        }
+
+        for (int i = 0; i < cantidad && !usar_carga_masiva; i++) {
             DNI_t dni = generar_dni();
             Ciudadano c = generar_ciudadano_aleatorio(dni);
 
@@ -149,6 +192,31 @@ int main(int argc, char* argv[]) {
             std::cout << "Velocidad promedio: " << (insertados / duracion.count()) << " registros/segundo" << std::endl;
         }
 
+        EstadisticasPaginador stats = db.get_estadisticas_paginador();
+        std::cout << "Paginas usadas: " << stats.num_paginas
+                  << " | Capacidad: " << stats.capacidad_paginas
+                  << " | Libres: " << stats.num_paginas_libres
+                  << " | Extensiones del archivo: " << stats.num_crecimientos << std::endl;
+
+        if (opciones.paginador.modo == ModoAlmacenamiento::BUFFER_POOL) {
+            std::cout << "Buffer pool: " << stats.buffer_pool.num_frames << " frames"
+                      << " | Aciertos: " << stats.buffer_pool.aciertos
+                      << " | Fallos: " << stats.buffer_pool.fallos
+                      << " | Lecturas: " << stats.buffer_pool.lecturas
+                      << " | Escrituras: " << stats.buffer_pool.escrituras
+                      << " | Desalojos: " << stats.buffer_pool.desalojos
+                      << " | Lotes de IO: " << stats.buffer_pool.lotes_io
+                      << (stats.io_uring_activo ? " (io_uring)" : " (pread/pwrite)") << std::endl;
+        }
+
+        if (opciones.wal.activo) {
+            EstadisticasWAL stats_wal = db.get_estadisticas_wal();
+            std::cout << "WAL: " << stats_wal.registros << " registros"
+                      << " | Log: " << stats_wal.bytes_log << " bytes"
+                      << " | Escrituras: " << stats_wal.escrituras
+                      << " | fdatasync: " << stats_wal.sincronizaciones << std::endl;
+        }
+
         std::cout << "\nBase de datos cerrada correctamente." << std::endl;
 
     } catch (const std::exception& e) {
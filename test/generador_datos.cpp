@@ -120,4 +120,9 @@ void carga_masiva_test(Database& db, int cantidad) {
     if (duracion.count() > 0) {
         std::cout << "Velocidad promedio: " << (insertados / duracion.count()) << " registros/segundo\n";
     }
+
+    EstadisticasPaginador stats = db.get_estadisticas_paginador();
+    std::cout << "Paginas usadas: " << stats.num_paginas
+              << " | Capacidad: " << stats.capacidad_paginas
+              << " | Extensiones del archivo: " << stats.num_crecimientos << "\n";
 }
@@ -0,0 +1,470 @@
+#include "database.hpp"
+#include "index/bplustree.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Verificacion de la carga masiva, en MAPEO y en BUFFER_POOL:
+//  - BPlusTree::construir_desde_ordenados con distintos factores de llenado y cantidades
+//    justo en los bordes de una hoja y de un nodo interno: la forma del arbol (todas las
+//    hojas a la misma altura, cada nodo lleno hasta el factor salvo los dos ultimos de cada
+//    nivel y ninguno debajo de la mitad, las claves separadoras), la cadena de hojas,
+//    buscar, e insertar y eliminar despues de la carga. Claves desordenadas o repetidas lanzan.
+//  - Database::carga_masiva con tabla HEAP y AGRUPADA, con poca memoria de orden para que
+//    se mezclen varios tramos: con DNIs repetidos queda el primero, se encuentra cada
+//    ciudadano por DNI, por rango y por nombre, tambien despues de cerrar y abrir, no quedan
+//    archivos temporales, una carga vacia deja la base usable y cargar en una base con
+//    ciudadanos lanza
+// Termina con codigo 1 si algo falla.
+
+static int fallas = 0;
+
+#define VERIFICAR(condicion, detalle) do { \
+    if (!(condicion)) { \
+        std::cerr << "  FALLA: " << #condicion << " (" << detalle << ")" << std::endl; \
+        fallas++; \
+    } \
+} while (0)
+
+static const std::string RUTA_ARBOL = "verificar_carga_masiva.tmp";
+static const std::string RUTA_DB = "verificar_carga_masiva.db";
+static const DNI_t DNI_MAXIMO = std::numeric_limits<DNI_t>::max();
+
+using Hoja = BPlusTree::Hoja;
+using Interno = BPlusTree::Interno;
+
+static const char* nombre_modo(ModoAlmacenamiento modo) {
+    return modo == ModoAlmacenamiento::BUFFER_POOL ? "BUFFER_POOL" : "MAPEO";
+}
+
+static OpcionesPaginador opciones_paginador(ModoAlmacenamiento modo) {
+    OpcionesPaginador opciones;
+    opciones.modo = modo;
+    opciones.frames_buffer_pool = 256;
+    return opciones;
+}
+
+// === Arbol ===
+
+// Entradas por nodo que usa la carga, como en CargaAscendente
+static size_t llenado(size_t capacidad, size_t minimo, double factor_llenado) {
+    return std::clamp(static_cast<size_t>(capacidad * factor_llenado), minimo, capacidad);
+}
+
+struct FormaArbol {
+    std::vector<std::vector<size_t>> niveles; // Entradas (hojas) o hijos (internos) de cada nodo, de izquierda a derecha; niveles[0] son las hojas
+    std::vector<PaginaID> hojas;
+};
+
+// Recorre el arbol por niveles desde la raiz. Comprueba que las claves de cada subarbol
+// esten entre sus separadoras, [desde, hasta), y que todas las hojas esten a la misma altura.
+static void recorrer_forma(Paginador& paginador, PaginaID id, size_t altura, DNI_t desde, uint64_t hasta, FormaArbol& forma, const std::string& donde) {
+    PaginaFijada pagina = paginador.fijar_pagina(id);
+    if (!pagina) {
+        VERIFICAR(false, donde << ": no se pudo fijar la pagina " << id);
+        return;
+    }
+    const char* pagina_ptr = pagina.datos();
+    auto header = reinterpret_cast<const BPlusTreeHeader*>(pagina_ptr);
+    if (header->tipo == TipoNodo::Hoja) {
+        VERIFICAR(altura == 0, donde << ": hoja " << id << " a otra altura");
+        const DNI_t* claves = Hoja::claves(pagina_ptr);
+        for (int i = 0; i < header->num_claves; i++) {
+            if (claves[i] < desde || claves[i] >= hasta || (i > 0 && claves[i - 1] >= claves[i])) {
+                VERIFICAR(false, donde << ": la clave " << claves[i] << " de la hoja " << id << " esta fuera de lugar");
+                break;
+            }
+        }
+        forma.niveles[0].push_back(header->num_claves);
+        forma.hojas.push_back(id);
+        return;
+    }
+    VERIFICAR(altura > 0, donde << ": interno " << id << " en el nivel de las hojas");
+    if (altura == 0) {
+        return;
+    }
+    auto hijos = reinterpret_cast<const PaginaID*>(pagina_ptr + sizeof(BPlusTreeHeader));
+    auto claves = reinterpret_cast<const DNI_t*>(pagina_ptr + Interno::OFFSET_CLAVES);
+    forma.niveles[altura].push_back(header->num_claves + 1);
+    std::vector<PaginaID> copia_hijos(hijos, hijos + header->num_claves + 1);
+    std::vector<DNI_t> copia_claves(claves, claves + header->num_claves);
+    pagina.soltar();
+    for (size_t i = 0; i < copia_hijos.size(); i++) {
+        DNI_t desde_hijo = i == 0 ? desde : copia_claves[i - 1];
+        uint64_t hasta_hijo = i == copia_claves.size() ? hasta : copia_claves[i];
+        recorrer_forma(paginador, copia_hijos[i], altura - 1, desde_hijo, hasta_hijo, forma, donde);
+    }
+}
+
+static size_t altura_arbol(Paginador& paginador, PaginaID id) {
+    size_t altura = 0;
+    while (true) {
+        PaginaFijada pagina = paginador.fijar_pagina(id);
+        if (!pagina) {
+            return altura;
+        }
+        if (reinterpret_cast<const BPlusTreeHeader*>(pagina.datos())->tipo == TipoNodo::Hoja) {
+            return altura;
+        }
+        id = reinterpret_cast<const PaginaID*>(pagina.datos() + sizeof(BPlusTreeHeader))[0];
+        altura++;
+    }
+}
+
+// Cada nivel tiene todos sus nodos con lleno entradas, salvo los dos ultimos, que se reparten
+// lo que sobra y no bajan de minimo. La raiz puede tener menos.
+static void comprobar_nivel(const std::vector<size_t>& nodos, size_t lleno, size_t minimo, size_t maximo, const std::string& donde) {
+    if (nodos.size() == 1) {
+        VERIFICAR(nodos[0] <= maximo, donde << ": la raiz tiene " << nodos[0]);
+        return;
+    }
+    for (size_t i = 0; i < nodos.size(); i++) {
+        if (i + 2 < nodos.size()) {
+            VERIFICAR(nodos[i] == lleno, donde << ", nodo " << i << " de " << nodos.size() << ": " << nodos[i] << " en lugar de " << lleno);
+        } else {
+            VERIFICAR(nodos[i] >= minimo && nodos[i] <= maximo, donde << ", nodo " << i << " de " << nodos.size() << ": " << nodos[i]);
+        }
+    }
+}
+
+static void verificar_construccion(ModoAlmacenamiento modo, size_t cantidad, double factor_llenado) {
+    std::string donde = std::to_string(cantidad) + " claves al " + std::to_string(static_cast<int>(factor_llenado * 100)) + "%";
+    std::remove(RUTA_ARBOL.c_str());
+
+    Paginador paginador;
+    if (!paginador.abrir(RUTA_ARBOL, 10, opciones_paginador(modo))) {
+        throw std::runtime_error("No se pudo crear " + RUTA_ARBOL);
+    }
+    paginador.fijar_num_paginas(1);
+    {
+        BPlusTree arbol(paginador);
+        PaginaID raiz_vacia = arbol.inicializar(INVALID_PAGE_ID);
+
+        // Claves de tres en tres, con valores que dependen de la clave
+        std::map<DNI_t, RegistroID> referencia;
+        size_t generadas = 0;
+        PaginaID raiz_anterior = arbol.construir_desde_ordenados([&](DNI_t& clave, RegistroID& valor) {
+            if (generadas == cantidad) return false;
+            clave = static_cast<DNI_t>(1000 + 3 * generadas);
+            valor = RegistroID{static_cast<PaginaID>(clave / 5), static_cast<SlotID>(clave % 5)};
+            referencia[clave] = valor;
+            generadas++;
+            return true;
+        }, factor_llenado);
+        VERIFICAR(raiz_anterior == raiz_vacia, donde << ": devolvio " << raiz_anterior << " y la raiz anterior era " << raiz_vacia);
+
+        // Forma
+        FormaArbol forma;
+        forma.niveles.resize(altura_arbol(paginador, arbol.get_id_raiz()) + 1);
+        recorrer_forma(paginador, arbol.get_id_raiz(), forma.niveles.size() - 1, 0, uint64_t(DNI_MAXIMO) + 1, forma, donde);
+        comprobar_nivel(forma.niveles[0], llenado(Hoja::MAX_CLAVES, Hoja::MAX_CLAVES / 2, factor_llenado),
+                        Hoja::MAX_CLAVES / 2, Hoja::MAX_CLAVES, donde + ", hojas");
+        for (size_t nivel = 1; nivel < forma.niveles.size(); nivel++) {
+            comprobar_nivel(forma.niveles[nivel], llenado(Interno::ORDEN, Interno::MAX_CLAVES / 2 + 1, factor_llenado),
+                            Interno::MAX_CLAVES / 2 + 1, Interno::ORDEN, donde + ", nivel " + std::to_string(nivel));
+            VERIFICAR(forma.niveles[nivel].size() == 1 || nivel + 1 < forma.niveles.size(), donde << ": " << forma.niveles[nivel].size() << " raices");
+        }
+        size_t entradas = 0;
+        for (size_t n : forma.niveles[0]) {
+            entradas += n;
+        }
+        VERIFICAR(entradas == cantidad, donde << ": las hojas tienen " << entradas);
+
+        // La cadena de hojas sigue el orden del arbol y termina en la ultima
+        for (size_t i = 0; i < forma.hojas.size(); i++) {
+            PaginaFijada hoja = paginador.fijar_pagina(forma.hojas[i]);
+            PaginaID siguiente = *reinterpret_cast<const PaginaID*>(hoja.datos() + sizeof(BPlusTreeHeader));
+            PaginaID esperada = i + 1 < forma.hojas.size() ? forma.hojas[i + 1] : INVALID_PAGE_ID;
+            if (siguiente != esperada) {
+                VERIFICAR(siguiente == esperada, donde << ": la hoja " << i << " apunta a " << siguiente);
+                break;
+            }
+        }
+
+        // Contenido
+        auto it_ref = referencia.begin();
+        size_t recorridas = 0;
+        for (BPlusTree::Iterador it = arbol.buscar_desde(0); it.valido(); it.siguiente(), ++it_ref, recorridas++) {
+            if (it_ref == referencia.end() || it.clave() != it_ref->first || !(it.valor() == it_ref->second)) {
+                VERIFICAR(false, donde << ": el recorrido se separa en la posicion " << recorridas);
+                break;
+            }
+        }
+        VERIFICAR(recorridas == cantidad, donde << ": se recorrieron " << recorridas);
+        size_t mal = 0;
+        for (const auto& [clave, valor] : referencia) {
+            auto encontrado = arbol.buscar(clave);
+            mal += !encontrado.has_value() || !(*encontrado == valor) || arbol.buscar(clave + 1).has_value();
+        }
+        VERIFICAR(mal == 0, donde << ": " << mal << " claves mal con buscar");
+
+        // El arbol cargado sigue funcionando: entre cada par de claves, y despues se eliminan las viejas
+        std::mt19937 gen(static_cast<unsigned>(cantidad));
+        for (int i = 0; i < 3000 && cantidad > 0; i++) {
+            DNI_t clave = static_cast<DNI_t>(1000 + 3 * (gen() % cantidad) + 1 + gen() % 2);
+            RegistroID valor{clave, 1};
+            if (arbol.insertar(clave, valor)) {
+                VERIFICAR(referencia.emplace(clave, valor).second, donde << ": la clave " << clave << " se inserto dos veces");
+            }
+        }
+        for (auto it = referencia.begin(); it != referencia.end();) {
+            if (it->first % 3 == 1 && gen() % 2 == 0) {
+                VERIFICAR(arbol.eliminar(it->first), donde << ": eliminar " << it->first);
+                it = referencia.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        it_ref = referencia.begin();
+        recorridas = 0;
+        for (BPlusTree::Iterador it = arbol.buscar_desde(0); it.valido(); it.siguiente(), ++it_ref, recorridas++) {
+            if (it_ref == referencia.end() || it.clave() != it_ref->first || !(it.valor() == it_ref->second)) {
+                VERIFICAR(false, donde << ": despues de insertar y eliminar, el recorrido se separa en la posicion " << recorridas);
+                break;
+            }
+        }
+        VERIFICAR(recorridas == referencia.size(), donde << ": despues de insertar y eliminar se recorrieron " << recorridas << " de " << referencia.size());
+    }
+    paginador.cerrar();
+    std::remove(RUTA_ARBOL.c_str());
+}
+
+// La entrada tiene que venir en orden estrictamente creciente
+static void verificar_entrada_invalida(ModoAlmacenamiento modo, const std::vector<DNI_t>& claves, const std::string& donde) {
+    std::remove(RUTA_ARBOL.c_str());
+    Paginador paginador;
+    if (!paginador.abrir(RUTA_ARBOL, 10, opciones_paginador(modo))) {
+        throw std::runtime_error("No se pudo crear " + RUTA_ARBOL);
+    }
+    paginador.fijar_num_paginas(1);
+    {
+        BPlusTree arbol(paginador);
+        arbol.inicializar(INVALID_PAGE_ID);
+        size_t i = 0;
+        bool lanzo = false;
+        try {
+            arbol.construir_desde_ordenados([&](DNI_t& clave, RegistroID& valor) {
+                if (i == claves.size()) return false;
+                clave = claves[i++];
+                valor = RegistroID{clave, 0};
+                return true;
+            }, 0.9);
+        } catch (const std::runtime_error&) {
+            lanzo = true;
+        }
+        VERIFICAR(lanzo, donde << ": no lanzo");
+    }
+    paginador.cerrar();
+    std::remove(RUTA_ARBOL.c_str());
+}
+
+static void verificar_arbol(ModoAlmacenamiento modo) {
+    std::cout << "BPlusTree::construir_desde_ordenados, " << nombre_modo(modo) << std::endl;
+
+    // En los bordes de una hoja (y de dos, donde la carga empieza a escribir) y de un nodo
+    // interno, para los factores extremos y uno del medio
+    const size_t hoja = Hoja::MAX_CLAVES;
+    for (double factor_llenado : {0.5, 0.9, 1.0}) {
+        size_t lleno = llenado(Hoja::MAX_CLAVES, Hoja::MAX_CLAVES / 2, factor_llenado);
+        size_t interno = llenado(Interno::ORDEN, Interno::MAX_CLAVES / 2 + 1, factor_llenado);
+        for (size_t cantidad : {size_t(0), size_t(1), size_t(2), hoja - 1, hoja, hoja + 1,
+                                2 * lleno, 2 * lleno + 1, 2 * lleno + 2, 5 * lleno + 7,
+                                lleno * interno, lleno * (2 * interno + 1), lleno * (2 * interno + 1) + 1,
+                                lleno * interno * 3 + 11}) {
+            verificar_construccion(modo, cantidad, factor_llenado);
+        }
+    }
+
+    verificar_entrada_invalida(modo, {5, 9, 7}, "desordenada");
+    verificar_entrada_invalida(modo, {5, 7, 7, 9}, "repetida");
+    std::vector<DNI_t> larga;
+    for (DNI_t i = 0; i < 5000; i++) {
+        larga.push_back(i == 4000 ? 10 : 100 + i);
+    }
+    verificar_entrada_invalida(modo, larga, "desordenada despues de varias hojas");
+}
+
+// === Database::carga_masiva ===
+
+static Ciudadano ciudadano(DNI_t dni, int version) {
+    return Ciudadano(dni, "Nombre " + std::to_string(dni), "Apellido " + std::to_string(dni % 997),
+                     "Calle " + std::to_string(version));
+}
+
+static bool iguales(const Ciudadano& a, const Ciudadano& b) {
+    return a.dni == b.dni && a.nombres == b.nombres && a.apellidos == b.apellidos && a.direccion == b.direccion;
+}
+
+static void borrar_db() {
+    std::remove(RUTA_DB.c_str());
+    std::remove((RUTA_DB + ".wal").c_str());
+    std::remove((RUTA_DB + ".wal.1").c_str());
+}
+
+// Archivos que empiezan con la ruta de la base y no son la base ni su WAL
+static size_t archivos_temporales() {
+    size_t temporales = 0;
+    for (const auto& entrada : std::filesystem::directory_iterator(".")) {
+        std::string nombre = entrada.path().filename().string();
+        if (nombre.rfind(RUTA_DB + ".carga", 0) == 0) {
+            temporales++;
+        }
+    }
+    return temporales;
+}
+
+static void comprobar_db(Database& db, const std::map<DNI_t, Ciudadano>& referencia, const std::string& donde) {
+    size_t mal = 0;
+    for (const auto& [dni, esperado] : referencia) {
+        auto encontrado = db.buscar_ciudadano(dni);
+        mal += !encontrado.has_value() || !iguales(*encontrado, esperado);
+    }
+    VERIFICAR(mal == 0, donde << ": " << mal << " ciudadanos mal con buscar_ciudadano");
+
+    auto it_ref = referencia.begin();
+    size_t fuera_de_lugar = 0;
+    size_t visitados = db.buscar_rango(0, DNI_MAXIMO, [&](const Ciudadano& c) {
+        fuera_de_lugar += it_ref == referencia.end() || !iguales(c, it_ref->second);
+        if (it_ref != referencia.end()) ++it_ref;
+        return true;
+    });
+    VERIFICAR(visitados == referencia.size() && fuera_de_lugar == 0,
+              donde << ": buscar_rango visito " << visitados << " de " << referencia.size() << ", " << fuera_de_lugar << " fuera de lugar");
+
+    size_t por_nombre = db.buscar_por_nombre("", "", [](const Ciudadano&) { return true; });
+    VERIFICAR(por_nombre == referencia.size(), donde << ": buscar_por_nombre visito " << por_nombre << " de " << referencia.size());
+    if (!referencia.empty()) {
+        const Ciudadano& alguno = referencia.begin()->second;
+        size_t mismos = 0;
+        for (const auto& [dni, c] : referencia) {
+            mismos += c.apellidos.rfind(alguno.apellidos, 0) == 0; // Por prefijo
+        }
+        size_t encontrados = db.buscar_por_nombre(alguno.apellidos, "", [](const Ciudadano&) { return true; });
+        VERIFICAR(encontrados == mismos, donde << ": " << encontrados << " con apellidos " << alguno.apellidos << " en lugar de " << mismos);
+    }
+}
+
+static void verificar_db(ModoAlmacenamiento modo, ModoTabla tabla, size_t cantidad) {
+    std::string donde = std::string(nombre_modo(modo)) + ", " + (tabla == ModoTabla::AGRUPADA ? "AGRUPADA" : "HEAP");
+    std::cout << "Database::carga_masiva, " << donde << std::endl;
+    borrar_db();
+
+    OpcionesDB opciones;
+    opciones.modo_tabla = tabla;
+    opciones.paginador = opciones_paginador(modo);
+    OpcionesCargaMasiva opciones_carga;
+    opciones_carga.memoria_orden = 256 << 10; // Varios tramos que mezclar
+    opciones_carga.factor_llenado = 0.8;
+
+    // DNIs al azar, con repetidos: queda el primero de cada uno
+    std::mt19937 gen(13);
+    std::vector<Ciudadano> entrada;
+    std::map<DNI_t, Ciudadano> referencia;
+    for (size_t i = 0; i < cantidad; i++) {
+        DNI_t dni = static_cast<DNI_t>(10000000 + gen() % (2 * cantidad));
+        entrada.push_back(ciudadano(dni, static_cast<int>(i)));
+        referencia.emplace(dni, entrada.back());
+    }
+
+    {
+        Database db;
+        if (!db.abrir(RUTA_DB, opciones)) {
+            throw std::runtime_error("No se pudo abrir " + RUTA_DB);
+        }
+        size_t i = 0;
+        size_t cargados = db.carga_masiva([&](Ciudadano& c) {
+            if (i == entrada.size()) return false;
+            c = entrada[i++];
+            return true;
+        }, opciones_carga);
+        VERIFICAR(cargados == referencia.size(), donde << ": cargo " << cargados << " de " << referencia.size());
+        VERIFICAR(archivos_temporales() == 0, donde << ": quedaron " << archivos_temporales() << " archivos temporales");
+        comprobar_db(db, referencia, donde + ", recien cargada");
+
+        bool lanzo = false;
+        try {
+            db.carga_masiva([](Ciudadano&) { return false; }, opciones_carga);
+        } catch (const std::runtime_error&) {
+            lanzo = true;
+        }
+        VERIFICAR(lanzo, donde << ": cargar en una base con ciudadanos no lanzo");
+    }
+    {
+        Database db;
+        if (!db.abrir(RUTA_DB, opciones)) {
+            throw std::runtime_error("No se pudo abrir " + RUTA_DB);
+        }
+        comprobar_db(db, referencia, donde + ", al abrir");
+
+        // Sigue funcionando: insertar, modificar y eliminar
+        for (int i = 0; i < 2000; i++) {
+            DNI_t dni = static_cast<DNI_t>(10000000 + gen() % (3 * cantidad));
+            auto it = referencia.find(dni);
+            if (it == referencia.end()) {
+                VERIFICAR(db.insertar_ciudadano(ciudadano(dni, -1)), donde << ": insertar " << dni);
+                referencia.emplace(dni, ciudadano(dni, -1));
+            } else if (i % 2 == 0) {
+                VERIFICAR(db.modificar_ciudadano(ciudadano(dni, -2)), donde << ": modificar " << dni);
+                it->second = ciudadano(dni, -2);
+            } else {
+                VERIFICAR(db.eliminar_ciudadano(dni), donde << ": eliminar " << dni);
+                referencia.erase(it);
+            }
+        }
+        comprobar_db(db, referencia, donde + ", despues de cambios");
+    }
+    {
+        Database db;
+        if (!db.abrir(RUTA_DB, opciones)) {
+            throw std::runtime_error("No se pudo abrir " + RUTA_DB);
+        }
+        comprobar_db(db, referencia, donde + ", al abrir despues de cambios");
+    }
+    borrar_db();
+
+    // Una carga sin ciudadanos deja la base vacia y usable
+    {
+        Database db;
+        if (!db.abrir(RUTA_DB, opciones)) {
+            throw std::runtime_error("No se pudo abrir " + RUTA_DB);
+        }
+        size_t cargados = db.carga_masiva([](Ciudadano&) { return false; }, opciones_carga);
+        VERIFICAR(cargados == 0, donde << ": carga vacia cargo " << cargados);
+        std::map<DNI_t, Ciudadano> pocos;
+        comprobar_db(db, pocos, donde + ", carga vacia");
+        for (DNI_t dni : {30000000u, 30000001u, 29999999u}) {
+            VERIFICAR(db.insertar_ciudadano(ciudadano(dni, 0)), donde << ": insertar " << dni << " despues de una carga vacia");
+            pocos.emplace(dni, ciudadano(dni, 0));
+        }
+        comprobar_db(db, pocos, donde + ", carga vacia e inserciones");
+    }
+    borrar_db();
+}
+
+int main(int argc, char* argv[]) {
+    size_t cantidad = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+
+    try {
+        for (ModoAlmacenamiento modo : {ModoAlmacenamiento::MAPEO, ModoAlmacenamiento::BUFFER_POOL}) {
+            verificar_arbol(modo);
+            for (ModoTabla tabla : {ModoTabla::HEAP, ModoTabla::AGRUPADA}) {
+                verificar_db(modo, tabla, cantidad);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::remove(RUTA_ARBOL.c_str());
+        borrar_db();
+        return 1;
+    }
+
+    std::cout << (fallas == 0 ? "Todo bien" : std::to_string(fallas) + " fallas") << std::endl;
+    return fallas == 0 ? 0 : 1;
+}
@@ -0,0 +1,365 @@
+#include "database.hpp"
+#include "index/bplustree.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Verificacion de los recorridos por la cadena de hojas, en MAPEO y en BUFFER_POOL (con pocos
+// frames, para que el iterador tenga que pedir las hojas al disco):
+//  - BPlusTree::Iterador contra un std::map: buscar_desde y buscar_hasta en cualquier clave,
+//    siguiente y anterior en los dos extremos de la cadena, y lo mismo despues de vaciar
+//    bloques enteros de hojas, de eliminar casi todo y de eliminar todo
+//  - Database::buscar_rango con tabla HEAP y AGRUPADA: cada rango devuelve los mismos
+//    ciudadanos que buscar_ciudadano uno por uno, los rangos vacios no visitan a nadie y
+//    cortar el recorrido devuelve cuantos se visitaron
+// Termina con codigo 1 si algo falla.
+
+static int fallas = 0;
+
+#define VERIFICAR(condicion, detalle) do { \
+    if (!(condicion)) { \
+        std::cerr << "  FALLA: " << #condicion << " (" << detalle << ")" << std::endl; \
+        fallas++; \
+    } \
+} while (0)
+
+static const std::string RUTA_ARBOL = "verificar_iterador.tmp";
+static const std::string RUTA_DB = "verificar_iterador.db";
+static const DNI_t DNI_MAXIMO = std::numeric_limits<DNI_t>::max();
+
+using Entradas = std::vector<std::pair<DNI_t, RegistroID>>;
+
+static const char* nombre_modo(ModoAlmacenamiento modo) {
+    return modo == ModoAlmacenamiento::BUFFER_POOL ? "BUFFER_POOL" : "MAPEO";
+}
+
+static OpcionesPaginador opciones_paginador(ModoAlmacenamiento modo) {
+    OpcionesPaginador opciones;
+    opciones.modo = modo;
+    opciones.frames_buffer_pool = 64;
+    return opciones;
+}
+
+// === Iterador del arbol ===
+
+// El iterador tiene que estar en orden[indice], o invalido si el indice cae fuera
+static bool comparar(const BPlusTree::Iterador& it, const Entradas& orden, long indice, const std::string& donde) {
+    bool esperado = indice >= 0 && indice < static_cast<long>(orden.size());
+    VERIFICAR(it.valido() == esperado, donde << ", posicion " << indice << " de " << orden.size());
+    if (!esperado || !it.valido()) {
+        return false;
+    }
+    VERIFICAR(it.clave() == orden[indice].first, donde << ": clave " << it.clave() << " en lugar de " << orden[indice].first);
+    VERIFICAR(it.valor() == orden[indice].second, donde << ": valor de la clave " << orden[indice].first);
+    return it.clave() == orden[indice].first;
+}
+
+// Desde orden[indice], pasos hacia adelante y despues el doble hacia atras
+static void caminar(BPlusTree::Iterador& it, const Entradas& orden, long indice, int pasos, const std::string& donde) {
+    if (!comparar(it, orden, indice, donde)) {
+        return;
+    }
+    for (int i = 0; i < pasos; i++) {
+        it.siguiente();
+        if (!comparar(it, orden, ++indice, donde + ", siguiente")) {
+            return;
+        }
+    }
+    for (int i = 0; i < 2 * pasos; i++) {
+        it.anterior();
+        if (!comparar(it, orden, --indice, donde + ", anterior")) {
+            return;
+        }
+    }
+}
+
+static void comprobar_arbol(BPlusTree& arbol, const std::map<DNI_t, RegistroID>& referencia, std::mt19937& gen, const std::string& etapa) {
+    Entradas orden(referencia.begin(), referencia.end());
+    const long n = static_cast<long>(orden.size());
+
+    // La cadena completa, de ida y de vuelta
+    long indice = 0;
+    BPlusTree::Iterador it = arbol.buscar_desde(0);
+    while (it.valido() && comparar(it, orden, indice, etapa + ", de ida")) {
+        it.siguiente();
+        indice++;
+    }
+    VERIFICAR(indice == n && !it.valido(), etapa << ": de ida se recorrieron " << indice << " de " << n);
+
+    indice = n - 1;
+    it = arbol.buscar_hasta(DNI_MAXIMO);
+    while (it.valido() && comparar(it, orden, indice, etapa + ", de vuelta")) {
+        it.anterior();
+        indice--;
+    }
+    VERIFICAR(indice == -1 && !it.valido(), etapa << ": de vuelta faltaron " << indice + 1);
+
+    if (n == 0) {
+        VERIFICAR(!arbol.buscar_desde(0).valido(), etapa << ": arbol vacio");
+        VERIFICAR(!arbol.buscar_hasta(DNI_MAXIMO).valido(), etapa << ": arbol vacio");
+        return;
+    }
+
+    // Los extremos: antes de la primera y despues de la ultima no hay nada
+    DNI_t primera = orden.front().first;
+    DNI_t ultima = orden.back().first;
+    it = arbol.buscar_desde(primera);
+    comparar(it, orden, 0, etapa + ", buscar_desde la primera");
+    it.anterior();
+    comparar(it, orden, -1, etapa + ", anterior a la primera");
+    it = arbol.buscar_hasta(ultima);
+    comparar(it, orden, n - 1, etapa + ", buscar_hasta la ultima");
+    it.siguiente();
+    comparar(it, orden, n, etapa + ", siguiente a la ultima");
+    if (primera > 0) {
+        comparar(arbol.buscar_hasta(primera - 1), orden, -1, etapa + ", buscar_hasta antes de la primera");
+        comparar(arbol.buscar_desde(0), orden, 0, etapa + ", buscar_desde 0");
+    }
+    if (ultima < DNI_MAXIMO) {
+        comparar(arbol.buscar_desde(ultima + 1), orden, n, etapa + ", buscar_desde despues de la ultima");
+        comparar(arbol.buscar_hasta(DNI_MAXIMO), orden, n - 1, etapa + ", buscar_hasta el maximo");
+    }
+
+    // Claves al azar, esten o no, y algunos pasos para cada lado desde ahi
+    std::uniform_int_distribution<DNI_t> clave_al_azar(primera > 1000 ? primera - 1000 : 0, ultima + 1000);
+    for (int i = 0; i < 2000; i++) {
+        DNI_t clave = clave_al_azar(gen);
+        int pasos = static_cast<int>(gen() % 600);
+        long desde = std::lower_bound(orden.begin(), orden.end(), std::make_pair(clave, RegistroID{0, 0}),
+            [](const auto& a, const auto& b) { return a.first < b.first; }) - orden.begin();
+        BPlusTree::Iterador it_desde = arbol.buscar_desde(clave);
+        caminar(it_desde, orden, desde, pasos, etapa + ", buscar_desde " + std::to_string(clave));
+
+        long hasta = std::upper_bound(orden.begin(), orden.end(), std::make_pair(clave, RegistroID{0, 0}),
+            [](const auto& a, const auto& b) { return a.first < b.first; }) - orden.begin() - 1;
+        BPlusTree::Iterador it_hasta = arbol.buscar_hasta(clave);
+        caminar(it_hasta, orden, hasta, pasos, etapa + ", buscar_hasta " + std::to_string(clave));
+    }
+}
+
+static void verificar_arbol(ModoAlmacenamiento modo, size_t cantidad) {
+    std::cout << "BPlusTree::Iterador, " << nombre_modo(modo) << std::endl;
+    std::remove(RUTA_ARBOL.c_str());
+
+    Paginador paginador;
+    if (!paginador.abrir(RUTA_ARBOL, 10, opciones_paginador(modo))) {
+        throw std::runtime_error("No se pudo crear " + RUTA_ARBOL);
+    }
+    paginador.fijar_num_paginas(1);
+    {
+        BPlusTree arbol(paginador);
+        arbol.inicializar(INVALID_PAGE_ID);
+        std::map<DNI_t, RegistroID> referencia;
+        std::mt19937 gen(12);
+
+        comprobar_arbol(arbol, referencia, gen, "vacio");
+
+        // Claves separadas en promedio por 10, para que muchas busquedas caigan entre dos
+        const DNI_t base = 10000000;
+        const DNI_t ancho = static_cast<DNI_t>(10 * cantidad);
+        while (referencia.size() < cantidad) {
+            DNI_t clave = base + gen() % ancho;
+            RegistroID valor{static_cast<PaginaID>(clave / 7), static_cast<SlotID>(clave % 7)};
+            if (arbol.insertar(clave, valor)) {
+                referencia[clave] = valor;
+            }
+        }
+        comprobar_arbol(arbol, referencia, gen, "lleno");
+
+        // Bloques enteros de claves, para que queden hojas vacias en el medio de la cadena, y
+        // los dos extremos de la cadena
+        auto eliminar_entre = [&](DNI_t desde, DNI_t hasta) {
+            for (auto it = referencia.lower_bound(desde); it != referencia.end() && it->first <= hasta;) {
+                VERIFICAR(arbol.eliminar(it->first), "clave " << it->first);
+                it = referencia.erase(it);
+            }
+        };
+        std::vector<std::pair<DNI_t, DNI_t>> bloques;
+        for (int i = 0; i < 20; i++) {
+            DNI_t desde = base + gen() % ancho;
+            bloques.emplace_back(desde, desde + ancho / 100);
+            eliminar_entre(desde, desde + ancho / 100);
+        }
+        eliminar_entre(0, base + ancho / 20);
+        eliminar_entre(base + ancho - ancho / 20, DNI_MAXIMO);
+        comprobar_arbol(arbol, referencia, gen, "sin bloques");
+
+        // Un rango sin claves: buscar_desde su principio salta a la primera despues, y
+        // buscar_hasta su final vuelve a la ultima antes
+        for (const auto& bloque : bloques) {
+            auto despues = referencia.upper_bound(bloque.second);
+            BPlusTree::Iterador it = arbol.buscar_desde(bloque.first);
+            VERIFICAR(it.valido() == (despues != referencia.end()), "bloque " << bloque.first);
+            if (it.valido() && despues != referencia.end()) {
+                VERIFICAR(it.clave() == despues->first, "bloque " << bloque.first << ": " << it.clave());
+            }
+            auto antes = referencia.lower_bound(bloque.first);
+            it = arbol.buscar_hasta(bloque.second);
+            VERIFICAR(it.valido() == (antes != referencia.begin()), "bloque " << bloque.second);
+            if (it.valido() && antes != referencia.begin()) {
+                VERIFICAR(it.clave() == std::prev(antes)->first, "bloque " << bloque.second << ": " << it.clave());
+            }
+        }
+
+        // Casi todo, al azar: quedan hojas con muy pocas entradas
+        for (auto it = referencia.begin(); it != referencia.end();) {
+            if (gen() % 20 != 0) {
+                VERIFICAR(arbol.eliminar(it->first), "clave " << it->first);
+                it = referencia.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        comprobar_arbol(arbol, referencia, gen, "casi vacio");
+
+        eliminar_entre(0, DNI_MAXIMO);
+        comprobar_arbol(arbol, referencia, gen, "vaciado");
+
+        for (DNI_t clave : {base, base + 1, base + 5}) {
+            RegistroID valor{clave, 0};
+            arbol.insertar(clave, valor);
+            referencia[clave] = valor;
+        }
+        comprobar_arbol(arbol, referencia, gen, "vaciado y con tres claves");
+    }
+    paginador.cerrar();
+    std::remove(RUTA_ARBOL.c_str());
+}
+
+// === Database::buscar_rango ===
+
+static Ciudadano ciudadano(DNI_t dni) {
+    return Ciudadano(dni, "Nombre " + std::to_string(dni), "Apellido " + std::to_string(dni % 1000),
+                     "Calle " + std::to_string(dni % 7919));
+}
+
+static bool iguales(const Ciudadano& a, const Ciudadano& b) {
+    return a.dni == b.dni && a.nombres == b.nombres && a.apellidos == b.apellidos && a.direccion == b.direccion;
+}
+
+static void borrar_db() {
+    std::remove(RUTA_DB.c_str());
+    std::remove((RUTA_DB + ".wal").c_str());
+    std::remove((RUTA_DB + ".wal.1").c_str());
+}
+
+// Lo que visita buscar_rango: en orden, los mismos DNIs que la referencia, y cada uno igual
+// a lo que devuelve buscar_ciudadano
+static void comprobar_rango(Database& db, const std::set<DNI_t>& referencia, DNI_t desde, DNI_t hasta) {
+    std::vector<Ciudadano> visitados;
+    size_t devuelto = db.buscar_rango(desde, hasta, [&](const Ciudadano& c) {
+        visitados.push_back(c);
+        return true;
+    });
+    std::string rango = "[" + std::to_string(desde) + ", " + std::to_string(hasta) + "]";
+    VERIFICAR(devuelto == visitados.size(), rango << ": devolvio " << devuelto << " y visito " << visitados.size());
+
+    std::vector<DNI_t> esperados;
+    if (desde <= hasta) {
+        esperados.assign(referencia.lower_bound(desde), referencia.upper_bound(hasta));
+    }
+    VERIFICAR(visitados.size() == esperados.size(), rango << ": " << visitados.size() << " en lugar de " << esperados.size());
+    for (size_t i = 0; i < std::min(visitados.size(), esperados.size()); i++) {
+        if (visitados[i].dni != esperados[i]) {
+            VERIFICAR(visitados[i].dni == esperados[i], rango << ", posicion " << i);
+            return;
+        }
+        auto puntual = db.buscar_ciudadano(visitados[i].dni);
+        if (!puntual.has_value() || !iguales(*puntual, visitados[i]) || !iguales(visitados[i], ciudadano(esperados[i]))) {
+            VERIFICAR(false, rango << ": el DNI " << esperados[i] << " no es igual que con buscar_ciudadano");
+            return;
+        }
+    }
+}
+
+static void comprobar_db(Database& db, size_t cantidad) {
+    std::set<DNI_t> referencia;
+    std::mt19937 gen(13);
+
+    comprobar_rango(db, referencia, 0, DNI_MAXIMO);
+
+    const DNI_t base = 20000000;
+    const DNI_t ancho = static_cast<DNI_t>(10 * cantidad);
+    std::vector<Ciudadano> lote;
+    for (size_t i = 0; i < cantidad; i++) {
+        lote.push_back(ciudadano(base + gen() % ancho));
+    }
+    db.insertar_lote(lote);
+    for (const Ciudadano& c : lote) {
+        referencia.insert(c.dni);
+    }
+
+    // Un bloque del medio sin ciudadanos
+    DNI_t hueco_desde = base + ancho / 2;
+    DNI_t hueco_hasta = hueco_desde + ancho / 50;
+    for (auto it = referencia.lower_bound(hueco_desde); it != referencia.end() && *it <= hueco_hasta;) {
+        VERIFICAR(db.eliminar_ciudadano(*it), "DNI " << *it);
+        it = referencia.erase(it);
+    }
+
+    comprobar_rango(db, referencia, 0, DNI_MAXIMO);
+    for (int i = 0; i < 300; i++) {
+        DNI_t desde = base + gen() % ancho;
+        comprobar_rango(db, referencia, desde, desde + gen() % (ancho / 20));
+    }
+
+    // Rangos vacios: al reves, dentro del hueco, antes del primero y despues del ultimo
+    comprobar_rango(db, referencia, base + 100, base);
+    comprobar_rango(db, referencia, hueco_desde, hueco_hasta);
+    comprobar_rango(db, referencia, 0, *referencia.begin() - 1);
+    comprobar_rango(db, referencia, *referencia.rbegin() + 1, DNI_MAXIMO);
+    comprobar_rango(db, referencia, *referencia.begin(), *referencia.begin());
+
+    // Cortar el recorrido
+    size_t llamadas = 0;
+    size_t devuelto = db.buscar_rango(0, DNI_MAXIMO, [&](const Ciudadano&) { return ++llamadas < 3; });
+    VERIFICAR(llamadas == 3 && devuelto == 3, "visito " << llamadas << " y devolvio " << devuelto);
+}
+
+static void verificar_rangos(ModoAlmacenamiento modo, ModoTabla tabla, size_t cantidad) {
+    std::cout << "Database::buscar_rango, " << nombre_modo(modo) << ", "
+              << (tabla == ModoTabla::AGRUPADA ? "AGRUPADA" : "HEAP") << std::endl;
+    borrar_db();
+
+    OpcionesDB opciones;
+    opciones.modo_tabla = tabla;
+    opciones.paginador = opciones_paginador(modo);
+
+    {
+        Database db;
+        if (!db.abrir(RUTA_DB, opciones)) {
+            throw std::runtime_error("No se pudo abrir " + RUTA_DB);
+        }
+        comprobar_db(db, cantidad);
+    }
+    borrar_db();
+}
+
+int main(int argc, char* argv[]) {
+    size_t cantidad = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000;
+
+    try {
+        for (ModoAlmacenamiento modo : {ModoAlmacenamiento::MAPEO, ModoAlmacenamiento::BUFFER_POOL}) {
+            verificar_arbol(modo, cantidad);
+            for (ModoTabla tabla : {ModoTabla::HEAP, ModoTabla::AGRUPADA}) {
+                verificar_rangos(modo, tabla, cantidad);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        std::remove(RUTA_ARBOL.c_str());
+        borrar_db();
+        return 1;
+    }
+
+    std::cout << (fallas == 0 ? "Todo bien" : std::to_string(fallas) + " fallas") << std::endl;
+    return fallas == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+#include "database.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+// Verificacion de Database::vacuum. Para cada combinacion de WAL, modo de almacenamiento, modo
+// de tabla y modo de vacuum: inserta ciudadanos, elimina los primeros dos tercios, hace vacuum
+// y comprueba que
+//  - el archivo no vuelve a crecer al cerrar, ni al abrir y cerrar de nuevo (el filtro de DNIs
+//    y lo demas que la base guarda al cerrar ya tiene su lugar)
+//  - ResultadoVacuum dice lo que se achico el archivo mas lo perforado
+//  - estan los ciudadanos que quedaron y no los eliminados
+// Termina con codigo 1 si algo falla.
+
+static int fallas = 0;
+
+#define VERIFICAR(condicion, detalle) do { \
+    if (!(condicion)) { \
+        std::cerr << "  FALLA: " << #condicion << " (" << detalle << ")" << std::endl; \
+        fallas++; \
+    } \
+} while (0)
+
+static const std::string RUTA = "verificar_vacuum.db";
+
+static void borrar_archivos() {
+    std::remove(RUTA.c_str());
+    std::remove((RUTA + ".wal").c_str());
+    std::remove((RUTA + ".wal.1").c_str());
+}
+
+static size_t size_archivo() {
+    return static_cast<size_t>(std::filesystem::file_size(RUTA));
+}
+
+static Ciudadano ciudadano(DNI_t dni) {
+    return Ciudadano(dni, "Rosa Maria", "Huaman Ccori", "Jr. Ayacucho " + std::to_string(dni % 900 + 100));
+}
+
+static void abrir(Database& db, const OpcionesDB& opciones) {
+    if (!db.abrir(RUTA, opciones)) {
+        throw std::runtime_error("No se pudo abrir " + RUTA);
+    }
+}
+
+static void comprobar_contenido(Database& db, const std::set<DNI_t>& quedan, const std::vector<DNI_t>& eliminados) {
+    size_t faltan = 0;
+    for (DNI_t dni : quedan) {
+        auto encontrado = db.buscar_ciudadano(dni);
+        if (!encontrado.has_value() || encontrado->direccion != ciudadano(dni).direccion) {
+            faltan++;
+        }
+    }
+    size_t sobran = 0;
+    for (DNI_t dni : eliminados) {
+        sobran += db.buscar_ciudadano(dni).has_value();
+    }
+    VERIFICAR(faltan == 0, faltan << " ciudadanos que quedaron no se encuentran");
+    VERIFICAR(sobran == 0, sobran << " ciudadanos eliminados se siguen encontrando");
+}
+
+static void verificar(bool wal, ModoAlmacenamiento modo, ModoTabla tabla, ModoVacuum modo_vacuum, size_t cantidad) {
+    std::cout << (wal ? "con WAL" : "sin WAL") << ", "
+              << (modo == ModoAlmacenamiento::BUFFER_POOL ? "BUFFER_POOL" : "MAPEO") << ", "
+              << (tabla == ModoTabla::AGRUPADA ? "AGRUPADA" : "HEAP") << ", "
+              << (modo_vacuum == ModoVacuum::COMPACTAR ? "COMPACTAR" : "SOLO_PERFORAR") << std::endl;
+    borrar_archivos();
+
+    OpcionesDB opciones;
+    opciones.wal.activo = wal;
+    opciones.modo_tabla = tabla;
+    opciones.paginador.modo = modo;
+    opciones.paginador.frames_buffer_pool = 1024;
+
+    std::mt19937 gen(17);
+    std::set<DNI_t> quedan;
+    std::vector<DNI_t> eliminados;
+    {
+        // De a uno, asi las paginas de datos quedan en el orden de insercion
+        Database db;
+        abrir(db, opciones);
+        std::vector<DNI_t> insertados;
+        while (insertados.size() < cantidad) {
+            DNI_t dni = static_cast<DNI_t>(10000000 + gen() % 80000000);
+            if (db.insertar_ciudadano(ciudadano(dni))) {
+                insertados.push_back(dni);
+            }
+        }
+        // Los primeros dos tercios se eliminan: las paginas de datos del principio quedan
+        // libres y las hojas, con los DNIs al azar, a medio llenar
+        for (size_t i = 0; i < insertados.size(); i++) {
+            if (i < insertados.size() * 2 / 3) {
+                VERIFICAR(db.eliminar_ciudadano(insertados[i]), "DNI " << insertados[i]);
+                eliminados.push_back(insertados[i]);
+            } else {
+                quedan.insert(insertados[i]);
+            }
+        }
+    }
+
+    size_t antes = size_archivo();
+    size_t despues_vacuum;
+    ResultadoVacuum resultado;
+    {
+        Database db;
+        abrir(db, opciones);
+        resultado = db.vacuum(modo_vacuum);
+        despues_vacuum = size_archivo();
+    }
+    size_t al_cerrar = size_archivo();
+    {
+        Database db;
+        abrir(db, opciones);
+        comprobar_contenido(db, quedan, eliminados);
+    }
+    size_t al_reabrir = size_archivo();
+
+    std::cout << "  " << antes << " bytes antes, " << despues_vacuum << " despues de vacuum, "
+              << al_cerrar << " al cerrar, " << al_reabrir << " al abrir y cerrar otra vez; "
+              << resultado.paginas_perforadas << " perforadas, " << resultado.bytes_recuperados << " bytes recuperados" << std::endl;
+    if (modo_vacuum == ModoVacuum::COMPACTAR) {
+        VERIFICAR(despues_vacuum < antes, "vacuum no achico el archivo");
+        VERIFICAR(resultado.paginas_perforadas == 0, resultado.paginas_perforadas);
+    } else if (tabla == ModoTabla::HEAP) {
+        // Las paginas de datos del principio quedaron libres en el medio del archivo. En la
+        // tabla agrupada las hojas a medio llenar no se liberan: puede no haber nada que perforar
+        VERIFICAR(resultado.paginas_perforadas > 0, "vacuum no perforo ninguna pagina");
+    }
+    size_t achicado = antes > despues_vacuum ? antes - despues_vacuum : 0;
+    VERIFICAR(resultado.bytes_recuperados == achicado + resultado.paginas_perforadas * PAGINA_SIZE,
+              "el archivo se achico " << achicado << " bytes");
+    VERIFICAR(al_cerrar == despues_vacuum, "el archivo crecio al cerrar");
+    VERIFICAR(al_reabrir == despues_vacuum, "el archivo crecio al abrir y cerrar");
+
+    borrar_archivos();
+}
+
+int main(int argc, char* argv[]) {
+    size_t cantidad = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+
+    try {
+        for (bool wal : {false, true}) {
+            for (ModoAlmacenamiento modo : {ModoAlmacenamiento::MAPEO, ModoAlmacenamiento::BUFFER_POOL}) {
+                for (ModoTabla tabla : {ModoTabla::HEAP, ModoTabla::AGRUPADA}) {
+                    for (ModoVacuum modo_vacuum : {ModoVacuum::COMPACTAR, ModoVacuum::SOLO_PERFORAR}) {
+                        verificar(wal, modo, tabla, modo_vacuum, cantidad);
+                    }
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        borrar_archivos();
+        return 1;
+    }
+
+    std::cout << (fallas == 0 ? "Todo bien" : std::to_string(fallas) + " fallas") << std::endl;
+    return fallas == 0 ? 0 : 1;
+}